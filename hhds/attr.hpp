@@ -1,11 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstdint>
 #include <functional>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <ostream>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -24,6 +28,7 @@
 #include <mutex>
 #endif
 
+#include "hhds/function_ref.hpp"
 #include "hhds/graph_sizing.hpp"
 
 namespace hhds {
@@ -40,7 +45,8 @@ concept Attribute = requires {
 
 // Optional per-tag layout policy (`using layout = hhds::dense_layout;`).
 // Default is sparse (hash map). dense_layout backs the store with a plain
-// vector indexed by the flat key; it is only valid for flat_storage tags.
+// vector indexed by the flat key. A hier_storage tag gets one such block per
+// interned occurrence path (see Dense_hier_attr_map).
 //
 // dense_layout contract: value_type{} is reserved as the not-present
 // sentinel (hhds ids reserve 0 as invalid), so a dense tag must never store
@@ -48,10 +54,16 @@ concept Attribute = requires {
 // dense store yields proxy entries: bind with `auto&&` or `const auto&`,
 // never `auto&`.
 //
+// dense_presence_layout (flat_storage only) is the same vector plus a presence
+// bitmap: value_type{} is a legal value (e.g. an integer where 0 matters),
+// size() is O(1) and iteration skips absent keys 64 at a time, for one extra
+// bit per key slot.
+//
 // Build with -DHHDS_ATTR_PROFILE (bazel --config=attr_profile) to dump
 // per-tag utilization at exit and get a dense-vs-sparse recommendation.
 struct sparse_layout {};
 struct dense_layout {};
+struct dense_presence_layout {};
 
 template <class Tag>
 struct attr_layout {
@@ -70,17 +82,21 @@ using attr_layout_t = typename attr_layout<Tag>::type;
 template <Attribute Tag>
 [[nodiscard]] constexpr bool attr_is_dense() noexcept {
   using Layout = attr_layout_t<Tag>;
-  static_assert(std::is_same_v<Layout, sparse_layout> || std::is_same_v<Layout, dense_layout>,
-                "attribute Tag::layout must be hhds::sparse_layout or hhds::dense_layout");
-  if constexpr (std::is_same_v<Layout, dense_layout>) {
-    static_assert(std::is_same_v<typename Tag::storage, flat_storage>,
-                  "dense_layout requires flat_storage; hier_storage attributes must stay sparse");
-    return true;
-  } else {
+  static_assert(std::is_same_v<Layout, sparse_layout> || std::is_same_v<Layout, dense_layout>
+                    || std::is_same_v<Layout, dense_presence_layout>,
+                "attribute Tag::layout must be hhds::sparse_layout, hhds::dense_layout or hhds::dense_presence_layout");
+  if constexpr (std::is_same_v<Layout, sparse_layout>) {
     return false;
+  } else {
+    return true;
   }
 }
 
+template <Attribute Tag>
+[[nodiscard]] constexpr bool attr_has_presence() noexcept {
+  return std::is_same_v<attr_layout_t<Tag>, dense_presence_layout>;
+}
+
 template <Attribute Tag>
 using attr_result_t
     = std::conditional_t<std::is_trivially_copyable_v<typename Tag::value_type> && sizeof(typename Tag::value_type) <= 16,
@@ -96,24 +112,26 @@ struct Hier_attr_step {
   [[nodiscard]] bool operator==(const Hier_attr_step&) const noexcept = default;
 };
 
+// Key of a hier_storage entry: the occurrence path, interned once per host
+// (detail::Hier_path_table), plus the flat object key. Path 0 is never
+// interned, so a key built from an unknown path simply misses.
 struct Hier_attr_key {
-  Gid                         root_gid = Gid_invalid;
-  std::vector<Hier_attr_step> steps;
-  Attr_key                    flat_key = 0;
+  uint32_t path     = 0;
+  Attr_key flat_key = 0;
 
   [[nodiscard]] bool operator==(const Hier_attr_key&) const noexcept = default;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const Hier_attr_key& key) {
+    return H::combine(std::move(h), key.path, key.flat_key);
+  }
 };
+static_assert(sizeof(Hier_attr_key) == 16 && std::is_trivially_copyable_v<Hier_attr_key>);
 
 struct Hier_attr_key_hash {
   [[nodiscard]] size_t operator()(const Hier_attr_key& key) const noexcept {
-    size_t     h   = std::hash<Gid>{}(key.root_gid);
-    const auto mix = [&h](size_t value) { h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U); };
-    for (const auto& step : key.steps) {
-      mix(std::hash<Gid>{}(step.site_gid));
-      mix(std::hash<Nid>{}(step.site_value));
-      mix(step.ordinal ? std::hash<uint64_t>{}(*step.ordinal) : 0x6a09e667f3bcc909ULL);
-    }
-    mix(std::hash<Attr_key>{}(key.flat_key));
+    size_t h = std::hash<Attr_key>{}(key.flat_key);
+    h ^= std::hash<uint32_t>{}(key.path) + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);
     return h;
   }
 };
@@ -121,6 +139,31 @@ struct Hier_attr_key_hash {
 [[nodiscard]] constexpr Attr_key make_node_attr_key(uint64_t raw_id) noexcept { return (raw_id << 1U) | 0U; }
 [[nodiscard]] constexpr Attr_key make_pin_attr_key(uint64_t raw_id) noexcept { return (raw_id << 1U) | 1U; }
 
+// Dense column of a flat object key: nodes, the pin a node stands in for
+// (port 0, keyed by the node's raw id) and table pins. Graph keeps the three
+// apart; a host whose raw ids carry no tag bits folds Node_pin into Pin.
+enum class Attr_column : uint8_t { Node = 0, Node_pin = 1, Pin = 2 };
+
+// Shape of a host's flat object keys (Attr_host::attr_key_space). The low
+// `column_bits` of a key (bit 0 = pin key, then any tag bits the raw id
+// carries) pick the dense column and the remaining bits index into it.
+// Slot counts are the objects per column minted so far, 0 when unknown.
+struct Attr_key_space {
+  uint8_t  column_bits = 1;
+  uint8_t  pin_column  = 1;
+  uint64_t node_slots  = 0;
+  uint64_t pin_slots   = 0;
+
+  [[nodiscard]] constexpr uint8_t column(Attr_column which) const noexcept {
+    return which == Attr_column::Node ? 0 : which == Attr_column::Node_pin ? 1 : pin_column;
+  }
+  [[nodiscard]] constexpr uint64_t slots(Attr_column which) const noexcept {
+    return which == Attr_column::Pin ? pin_slots : node_slots;
+  }
+  // One past the largest key any object minted so far can have.
+  [[nodiscard]] constexpr Attr_key span() const noexcept { return std::max(node_slots, pin_slots) << column_bits; }
+};
+
 enum class Attr_storage_kind : uint8_t { Flat = 0, Hier = 1 };
 
 template <Attribute Tag>
@@ -224,11 +267,18 @@ T read_value(std::istream& is) {
   }
 }
 
-// Vector-backed store for dense_layout attributes. value_type{} marks an
+// Vector-backed store for dense_layout attributes. Keys are split into
+// columns by their low bits (Attr_key_space, bound when the store is minted),
+// so Graph nodes and pins each get a vector indexed by table slot instead of
+// sharing one interleaved, mostly empty key range. value_type{} marks an
 // absent entry (see the dense_layout contract above), so presence needs no
-// extra bitmap. Exposes the subset of the unordered_map surface that
-// Attr_store_impl and AttrRef use; iterators yield proxy entries by value.
-template <typename T>
+// extra bitmap. With Presence (dense_presence_layout) a per-column bitmap
+// marks the set slots instead, value_type{} is an ordinary value,
+// size()/empty() read a maintained count and iteration skips absent slots a
+// 64-bit word at a time. Exposes the subset of the unordered_map surface that
+// Attr_store_impl and AttrRef use; iterators yield proxy entries by value, in
+// column then slot order.
+template <typename T, bool Presence = false>
 class Dense_attr_map {
 public:
   using key_type    = Attr_key;
@@ -237,7 +287,7 @@ public:
   template <bool IsConst>
   class basic_iterator {
   public:
-    using vector_type    = std::conditional_t<IsConst, const std::vector<T>, std::vector<T>>;
+    using map_type       = std::conditional_t<IsConst, const Dense_attr_map, Dense_attr_map>;
     using reference_type = std::conditional_t<IsConst, const T&, T&>;
 
     struct entry {
@@ -251,57 +301,113 @@ public:
     };
 
     basic_iterator() = default;
-    basic_iterator(vector_type* data, size_t pos) : data_(data), pos_(pos) { skip_absent(); }
+    basic_iterator(map_type* map, size_t col, size_t slot) : map_(map), col_(col), slot_(slot) { skip_absent(); }
 
-    [[nodiscard]] entry       operator*() const noexcept { return entry{static_cast<Attr_key>(pos_), (*data_)[pos_]}; }
+    [[nodiscard]] entry operator*() const noexcept {
+      return entry{(static_cast<Attr_key>(slot_) << map_->column_bits_) | col_, map_->cols_[col_].values[slot_]};
+    }
     [[nodiscard]] arrow_proxy operator->() const noexcept { return arrow_proxy{**this}; }
 
     basic_iterator& operator++() noexcept {
-      ++pos_;
+      ++slot_;
       skip_absent();
       return *this;
     }
 
-    [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept { return pos_ == other.pos_; }
+    [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept {
+      return col_ == other.col_ && slot_ == other.slot_;
+    }
 
   private:
     void skip_absent() noexcept {
-      while (data_ != nullptr && pos_ < data_->size() && (*data_)[pos_] == T{}) {
-        ++pos_;
+      if (map_ == nullptr) {
+        return;
+      }
+      for (; col_ < map_->cols_.size(); ++col_, slot_ = 0) {
+        const auto&  column = map_->cols_[col_];
+        const size_t limit  = column.values.size();
+        if constexpr (Presence) {
+          while (slot_ < limit) {
+            const uint64_t word = column.present[slot_ >> 6] >> (slot_ & 63);
+            if (word != 0) {
+              slot_ += static_cast<size_t>(std::countr_zero(word));
+              return;
+            }
+            slot_ = (slot_ | 63) + 1;
+          }
+        } else {
+          for (; slot_ < limit; ++slot_) {
+            if (!(column.values[slot_] == T{})) {
+              return;
+            }
+          }
+        }
       }
     }
 
-    vector_type* data_ = nullptr;
-    size_t       pos_  = 0;
+    map_type* map_  = nullptr;
+    size_t    col_  = 0;
+    size_t    slot_ = 0;
   };
 
   using iterator       = basic_iterator<false>;
   using const_iterator = basic_iterator<true>;
 
-  [[nodiscard]] iterator       begin() noexcept { return iterator(&data_, 0); }
-  [[nodiscard]] iterator       end() noexcept { return iterator(&data_, data_.size()); }
-  [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(&data_, 0); }
-  [[nodiscard]] const_iterator end() const noexcept { return const_iterator(&data_, data_.size()); }
+  Dense_attr_map() : cols_(size_t{1} << column_bits_) {}
 
-  [[nodiscard]] iterator find(Attr_key key) noexcept {
-    if (key < data_.size() && !(data_[key] == T{})) {
-      return iterator(&data_, static_cast<size_t>(key));
+  // Adopt the host's key layout. Entries already stored are rehomed, so the
+  // call is cheap only on an empty map (the usual case: at store mint).
+  void bind_key_space(const Attr_key_space& space) {
+    if (space.column_bits == column_bits_) {
+      return;
+    }
+    Dense_attr_map rebound;
+    rebound.column_bits_ = space.column_bits;
+    rebound.cols_.assign(size_t{1} << space.column_bits, Column{});
+    for (auto&& [key, value] : *this) {
+      rebound.emplace(key, std::move(value));
     }
-    return end();
+    *this = std::move(rebound);
+  }
+  [[nodiscard]] Attr_key_space key_space() const noexcept { return Attr_key_space{.column_bits = column_bits_}; }
+
+  [[nodiscard]] iterator       begin() noexcept { return iterator(this, 0, 0); }
+  [[nodiscard]] iterator       end() noexcept { return iterator(this, cols_.size(), 0); }
+  [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, 0, 0); }
+  [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, cols_.size(), 0); }
+
+  [[nodiscard]] bool contains(Attr_key key) const noexcept {
+    const auto& column = cols_[column_of(key)];
+    const auto  slot   = key >> column_bits_;
+    if constexpr (Presence) {
+      return slot < column.values.size() && ((column.present[slot >> 6] >> (slot & 63)) & 1U) != 0;
+    } else {
+      return slot < column.values.size() && !(column.values[slot] == T{});
+    }
+  }
+
+  [[nodiscard]] iterator find(Attr_key key) noexcept {
+    return contains(key) ? iterator(this, column_of(key), static_cast<size_t>(key >> column_bits_)) : end();
   }
 
   [[nodiscard]] const_iterator find(Attr_key key) const noexcept {
-    if (key < data_.size() && !(data_[key] == T{})) {
-      return const_iterator(&data_, static_cast<size_t>(key));
-    }
-    return end();
+    return contains(key) ? const_iterator(this, column_of(key), static_cast<size_t>(key >> column_bits_)) : end();
   }
 
+  // Inserts (marks present) like std::unordered_map::operator[].
   [[nodiscard]] T& operator[](Attr_key key) {
-    if (key >= data_.size()) {
-      data_.resize(static_cast<size_t>(key) + 1);
+    auto&        column = cols_[column_of(key)];
+    const size_t slot   = static_cast<size_t>(key >> column_bits_);
+    if (slot >= column.values.size()) {
+      grow(column, slot + 1);
+    }
+    if constexpr (Presence) {
+      uint64_t&      word = column.present[slot >> 6];
+      const uint64_t bit  = uint64_t{1} << (slot & 63);
+      count_ += (word & bit) == 0 ? 1 : 0;
+      word |= bit;
     }
-    return data_[static_cast<size_t>(key)];
+    return column.values[slot];
   }
 
   template <typename V>
@@ -310,36 +416,356 @@ public:
   }
 
   size_t erase(Attr_key key) {
-    if (key < data_.size() && !(data_[key] == T{})) {
-      data_[static_cast<size_t>(key)] = T{};
-      return 1;
+    if (!contains(key)) {
+      return 0;
     }
-    return 0;
+    auto&        column = cols_[column_of(key)];
+    const size_t slot   = static_cast<size_t>(key >> column_bits_);
+    column.values[slot] = T{};
+    if constexpr (Presence) {
+      column.present[slot >> 6] &= ~(uint64_t{1} << (slot & 63));
+      --count_;
+    }
+    return 1;
   }
 
-  void clear() noexcept { data_.clear(); }
+  void clear() noexcept {
+    for (auto& column : cols_) {
+      column.values.clear();
+      column.present.clear();
+    }
+    count_ = 0;
+  }
 
   [[nodiscard]] size_t size() const noexcept {
-    size_t count = 0;
-    for (const auto& value : data_) {
-      if (!(value == T{})) {
-        ++count;
+    if constexpr (Presence) {
+      return count_;
+    } else {
+      size_t count = 0;
+      for (const auto& column : cols_) {
+        for (const auto& value : column.values) {
+          if (!(value == T{})) {
+            ++count;
+          }
+        }
       }
+      return count;
     }
-    return count;
   }
 
   [[nodiscard]] bool empty() const noexcept {
-    for (const auto& value : data_) {
-      if (!(value == T{})) {
-        return false;
+    if constexpr (Presence) {
+      return count_ == 0;
+    } else {
+      return begin() == end();
+    }
+  }
+
+  // Reserved slots over all columns; the footprint is capacity() * sizeof(T)
+  // plus the presence bitmaps, if any (heap_bytes()).
+  [[nodiscard]] size_t capacity() const noexcept {
+    size_t slots = 0;
+    for (const auto& column : cols_) {
+      slots += column.values.capacity();
+    }
+    return slots;
+  }
+  [[nodiscard]] uint64_t heap_bytes() const noexcept {
+    uint64_t bytes = static_cast<uint64_t>(cols_.capacity()) * sizeof(Column);
+    for (const auto& column : cols_) {
+      bytes += static_cast<uint64_t>(column.values.capacity()) * sizeof(T)
+               + static_cast<uint64_t>(column.present.capacity()) * sizeof(uint64_t);
+    }
+    return bytes;
+  }
+
+  // One column (Attr_key_space::column) indexed by slot; absent slots hold
+  // T{}. Invalidated by the next operator[] / emplace / grow_column that
+  // resizes it. Under Presence a write through it changes the value only,
+  // never whether the slot is set.
+  [[nodiscard]] std::span<T> column(uint8_t col) noexcept {
+    assert(col < cols_.size());
+    return cols_[col].values;
+  }
+  [[nodiscard]] std::span<const T> column(uint8_t col) const noexcept {
+    assert(col < cols_.size());
+    return cols_[col].values;
+  }
+
+  void grow_column(uint8_t col, uint64_t slots) {
+    assert(col < cols_.size());
+    if (slots > cols_[col].values.size()) {
+      grow(cols_[col], static_cast<size_t>(slots));
+    }
+  }
+
+private:
+  struct Column {
+    std::vector<T>        values;
+    std::vector<uint64_t> present;  // Presence only: bit s set <=> slot s stored
+  };
+
+  [[nodiscard]] size_t column_of(Attr_key key) const noexcept {
+    return static_cast<size_t>(key & ((Attr_key{1} << column_bits_) - 1));
+  }
+
+  static void grow(Column& column, size_t slots) {
+    column.values.resize(slots);
+    if constexpr (Presence) {
+      column.present.resize((slots + 63) >> 6);
+    }
+  }
+
+  uint8_t             column_bits_ = 1;
+  std::vector<Column> cols_;
+  size_t              count_ = 0;  // Presence only: set slots over all columns
+};
+
+// Store for dense_layout hier_storage attributes. Keys split into the host's
+// columns (Attr_key_space) as in Dense_attr_map, and every interned occurrence
+// path that gets a value in a column owns one block of that column's slot
+// count there, so a read/write is block_base(column, path) + slot. A node-only
+// tag on a Graph therefore allocates node-table-sized blocks and no pin
+// blocks. The slot counts are the host's extent when the store is minted or
+// last compacted (see Attr_host::attr_key_space); objects created since, and
+// a host that reports no extent, fall back to a sparse map. Same
+// value_type{} sentinel and proxy-entry iteration as Dense_attr_map; dense
+// slots iterate first, in column then block order.
+template <typename T>
+class Dense_hier_attr_map {
+public:
+  using key_type      = Hier_attr_key;
+  using mapped_type   = T;
+  using overflow_type = std::conditional_t<std::is_trivially_copyable_v<T>, absl::flat_hash_map<Hier_attr_key, T>,
+                                           std::unordered_map<Hier_attr_key, T, Hier_attr_key_hash>>;
+
+  template <bool IsConst>
+  class basic_iterator {
+  public:
+    using map_type       = std::conditional_t<IsConst, const Dense_hier_attr_map, Dense_hier_attr_map>;
+    using reference_type = std::conditional_t<IsConst, const T&, T&>;
+    using overflow_iter
+        = std::conditional_t<IsConst, typename overflow_type::const_iterator, typename overflow_type::iterator>;
+
+    struct entry {
+      Hier_attr_key  first;
+      reference_type second;
+    };
+
+    struct arrow_proxy {
+      entry  value;
+      entry* operator->() noexcept { return &value; }
+    };
+
+    basic_iterator() = default;
+    basic_iterator(map_type* map, size_t col, size_t pos, overflow_iter ovf) : map_(map), col_(col), pos_(pos), ovf_(ovf) {
+      skip_absent();
+    }
+
+    [[nodiscard]] entry operator*() const noexcept {
+      if (col_ < map_->cols_.size()) {
+        auto&        column = map_->cols_[col_];
+        const size_t slots  = static_cast<size_t>(column.slots);
+        const auto   flat   = (static_cast<Attr_key>(pos_ % slots) << map_->column_bits_) | col_;
+        return entry{Hier_attr_key{column.block_path[pos_ / slots], flat}, column.data[pos_]};
       }
+      return entry{ovf_->first, ovf_->second};
     }
-    return true;
+    [[nodiscard]] arrow_proxy operator->() const noexcept { return arrow_proxy{**this}; }
+
+    basic_iterator& operator++() noexcept {
+      if (col_ < map_->cols_.size()) {
+        ++pos_;
+      } else {
+        ++ovf_;
+      }
+      skip_absent();
+      return *this;
+    }
+    basic_iterator operator++(int) noexcept {
+      basic_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept {
+      return col_ == other.col_ && pos_ == other.pos_ && (col_ < map_->cols_.size() || ovf_ == other.ovf_);
+    }
+
+  private:
+    void skip_absent() noexcept {
+      if (map_ == nullptr) {
+        return;
+      }
+      for (; col_ < map_->cols_.size(); ++col_, pos_ = 0) {
+        const auto& data = map_->cols_[col_].data;
+        for (; pos_ < data.size(); ++pos_) {
+          if (!(data[pos_] == T{})) {
+            return;
+          }
+        }
+      }
+    }
+
+    map_type*     map_ = nullptr;
+    size_t        col_ = 0;
+    size_t        pos_ = 0;
+    overflow_iter ovf_{};
+
+    friend class Dense_hier_attr_map;
+  };
+
+  using iterator       = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  Dense_hier_attr_map() : cols_(size_t{1} << column_bits_) {}
+
+  // Adopt the host's key layout and per-column slot counts (the block sizes);
+  // only before the first value (see class comment).
+  void bind_key_space(const Attr_key_space& space) {
+    if (!overflow_.empty()
+        || std::any_of(cols_.begin(), cols_.end(), [](const Column& column) { return !column.data.empty(); })) {
+      return;
+    }
+    column_bits_ = space.column_bits;
+    pin_column_  = space.pin_column;
+    cols_.assign(size_t{1} << space.column_bits, Column{});
+    for (size_t col = 0; col < cols_.size(); ++col) {
+      cols_[col].slots = col == space.pin_column ? space.pin_slots : space.node_slots;
+    }
+  }
+  [[nodiscard]] Attr_key_space key_space() const noexcept {
+    return Attr_key_space{.column_bits = column_bits_,
+                          .pin_column  = pin_column_,
+                          .node_slots  = cols_[0].slots,
+                          .pin_slots   = cols_[pin_column_].slots};
+  }
+
+  [[nodiscard]] iterator       begin() noexcept { return iterator(this, 0, 0, overflow_.begin()); }
+  [[nodiscard]] iterator       end() noexcept { return iterator(this, cols_.size(), 0, overflow_.end()); }
+  [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this, 0, 0, overflow_.begin()); }
+  [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this, cols_.size(), 0, overflow_.end()); }
+
+  [[nodiscard]] iterator find(const Hier_attr_key& key) noexcept {
+    const size_t col  = column_of(key.flat_key);
+    const auto   slot = key.flat_key >> column_bits_;
+    if (slot < cols_[col].slots) {
+      const size_t pos = pos_of(cols_[col], key.path, slot);
+      return pos != kNoSlot && !(cols_[col].data[pos] == T{}) ? iterator(this, col, pos, overflow_.begin()) : end();
+    }
+    return iterator(this, cols_.size(), 0, overflow_.find(key));
+  }
+
+  [[nodiscard]] const_iterator find(const Hier_attr_key& key) const noexcept {
+    const size_t col  = column_of(key.flat_key);
+    const auto   slot = key.flat_key >> column_bits_;
+    if (slot < cols_[col].slots) {
+      const size_t pos = pos_of(cols_[col], key.path, slot);
+      return pos != kNoSlot && !(cols_[col].data[pos] == T{}) ? const_iterator(this, col, pos, overflow_.begin()) : end();
+    }
+    return const_iterator(this, cols_.size(), 0, overflow_.find(key));
+  }
+
+  [[nodiscard]] T& operator[](const Hier_attr_key& key) {
+    auto&      column = cols_[column_of(key.flat_key)];
+    const auto slot   = key.flat_key >> column_bits_;
+    if (slot >= column.slots) {
+      return overflow_[key];
+    }
+    if (key.path >= column.block_of.size()) {
+      column.block_of.resize(static_cast<size_t>(key.path) + 1, kNoBlock);
+    }
+    if (column.block_of[key.path] == kNoBlock) {
+      column.block_of[key.path] = static_cast<uint32_t>(column.block_path.size());
+      column.block_path.push_back(key.path);
+      column.data.resize(column.data.size() + static_cast<size_t>(column.slots));
+    }
+    return column.data[static_cast<size_t>(column.block_of[key.path] * column.slots + slot)];
+  }
+
+  template <typename V>
+  void emplace(const Hier_attr_key& key, V&& value) {
+    (*this)[key] = std::forward<V>(value);
+  }
+
+  size_t erase(const Hier_attr_key& key) {
+    auto it = find(key);
+    if (it == end()) {
+      return 0;
+    }
+    erase(it);
+    return 1;
+  }
+
+  // Other iterators stay valid (a dense slot is just reset to the sentinel).
+  void erase(const iterator& it) {
+    if (it.col_ < cols_.size()) {
+      cols_[it.col_].data[it.pos_] = T{};
+    } else {
+      overflow_.erase(it.ovf_);
+    }
+  }
+
+  void clear() noexcept {
+    for (auto& column : cols_) {
+      column.data.clear();
+      column.block_of.clear();
+      column.block_path.clear();
+    }
+    overflow_.clear();
+  }
+
+  [[nodiscard]] size_t size() const noexcept {
+    size_t count = overflow_.size();
+    for (const auto& column : cols_) {
+      for (const auto& value : column.data) {
+        if (!(value == T{})) {
+          ++count;
+        }
+      }
+    }
+    return count;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return begin() == end(); }
+
+  // Slots, block tables and the sparse fallback (one control byte per slot).
+  [[nodiscard]] uint64_t heap_bytes() const noexcept {
+    uint64_t bytes = static_cast<uint64_t>(cols_.capacity()) * sizeof(Column)
+                     + static_cast<uint64_t>(overflow_.bucket_count()) * (sizeof(typename overflow_type::value_type) + 1);
+    for (const auto& column : cols_) {
+      bytes += static_cast<uint64_t>(column.data.capacity()) * sizeof(T)
+               + static_cast<uint64_t>(column.block_of.capacity() + column.block_path.capacity()) * sizeof(uint32_t);
+    }
+    return bytes;
   }
 
 private:
-  std::vector<T> data_;
+  static constexpr uint32_t kNoBlock = ~uint32_t{0};
+  static constexpr size_t   kNoSlot  = ~size_t{0};
+
+  struct Column {
+    Attr_key              slots = 0;   // block size; keys at slot >= slots go to overflow_
+    std::vector<T>        data;        // block b covers [b * slots, (b + 1) * slots)
+    std::vector<uint32_t> block_of;    // path id -> block (kNoBlock: none yet)
+    std::vector<uint32_t> block_path;  // block -> path id
+  };
+
+  [[nodiscard]] size_t column_of(Attr_key key) const noexcept {
+    return static_cast<size_t>(key & ((Attr_key{1} << column_bits_) - 1));
+  }
+
+  [[nodiscard]] static size_t pos_of(const Column& column, uint32_t path, Attr_key slot) noexcept {
+    if (path >= column.block_of.size() || column.block_of[path] == kNoBlock) {
+      return kNoSlot;
+    }
+    return static_cast<size_t>(column.block_of[path] * column.slots + slot);
+  }
+
+  uint8_t             column_bits_ = 1;
+  uint8_t             pin_column_  = 1;
+  std::vector<Column> cols_;
+  overflow_type       overflow_;  // slot >= the column's slots
 };
 
 #ifdef HHDS_ATTR_PROFILE
@@ -384,7 +810,7 @@ private:
     }
     std::fprintf(stderr, "\nhhds attr profile (flat stores, aggregated at store destruction):\n");
     for (const auto& [id, stat] : stats_) {
-      // Dense pays value_bytes per key slot; sparse pays key+value plus hash
+      // Dense pays value_bytes per column slot; sparse pays key+value plus hash
       // node overhead per present entry.
       const uint64_t dense_bytes  = stat.key_span * stat.value_bytes;
       const uint64_t sparse_bytes = stat.entries * (sizeof(Attr_key) + stat.value_bytes + 16);
@@ -407,6 +833,153 @@ private:
 };
 #endif
 
+// Per-host interning of hier attribute occurrence paths, shared by every
+// hier_storage store of the host. Paths form a parent-pointer trie (the same
+// shape as the views' Occurrence_path_storage): entry 0 is "no path", a root
+// entry holds the root gid, and each step entry points at its prefix. A store
+// entry is then a 16-byte Hier_attr_key instead of a full step vector, and a
+// lookup is one hash probe per step with no allocation.
+class Hier_path_table {
+public:
+  [[nodiscard]] bool   empty() const noexcept { return index_.empty(); }
+  [[nodiscard]] size_t size() const noexcept { return index_.size(); }
+
+  // Read-only lookups: 0 when the path was never interned.
+  [[nodiscard]] uint32_t find_root(Gid root_gid) const noexcept { return find_key(Key{0, root_gid, 0, std::nullopt}); }
+  [[nodiscard]] uint32_t find_child(uint32_t parent, const Hier_attr_step& step) const noexcept {
+    return parent == 0 ? 0 : find_key(Key{parent, step.site_gid, step.site_value, step.ordinal});
+  }
+  [[nodiscard]] uint32_t find(Gid root_gid, std::span<const Hier_attr_step> steps) const noexcept {
+    uint32_t id = find_root(root_gid);
+    for (const auto& step : steps) {
+      id = find_child(id, step);
+    }
+    return id;
+  }
+
+  uint32_t intern(Gid root_gid, std::span<const Hier_attr_step> steps) {
+    uint32_t id = intern_key(Key{0, root_gid, 0, std::nullopt});
+    for (const auto& step : steps) {
+      id = intern_key(Key{id, step.site_gid, step.site_value, step.ordinal});
+    }
+    return id;
+  }
+
+  // True for an id whose path lost a site in remap_sites. The id stays
+  // allocated (a live AttrRef may hold it) but no longer names a path.
+  [[nodiscard]] bool is_dead(uint32_t id) const noexcept { return id != 0 && entries_[id].parent == kDead; }
+
+  // Gid_invalid for a dead id.
+  [[nodiscard]] Gid root_gid(uint32_t id) const noexcept {
+    while (id != 0 && entries_[id].parent != 0) {
+      if (entries_[id].parent == kDead) {
+        return Gid_invalid;
+      }
+      id = entries_[id].parent;
+    }
+    return entries_[id].step.site_gid;
+  }
+
+  // Root-first steps of `id` (the persisted encoding); empty for a dead id.
+  void steps(uint32_t id, std::vector<Hier_attr_step>& out) const {
+    out.clear();
+    for (; id != 0 && entries_[id].parent != 0; id = entries_[id].parent) {
+      if (entries_[id].parent == kDead) {
+        out.clear();
+        return;
+      }
+      out.push_back(entries_[id].step);
+    }
+    std::reverse(out.begin(), out.end());
+  }
+
+  // Rewrite the steps that go through `site_gid` (Graph::compact of that
+  // body). Returns one flag per id, set for paths that lost a site (and their
+  // descendants); empty when nothing changed.
+  [[nodiscard]] std::vector<bool> remap_sites(Gid site_gid, function_ref<Nid(Nid)> site_map) {
+    std::vector<bool> dropped(entries_.size(), false);
+    bool              changed = false;
+    for (uint32_t id = 1; id < entries_.size(); ++id) {
+      auto& entry = entries_[id];
+      if (entry.parent == kDead) {
+        continue;
+      }
+      if (entry.parent != 0 && dropped[entry.parent]) {
+        dropped[id] = true;  // parents are interned before their children
+        continue;
+      }
+      if (entry.parent == 0 || entry.step.site_gid != site_gid) {
+        continue;
+      }
+      const Nid new_site    = site_map(entry.step.site_value);
+      changed               = changed || new_site != entry.step.site_value;
+      dropped[id]           = new_site == 0;
+      entry.step.site_value = new_site;
+    }
+    if (!changed) {
+      return {};
+    }
+    index_.clear();
+    for (uint32_t id = 1; id < entries_.size(); ++id) {
+      auto& entry = entries_[id];
+      if (dropped[id]) {
+        entry.parent = kDead;  // ids stay stable; the slot is just unreachable
+      }
+      if (entry.parent != kDead) {
+        index_.emplace(key_of(entry), id);
+      }
+    }
+    return dropped;
+  }
+
+  [[nodiscard]] uint64_t memory_bytes() const noexcept {
+    return static_cast<uint64_t>(entries_.capacity()) * sizeof(Entry)
+           + static_cast<uint64_t>(index_.capacity()) * (sizeof(std::pair<const Key, uint32_t>) + 1);
+  }
+
+private:
+  static constexpr uint32_t kDead = ~uint32_t{0};
+
+  struct Entry {
+    uint32_t       parent = 0;  // 0: root entry (step.site_gid is the root gid)
+    Hier_attr_step step;
+  };
+
+  struct Key {
+    uint32_t                parent = 0;
+    Gid                     gid    = Gid_invalid;
+    Nid                     value  = 0;
+    std::optional<uint64_t> ordinal;
+
+    [[nodiscard]] bool operator==(const Key&) const noexcept = default;
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.parent, key.gid, key.value, key.ordinal);
+    }
+  };
+
+  [[nodiscard]] static Key key_of(const Entry& entry) noexcept {
+    return Key{entry.parent, entry.step.site_gid, entry.step.site_value, entry.step.ordinal};
+  }
+
+  [[nodiscard]] uint32_t find_key(const Key& key) const noexcept {
+    const auto it = index_.find(key);
+    return it == index_.end() ? 0 : it->second;
+  }
+
+  uint32_t intern_key(const Key& key) {
+    const auto [it, inserted] = index_.try_emplace(key, static_cast<uint32_t>(entries_.size()));
+    if (inserted) {
+      entries_.push_back(Entry{key.parent, Hier_attr_step{key.gid, key.value, key.ordinal}});
+    }
+    return it->second;
+  }
+
+  std::vector<Entry>                 entries_{1};  // id 0: no path
+  absl::flat_hash_map<Key, uint32_t> index_;
+};
+
 class Attr_store_base {
 public:
   virtual ~Attr_store_base() = default;
@@ -417,28 +990,60 @@ public:
   [[nodiscard]] virtual bool                             empty() const noexcept                                           = 0;
   [[nodiscard]] virtual uint64_t                         size() const noexcept                                            = 0;
   virtual void                                           clear_entries() noexcept                                         = 0;
+  // Dense stores adopt the host's key layout (Attr_host::attr_key_space):
+  // both split their columns by it, and hier ones also size their per-path
+  // blocks from its slot counts. Sparse stores ignore it.
+  virtual void                                           bind_key_space(const Attr_key_space& space)                      = 0;
   virtual void                                           erase_object(Attr_key key) noexcept                              = 0;
-  virtual void                                           save_entries(std::ostream& os) const                             = 0;
-  virtual void                                           load_entries(std::istream& is, uint64_t count, bool legacy_hier) = 0;
+  // Rekey after a host renumbering (Graph::compact). `key_map` returns 0 for a
+  // dropped object; dense stores rebind to the renumbered `space`. erase_paths drops hier entries whose interned path lost a
+  // site (Hier_path_table::remap_sites); flat stores have no paths.
+  virtual void remap_objects(function_ref<Attr_key(Attr_key)> key_map, const Attr_key_space& space) = 0;
+  virtual void                                           erase_paths(const std::vector<bool>& dropped) noexcept           = 0;
+  // Hier entries persist their full step encoding; `paths` translates ids.
+  virtual void                                           save_entries(std::ostream& os, const Hier_path_table& paths) const = 0;
+  virtual void load_entries(std::istream& is, uint64_t count, bool legacy_hier, Hier_path_table& paths) = 0;
   [[nodiscard]] virtual std::unique_ptr<Attr_store_base> clone() const                                                    = 0;
+  // Approximate heap bytes held by the map (slots, buckets or nodes, plus
+  // string / vector value buffers). The host's Hier_path_table is separate.
+  [[nodiscard]] virtual uint64_t                         memory_bytes() const noexcept                                    = 0;
 };
 
+// Heap bytes owned by one stored value beyond sizeof(V): the out-of-line
+// buffer of a std::string or a vector of trivially sized elements.
+template <typename V>
+[[nodiscard]] uint64_t attr_value_heap_bytes(const V& value) noexcept {
+  if constexpr (std::is_same_v<V, std::string>) {
+    return value.capacity() > std::string().capacity() ? static_cast<uint64_t>(value.capacity()) + 1 : 0;
+  } else if constexpr (requires { value.capacity(); value.data(); }) {
+    return static_cast<uint64_t>(value.capacity()) * sizeof(*value.data());
+  } else {
+    (void)value;
+    return 0;
+  }
+}
+
 // flat_storage backing map. A trivially-copyable value (int/uint64 attrs like
 // name / srcid — read by value via get/get_or, never a held pointer into
 // the map) uses absl::flat_hash_map: no per-element node allocation (the
 // std::unordered_map _M_insert_unique_node hot spot). A non-trivial value
 // (std::string attrs, e.g. the graph node name, where try_get hands out a
 // pointer/string_view that callers may hold across an insert) stays on the
-// reference-STABLE std::unordered_map. Hier storage likewise stays std (its
-// erase-during-iteration loop relies on erase(it) returning the next iterator).
+// reference-STABLE std::unordered_map. Hier storage follows the same rule over
+// its 16-byte Hier_attr_key.
 template <Attribute Tag>
-using attr_map_t
-    = std::conditional_t<attr_is_dense<Tag>(), Dense_attr_map<typename Tag::value_type>,
-                         std::conditional_t<std::is_same_v<typename Tag::storage, flat_storage>,
-                                            std::conditional_t<std::is_trivially_copyable_v<typename Tag::value_type>,
-                                                               absl::flat_hash_map<Attr_key, typename Tag::value_type>,
-                                                               std::unordered_map<Attr_key, typename Tag::value_type>>,
-                                            std::unordered_map<Hier_attr_key, typename Tag::value_type, Hier_attr_key_hash>>>;
+using attr_map_t = std::conditional_t<
+    attr_is_dense<Tag>(),
+    std::conditional_t<std::is_same_v<typename Tag::storage, flat_storage>,
+                       Dense_attr_map<typename Tag::value_type, attr_has_presence<Tag>()>,
+                       Dense_hier_attr_map<typename Tag::value_type>>,
+    std::conditional_t<std::is_same_v<typename Tag::storage, flat_storage>,
+                       std::conditional_t<std::is_trivially_copyable_v<typename Tag::value_type>,
+                                          absl::flat_hash_map<Attr_key, typename Tag::value_type>,
+                                          std::unordered_map<Attr_key, typename Tag::value_type>>,
+                       std::conditional_t<std::is_trivially_copyable_v<typename Tag::value_type>,
+                                          absl::flat_hash_map<Hier_attr_key, typename Tag::value_type>,
+                                          std::unordered_map<Hier_attr_key, typename Tag::value_type, Hier_attr_key_hash>>>>;
 
 template <Attribute Tag>
 class Attr_store_impl final : public Attr_store_base {
@@ -446,18 +1051,28 @@ public:
   using map_type   = attr_map_t<Tag>;
   using value_type = typename Tag::value_type;
 
+  static constexpr bool is_dense_hier = attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, hier_storage>;
+  static_assert(!(attr_has_presence<Tag>() && is_dense_hier),
+                "dense_presence_layout supports flat_storage only; use dense_layout or sparse_layout for hier_storage");
+
   explicit Attr_store_impl(std::string persistent_id) : persistent_id_(std::move(persistent_id)) {}
 
 #ifdef HHDS_ATTR_PROFILE
   ~Attr_store_impl() override {
     if constexpr (std::is_same_v<typename Tag::storage, flat_storage>) {
-      uint64_t entries  = 0;
-      uint64_t key_span = 0;
+      // key_span counts the slots a dense store needs: per key column (see
+      // Attr_key_space), one past the largest slot used.
+      const Attr_key        column_mask = (Attr_key{1} << key_space_.column_bits) - 1;
+      std::vector<uint64_t> column_span(static_cast<size_t>(column_mask) + 1, 0);
+      uint64_t              entries = 0;
       for (const auto& [key, value] : map_) {
         ++entries;
-        if (static_cast<uint64_t>(key) + 1 > key_span) {
-          key_span = static_cast<uint64_t>(key) + 1;
-        }
+        auto& span = column_span[static_cast<size_t>(key & column_mask)];
+        span       = std::max(span, static_cast<uint64_t>(key >> key_space_.column_bits) + 1);
+      }
+      uint64_t key_span = 0;
+      for (const auto span : column_span) {
+        key_span += span;
       }
       if (entries != 0) {
         Attr_profile::instance().record(persistent_id_, attr_is_dense<Tag>(), sizeof(value_type), entries, key_span);
@@ -472,6 +1087,16 @@ public:
   [[nodiscard]] bool              empty() const noexcept override { return map_.empty(); }
   [[nodiscard]] uint64_t          size() const noexcept override { return static_cast<uint64_t>(map_.size()); }
   void                            clear_entries() noexcept override { map_.clear(); }
+  void                            bind_key_space(const Attr_key_space& space) override {
+#ifdef HHDS_ATTR_PROFILE
+    key_space_ = space;
+#endif
+    if constexpr (attr_is_dense<Tag>()) {
+      map_.bind_key_space(space);
+    } else {
+      (void)space;
+    }
+  }
 
   void erase_object(Attr_key key) noexcept override {
     if constexpr (std::is_same_v<typename Tag::storage, flat_storage>) {
@@ -479,7 +1104,7 @@ public:
     } else {
       for (auto it = map_.begin(); it != map_.end();) {
         if (it->first.flat_key == key) {
-          it = map_.erase(it);
+          map_.erase(it++);  // absl erase(it) returns void; other iterators stay valid
         } else {
           ++it;
         }
@@ -487,18 +1112,59 @@ public:
     }
   }
 
-  void save_entries(std::ostream& os) const override {
+  void remap_objects(function_ref<Attr_key(Attr_key)> key_map, const Attr_key_space& space) override {
+    map_type remapped;
+    if constexpr (attr_is_dense<Tag>()) {
+      remapped.bind_key_space(space);  // hier blocks also cover objects minted since
+    } else {
+      (void)space;
+    }
+    for (auto&& [key, value] : map_) {
+      if constexpr (std::is_same_v<typename Tag::storage, flat_storage>) {
+        if (const Attr_key new_key = key_map(key); new_key != 0) {
+          remapped.emplace(new_key, std::move(value));
+        }
+      } else {
+        const Hier_attr_key new_key{key.path, key_map(key.flat_key)};
+        if (new_key.flat_key != 0) {
+          remapped.emplace(new_key, std::move(value));
+        }
+      }
+    }
+    map_ = std::move(remapped);
+  }
+
+  void erase_paths(const std::vector<bool>& dropped) noexcept override {
+    if constexpr (std::is_same_v<typename Tag::storage, hier_storage>) {
+      for (auto it = map_.begin(); it != map_.end();) {
+        if (it->first.path < dropped.size() && dropped[it->first.path]) {
+          map_.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+    } else {
+      (void)dropped;
+    }
+  }
+
+  void save_entries(std::ostream& os, const Hier_path_table& paths) const override {
     if constexpr (std::is_same_v<typename Tag::storage, flat_storage>) {
+      (void)paths;
       for (const auto& [key, value] : map_) {
         os.write(reinterpret_cast<const char*>(&key), sizeof(key));
         write_value<value_type>(os, value);
       }
     } else {
+      // Same on-disk encoding as before path interning: root gid + full steps.
+      std::vector<Hier_attr_step> steps;
       for (const auto& [key, value] : map_) {
-        os.write(reinterpret_cast<const char*>(&key.root_gid), sizeof(key.root_gid));
-        const uint64_t step_count = key.steps.size();
+        const Gid root_gid = paths.root_gid(key.path);
+        paths.steps(key.path, steps);
+        os.write(reinterpret_cast<const char*>(&root_gid), sizeof(root_gid));
+        const uint64_t step_count = steps.size();
         os.write(reinterpret_cast<const char*>(&step_count), sizeof(step_count));
-        for (const auto& step : key.steps) {
+        for (const auto& step : steps) {
           os.write(reinterpret_cast<const char*>(&step.site_gid), sizeof(step.site_gid));
           os.write(reinterpret_cast<const char*>(&step.site_value), sizeof(step.site_value));
           const uint8_t has_ordinal = step.ordinal ? 1U : 0U;
@@ -513,10 +1179,13 @@ public:
     }
   }
 
-  void load_entries(std::istream& is, uint64_t count, bool legacy_hier) override {
+  void load_entries(std::istream& is, uint64_t count, bool legacy_hier, Hier_path_table& paths) override {
     map_.clear();
+    std::vector<Hier_attr_step> steps;
     for (uint64_t i = 0; i < count; ++i) {
       if constexpr (std::is_same_v<typename Tag::storage, flat_storage>) {
+        (void)legacy_hier;
+        (void)paths;
         Attr_key key = 0;
         is.read(reinterpret_cast<char*>(&key), sizeof(key));
         map_.emplace(key, read_value<value_type>(is));
@@ -529,15 +1198,15 @@ public:
           (void)read_value<value_type>(is);
           continue;  // old immediate-parent keys are ambiguous; recompute them
         }
-        Hier_attr_key key{};
-        is.read(reinterpret_cast<char*>(&key.root_gid), sizeof(key.root_gid));
+        Gid root_gid = Gid_invalid;
+        is.read(reinterpret_cast<char*>(&root_gid), sizeof(root_gid));
         uint64_t step_count = 0;
         is.read(reinterpret_cast<char*>(&step_count), sizeof(step_count));
         if (step_count > (1ULL << 30)) {
           throw std::runtime_error("load_attr_stores: unreasonable occurrence path length");
         }
-        key.steps.resize(static_cast<size_t>(step_count));
-        for (auto& step : key.steps) {
+        steps.assign(static_cast<size_t>(step_count), Hier_attr_step{});
+        for (auto& step : steps) {
           is.read(reinterpret_cast<char*>(&step.site_gid), sizeof(step.site_gid));
           is.read(reinterpret_cast<char*>(&step.site_value), sizeof(step.site_value));
           uint8_t has_ordinal = 0;
@@ -551,6 +1220,7 @@ public:
             step.ordinal = ordinal;
           }
         }
+        Hier_attr_key key{paths.intern(root_gid, steps), 0};
         is.read(reinterpret_cast<char*>(&key.flat_key), sizeof(key.flat_key));
         map_.emplace(key, read_value<value_type>(is));
       }
@@ -563,12 +1233,39 @@ public:
   [[nodiscard]] std::unique_ptr<Attr_store_base> clone() const override {
     auto copy  = std::make_unique<Attr_store_impl<Tag>>(persistent_id_);
     copy->map_ = map_;
+#ifdef HHDS_ATTR_PROFILE
+    copy->key_space_ = key_space_;
+#endif
     return copy;
   }
 
+  [[nodiscard]] uint64_t memory_bytes() const noexcept override {
+    uint64_t bytes = 0;
+    if constexpr (attr_is_dense<Tag>()) {
+      bytes = map_.heap_bytes();
+    } else if constexpr (std::is_same_v<map_type, absl::flat_hash_map<typename map_type::key_type, value_type>>) {
+      // One slot plus one control byte per capacity entry.
+      bytes = static_cast<uint64_t>(map_.capacity()) * (sizeof(typename map_type::value_type) + 1);
+    } else {
+      // Bucket array plus one node (next pointer + cached hash) per entry.
+      bytes = static_cast<uint64_t>(map_.bucket_count()) * sizeof(void*)
+              + static_cast<uint64_t>(map_.size()) * (sizeof(typename map_type::value_type) + 2 * sizeof(void*));
+    }
+    // Trivially copyable values own no heap: skip the walk.
+    if constexpr (!std::is_trivially_copyable_v<value_type>) {
+      for (const auto& [key, value] : map_) {
+        bytes += attr_value_heap_bytes(value);
+      }
+    }
+    return bytes;
+  }
+
 private:
   std::string persistent_id_;
   map_type    map_;
+#ifdef HHDS_ATTR_PROFILE
+  Attr_key_space key_space_;
+#endif
 };
 
 template <Attribute Tag>
@@ -636,6 +1333,13 @@ template <Attribute Tag>
 
 class Attr_host;
 
+// One attribute store of a host, as reported by Attr_host::attr_store_stats.
+struct Attr_store_stats {
+  std::string persistent_id;
+  uint64_t    entries = 0;
+  uint64_t    bytes   = 0;  // Attr_store_base::memory_bytes
+};
+
 template <Attribute Tag>
 class AttrRef {
 public:
@@ -644,16 +1348,19 @@ public:
   AttrRef() = default;
   // No hierarchy context. hier_key_ still carries flat_key so that a hier-storage
   // tag reached from a Class/Flat handle stays per-object: has_hier_ keeps the
-  // debug assert in key(), but under NDEBUG a default-constructed hier_key_ would
-  // collapse every node and pin in the graph onto the single key {_, {}, 0}.
-  AttrRef(Attr_host* host, Attr_key flat_key) : host_(host), flat_key_(flat_key), hier_key_{Gid_invalid, {}, flat_key} {}
+  // debug assert in key(), but under NDEBUG the empty Gid_invalid path would
+  // otherwise collapse every node and pin in the graph onto one key.
+  AttrRef(Attr_host* host, Attr_key flat_key) : host_(host), flat_key_(flat_key), hier_key_{0, flat_key} {}
   AttrRef(Attr_host* host, Attr_key flat_key, int64_t hier_pos)
       : host_(host)
       , flat_key_(flat_key)
-      , hier_key_{Gid_invalid, {{Gid_invalid, static_cast<Nid>(hier_pos), std::nullopt}}, flat_key}
+      , hier_key_{0, flat_key}
+      , hier_steps_{{Gid_invalid, static_cast<Nid>(hier_pos), std::nullopt}}
       , has_hier_(true) {}
   AttrRef(Attr_host* host, Attr_key flat_key, Gid root_gid, std::vector<Hier_attr_step> steps)
-      : host_(host), flat_key_(flat_key), hier_key_{root_gid, std::move(steps), flat_key}, has_hier_(true) {}
+      : host_(host), flat_key_(flat_key), hier_key_{0, flat_key}, hier_root_(root_gid), hier_steps_(std::move(steps)), has_hier_(true) {}
+  // Path already interned on `host` (see Attr_host::hier_paths): no steps kept.
+  AttrRef(Attr_host* host, Hier_attr_key key) : host_(host), flat_key_(key.flat_key), hier_key_(key), has_hier_(true) {}
 
   [[nodiscard]] bool               has() const;
   [[nodiscard]] attr_result_t<Tag> get() const;
@@ -668,11 +1375,15 @@ public:
 
 private:
   [[nodiscard]] auto key() const;
-
-  Attr_host*    host_     = nullptr;
-  Attr_key      flat_key_ = 0;
-  Hier_attr_key hier_key_;
-  bool          has_hier_ = false;
+  // Hier only: key() for writers, interning the path on first use.
+  [[nodiscard]] Hier_attr_key interned_key();
+
+  Attr_host*                  host_     = nullptr;
+  Attr_key                    flat_key_ = 0;
+  Hier_attr_key               hier_key_;  // path 0 until the path is interned
+  Gid                         hier_root_ = Gid_invalid;
+  std::vector<Hier_attr_step> hier_steps_;  // unresolved path only
+  bool                        has_hier_ = false;
 };
 
 class Attr_host {
@@ -690,6 +1401,7 @@ public:
       // Cold path only: mint the store the first time this Tag is written on
       // this host. The steady-state set/del path finds it already present.
       store = detail::Attr_tag_registry::instance().ensure_tag<Tag>().factory();
+      store->bind_key_space(attr_key_space());
     }
     auto* typed = static_cast<detail::Attr_store_impl<Tag>*>(store.get());
     return typed->map();
@@ -712,12 +1424,113 @@ public:
     attr_note_modified();
   }
 
+  // Column access for flat dense tags: slot s of attr_span(tag, which) holds
+  // the value of the object whose get_attr_slot() is s in that column (Graph:
+  // the node / pin table index), and an absent slot holds value_type{}. The
+  // mutable overload mints the store, grows the column to every object minted
+  // so far and marks the host modified; the span stays valid until a write
+  // grows the column. Under dense_presence_layout writes through the span
+  // change values, not presence (use the bulk helpers or AttrRef to add
+  // entries). The const overload is empty before the first write and may be
+  // shorter than the table.
+  template <Attribute Tag>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  [[nodiscard]] std::span<typename Tag::value_type> attr_span(Tag = {}, Attr_column which = Attr_column::Node) {
+    auto&      map   = attr_store(Tag{});
+    const auto space = attr_key_space();
+    map.grow_column(space.column(which), space.slots(which));
+    attr_note_modified();
+    return map.column(space.column(which));
+  }
+
+  template <Attribute Tag>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  [[nodiscard]] std::span<const typename Tag::value_type> attr_span(Tag = {}, Attr_column which = Attr_column::Node) const {
+    const auto* map = find_attr_store(Tag{});
+    return map != nullptr ? map->column(attr_key_space().column(which)) : std::span<const typename Tag::value_type>{};
+  }
+
+  // Keyed bulk helpers (get_attr_key()): one store lookup per call, then a
+  // plain loop over `keys`, which may mix nodes and pins. A pass that visits
+  // the same objects repeatedly builds the key list once (e.g. from
+  // Body_view::nodes()) and reuses it. Every key written is present
+  // afterwards, except that a sentinel dense store treats a value_type{}
+  // write as a delete.
+  template <Attribute Tag>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  void attr_fill(std::span<const Attr_key> keys, const typename Tag::value_type& value, Tag = {}) {
+    auto& map = attr_store(Tag{});
+    for (const auto key : keys) {
+      map[key] = value;
+    }
+    attr_note_modified();
+  }
+
+  // out[i] = value at keys[i], value_type{} when absent.
+  template <Attribute Tag>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  void attr_gather(std::span<const Attr_key> keys, std::span<typename Tag::value_type> out, Tag = {}) const {
+    assert(out.size() >= keys.size());
+    const auto* map = find_attr_store(Tag{});
+    if (map == nullptr) {
+      std::fill_n(out.begin(), keys.size(), typename Tag::value_type{});
+      return;
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const auto it = map->find(keys[i]);
+      out[i]        = it != map->end() ? it->second : typename Tag::value_type{};
+    }
+  }
+
+  template <Attribute Tag>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  void attr_scatter(std::span<const Attr_key> keys, std::span<const typename Tag::value_type> values, Tag = {}) {
+    assert(values.size() >= keys.size());
+    auto& map = attr_store(Tag{});
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      map[keys[i]] = values[i];
+    }
+    attr_note_modified();
+  }
+
+  // value at each key = fn(value), absent slots included (fn sees value_type{}).
+  template <Attribute Tag, typename Fn>
+    requires(attr_is_dense<Tag>() && std::is_same_v<typename Tag::storage, flat_storage>)
+  void attr_transform(std::span<const Attr_key> keys, Fn&& fn, Tag = {}) {
+    auto& map = attr_store(Tag{});
+    for (const auto key : keys) {
+      auto& value = map[key];
+      value       = fn(std::as_const(value));
+    }
+    attr_note_modified();
+  }
+
   template <Attribute Tag>
   [[nodiscard]] bool has_attr(Tag = {}) const {
     const auto slot = attr_tag_slot<Tag>();
     return slot < attr_stores_.size() && attr_stores_[slot] != nullptr;
   }
 
+  // Footprint of every minted store, in tag-slot order, then the interned
+  // hier path table (if any hier attribute was ever written).
+  [[nodiscard]] std::vector<Attr_store_stats> attr_store_stats() const {
+    std::vector<Attr_store_stats> out;
+    for (const auto& store : attr_stores_) {
+      if (store) {
+        out.push_back({std::string(store->persistent_id()), store->size(), store->memory_bytes()});
+      }
+    }
+    if (hier_paths_ && !hier_paths_->empty()) {
+      out.push_back({"hhds.hier_paths", hier_paths_->size(), hier_paths_->memory_bytes()});
+    }
+    return out;
+  }
+
+  // Occurrence paths interned by this host's hier_storage stores, or nullptr
+  // before the first hier write. Read-only lookups are safe for concurrent
+  // readers; a hier set() may intern and is a mutation like any other.
+  [[nodiscard]] const detail::Hier_path_table* hier_paths() const noexcept { return hier_paths_.get(); }
+
 protected:
   void erase_attr_object(Attr_key key) noexcept {
     for (auto& store : attr_stores_) {
@@ -727,8 +1540,38 @@ protected:
     }
   }
 
+  // The hier path table survives: live AttrRefs may hold interned ids.
   void discard_attr_stores() noexcept { attr_stores_.clear(); }
 
+  // Call once the host's tables are renumbered, so attr_key_space() reports
+  // the new extent.
+  void remap_attr_objects(function_ref<Attr_key(Attr_key)> key_map) {
+    const auto space = attr_key_space();
+    for (auto& store : attr_stores_) {
+      if (store) {
+        store->remap_objects(key_map, space);
+      }
+    }
+  }
+
+  // Paths are shared by every hier store, so the sites are rewritten once in
+  // the table; stores only drop entries whose path lost a site.
+  [[nodiscard]] bool remap_attr_sites(Gid site_gid, function_ref<Nid(Nid)> site_map) {
+    if (!hier_paths_) {
+      return false;
+    }
+    const auto dropped = hier_paths_->remap_sites(site_gid, site_map);
+    if (dropped.empty()) {
+      return false;
+    }
+    for (auto& store : attr_stores_) {
+      if (store) {
+        store->erase_paths(dropped);
+      }
+    }
+    return true;
+  }
+
   void clone_attr_stores_from(const Attr_host& other) {
     discard_attr_stores();
     attr_stores_.resize(other.attr_stores_.size());
@@ -737,6 +1580,9 @@ protected:
         attr_stores_[i] = other.attr_stores_[i]->clone();
       }
     }
+    if (other.hier_paths_) {
+      hier_paths_ = std::make_unique<detail::Hier_path_table>(*other.hier_paths_);
+    }
   }
 
   void save_attr_stores(std::ostream& os) const {
@@ -748,6 +1594,8 @@ protected:
     }
 
     os.write(reinterpret_cast<const char*>(&store_count), sizeof(store_count));
+    const detail::Hier_path_table no_paths;
+    const auto&                   paths = hier_paths_ ? *hier_paths_ : no_paths;
     for (const auto& store : attr_stores_) {
       if (!store || store->empty()) {
         continue;
@@ -762,7 +1610,7 @@ protected:
 
       const auto entry_count = store->size();
       os.write(reinterpret_cast<const char*>(&entry_count), sizeof(entry_count));
-      store->save_entries(os);
+      store->save_entries(os, paths);
     }
   }
 
@@ -798,21 +1646,38 @@ protected:
       }
 
       auto store = desc->factory();
-      store->load_entries(is, entry_count, legacy_hier);
+      store->bind_key_space(attr_key_space());
+      store->load_entries(is, entry_count, legacy_hier, hier_path_table());
       if (desc->slot >= attr_stores_.size()) {
         attr_stores_.resize(static_cast<std::size_t>(desc->slot) + 1);
       }
       attr_stores_[desc->slot] = std::move(store);
     }
+    if (hier_paths_ && hier_paths_->empty()) {
+      hier_paths_.reset();  // only flat stores were loaded
+    }
   }
 
 private:
   virtual void attr_note_modified() noexcept = 0;
+  // Layout and current extent of the host's flat object keys; bound into a
+  // dense store when it is created or loaded. The default suits keys made
+  // from untagged raw ids with no known extent.
+  [[nodiscard]] virtual Attr_key_space attr_key_space() const noexcept { return {}; }
+
+  detail::Hier_path_table& hier_path_table() {
+    if (!hier_paths_) {
+      hier_paths_ = std::make_unique<detail::Hier_path_table>();
+    }
+    return *hier_paths_;
+  }
 
   // Per-tag stores indexed by attr_tag_slot<Tag>() — a vector, not a hash map,
   // so a store lookup is a bounds-checked index with no std::type_index hashing.
   // Sparse: a slot stays null until that Tag is first written on this host.
   std::vector<std::unique_ptr<detail::Attr_store_base>> attr_stores_;
+  // Minted on the first hier write (or load); see hier_paths().
+  std::unique_ptr<detail::Hier_path_table> hier_paths_;
 
   template <Attribute Tag>
   friend class AttrRef;
@@ -825,10 +1690,31 @@ inline auto AttrRef<Tag>::key() const {
     return flat_key_;
   } else {
     assert(has_hier_ && "AttrRef: hier attribute requires hierarchy context");
-    return hier_key_;
+    if (hier_key_.path != 0) {
+      return hier_key_;
+    }
+    // Not interned when this ref was made: another ref may have interned it
+    // since, so look again (read-only). Still 0 means no entry can exist.
+    const auto* paths = host_->hier_paths();
+    return Hier_attr_key{paths != nullptr ? paths->find(hier_root_, hier_steps_) : 0, flat_key_};
   }
 }
 
+template <Attribute Tag>
+inline Hier_attr_key AttrRef<Tag>::interned_key() {
+  assert(has_hier_ && "AttrRef: hier attribute requires hierarchy context");
+  if (hier_key_.path == 0) {
+    hier_key_.path = host_->hier_path_table().intern(hier_root_, hier_steps_);
+    hier_steps_.clear();
+    hier_steps_.shrink_to_fit();
+  } else if (host_->hier_path_table().is_dead(hier_key_.path)) {
+    // Graph::compact removed a site on this path: the occurrence is gone and
+    // the ref no longer has the steps to re-intern it.
+    throw std::logic_error("AttrRef::set: the occurrence was removed by Graph::compact");
+  }
+  return hier_key_;
+}
+
 template <Attribute Tag>
 inline bool AttrRef<Tag>::has() const {
   const auto* map = host_ != nullptr ? host_->find_attr_store(Tag{}) : nullptr;
@@ -872,21 +1758,29 @@ inline typename AttrRef<Tag>::value_type AttrRef<Tag>::get_or(typename AttrRef<T
 
 template <Attribute Tag>
 inline void AttrRef<Tag>::set(const value_type& value) {
-  if constexpr (attr_is_dense<Tag>()) {
+  if constexpr (attr_is_dense<Tag>() && !attr_has_presence<Tag>()) {
     assert(!(value == value_type{}) && "AttrRef::set: dense_layout reserves value_type{} as not-present; use del()");
   }
-  auto& map  = host_->attr_store(Tag{});
-  map[key()] = value;
+  auto& map = host_->attr_store(Tag{});
+  if constexpr (std::is_same_v<typename Tag::storage, hier_storage>) {
+    map[interned_key()] = value;
+  } else {
+    map[key()] = value;
+  }
   host_->attr_note_modified();
 }
 
 template <Attribute Tag>
 inline void AttrRef<Tag>::set(value_type&& value) {
-  if constexpr (attr_is_dense<Tag>()) {
+  if constexpr (attr_is_dense<Tag>() && !attr_has_presence<Tag>()) {
     assert(!(value == value_type{}) && "AttrRef::set: dense_layout reserves value_type{} as not-present; use del()");
   }
-  auto& map  = host_->attr_store(Tag{});
-  map[key()] = std::move(value);
+  auto& map = host_->attr_store(Tag{});
+  if constexpr (std::is_same_v<typename Tag::storage, hier_storage>) {
+    map[interned_key()] = std::move(value);
+  } else {
+    map[key()] = std::move(value);
+  }
   host_->attr_note_modified();
 }
 
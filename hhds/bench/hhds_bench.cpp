@@ -227,6 +227,43 @@ OpResult op_build_edges(const hhds_bench::GraphSpec& spec) {
   return {ns_between(t0, t1), added};
 }
 
+// Same graph and timed phase as op_build_edges, but through Graph::add_edges:
+// the pins are created up front (untimed) and the batch is inserted in one call.
+OpResult op_build_edges_bulk(const hhds_bench::GraphSpec& spec) {
+  hhds_bench::EdgeList      edges = hhds_bench::make_edge_list(spec);
+  hhds_bench::PinAssignment pins  = hhds_bench::make_pin_assignment(spec, edges);
+  BuiltGraph                bg;
+  auto                      gio = bg.lib.create_io("top");
+  gio->add_input("in", 0);
+  gio->add_output("out", 0);
+  bg.graph = gio->create_graph();
+  bg.graph->reserve(static_cast<size_t>(spec.nodes) + 4);
+  bg.nodes.reserve(static_cast<size_t>(spec.nodes));
+  for (int i = 0; i < spec.nodes; ++i) {
+    bg.nodes.push_back(bg.graph->create_node());
+  }
+  if (spec.nodes > 0) {
+    bg.graph->get_input_pin("in").connect_sink(bg.nodes[0].create_sink_pin());
+  }
+  std::vector<std::pair<hhds::Pin, hhds::Pin>> batch;
+  batch.reserve(edges.edges.size());
+  for (size_t i = 0; i < edges.edges.size(); ++i) {
+    const auto [src, dst] = edges.edges[i];
+    if (pins.driver_ports.empty()) {
+      batch.emplace_back(bg.nodes[src].create_driver_pin(), bg.nodes[dst].create_sink_pin());
+    } else {
+      const auto dport = static_cast<hhds::Port_id>(pins.driver_ports[i]);
+      const auto sport = static_cast<hhds::Port_id>(pins.sink_ports[i]);
+      batch.emplace_back(bg.nodes[src].create_driver_pin(dport), bg.nodes[dst].create_sink_pin(sport));
+    }
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  bg.graph->add_edges(batch);
+  auto t1 = std::chrono::steady_clock::now();
+  return {ns_between(t0, t1), static_cast<int64_t>(batch.size())};
+}
+
 OpResult op_traverse_forward_class(const hhds_bench::GraphSpec& spec) {
   hhds_bench::EdgeList      edges = hhds_bench::make_edge_list(spec);
   hhds_bench::PinAssignment pins  = hhds_bench::make_pin_assignment(spec, edges);
@@ -492,6 +529,9 @@ OpResult dispatch(const std::string& op, const hhds_bench::GraphSpec& spec) {
   if (op == "build_edges") {
     return op_build_edges(spec);
   }
+  if (op == "build_edges_bulk") {
+    return op_build_edges_bulk(spec);
+  }
   if (op == "add_pin") {
     return op_add_pin(spec);
   }
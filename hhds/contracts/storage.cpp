@@ -1,8 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <map>
+#include <random>
+#include <sstream>
 
 #include "hhds/graph.hpp"
+#include "hhds/sedge_decode.hpp"
 #include "hhds/tree.hpp"
 
 namespace test_attrs {
@@ -32,15 +37,35 @@ struct dbits_t {
 };
 inline constexpr dbits_t dbits{};
 
+struct dhbits_t {
+  using value_type = int;
+  using storage    = hhds::hier_storage;
+  using layout     = hhds::dense_layout;
+};
+inline constexpr dhbits_t dhbits{};
+
+struct pbits_t {
+  using value_type = int;
+  using storage    = hhds::flat_storage;
+  using layout     = hhds::dense_presence_layout;
+};
+inline constexpr pbits_t pbits{};
+
 }  // namespace test_attrs
 
 // Layout policy resolution: sparse by default, dense only when opted in.
-// dense_layout + hier_storage is a compile error (static_assert in attr_is_dense).
+// dense_layout + hier_storage gets per-occurrence blocks (Dense_hier_attr_map);
+// dense_presence_layout adds a presence bitmap to the flat vector.
 static_assert(std::is_same_v<hhds::attr_layout_t<test_attrs::bits_t>, hhds::sparse_layout>);
 static_assert(std::is_same_v<hhds::attr_layout_t<test_attrs::dbits_t>, hhds::dense_layout>);
 static_assert(!hhds::attr_is_dense<test_attrs::bits_t>());
 static_assert(!hhds::attr_is_dense<test_attrs::hbits_t>());
 static_assert(hhds::attr_is_dense<test_attrs::dbits_t>());
+static_assert(hhds::attr_is_dense<test_attrs::dhbits_t>());
+static_assert(std::is_same_v<hhds::detail::Attr_store_impl<test_attrs::dhbits_t>::map_type, hhds::detail::Dense_hier_attr_map<int>>);
+static_assert(hhds::attr_is_dense<test_attrs::pbits_t>() && hhds::attr_has_presence<test_attrs::pbits_t>());
+static_assert(!hhds::attr_has_presence<test_attrs::dbits_t>());
+static_assert(std::is_same_v<hhds::detail::Attr_store_impl<test_attrs::pbits_t>::map_type, hhds::detail::Dense_attr_map<int, true>>);
 
 // ------------------------------------------------------------------
 // Compile-time size checks — these enforce the public storage layout
@@ -134,6 +159,121 @@ TEST(GraphStorage, NonZeroPortSharesSinglePinEntry) {
   EXPECT_EQ(driver_pin.get_debug_pid() & ~static_cast<hhds::Pid>(2), sink_pin.get_debug_pid() & ~static_cast<hhds::Pid>(2));
 }
 
+TEST(GraphStorage, WideNodePortLookupSurvivesEditsAndReload) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_graph_wide_ports";
+  fs::remove_all(test_dir);
+
+  hhds::GraphLibrary lib;
+  auto               gio   = lib.create_io("top");
+  auto               graph = gio->create_graph();
+
+  // Scrambled port order so pins land before, between and after the existing
+  // ones; well past the point where the node switches to indexed lookup.
+  constexpr hhds::Port_id kPorts = 600;
+  auto                    wide   = graph->create_node();
+  std::vector<hhds::Pid>  pid_of(kPorts + 1, 0);
+  for (hhds::Port_id i = 0; i < kPorts; ++i) {
+    const hhds::Port_id port = (i * 7919u) % kPorts + 1;
+    pid_of[port]             = wide.create_driver_pin(port).get_debug_pid() & ~static_cast<hhds::Pid>(2);
+  }
+  for (hhds::Port_id port = 1; port <= kPorts; ++port) {
+    EXPECT_EQ(wide.create_sink_pin(port).get_debug_pid(), pid_of[port]);  // found, not re-created
+    EXPECT_EQ(wide.get_sink_pin(port).get_port_id(), port);
+  }
+
+  // Declared IO pins go through create_pin/delete_pin on INPUT_NODE: shrink a
+  // wide port list through the index threshold and grow it back.
+  for (hhds::Port_id port = 1; port <= 80; ++port) {
+    gio->add_input("i" + std::to_string(port), port);
+  }
+  for (hhds::Port_id port = 2; port <= 80; port += 2) {
+    gio->delete_input("i" + std::to_string(port));
+  }
+  for (hhds::Port_id port = 81; port <= 90; ++port) {
+    gio->add_input("i" + std::to_string(port), port);
+  }
+  for (hhds::Port_id port = 1; port <= 90; ++port) {
+    if (port > 80 || port % 2 == 1) {
+      EXPECT_EQ(graph->get_input_pin("i" + std::to_string(port)).get_port_id(), port);
+    }
+  }
+  auto sink = graph->create_node();
+  wide.get_driver_pin(kPorts - 1).connect_sink(sink.create_sink_pin(0));
+  lib.save(test_dir);
+
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto graph2 = lib2.find_io("top")->get_graph();
+  ASSERT_NE(graph2, nullptr);
+  hhds::Node_class wide2(graph2.get(), wide.get_debug_nid());
+  for (hhds::Port_id port = 1; port <= kPorts; ++port) {
+    EXPECT_EQ(wide2.get_sink_pin(port).get_debug_pid(), pid_of[port]);
+  }
+  EXPECT_EQ(graph2->get_input_pin("i81").get_port_id(), 81u);
+  EXPECT_EQ(wide2.get_driver_pin(kPorts - 1).out_edges().size(), 1u);
+  // Inserting into the reloaded (index-rebuilt) node keeps the list sorted.
+  EXPECT_EQ(wide2.create_driver_pin(kPorts + 5).get_port_id(), kPorts + 5);
+  EXPECT_EQ(wide2.get_sink_pin(33).get_port_id(), 33u);
+  EXPECT_EQ(wide2.create_sink_pin(33).get_debug_pid(), wide2.get_sink_pin(33).get_debug_pid());
+
+  fs::remove_all(test_dir);
+}
+
+// A missing port is a debug assert; release builds get an invalid pin
+// whether the node walks its pin list or uses the port index.
+TEST(GraphStorage, MissingPortLookupIsInvalidWithOrWithoutIndex) {
+  hhds::GraphLibrary lib;
+  auto               graph  = lib.create_io("top")->create_graph();
+  auto               narrow = graph->create_node();
+  auto               wide   = graph->create_node();
+  (void)narrow.create_driver_pin(1);
+  (void)narrow.create_driver_pin(3);
+  for (hhds::Port_id port = 1; port <= 200; port += 2) {
+    (void)wide.create_driver_pin(port);
+  }
+
+#ifdef NDEBUG
+  for (auto* node : {&narrow, &wide}) {
+    for (hhds::Port_id port : {2u, 4u, 1000u}) {
+      const auto pin = node->get_sink_pin(port);
+      EXPECT_TRUE(pin.is_invalid());
+      EXPECT_EQ(pin.get_graph(), nullptr);  // `{}`, not a pid-0 pin bound to the graph
+      EXPECT_EQ(pin.get_debug_pid(), 0u);
+    }
+  }
+#else
+  EXPECT_DEATH((void)narrow.get_sink_pin(2), "requested pin was not created");
+  EXPECT_DEATH((void)wide.get_sink_pin(2), "requested pin was not created");
+  EXPECT_DEATH((void)wide.get_sink_pin(1000), "requested pin was not created");
+#endif
+  EXPECT_EQ(wide.get_sink_pin(199).get_port_id(), 199u);
+}
+
+TEST(GraphStorage, DescendingPortsStillBuildThePortIndex) {
+  // Descending ports insert every pin at the list head, so the walk before
+  // the insertion point is always empty; the index must still kick in.
+  auto side_tables_with_ports = [](hhds::Port_id ports, bool descending) {
+    hhds::GraphLibrary lib;
+    auto               graph = lib.create_io("top")->create_graph();
+    auto               wide  = graph->create_node();
+    for (hhds::Port_id i = 0; i < ports; ++i) {
+      const hhds::Port_id port = descending ? ports - i : i + 1;
+      (void)wide.create_driver_pin(port);
+    }
+    for (hhds::Port_id port = 1; port <= ports; ++port) {
+      EXPECT_EQ(wide.get_sink_pin(port).get_port_id(), port);
+    }
+    return graph->memory_stats().side_tables;
+  };
+
+  const auto unindexed  = side_tables_with_ports(16, true);
+  const auto ascending  = side_tables_with_ports(256, false);
+  const auto descending = side_tables_with_ports(256, true);
+  EXPECT_GT(ascending, unindexed);
+  EXPECT_EQ(descending, ascending);
+}
+
 TEST(GraphStorage, EdgeBidirectionalBits) {
   hhds::GraphLibrary lib;
   auto               gio   = lib.create_io("top");
@@ -211,7 +351,7 @@ TEST(GraphStorage, ClearSemantics) {
   EXPECT_FALSE(gio->has_graph());
 }
 
-TEST(GraphStorage, SubnodeForcesOverflow) {
+TEST(GraphStorage, SubnodeLinkResolvesNamedPins) {
   hhds::GraphLibrary lib;
   auto               leaf_gio = lib.create_io("leaf");
   auto               top_gio  = lib.create_io("top");
@@ -227,6 +367,57 @@ TEST(GraphStorage, SubnodeForcesOverflow) {
   EXPECT_EQ(pin.get_port_id(), 1u);
 }
 
+// The subnode target lives outside the entry: the instance node keeps its
+// inline edges (including both long-edge slots) and its pin list intact.
+TEST(GraphStorage, SubnodeKeepsInlineEdges) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_subnode_inline";
+  fs::remove_all(test_dir);
+
+  hhds::GraphLibrary lib;
+  auto               leaf_gio = lib.create_io("leaf");
+  leaf_gio->add_input("a", 1);
+  leaf_gio->add_input("b", 2);
+  auto top_gio = lib.create_io("top");
+  auto graph   = top_gio->create_graph();
+
+  auto inst = graph->create_node();
+  auto near = graph->create_node();
+  for (int i = 0; i < 9000; ++i) {
+    (void)graph->create_node();
+  }
+  auto far0 = graph->create_node();
+  auto far1 = graph->create_node();
+  inst.create_driver_pin(0).connect_sink(near.create_sink_pin(0));
+  inst.create_driver_pin(0).connect_sink(far0.create_sink_pin(0));
+  inst.create_driver_pin(0).connect_sink(far1.create_sink_pin(0));
+  inst.set_subnode(leaf_gio);
+  near.create_driver_pin(0).connect_sink(inst.create_sink_pin("b"));
+  near.create_driver_pin(0).connect_sink(inst.create_sink_pin("a"));
+
+  const auto check = [](hhds::Node_class n, hhds::Gid leaf) {
+    EXPECT_EQ(n.get_subnode_gid(), leaf);
+    EXPECT_EQ(n.out_edges().size(), 3u);
+    EXPECT_EQ(n.inp_edges().size(), 2u);
+    EXPECT_EQ(n.get_sink_pin("a").inp_edges().size(), 1u);
+    EXPECT_EQ(n.get_sink_pin("b").inp_edges().size(), 1u);
+  };
+  check(inst, leaf_gio->get_gid());
+
+  lib.save(test_dir);
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto graph2 = lib2.find_io("top")->get_graph();
+  check(hhds::Node_class(graph2.get(), inst.get_debug_nid()), lib2.find_io("leaf")->get_gid());
+
+  inst.del_node();
+  EXPECT_EQ(near.out_edges().size(), 0u);
+  for (auto n : graph->body().nodes()) {
+    EXPECT_EQ(n.get_subnode_gid(), hhds::Gid_invalid);
+  }
+  fs::remove_all(test_dir);
+}
+
 TEST(GraphAttrs, FlatGetSetHasDeleteOnNodeAndPin) {
   hhds::GraphLibrary lib;
   auto               gio   = lib.create_io("top");
@@ -377,6 +568,135 @@ TEST(GraphAttrs, DenseLayoutIterationSizeAndClear) {
   EXPECT_EQ(store.size(), 0u);
 }
 
+TEST(GraphAttrs, DenseLayoutSpanAndBulkHelpers) {
+  hhds::GraphLibrary lib;
+  auto               graph = lib.create_io("top")->create_graph();
+
+  const hhds::Graph& cgraph = *graph;
+  EXPECT_TRUE(cgraph.attr_span(test_attrs::dbits).empty());
+
+  std::vector<hhds::Node_class> nodes;
+  std::vector<hhds::Attr_key>   keys;
+  for (int i = 0; i < 5; ++i) {
+    nodes.push_back(graph->create_node());
+    keys.push_back(nodes.back().get_attr_key());
+  }
+  auto pin = nodes[0].create_driver_pin(1);
+  pin.attr(test_attrs::dbits).set(99);
+  for (auto node : graph->body().nodes()) {
+    EXPECT_NE(std::ranges::find(keys, node.get_attr_key()), keys.end());
+  }
+
+  // The node column is indexed by node table slot and sized to the table: no
+  // interleaved pin or tag-bit slots.
+  auto col = graph->attr_span(test_attrs::dbits);
+  EXPECT_EQ(col.size(), nodes.back().get_attr_slot() + 1);
+  for (const auto& node : nodes) {
+    ASSERT_LT(node.get_attr_slot(), col.size());
+    EXPECT_EQ(col[node.get_attr_slot()], 0);
+  }
+  col[nodes[1].get_attr_slot()] = 5;
+  EXPECT_EQ(nodes[1].attr(test_attrs::dbits).get(), 5);
+
+  EXPECT_EQ(pin.get_attr_column(), hhds::Attr_column::Pin);
+  auto pin_col = graph->attr_span(test_attrs::dbits, hhds::Attr_column::Pin);
+  ASSERT_LT(pin.get_attr_slot(), pin_col.size());
+  EXPECT_EQ(pin_col[pin.get_attr_slot()], 99);
+
+  // A port-0 pin is the node itself; its values live in a separate column.
+  auto port0 = nodes[4].create_sink_pin(0);
+  EXPECT_EQ(port0.get_attr_column(), hhds::Attr_column::Node_pin);
+  graph->attr_span(test_attrs::dbits, hhds::Attr_column::Node_pin)[port0.get_attr_slot()] = 3;
+  EXPECT_EQ(port0.attr(test_attrs::dbits).get(), 3);
+  EXPECT_FALSE(nodes[4].attr(test_attrs::dbits).has());
+  port0.attr(test_attrs::dbits).del();
+
+  graph->attr_fill(std::span<const hhds::Attr_key>(keys).first(3), 7, test_attrs::dbits);
+  std::vector<int> out(keys.size());
+  graph->attr_gather(keys, std::span<int>(out), test_attrs::dbits);
+  EXPECT_EQ(out, (std::vector<int>{7, 7, 7, 0, 0}));
+
+  const std::vector<int> in{1, 0, 3, 4, 5};  // 0 deletes
+  graph->attr_scatter(keys, std::span<const int>(in), test_attrs::dbits);
+  auto twice = [](int v) { return v * 2; };
+  graph->attr_transform(keys, twice, test_attrs::dbits);
+  graph->attr_gather(keys, std::span<int>(out), test_attrs::dbits);
+  EXPECT_EQ(out, (std::vector<int>{2, 0, 6, 8, 10}));
+
+  // Bulk writes and per-object AttrRef share one column.
+  EXPECT_EQ(graph->find_attr_store(test_attrs::dbits)->size(), 5u);  // 4 nodes + the pin
+  EXPECT_EQ(nodes[2].attr(test_attrs::dbits).get(), 6);
+  nodes[2].attr(test_attrs::dbits).del();
+  EXPECT_FALSE(nodes[1].attr(test_attrs::dbits).has());
+  EXPECT_EQ(cgraph.attr_span(test_attrs::dbits)[nodes[2].get_attr_slot()], 0);
+  graph->attr_gather(keys, std::span<int>(out), test_attrs::dbits);
+  EXPECT_EQ(out, (std::vector<int>{2, 0, 0, 8, 10}));
+}
+
+TEST(GraphAttrs, DensePresenceLayoutStoresZeroAndCountsInO1) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_dense_presence";
+  fs::remove_all(test_dir);
+  hhds::register_attr_tag<test_attrs::pbits_t>("test_attrs::pbits");
+
+  hhds::GraphLibrary lib;
+  auto               graph = lib.create_io("top")->create_graph();
+
+  // Enough nodes that present keys span several 64-bit bitmap words.
+  std::vector<hhds::Node_class> nodes;
+  for (int i = 0; i < 40; ++i) {
+    nodes.push_back(graph->create_node());
+  }
+
+  nodes[0].attr(test_attrs::pbits).set(0);  // value_type{} is a real value here
+  EXPECT_TRUE(nodes[0].attr(test_attrs::pbits).has());
+  EXPECT_EQ(nodes[0].attr(test_attrs::pbits).get(), 0);
+  EXPECT_FALSE(nodes[1].attr(test_attrs::pbits).has());
+
+  std::vector<hhds::Attr_key> keys;
+  for (size_t i = 0; i < nodes.size(); i += 3) {
+    keys.push_back(nodes[i].get_attr_key());
+  }
+  graph->attr_fill(keys, 0, test_attrs::pbits);
+  auto&      store = graph->attr_store(test_attrs::pbits);
+  const auto total = keys.size();
+  EXPECT_EQ(store.size(), total);
+  EXPECT_FALSE(store.empty());
+
+  auto inc = [](int v) { return v + 1; };
+  graph->attr_transform(std::span<const hhds::Attr_key>(keys).first(2), inc, test_attrs::pbits);
+  nodes[3].attr(test_attrs::pbits).del();
+  EXPECT_FALSE(nodes[3].attr(test_attrs::pbits).has());
+  EXPECT_EQ(store.size(), total - 1);
+
+  std::vector<std::pair<hhds::Attr_key, int>> seen;
+  for (const auto& [key, value] : store) {
+    seen.emplace_back(key, value);
+  }
+  ASSERT_EQ(seen.size(), total - 1);
+  EXPECT_EQ(seen[0], (std::pair<hhds::Attr_key, int>{keys[0], 1}));
+  EXPECT_EQ(seen.back(), (std::pair<hhds::Attr_key, int>{keys.back(), 0}));
+  EXPECT_TRUE(std::ranges::is_sorted(seen));
+
+  nodes[6].del_node();
+  EXPECT_EQ(store.size(), total - 2);
+
+  lib.save(test_dir);
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto  loaded       = lib2.find_io("top")->get_graph();
+  auto* loaded_store = loaded->find_attr_store(test_attrs::pbits);
+  ASSERT_NE(loaded_store, nullptr);
+  EXPECT_EQ(loaded_store->size(), total - 2);
+  EXPECT_TRUE(loaded_store->find(keys.back()) != loaded_store->end());
+  EXPECT_TRUE(loaded_store->find(nodes[1].get_attr_key()) == loaded_store->end());
+
+  graph->attr_clear(test_attrs::pbits);
+  EXPECT_TRUE(store.empty());
+  EXPECT_EQ(store.size(), 0u);
+  fs::remove_all(test_dir);
+}
+
 TEST(GraphAttrs, HierAttrUsesHierarchyContext) {
   hhds::GraphLibrary lib;
 
@@ -409,6 +729,249 @@ TEST(GraphAttrs, HierAttrUsesHierarchyContext) {
   EXPECT_EQ(leaf_instances[1].attr(test_attrs::hbits).get(), 22);
 }
 
+// Hier keys share one interned path per instance: many objects under the same
+// occurrence cost one path-table entry, and the step encoding still persists.
+TEST(GraphAttrs, HierAttrPathsAreInternedPerHost) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_hier_paths";
+  fs::remove_all(test_dir);
+  hhds::register_attr_tag<test_attrs::hbits_t>("test_attrs::hbits");
+
+  hhds::GraphLibrary lib;
+  auto               leaf_io = lib.create_io("leaf");
+  auto               leaf    = leaf_io->create_graph();
+  for (int i = 0; i < 8; ++i) {
+    (void)leaf->create_node();
+  }
+  auto top = lib.create_io("top")->create_graph();
+  top->create_node().set_subnode(leaf_io);
+  top->create_node().set_subnode(leaf_io);
+
+  std::vector<hhds::Occurrence_node> occs;
+  for (auto node : top->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+    if (node.get_current_gid() == leaf->get_gid()) {
+      occs.push_back(node);
+    }
+  }
+  ASSERT_EQ(occs.size(), 16u);
+
+  EXPECT_EQ(leaf->hier_paths(), nullptr);
+  auto early = occs[0].attr(test_attrs::hbits);  // taken before the path exists
+  EXPECT_FALSE(early.has());
+  for (size_t i = 0; i < occs.size(); ++i) {
+    occs[i].attr(test_attrs::hbits).set(static_cast<int>(i) + 1);
+  }
+  EXPECT_EQ(early.get(), 1);  // the stale ref finds the path interned since
+
+  // One root entry plus one step entry per instance, shared by 16 keys.
+  ASSERT_NE(leaf->hier_paths(), nullptr);
+  EXPECT_EQ(leaf->hier_paths()->size(), 3u);
+  const auto stats = leaf->memory_stats();
+  ASSERT_EQ(stats.attrs.size(), 2u);
+  EXPECT_EQ(stats.attrs[0].entries, 16u);
+  EXPECT_EQ(stats.attrs[1].persistent_id, "hhds.hier_paths");
+  EXPECT_EQ(stats.attrs[1].entries, 3u);
+
+  occs[3].attr(test_attrs::hbits).del();
+  EXPECT_FALSE(occs[3].attr(test_attrs::hbits).has());
+
+  lib.save(test_dir);
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto   top2 = lib2.find_io("top")->get_graph();
+  auto   gid2 = lib2.find_io("leaf")->get_gid();
+  size_t i    = 0;
+  for (auto node : top2->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+    if (node.get_current_gid() != gid2) {
+      continue;
+    }
+    if (i == 3) {
+      EXPECT_FALSE(node.attr(test_attrs::hbits).has());
+    } else {
+      EXPECT_EQ(node.attr(test_attrs::hbits).get(), static_cast<int>(i) + 1);
+    }
+    ++i;
+  }
+  EXPECT_EQ(i, 16u);
+  fs::remove_all(test_dir);
+}
+
+// Compacting the parent away from an instance kills its interned path: refs
+// taken before read nothing, refuse to write, and the path is not saved.
+TEST(GraphAttrs, HierAttrRefRejectsPathRemovedByCompact) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_hier_dead_path";
+  fs::remove_all(test_dir);
+  hhds::register_attr_tag<test_attrs::hbits_t>("test_attrs::hbits");
+
+  hhds::GraphLibrary lib;
+  auto               leaf_io = lib.create_io("leaf");
+  auto               leaf    = leaf_io->create_graph();
+  (void)leaf->create_node();
+  (void)leaf->create_node();
+  auto top  = lib.create_io("top")->create_graph();
+  auto inst = top->create_node();
+  inst.set_subnode(leaf_io);
+  top->create_node().set_subnode(leaf_io);
+
+  auto leaf_occurrences = [&] {
+    std::vector<hhds::Occurrence_node> occs;
+    for (auto node : top->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+      if (node.get_current_gid() == leaf->get_gid()) {
+        occs.push_back(node);
+      }
+    }
+    return occs;
+  };
+  auto occs = leaf_occurrences();
+  ASSERT_EQ(occs.size(), 4u);
+  for (size_t i = 0; i < occs.size(); ++i) {
+    occs[i].attr(test_attrs::hbits).set(static_cast<int>(i) + 1);
+  }
+  auto stale = occs[0].attr(test_attrs::hbits);  // under `inst`
+  EXPECT_EQ(stale.get(), 1);
+
+  inst.del_node();
+  EXPECT_FALSE(top->compact().is_identity());
+
+  EXPECT_FALSE(stale.has());
+  EXPECT_THROW(stale.set(7), std::logic_error);
+  occs = leaf_occurrences();
+  ASSERT_EQ(occs.size(), 2u);
+  EXPECT_EQ(occs[0].attr(test_attrs::hbits).get(), 3);
+  EXPECT_EQ(occs[1].attr(test_attrs::hbits).get(), 4);
+
+  lib.save(test_dir);
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto   top2 = lib2.find_io("top")->get_graph();
+  auto   gid2 = lib2.find_io("leaf")->get_gid();
+  size_t n    = 0;
+  for (auto node : top2->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+    if (node.get_current_gid() == gid2) {
+      EXPECT_EQ(node.attr(test_attrs::hbits).get(), static_cast<int>(n++) + 3);
+    }
+  }
+  EXPECT_EQ(n, 2u);
+  fs::remove_all(test_dir);
+}
+
+// A dense hier tag indexes block(column, path) + slot; objects minted after
+// the store fall back to the sparse map until Graph::compact rebinds it.
+TEST(GraphAttrs, DenseHierAttrUsesPerOccurrenceBlocks) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_dense_hier";
+  fs::remove_all(test_dir);
+  hhds::register_attr_tag<test_attrs::dhbits_t>("test_attrs::dhbits");
+
+  hhds::GraphLibrary lib;
+  auto               leaf_io = lib.create_io("leaf");
+  auto               leaf    = leaf_io->create_graph();
+  std::vector<hhds::Node_class> leaf_nodes;
+  for (int i = 0; i < 6; ++i) {
+    leaf_nodes.push_back(leaf->create_node());
+  }
+  auto top = lib.create_io("top")->create_graph();
+  for (int i = 0; i < 3; ++i) {
+    top->create_node().set_subnode(leaf_io);
+  }
+
+  const auto leaf_occurrences = [&](std::shared_ptr<hhds::Graph> g, hhds::Gid gid) {
+    std::vector<hhds::Occurrence_node> out;
+    for (auto node : g->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+      if (node.get_current_gid() == gid) {
+        out.push_back(node);
+      }
+    }
+    return out;
+  };
+  auto occs = leaf_occurrences(top, leaf->get_gid());
+  ASSERT_EQ(occs.size(), 18u);
+  for (size_t i = 0; i < occs.size(); ++i) {
+    occs[i].attr(test_attrs::dhbits).set(static_cast<int>(i) + 1);
+  }
+  for (size_t i = 0; i < occs.size(); ++i) {
+    EXPECT_EQ(occs[i].attr(test_attrs::dhbits).get(), static_cast<int>(i) + 1);
+  }
+
+  const auto* map = leaf->find_attr_store(test_attrs::dhbits);
+  ASSERT_NE(map, nullptr);
+  const auto space      = map->key_space();
+  const auto node_slots = space.slots(hhds::Attr_column::Node);
+  EXPECT_EQ(node_slots, leaf_nodes.back().get_attr_slot() + 1);
+  EXPECT_EQ(map->size(), 18u);
+  // One node-column block per instance; a node-only tag allocates no pin blocks.
+  EXPECT_GE(map->heap_bytes(), 3 * node_slots * sizeof(int));
+  EXPECT_LT(map->heap_bytes(), 3 * space.span() * sizeof(int));
+
+  // A node created after the store was minted lands in the sparse fallback.
+  auto late = leaf->create_node();
+  EXPECT_GE(late.get_attr_slot(), node_slots);
+  occs = leaf_occurrences(top, leaf->get_gid());
+  ASSERT_EQ(occs.size(), 21u);
+  size_t late_hits = 0;
+  for (auto& occ : occs) {
+    if (occ.get_debug_nid() == late.get_debug_nid()) {
+      EXPECT_FALSE(occ.attr(test_attrs::dhbits).has());
+      occ.attr(test_attrs::dhbits).set(100 + static_cast<int>(late_hits++));
+    }
+  }
+  EXPECT_EQ(late_hits, 3u);
+  EXPECT_EQ(map->size(), 21u);
+  occs[0].attr(test_attrs::dhbits).del();
+  EXPECT_FALSE(occs[0].attr(test_attrs::dhbits).has());
+  EXPECT_EQ(map->size(), 20u);
+
+  std::map<std::pair<hhds::Nid, size_t>, int> expected;
+  std::map<hhds::Nid, size_t>                 seen;
+  for (auto& occ : occs) {
+    const auto* v = occ.attr(test_attrs::dhbits).try_get();
+    expected[{occ.get_debug_nid(), seen[occ.get_debug_nid()]++}] = v != nullptr ? *v : 0;
+  }
+
+  lib.save(test_dir);
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto loaded = leaf_occurrences(lib2.find_io("top")->get_graph(), lib2.find_io("leaf")->get_gid());
+  ASSERT_EQ(loaded.size(), occs.size());
+  seen.clear();
+  for (auto& occ : loaded) {
+    const auto* v = occ.attr(test_attrs::dhbits).try_get();
+    EXPECT_EQ((v != nullptr ? *v : 0), (expected[{occ.get_debug_nid(), seen[occ.get_debug_nid()]++}]));
+  }
+
+  // Compaction rekeys inside the blocks, drops entries of deleted nodes and
+  // rebinds to the current node count, so a later node moves into the blocks.
+  auto late2 = leaf->create_node();
+  occs       = leaf_occurrences(top, leaf->get_gid());
+  for (auto& occ : occs) {
+    if (occ.get_debug_nid() == late2.get_debug_nid()) {
+      occ.attr(test_attrs::dhbits).set(200);
+    }
+  }
+  const auto gone = leaf_nodes[0].get_debug_nid();
+  std::vector<int> before;
+  for (auto& occ : occs) {
+    if (occ.get_debug_nid() != gone && occ.get_debug_nid() != late.get_debug_nid()) {
+      before.push_back(occ.attr(test_attrs::dhbits).get_or(0));
+    }
+  }
+  leaf_nodes[0].del_node();
+  late.del_node();
+  const auto remap = leaf->compact();
+  EXPECT_FALSE(remap.is_identity());
+  std::vector<int> after;
+  for (auto& occ : leaf_occurrences(top, leaf->get_gid())) {
+    after.push_back(occ.attr(test_attrs::dhbits).get_or(0));
+  }
+  EXPECT_EQ(after, before);
+  EXPECT_EQ(std::count(after.begin(), after.end(), 200), 3);
+  const auto* compacted = leaf->find_attr_store(test_attrs::dhbits);
+  EXPECT_EQ(compacted->size(), before.size());
+  EXPECT_EQ(compacted->key_space().slots(hhds::Attr_column::Node), (remap.remap(late2.get_debug_nid()) >> 2) + 1);
+  fs::remove_all(test_dir);
+}
+
 // ------------------------------------------------------------------
 // Tree storage tests
 // ------------------------------------------------------------------
@@ -703,6 +1266,563 @@ TEST(GraphPersistence, OverflowSetRoundTrip) {
   fs::remove_all(test_dir);
 }
 
+// Fanout crosses every overflow tier: inline -> slab chunks (16, 32) -> hash
+// set. Each step must keep the exact edge set, and deletions must hit the
+// right tier.
+TEST(GraphStorage, OverflowSlabTierGrowsAndPromotes) {
+  for (const uint32_t threshold : {hhds::kDefaultOverflowPromoteThreshold, 0u}) {
+    hhds::GraphLibrary lib;
+    auto               gio   = lib.create_io("top");
+    auto               graph = gio->create_graph();
+    graph->set_overflow_promote_threshold(threshold);
+
+    auto                          hub = graph->create_node();
+    auto                          hp  = hub.create_driver_pin(3);
+    std::vector<hhds::Node_class> targets;
+    for (size_t i = 0; i < 80; ++i) {
+      auto t = graph->create_node();
+      targets.push_back(t);
+      hub.create_driver_pin(0).connect_sink(t.create_sink_pin(0));
+      hp.connect_sink(t.create_sink_pin(1));
+      EXPECT_EQ(hub.get_driver_pin(0).out_edges().size(), i + 1);
+      EXPECT_EQ(hp.out_edges().size(), i + 1);
+    }
+    for (size_t i = 0; i < targets.size(); i += 2) {
+      hp.del_sink(targets[i].create_sink_pin(1));
+    }
+    EXPECT_EQ(hp.out_edges().size(), 40u);
+    for (size_t i = 0; i < targets.size(); ++i) {
+      EXPECT_EQ(targets[i].get_sink_pin(1).inp_edges().size(), i % 2) << i;
+    }
+
+    // A second hub reuses the chunks freed when the first one grew.
+    auto hub2 = graph->create_node();
+    for (size_t i = 0; i < 12; ++i) {
+      hub2.create_driver_pin(0).connect_sink(targets[i].create_sink_pin(2));
+    }
+    EXPECT_EQ(hub2.out_edges().size(), 12u);
+    targets[3].del_node();
+    EXPECT_EQ(hub2.out_edges().size(), 11u);
+    EXPECT_EQ(hub.out_edges().size(), 79u + 39u);
+  }
+}
+
+// Deleting most edges of a spilled entry re-packs the survivors inline; an
+// entry whose survivors are all long edges (> 8191 apart) cannot re-pack and
+// stays in overflow. Either way the edge set must stay exact.
+TEST(GraphStorage, OverflowDemotesAfterDeletes) {
+  hhds::GraphLibrary lib;
+  auto               gio   = lib.create_io("top");
+  auto               graph = gio->create_graph();
+
+  auto                          hub = graph->create_node();
+  auto                          hp  = hub.create_driver_pin(1);
+  std::vector<hhds::Node_class> near;
+  for (size_t i = 0; i < 60; ++i) {
+    near.push_back(graph->create_node());
+  }
+  for (size_t i = 0; i < 9000; ++i) {
+    (void)graph->create_node();
+  }
+  std::vector<hhds::Node_class> far;
+  for (size_t i = 0; i < 3; ++i) {
+    far.push_back(graph->create_node());
+  }
+
+  uint64_t slab_words = 0;
+  for (int round = 0; round < 3; ++round) {
+    for (auto& n : near) {
+      hub.create_driver_pin(0).connect_sink(n.create_sink_pin(0));
+      hp.connect_sink(n.create_sink_pin(0));
+    }
+    for (auto& n : far) {
+      hp.connect_sink(n.create_sink_pin(0));
+    }
+    EXPECT_EQ(hub.get_driver_pin(0).out_edges().size(), near.size());
+    EXPECT_EQ(hp.out_edges().size(), near.size() + far.size());
+    const auto grown = graph->edge_tier_stats();
+    EXPECT_GT(grown.slab_sets + grown.hash_sets, 0u);
+
+    for (size_t i = 1; i < near.size(); ++i) {
+      hub.create_driver_pin(0).del_sink(near[i].create_sink_pin(0));
+      hp.del_sink(near[i].create_sink_pin(0));
+    }
+    EXPECT_EQ(hub.get_driver_pin(0).out_edges().size(), 1u);
+    EXPECT_EQ(hp.out_edges().size(), 1u + far.size());
+    EXPECT_EQ(near[0].inp_edges().size(), 2u);
+    EXPECT_EQ(near[1].inp_edges().size(), 0u);
+
+    // Both hash sets demote: hub's single survivor goes back inline, while
+    // hp keeps one slab chunk for its near edge plus the three far ones that
+    // cannot be encoded inline.
+    const auto shrunk = graph->edge_tier_stats();
+    EXPECT_EQ(shrunk.hash_sets, 0u);
+    EXPECT_EQ(shrunk.hash_edges, 0u);
+    EXPECT_EQ(shrunk.slab_sets, 1u);
+    EXPECT_EQ(shrunk.slab_edges, 1u + far.size());
+    EXPECT_GT(shrunk.short_edges, 0u);
+
+    hub.create_driver_pin(0).del_sink(near[0].create_sink_pin(0));
+    hp.del_sink(near[0].create_sink_pin(0));
+    EXPECT_EQ(hub.get_driver_pin(0).out_edges().size(), 0u);
+    for (auto& n : far) {
+      EXPECT_EQ(n.inp_edges().size(), 1u);
+      hp.del_sink(n.create_sink_pin(0));
+    }
+    EXPECT_FALSE(hub.has_out_edges());
+
+    // Every overflow set is released, and later rounds reuse the slab chunks
+    // freed by the first one instead of growing the arena.
+    const auto empty = graph->edge_tier_stats();
+    EXPECT_EQ(empty.slab_sets, 0u);
+    EXPECT_EQ(empty.hash_sets, 0u);
+    EXPECT_EQ(empty.total_edges(), 0u);
+    if (round == 0) {
+      slab_words = graph->memory_stats().overflow_slab;
+      EXPECT_GT(slab_words, 0u);
+    } else {
+      EXPECT_EQ(graph->memory_stats().overflow_slab, slab_words);
+    }
+  }
+}
+
+TEST(GraphStorage, CompactDropsTombstonesAndRemapsIds) {
+  hhds::GraphLibrary lib;
+
+  auto leaf_io = lib.create_io("leaf");
+  auto leaf    = leaf_io->create_graph();
+  auto leaf_n  = leaf->create_node();
+
+  auto gio = lib.create_io("top");
+  gio->add_input("a", 1);
+  auto graph = gio->create_graph();
+
+  // Interleave survivors with nodes that get deleted, so every survivor moves.
+  std::vector<hhds::Node> keep;
+  std::vector<hhds::Node> drop;
+  for (int i = 0; i < 40; ++i) {
+    keep.push_back(graph->create_node());
+    drop.push_back(graph->create_node());
+  }
+  auto hub  = keep[0];
+  auto inst = keep[1];
+  inst.set_subnode(leaf_io);
+  for (size_t i = 2; i < keep.size(); ++i) {
+    hub.create_driver_pin(7).connect_sink(keep[i].create_sink_pin(0));  // overflow on the hub pin
+    drop[i].create_driver_pin(3).connect_sink(keep[i].create_sink_pin(2));
+    keep[i].attr(hhds::attrs::name).set("k" + std::to_string(i));
+  }
+  graph->get_input_pin("a").connect_sink(inst.create_sink_pin(0));
+  hub.create_driver_pin(7).attr(test_attrs::bits).set(77);
+
+  hhds::Occurrence_node leaf_occ;
+  for (auto node : graph->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+    if (node.get_current_gid() == leaf->get_gid() && node.get_debug_nid() == leaf_n.get_debug_nid()) {
+      leaf_occ = node;
+    }
+  }
+  leaf_occ.attr(test_attrs::hbits).set(5);
+
+  for (auto n : drop) {
+    n.del_node();
+  }
+
+  const auto remap = graph->compact();
+  EXPECT_FALSE(remap.is_identity());
+  for (auto n : drop) {
+    EXPECT_EQ(remap.remap(n.get_class_index()).value, 0u);
+  }
+  EXPECT_EQ(remap.remap(hhds::Class_index{hhds::Graph::CONST_NODE}).value, hhds::Graph::CONST_NODE);
+
+  size_t live = 0;
+  for ([[maybe_unused]] auto node : graph->body().nodes()) {
+    ++live;
+  }
+  EXPECT_EQ(live, keep.size());
+
+  auto at = [&](hhds::Node old) { return graph->get_node(remap.remap(old.get_class_index())); };
+  auto hub2 = at(hub);
+  EXPECT_EQ(hub2.get_debug_nid(), 4u << 2);  // first user slot
+  EXPECT_EQ(hub2.get_driver_pin(7).out_edges().size(), keep.size() - 2);
+  EXPECT_EQ(hub2.get_driver_pin(7).attr(test_attrs::bits).get(), 77);
+  for (size_t i = 2; i < keep.size(); ++i) {
+    auto n = at(keep[i]);
+    EXPECT_EQ(n.attr(hhds::attrs::name).get(), "k" + std::to_string(i));
+    EXPECT_EQ(n.get_sink_pin(2).inp_edges().size(), 0u);  // its driver was deleted
+    ASSERT_EQ(n.create_sink_pin(0).inp_edges().size(), 1u);
+    EXPECT_EQ(n.create_sink_pin(0).inp_edges()[0].driver.get_master_node(), hub2);
+  }
+  auto inst2 = at(inst);
+  EXPECT_EQ(inst2.get_subnode_gid(), leaf->get_gid());
+  EXPECT_EQ(graph->get_input_pin("a").out_edges().size(), 1u);
+
+  // The hier attr recorded through the (renumbered) instance still resolves.
+  int hits = 0;
+  for (auto node : graph->grouped_hierarchy().nodes(hhds::Node_order::forward)) {
+    if (node.get_current_gid() == leaf->get_gid() && node.get_debug_nid() == leaf_n.get_debug_nid()) {
+      EXPECT_EQ(node.attr(test_attrs::hbits).get(), 5);
+      ++hits;
+    }
+  }
+  EXPECT_EQ(hits, 1);
+
+  // A second pass has nothing left to reclaim.
+  EXPECT_TRUE(graph->compact().is_identity());
+}
+
+TEST(GraphStorage, RelayoutShortensEdgeDeltas) {
+  for (const auto order : {hhds::Relayout_order::rcm, hhds::Relayout_order::bfs}) {
+    hhds::GraphLibrary lib;
+    auto               gio   = lib.create_io("top");
+    auto               graph = gio->create_graph();
+
+    // A chain whose consecutive links sit ~15000 slots apart: every edge
+    // misses the 13-bit delta magnitude in creation order.
+    constexpr size_t        kN = 30000;
+    std::vector<hhds::Node> nodes;
+    for (size_t i = 0; i < kN; ++i) {
+      nodes.push_back(graph->create_node());
+    }
+    std::vector<hhds::Node> chain;
+    for (size_t k = 0; k < kN; ++k) {
+      chain.push_back(nodes[(k * 14999) % kN]);
+    }
+    for (size_t k = 0; k + 1 < kN; ++k) {
+      chain[k].create_driver_pin(0).connect_sink(chain[k + 1].create_sink_pin(0));
+    }
+    chain.front().attr(hhds::attrs::name).set("head");
+
+    const auto result = graph->relayout(order);
+    EXPECT_EQ(result.before.total_edges(), 2 * (kN - 1));
+    EXPECT_EQ(result.after.total_edges(), result.before.total_edges());
+    EXPECT_GT(result.before.long_edges, kN);
+    EXPECT_EQ(result.after.long_edges, 0u);
+    EXPECT_EQ(result.after.slab_sets + result.after.hash_sets, 0u);
+
+    // Walk the renumbered chain end to end.
+    auto cur = graph->get_node(result.remap.remap(chain.front().get_class_index()));
+    EXPECT_EQ(cur.attr(hhds::attrs::name).get(), "head");
+    size_t steps = 0;
+    while (true) {
+      auto out = cur.create_driver_pin(0).out_edges();
+      if (out.size() == 0) {
+        break;
+      }
+      cur = (*out.begin()).sink.get_master_node();
+      ++steps;
+    }
+    EXPECT_EQ(steps, kN - 1);
+    EXPECT_EQ(cur, graph->get_node(result.remap.remap(chain.back().get_class_index())));
+  }
+}
+
+TEST(GraphStorage, BulkAddEdgesMatchesPerEdgeConnect) {
+  hhds::GraphLibrary lib;
+  auto               one_io  = lib.create_io("one");
+  auto               bulk_io = lib.create_io("bulk");
+  auto               one     = one_io->create_graph();
+  auto               bulk    = bulk_io->create_graph();
+  bulk->reserve(4 + 130, 1 + 130);
+
+  // hub fans out past the promotion threshold (hash tier), mid lands in the
+  // slab tier, and the rest stay inline; some sinks already carry an edge.
+  std::vector<hhds::Node> a;
+  std::vector<hhds::Node> b;
+  for (int i = 0; i < 130; ++i) {
+    a.push_back(one->create_node());
+    b.push_back(bulk->create_node());
+  }
+  std::vector<std::pair<size_t, size_t>> conn;
+  for (size_t i = 2; i < 130; ++i) {
+    conn.emplace_back(0, i);
+  }
+  for (size_t i = 2; i < 22; ++i) {
+    conn.emplace_back(1, i);
+  }
+  for (size_t i = 3; i < 130; i += 7) {
+    conn.emplace_back(i, i - 1);
+  }
+  a[5].create_driver_pin(1).connect_sink(a[6].create_sink_pin(0));
+  b[5].create_driver_pin(1).connect_sink(b[6].create_sink_pin(0));
+
+  std::vector<std::pair<hhds::Pin, hhds::Pin>> batch;
+  for (const auto& [d, sk] : conn) {
+    a[d].create_driver_pin(1).connect_sink(a[sk].create_sink_pin(0));
+    batch.emplace_back(b[d].create_driver_pin(1), b[sk].create_sink_pin(0));
+  }
+  size_t before = 0;
+  for ([[maybe_unused]] auto n : bulk->body().nodes(hhds::Node_order::forward)) {
+    ++before;  // primes the traversal caches that add_edges must invalidate
+  }
+  EXPECT_EQ(before, 130u);
+  bulk->add_edges(batch);
+
+  for (size_t i = 0; i < 130; ++i) {
+    EXPECT_EQ(b[i].create_driver_pin(1).out_edges().size(), a[i].create_driver_pin(1).out_edges().size()) << i;
+    EXPECT_EQ(b[i].create_sink_pin(0).inp_edges().size(), a[i].create_sink_pin(0).inp_edges().size()) << i;
+  }
+  const auto stats = bulk->edge_tier_stats();
+  EXPECT_EQ(stats.total_edges(), one->edge_tier_stats().total_edges());
+  EXPECT_EQ(stats.hash_sets, 1u);
+  EXPECT_GE(stats.slab_sets, 1u);
+
+  // Forward order sees the new edges: every driver precedes its sinks.
+  std::vector<size_t> pos(130 * 4 + 16, 0);
+  size_t              k = 0;
+  for (auto n : bulk->body().nodes(hhds::Node_order::forward)) {
+    pos[n.get_debug_nid() >> 2] = k++;
+  }
+  for (const auto& [d, sk] : conn) {
+    EXPECT_LT(pos[b[d].get_debug_nid() >> 2], pos[b[sk].get_debug_nid() >> 2]);
+  }
+}
+
+TEST(GraphStorage, SedgeDecoderMatchesScalarReference) {
+  // The build-selected decoder (see sedge_decoder_isa()) must agree with the
+  // scalar loop on every lane, including empty slots and both sign halves.
+  std::mt19937_64 rng(12345);
+  for (int iter = 0; iter < 20000; ++iter) {
+    uint64_t packed = rng();
+    uint64_t extra  = rng() & ((1ULL << 48) - 1);
+    for (int lane = 0; lane < 8; ++lane) {
+      if (rng() % 3 == 0) {  // sprinkle empty slots
+        uint64_t& w = lane < 4 ? packed : extra;
+        w &= ~(0xFFFFULL << ((lane & 3) * 16));
+      }
+    }
+    const uint64_t           self = (rng() >> 24) + 8192;
+    std::array<hhds::Vid, 8> ref{};
+    std::array<hhds::Vid, 8> got{};
+    std::array<hhds::Vid, 8> got4{};
+    const auto               ref_m  = hhds::detail::decode_sedges_scalar(packed, extra, self, ref.data());
+    const auto               got_m  = hhds::detail::decode_sedges(packed, extra, self, got.data());
+    const auto               got4_m = hhds::detail::decode_sedges4(packed, self, got4.data());
+    ASSERT_EQ(got_m.live, ref_m.live) << hhds::detail::sedge_decoder_isa();
+    ASSERT_EQ(got_m.back, ref_m.back) << hhds::detail::sedge_decoder_isa();
+    ASSERT_EQ(got4_m.live, ref_m.live & 0xF);
+    ASSERT_EQ(got4_m.back, ref_m.back & 0xF);
+    for (int lane = 0; lane < 8; ++lane) {
+      const uint64_t raw = ((lane < 4 ? packed : extra) >> ((lane & 3) * 16)) & 0xFFFF;
+      ASSERT_EQ((ref_m.live >> lane) & 1U, raw != 0 ? 1U : 0U);
+      if (raw != 0) {
+        ASSERT_EQ(got[lane], ref[lane]) << lane;
+        ASSERT_EQ((ref_m.back >> lane) & 1U, (raw >> 1) & 1U);
+        if (lane < 4) {
+          ASSERT_EQ(got4[lane], ref[lane]) << lane;
+        }
+      }
+    }
+    std::array<hhds::Vid, 8> squeezed = got;
+    const unsigned           n        = hhds::detail::compact_live(squeezed.data(), got_m.live);
+    ASSERT_EQ(n, static_cast<unsigned>(std::popcount(got_m.live)));
+    unsigned k = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+      if ((got_m.live >> lane) & 1U) {
+        ASSERT_EQ(squeezed[k++], got[lane]);
+      }
+    }
+    for (const bool back : {false, true}) {
+      std::array<hhds::Vid, 8> dir{};
+      std::array<hhds::Vid, 8> dir4{};
+      const unsigned           nd  = hhds::detail::decode_sedges_dir(packed, extra, self, back, dir.data());
+      const unsigned           nd4 = hhds::detail::decode_sedges4_dir(packed, self, back, dir4.data());
+      unsigned                 j   = 0;
+      unsigned                 j4  = 0;
+      for (int lane = 0; lane < 8; ++lane) {
+        if (((ref_m.live >> lane) & 1U) && ((ref_m.back >> lane) & 1U) == (back ? 1U : 0U)) {
+          ASSERT_EQ(dir[j++], ref[lane]) << lane;
+          if (lane < 4) {
+            ASSERT_EQ(dir4[j4++], ref[lane]) << lane;
+          }
+        }
+      }
+      ASSERT_EQ(nd, j);
+      ASSERT_EQ(nd4, j4);
+    }
+  }
+
+  // has_out_edges / has_inp_edges answer from the masks; cover every tier.
+  hhds::GraphLibrary lib;
+  auto               g   = lib.create_io("top")->create_graph();
+  auto               hub = g->create_node();
+  auto               lhs = g->create_node();
+  auto               rhs = g->create_node();
+  EXPECT_FALSE(hub.has_out_edges());
+  lhs.create_driver_pin(3).connect_sink(rhs.create_sink_pin(0));
+  EXPECT_TRUE(lhs.has_out_edges());
+  EXPECT_FALSE(lhs.has_inp_edges());
+  EXPECT_TRUE(rhs.has_inp_edges());
+  EXPECT_FALSE(rhs.has_out_edges());
+  for (int i = 0; i < 40; ++i) {
+    auto t = g->create_node();
+    t.create_driver_pin(0).connect_sink(hub.create_sink_pin(0));
+  }
+  EXPECT_TRUE(hub.has_inp_edges());
+  EXPECT_FALSE(hub.has_out_edges());
+}
+
+TEST(GraphStorage, CsrSnapshotMatchesLiveEdges) {
+  hhds::GraphLibrary lib;
+  auto               gio = lib.create_io("top");
+  gio->add_input("a", 1);
+  gio->add_output("z", 2);
+  auto g = gio->create_graph();
+
+  // Mix of node-as-pin and port>0 edges, a hub in the hash tier, a pin on
+  // both sides of a net, a deleted node, and the graph IO pins.
+  std::vector<hhds::Node> n;
+  for (int i = 0; i < 120; ++i) {
+    n.push_back(g->create_node());
+  }
+  for (int i = 1; i < 120; ++i) {
+    n[0].create_driver_pin(0).connect_sink(n[i].create_sink_pin(0));
+  }
+  std::vector<hhds::Pin> pins;
+  for (int i = 2; i < 119; i += 3) {
+    pins.push_back(n[i].create_driver_pin(i % 5 + 1));
+    pins.push_back(n[i + 1].create_sink_pin(i % 4 + 1));
+    pins[pins.size() - 2].connect_sink(pins.back());
+  }
+  pins.push_back(n[1].create_sink_pin(7));
+  g->get_input_pin("a").connect_sink(pins.back());
+  pins.push_back(n[118].create_driver_pin(3));
+  pins.back().connect_sink(g->get_output_pin("z"));
+  n[40].del_node();
+  n.erase(n.begin() + 40);
+
+  using Key  = std::pair<hhds::Pid, hhds::Pid>;
+  auto keyed = [](const auto& range) {
+    std::vector<Key> out;
+    for (const auto& e : range) {
+      out.emplace_back(e.driver.get_debug_pid(), e.sink.get_debug_pid());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+
+  const auto csr = g->freeze_csr();
+  ASSERT_TRUE(csr->is_current());
+  EXPECT_EQ(g->freeze_csr(), csr);  // cached while nothing moves
+  size_t total = 0;
+  for (auto node : g->body().nodes()) {
+    EXPECT_EQ(keyed(csr->out_edges(node)), keyed(node.out_edges())) << node.get_debug_nid();
+    EXPECT_EQ(keyed(csr->inp_edges(node)), keyed(node.inp_edges())) << node.get_debug_nid();
+    total += csr->out_edges(node).size();
+  }
+  for (const auto& pin : pins) {
+    EXPECT_EQ(keyed(csr->out_edges(pin)), keyed(pin.out_edges())) << pin.get_debug_pid();
+    EXPECT_EQ(keyed(csr->inp_edges(pin)), keyed(pin.inp_edges())) << pin.get_debug_pid();
+  }
+  const auto in_pin = g->get_input_pin("a");
+  EXPECT_EQ(keyed(csr->out_edges(in_pin)), keyed(in_pin.out_edges()));
+  EXPECT_EQ(csr->out_edges(n[0]).size(), 118u);
+  EXPECT_LE(total, csr->num_edges());
+  EXPECT_EQ(csr->inp_edges(in_pin).size(), 0u);
+
+  // Any mutation moves the epoch: the old snapshot stays readable but stale.
+  n[3].create_driver_pin(0).connect_sink(n[4].create_sink_pin(0));
+  EXPECT_FALSE(csr->is_current());
+  EXPECT_EQ(keyed(csr->out_edges(n[3].create_driver_pin(0))).size(), 0u);
+  const auto fresh = g->freeze_csr();
+  EXPECT_NE(fresh, csr);
+  EXPECT_EQ(keyed(fresh->out_edges(n[3])), keyed(n[3].out_edges()));
+}
+
+TEST(GraphStorage, MemoryStatsTrackGrowth) {
+  hhds::register_attr_tag<test_attrs::dbits_t>("test_attrs::dbits");
+  hhds::GraphLibrary lib;
+  auto               g = lib.create_io("top")->create_graph();
+
+  const auto empty = g->memory_stats();
+  EXPECT_EQ(empty.attr_stores, 0u);
+  EXPECT_TRUE(empty.attrs.empty());
+
+  std::vector<hhds::Node> n;
+  for (int i = 0; i < 200; ++i) {
+    n.push_back(g->create_node());
+    n.back().attr(test_attrs::dbits).set(i + 1);
+  }
+  for (int i = 1; i < 200; ++i) {
+    n[0].create_driver_pin(0).connect_sink(n[i].create_sink_pin(0));  // hub -> hash tier
+  }
+  n[1].create_driver_pin(0).connect_sink(n[2].create_sink_pin(0));
+  (void)g->freeze_csr();
+
+  const auto stats = g->memory_stats();
+  EXPECT_GE(stats.node_table, 200u * 16);  // >= 16 bytes per entry
+  EXPECT_GT(stats.pin_table, 0u);
+  EXPECT_GT(stats.overflow_sets, 0u);
+  EXPECT_GT(stats.traversal_caches, 0u);  // the CSR snapshot
+  EXPECT_FALSE(stats.overflow_deferred);
+
+  const auto tiers = g->edge_tier_stats();
+  EXPECT_EQ(stats.edges.total_edges(), tiers.total_edges());
+  EXPECT_EQ(stats.edges.hash_sets, tiers.hash_sets);
+  EXPECT_GE(stats.edges.hash_edges, 199u);
+
+  ASSERT_EQ(stats.attrs.size(), 1u);
+  EXPECT_EQ(stats.attrs[0].persistent_id, "test_attrs::dbits");
+  EXPECT_EQ(stats.attrs[0].entries, 200u);
+  EXPECT_GE(stats.attrs[0].bytes, 200 * sizeof(int));
+  EXPECT_EQ(stats.attr_stores, stats.attrs[0].bytes);
+  EXPECT_GT(stats.total_bytes(), empty.total_bytes());
+
+  // The library view sums its bodies.
+  auto g2 = lib.create_io("other")->create_graph();
+  (void)g2->create_node();
+  const auto lib_stats = lib.memory_stats();
+  EXPECT_EQ(lib_stats.graphs, 2u);
+  EXPECT_EQ(lib_stats.pending_graphs, 0u);
+  EXPECT_EQ(lib_stats.bodies.node_table, stats.node_table + g2->memory_stats().node_table);
+  EXPECT_EQ(lib_stats.bodies.edges.total_edges(), tiers.total_edges());
+  EXPECT_GE(lib_stats.total_bytes(), stats.total_bytes());
+
+  std::ostringstream os;
+  lib_stats.print(os);
+  EXPECT_NE(os.str().find("attr[test_attrs::dbits]="), std::string::npos);
+}
+
+TEST(GraphPersistence, OverflowSlabRoundTrip) {
+  namespace fs               = std::filesystem;
+  const std::string test_dir = "/tmp/hhds_test_graph_overflow_slab";
+  fs::remove_all(test_dir);
+
+  hhds::GraphLibrary lib;
+  auto               gio   = lib.create_io("top");
+  auto               graph = gio->create_graph();
+
+  // small: slab tier; big: hash tier; mid: grew through two chunk classes.
+  auto small = graph->create_node();
+  auto mid   = graph->create_node();
+  auto big   = graph->create_node();
+  for (size_t i = 0; i < 100; ++i) {
+    auto t = graph->create_node();
+    if (i < 12) {
+      small.create_driver_pin(0).connect_sink(t.create_sink_pin(0));
+    }
+    if (i < 30) {
+      mid.create_driver_pin(0).connect_sink(t.create_sink_pin(0));
+    }
+    big.create_driver_pin(0).connect_sink(t.create_sink_pin(0));
+  }
+  lib.save(test_dir);
+
+  hhds::GraphLibrary lib2;
+  lib2.load(test_dir);
+  auto graph2 = lib2.find_io("top")->get_graph();
+  ASSERT_NE(graph2, nullptr);
+  EXPECT_EQ(hhds::Node_class(graph2.get(), small.get_debug_nid()).out_edges().size(), 12u);
+  EXPECT_EQ(hhds::Node_class(graph2.get(), mid.get_debug_nid()).out_edges().size(), 30u);
+  EXPECT_EQ(hhds::Node_class(graph2.get(), big.get_debug_nid()).out_edges().size(), 100u);
+
+  // The reloaded arena keeps accepting edges.
+  auto extra = graph2->create_node();
+  hhds::Node_class(graph2.get(), small.get_debug_nid()).create_driver_pin(0).connect_sink(extra.create_sink_pin(0));
+  EXPECT_EQ(hhds::Node_class(graph2.get(), small.get_debug_nid()).out_edges().size(), 13u);
+
+  fs::remove_all(test_dir);
+}
+
 // Build a graph named `nm` in `lib` whose single hub node spills into an
 // overflow set (>inline fanout); returns {gid, hub debug-nid} for later checks.
 static std::pair<hhds::Gid, hhds::Nid> make_overflow_graph(hhds::GraphLibrary& lib, const char* nm) {
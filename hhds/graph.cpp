@@ -3,17 +3,21 @@
 #include <strings.h>
 
 #include <algorithm>
+#include <atomic>
 #include <ctime>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <queue>
 #include <sstream>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include "sedge_decode.hpp"
 #include "serial_prune.hpp"
 #include "tree.hpp"
 
@@ -34,6 +38,12 @@
 
 namespace hhds {
 
+// Shared traversal constant: where iteration over user nodes begins in
+// node_table. 0:invalid, 1:INPUT, 2:OUTPUT, 3:CONST are built-in singletons
+// reached via Graph::get_input_node/get_output_node/get_constant_node — never
+// emitted by class/flat/hier traversals. User nodes start at idx 4.
+static constexpr size_t kFirstUserNodeIdx = 4;
+
 namespace detail {
 
 struct Occurrence_path_storage {
@@ -117,6 +127,12 @@ struct Hierarchy_view_state : public std::enable_shared_from_this<Hierarchy_view
   std::unordered_map<Occurrence_index, Instance_action> verdicts;
   const GraphLibrary*                                   library        = nullptr;
   uint64_t                                              mutation_epoch = 0;
+  // Set on the per-worker states of a parallel walk: serializes the policy
+  // call and loop validation (neither needs to be thread-safe), and each
+  // loop site is validated once per worker. Shared ownership: nodes emitted
+  // by a worker keep its state, and may reach the policy, after the walk.
+  std::shared_ptr<std::mutex>          shared_mu;
+  std::unordered_set<Definition_index> validated;
 
   Hierarchy_view_state(Graph* root_value, bool expand_value, Hierarchy_policy policy_value,
                        const ankerl::unordered_dense::set<Gid>* opaque_value)
@@ -191,7 +207,12 @@ struct Hierarchy_view_state : public std::enable_shared_from_this<Hierarchy_view
       result = Instance_action::opaque;
     } else if (policy) {
       const Instance_site instance(path(parent_handle), site.subnode_group());
-      result = policy(instance);
+      if (shared_mu != nullptr) {
+        std::lock_guard lock(*shared_mu);
+        result = policy(instance);
+      } else {
+        result = policy(instance);
+      }
     }
     verdicts.emplace(key, result);
     return result;
@@ -335,39 +356,68 @@ struct Hierarchy_view_state : public std::enable_shared_from_this<Hierarchy_view
 
   void visit_body(Graph* graph, uint32_t body_handle, ankerl::unordered_dense::set<Gid>& active,
                   std::vector<Occurrence_node>& out) {
+    auto push = [&out](const Occurrence_node& node) { out.push_back(node); };
+    visit_body(graph, body_handle, active, push);
+  }
+
+  void visit_body(Graph* graph, uint32_t body_handle, ankerl::unordered_dense::set<Gid>& active,
+                  function_ref<void(const Occurrence_node&)> emit) {
     if (graph == nullptr || active.contains(graph->get_gid())) {
       return;
     }
     active.insert(graph->get_gid());
-    for (const auto node : graph->body().nodes()) {
-      const auto sub_io = node.get_subnode_io();
-      if (!sub_io) {
-        out.push_back(make_node(node, body_handle, body_handle));
+    visit_slice(graph, body_handle, kFirstUserNodeIdx, graph->node_table.size(), active, emit);
+    active.erase(graph->get_gid());
+  }
+
+  // Storage slots [lo, hi) of a body already on the active stack, in nodes()
+  // order: a call site yields each of its ordinals, then its callee body.
+  void visit_slice(Graph* graph, uint32_t body_handle, size_t lo, size_t hi, ankerl::unordered_dense::set<Gid>& active,
+                   function_ref<void(const Occurrence_node&)> emit) {
+    hi = std::min(hi, graph->node_table.size());
+    for (FastClassIterator it(graph, lo, hi), end(graph, hi, hi); it != end; ++it) {
+      const auto node = *it;
+      if (!node.get_subnode_io()) {
+        emit(make_node(node, body_handle, body_handle));
         continue;
       }
-
       const auto verdict = action(body_handle, node);
       if (verdict == Instance_action::prune) {
         continue;
       }
-      const auto group = node.subnode_group();
-      if (group.is_loop()) {
-        group.validate();
-      }
-      const bool     loop_expanded = expand_loops && group.is_loop();
-      const uint64_t count         = loop_expanded ? group.size() : 1;
-      for (uint64_t ordinal = 0; ordinal < count; ++ordinal) {
-        const std::optional<uint64_t> path_ordinal = loop_expanded ? std::optional<uint64_t>(ordinal) : std::nullopt;
-        const uint32_t                call_handle  = append_path(body_handle, node, path_ordinal);
-        out.push_back(make_node(node, call_handle, body_handle));
-        if (verdict == Instance_action::descend) {
-          if (auto child = subgraph(node)) {
-            visit_body(child.get(), call_handle, active, out);
-          }
+      visit_calls(node, verdict, body_handle, 0, std::numeric_limits<uint64_t>::max(), active, emit);
+    }
+  }
+
+  // Ordinals [first, last) of one call site (clamped to its size).
+  void visit_calls(Node_class site, Instance_action verdict, uint32_t body_handle, uint64_t first, uint64_t last,
+                   ankerl::unordered_dense::set<Gid>& active, function_ref<void(const Occurrence_node&)> emit) {
+    const auto group = site.subnode_group();
+    validate(group, site);
+    const bool     loop_expanded = expand_loops && group.is_loop();
+    const uint64_t count         = std::min(last, loop_expanded ? group.size() : 1);
+    for (uint64_t ordinal = first; ordinal < count; ++ordinal) {
+      const std::optional<uint64_t> path_ordinal = loop_expanded ? std::optional<uint64_t>(ordinal) : std::nullopt;
+      const uint32_t                call_handle  = append_path(body_handle, site, path_ordinal);
+      emit(make_node(site, call_handle, body_handle));
+      if (verdict == Instance_action::descend) {
+        if (auto child = subgraph(site)) {
+          visit_body(child.get(), call_handle, active, emit);
         }
       }
     }
-    active.erase(graph->get_gid());
+  }
+
+  void validate(const Subnode_group& group, Node_class site) {
+    if (!group.is_loop()) {
+      return;
+    }
+    if (shared_mu == nullptr) {
+      group.validate();
+    } else if (validated.insert(site.get_definition_index()).second) {
+      std::lock_guard lock(*shared_mu);
+      group.validate();
+    }
   }
 
   [[nodiscard]] std::vector<uint32_t> site_handles(uint32_t parent_handle, Node_class site) {
@@ -389,23 +439,120 @@ struct Hierarchy_view_state : public std::enable_shared_from_this<Hierarchy_view
 
   [[nodiscard]] uint32_t handle_of(const Occurrence_path& value) const noexcept { return value.interned_handle(); }
 
+  // Slots of `graph`'s body in forward (or reverse) dependency order with
+  // loop_breaks in place. An acyclic body hands out its maintained order
+  // without copying; a cyclic one is materialized into `local` (nullptr).
+  [[nodiscard]] static const std::vector<uint32_t>* body_order(Graph* graph, bool forward, std::vector<uint32_t>& local) {
+    if (forward) {
+      graph->ensure_forward_caches();
+      if (graph->forward_order_valid_) {
+        return &graph->forward_order_cache_;
+      }
+      for (const auto node : graph->body().nodes(Node_order::forward)) {
+        local.push_back(static_cast<uint32_t>(node.get_debug_nid() >> 2));
+      }
+      return nullptr;
+    }
+    graph->ensure_backward_caches();
+    if (graph->backward_order_valid_) {
+      return &graph->backward_order_cache_;
+    }
+    for (const auto node : graph->body().nodes(Node_order::reverse)) {
+      local.push_back(static_cast<uint32_t>(node.get_debug_nid() >> 2));
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] static bool is_live(const Graph* graph, size_t idx) noexcept {
+    return idx < graph->node_table.size() && graph->node_table[idx].is_alive();
+  }
+
+  // Occurrences_view::cone: a plain worklist over occurrence refs; the
+  // visited set is one node_table bitmap per cone slot (see Occurrence_cone).
+  [[nodiscard]] Occurrence_cone cone(std::span<const Occurrence_node> seeds, const Cone_options& opts) {
+    assert_unmutated();
+    const bool                  forward = opts.direction == Direction::forward;
+    Occurrence_cone             result;
+    std::vector<Occurrence_ref> pending;
+    const auto                  claim = [&](const Occurrence_ref& ref) {
+      const size_t key = Occurrence_cone::slot_of(ref);
+      if (key >= result.slots_.size()) {
+        result.slots_.resize(std::max(key + 1, paths->entries.size() * 2));
+      }
+      auto& slot = result.slots_[key];
+      if (slot.graph == nullptr) {
+        slot.graph     = ref.graph;
+        slot.container = ref.container;
+        slot.bits.assign((ref.graph->node_table.size() + 63) / 64, 0);
+      }
+      assert(slot.graph == ref.graph);
+      const auto idx = static_cast<size_t>(ref.nid >> 2);
+      const auto bit = uint64_t{1} << (idx % 64);
+      if (slot.bits[idx / 64] & bit) {
+        return false;
+      }
+      slot.bits[idx / 64] |= bit;
+      ++result.count_;
+      return true;
+    };
+
+    for (const auto& seed : seeds) {
+      assert((seed.is_invalid() || seed.state_.get() == this) && "cone: seed from another view");
+      if (!seed.is_invalid()) {
+        claim(seed.ref());
+        pending.push_back(seed.ref());  // a seed expands even if another seed reached it
+      }
+    }
+    while (!pending.empty()) {
+      const auto ref = pending.back();
+      pending.pop_back();
+      const auto node  = make_node(Node_class(ref.graph, ref.nid), ref.path, ref.container);
+      const auto edges = forward ? node.out_edges() : node.inp_edges();
+      for (const auto& edge : edges) {
+        const auto far = (forward ? edge.sink : edge.driver).get_master_node();
+        if (far.is_invalid() || static_cast<size_t>(far.get_debug_nid() >> 2) < kFirstUserNodeIdx) {
+          continue;  // graph IO and constants are never members
+        }
+        if (claim(far.ref()) && (opts.through_loop_breaks || !far.is_loop_break())) {
+          pending.push_back(far.ref());
+        }
+      }
+    }
+    refresh_epoch();  // resolving edges may have materialized a persisted body
+    return result;
+  }
+
   [[nodiscard]] std::vector<Occurrence_pin>  resolve_driver(Pin_class driver, uint32_t body_handle, int depth = 0);
   [[nodiscard]] std::vector<Occurrence_pin>  resolve_sink(Pin_class sink, uint32_t body_handle, int depth = 0);
   [[nodiscard]] std::vector<Occurrence_edge> pin_in_edges(const Occurrence_pin& pin);
   [[nodiscard]] std::vector<Occurrence_edge> pin_out_edges(const Occurrence_pin& pin);
 };
 
+// Streams a hierarchical walk with O(depth) state. Storage walks each body in
+// storage order. Forward and reverse walk each body in its own cached
+// dependency order and splice the callee body at its call site: forward
+// yields the call then its callee, reverse the callee then the call (and
+// loop ordinals last-first). Cuts is the trailing storage pass that replays
+// the loop_break occurrences for Cut_placement::last / both.
 struct Occurrence_node_cursor {
+  enum class Walk : uint8_t { storage, forward, reverse, cuts };
+
   struct Frame {
     Graph*            graph       = nullptr;
     uint32_t          body_handle = 0;
     FastClassIterator current;
     FastClassIterator end;
-    Node_class        site;
-    Instance_action   verdict      = Instance_action::prune;
-    uint64_t          next_ordinal = 0;
-    uint64_t          count        = 0;
-    bool              has_site     = false;
+    // Ordered walks: the body's maintained order, or (cyclic body) `local`.
+    const std::vector<uint32_t>* order = nullptr;
+    std::vector<uint32_t>        local;
+    bool                         use_local = false;
+    size_t                       pos       = 0;
+    Node_class                   site;
+    Instance_action              verdict      = Instance_action::prune;
+    uint64_t                     next_ordinal = 0;
+    uint64_t                     count        = 0;
+    bool                         has_site     = false;
+    bool                         entered      = false;  // reverse: the callee of this ordinal was walked
   };
 
   struct Pending_descent {
@@ -413,7 +560,12 @@ struct Occurrence_node_cursor {
     uint32_t   body_handle = 0;
   };
 
-  explicit Occurrence_node_cursor(std::shared_ptr<Hierarchy_view_state> state_value) : state(std::move(state_value)) {
+  explicit Occurrence_node_cursor(std::shared_ptr<Hierarchy_view_state> state_value, Walk walk_value = Walk::storage,
+                                  Cut_placement cuts = Cut_placement::first)
+      : state(std::move(state_value))
+      , walk(walk_value)
+      , cuts_first(cuts == Cut_placement::first || cuts == Cut_placement::both)
+      , cuts_last(walk_value != Walk::storage && (cuts == Cut_placement::last || cuts == Cut_placement::both)) {
     if (state && state->root != nullptr) {
       push_body(state->root, 0);
       advance();
@@ -422,56 +574,125 @@ struct Occurrence_node_cursor {
     }
   }
 
+  [[nodiscard]] bool ordered() const noexcept { return walk == Walk::forward || walk == Walk::reverse; }
+
   void push_body(Graph* graph, uint32_t body_handle) {
     if (graph == nullptr || active.contains(graph->get_gid())) {
       return;
     }
     active.insert(graph->get_gid());
-    const auto body = graph->body().nodes();
-    stack.push_back(Frame{graph, body_handle, body.begin(), body.end(), Node_class{}, Instance_action::prune, 0, 0, false});
+    Frame frame;
+    frame.graph       = graph;
+    frame.body_handle = body_handle;
+    if (ordered()) {
+      frame.order     = state->body_order(graph, walk == Walk::forward, frame.local);
+      frame.use_local = frame.order == nullptr;
+    } else {
+      const auto body = graph->body().nodes();
+      frame.current   = body.begin();
+      frame.end       = body.end();
+    }
+    stack.push_back(std::move(frame));
+  }
+
+  // Next node of the frame's body, or false once it is exhausted.
+  [[nodiscard]] bool next_node(Frame& frame, Node_class& node) {
+    if (!ordered()) {
+      if (frame.current == frame.end) {
+        return false;
+      }
+      node = *frame.current;
+      ++frame.current;
+      return true;
+    }
+    const auto& order = frame.use_local ? frame.local : *frame.order;
+    while (frame.pos < order.size()) {
+      const uint32_t idx = order[frame.pos++];
+      if (!state->is_live(frame.graph, idx)) {
+        continue;
+      }
+      node = Node_class(frame.graph, static_cast<Nid>(idx) << 2);
+      if (cuts_first || !node.is_loop_break() || node.get_subnode_io()) {  // a call still leads to its callee
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Positions are yielded as refs; the full handle is built only if the
+  // caller dereferences it (OccurrenceNodeRange, not refs()).
+  void emit(const Node_class& node, uint32_t identity_handle, uint32_t container_handle) {
+    current = Occurrence_ref{node.get_graph(), node.get_debug_nid(), identity_handle, container_handle};
+    ++position;
+  }
+
+  [[nodiscard]] const Occurrence_node& node() {
+    if (!materialized) {
+      materialized = state->make_node(Node_class(current.graph, current.nid), current.path, current.container);
+    }
+    return *materialized;
   }
 
   void advance() {
     state->assert_unmutated();
     current = {};
-
-    if (pending) {
-      const auto descent = *pending;
-      pending.reset();
-      if (auto child = state->subgraph(descent.site)) {
-        push_body(child.get(), descent.body_handle);
+    materialized.reset();
+
+    while (true) {
+      if (pending) {
+        const auto descent = *pending;
+        pending.reset();
+        if (auto child = state->subgraph(descent.site)) {
+          push_body(child.get(), descent.body_handle);
+        }
+      }
+      if (stack.empty()) {
+        if (!cuts_last || walk == Walk::cuts) {
+          break;
+        }
+        walk = Walk::cuts;
+        push_body(state->root, 0);
+        continue;
       }
-    }
 
-    while (!stack.empty()) {
       auto& frame = stack.back();
       if (frame.has_site) {
         if (frame.next_ordinal < frame.count) {
-          const uint64_t ordinal       = frame.next_ordinal++;
+          const bool     reverse       = walk == Walk::reverse;
+          const uint64_t ordinal       = reverse ? frame.count - 1 - frame.next_ordinal : frame.next_ordinal;
           const bool     expanded_loop = state->expand_loops && frame.site.is_loop_subnode();
           const auto     path_ordinal  = expanded_loop ? std::optional<uint64_t>(ordinal) : std::nullopt;
           const uint32_t call_handle   = state->append_path(frame.body_handle, frame.site, path_ordinal);
-          current                      = state->make_node(frame.site, call_handle, frame.body_handle);
-          if (frame.verdict == Instance_action::descend) {
+          if (reverse && frame.verdict == Instance_action::descend && !frame.entered) {
+            frame.entered = true;
+            pending       = Pending_descent{frame.site, call_handle};
+            continue;
+          }
+          frame.entered = false;
+          ++frame.next_ordinal;
+          if (!reverse && frame.verdict == Instance_action::descend) {
             pending = Pending_descent{frame.site, call_handle};
           }
-          ++position;
+          if (walk == Walk::cuts ? !frame.site.is_loop_break() : !cuts_first && frame.site.is_loop_break()) {
+            continue;
+          }
+          emit(frame.site, call_handle, frame.body_handle);
           return;
         }
         frame.has_site = false;
       }
 
-      if (frame.current == frame.end) {
+      Node_class node;
+      if (!next_node(frame, node)) {
         active.erase(frame.graph->get_gid());
         stack.pop_back();
         continue;
       }
-
-      const auto node = *frame.current;
-      ++frame.current;
       if (!node.get_subnode_io()) {
-        current = state->make_node(node, frame.body_handle, frame.body_handle);
-        ++position;
+        if (walk == Walk::cuts && !node.is_loop_break()) {
+          continue;
+        }
+        emit(node, frame.body_handle, frame.body_handle);
         return;
       }
 
@@ -488,15 +709,20 @@ struct Occurrence_node_cursor {
       frame.next_ordinal = 0;
       frame.count        = state->expand_loops && group.is_loop() ? group.size() : 1;
       frame.has_site     = true;
+      frame.entered      = false;
     }
     done = true;
   }
 
   std::shared_ptr<Hierarchy_view_state> state;
+  Walk                                  walk       = Walk::storage;
+  bool                                  cuts_first = true;
+  bool                                  cuts_last  = false;
   std::vector<Frame>                    stack;
   ankerl::unordered_dense::set<Gid>     active;
   std::optional<Pending_descent>        pending;
-  Occurrence_node                       current;
+  Occurrence_ref                        current;
+  std::optional<Occurrence_node>        materialized;
   uint64_t                              position = 0;
   bool                                  done     = false;
 };
@@ -1335,36 +1561,21 @@ Graph::PinEntry::PinEntry(Nid mn, Port_id pid)
 
 auto Graph::PinEntry::overflow_handling(Pid self_id, Vid other_id, OverflowPool& pool) -> bool {
   if (use_overflow) {
-    pool.sets[sedges_.overflow_idx].insert(other_id);
+    sedges_.overflow_idx = pool.insert(sedges_.overflow_idx, other_id);
     return true;
   }
-  uint32_t           idx       = pool.alloc();
-  auto&              hs        = pool.sets[idx];
-  constexpr int      SHIFT     = 16;
-  constexpr uint64_t SLOT_MASK = (1ULL << SHIFT) - 1;
-
-  for (int i = 0; i < 4; ++i) {
-    uint64_t raw = (sedges_.sedges >> (i * SHIFT)) & SLOT_MASK;
-    if (!raw) {
-      continue;
-    }
-    bool is_driver = raw & (1ULL << 1);
-    bool is_pin    = raw & (1ULL << 0);
-    bool neg       = raw & (1ULL << 15);
-
-    uint64_t mag  = (raw >> 2) & ((1ULL << 13) - 1);
-    int64_t  diff = neg ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
-
-    Nid actual_self = self_id >> 2;
-    Vid nid         = static_cast<Vid>(actual_self - diff);
-    Vid target      = (nid << 2) | (is_driver ? 2 : 0) | (is_pin ? 1 : 0);
-    hs.insert(target);
-  }
-  if (ledge0) {
-    hs.insert(static_cast<Vid>(ledge0));
+  // Spill: decode the inline edges, then hand them (plus other_id) to the
+  // overflow tier sized for them -- a slab chunk under the promotion threshold.
+  std::array<Vid, EdgeRange::kInlineMax + 1> spill{};
+  size_t                                     n = 0;
+  for (const Vid v : EdgeRange(this, self_id, pool.store)) {
+    spill[n++] = v;
   }
-  if (ledge1) {
-    hs.insert(static_cast<Vid>(ledge1));
+  spill[n++] = other_id;
+
+  uint32_t idx = pool.alloc_for(n);
+  for (size_t i = 0; i < n; ++i) {
+    idx = pool.insert(idx, spill[i]);
   }
   use_overflow         = true;
   // Zero the full 64-bit union word before writing the 32-bit overflow_idx so
@@ -1374,16 +1585,57 @@ auto Graph::PinEntry::overflow_handling(Pid self_id, Vid other_id, OverflowPool&
   sedges_.sedges       = 0;
   sedges_.overflow_idx = idx;
   ledge0 = ledge1 = 0;
-
-  hs.insert(other_id);
   return true;
 }
 
 auto Graph::PinEntry::add_edge(Pid self_id, Vid other_id, OverflowPool& pool) -> bool {
-  if (use_overflow) {
-    return overflow_handling(self_id, other_id, pool);
+  if (!use_overflow && insert_inline(self_id, other_id)) {
+    return true;
+  }
+  return overflow_handling(self_id, other_id, pool);
+}
+
+void Graph::PinEntry::add_edges(Pid self_id, std::span<const Vid> others, OverflowPool& pool) {
+  if (!use_overflow) {
+    size_t n = 0;
+    for ([[maybe_unused]] const Vid v : EdgeRange(this, self_id, pool.store)) {
+      ++n;
+    }
+    if (n + others.size() <= EdgeRange::kInlineMax) {
+      for (const Vid v : others) {
+        (void)add_edge(self_id, v, pool);
+      }
+      return;
+    }
+    // The batch cannot stay inline: move the inline edges and the whole batch
+    // into one overflow set sized for the final count.
+    std::vector<Vid> spill;
+    spill.reserve(n + others.size());
+    for (const Vid v : EdgeRange(this, self_id, pool.store)) {
+      spill.push_back(v);
+    }
+    spill.insert(spill.end(), others.begin(), others.end());
+    uint32_t idx = pool.alloc_for(spill.size());
+    if (!Overflow_store::is_slab(idx)) {
+      pool.store.sets[idx].reserve(spill.size());
+    }
+    for (const Vid v : spill) {
+      idx = pool.insert(idx, v);
+    }
+    use_overflow         = true;
+    sedges_.sedges       = 0;
+    sedges_.overflow_idx = idx;
+    ledge0 = ledge1 = 0;
+    return;
   }
+  for (const Vid v : others) {
+    sedges_.overflow_idx = pool.insert(sedges_.overflow_idx, v);
+  }
+}
 
+// Places other_id in a free sedge/ledge slot; false when the inline slots
+// cannot hold it (the caller spills).
+auto Graph::PinEntry::insert_inline(Pid self_id, Vid other_id) -> bool {
   Nid     actual_self  = self_id >> 2;
   Vid     actual_other = other_id >> 2;
   int64_t diff         = static_cast<int64_t>(actual_self) - static_cast<int64_t>(actual_other);
@@ -1401,7 +1653,7 @@ auto Graph::PinEntry::add_edge(Pid self_id, Vid other_id, OverflowPool& pool) ->
       ledge1 = other_id;
       return true;
     }
-    return overflow_handling(self_id, other_id, pool);
+    return false;
   }
 
   uint64_t e = 0;
@@ -1432,7 +1684,7 @@ auto Graph::PinEntry::add_edge(Pid self_id, Vid other_id, OverflowPool& pool) ->
       }
     }
   }
-  // if we reach here, insert into ledge0 or ledge1, or overflow
+  // if we reach here, insert into ledge0 or ledge1, or report full
   if (ledge0 == 0) {
     ledge0 = other_id;
     return true;
@@ -1441,12 +1693,17 @@ auto Graph::PinEntry::add_edge(Pid self_id, Vid other_id, OverflowPool& pool) ->
     ledge1 = other_id;
     return true;
   }
-  return overflow_handling(self_id, other_id, pool);
+  return false;
 }
 
 auto Graph::PinEntry::delete_edge(Pid self_id, Vid other_id, OverflowPool& pool) -> bool {
   if (use_overflow) {
-    return pool.sets[sedges_.overflow_idx].erase(other_id) != 0;
+    if (!pool.erase(sedges_.overflow_idx, other_id)) {
+      return false;
+    }
+    sedges_.overflow_idx = pool.shrink(sedges_.overflow_idx);
+    demote_if_small(self_id, pool);
+    return true;
   }
 
   // Fast in-place delete for inline edges. We iterate slots, decode each, and
@@ -1486,33 +1743,48 @@ auto Graph::PinEntry::delete_edge(Pid self_id, Vid other_id, OverflowPool& pool)
   return false;
 }
 
-Graph::PinEntry::EdgeRange::EdgeRange(const Graph::PinEntry* pin, Pid pid, const OverflowVec& overflow) noexcept {
-  if (pin->use_overflow) {
-    overflow_set_ = &overflow[pin->sedges_.overflow_idx];
+// Re-pack a shrunken overflow set into the inline slots so churned entries
+// get the compact layout (and fast EdgeRange) back. Only below kDemoteMax,
+// well under the spill point, so an entry hovering at the inline capacity does
+// not bounce between tiers. Long edges may still not fit the two ledges; the
+// entry then stays in overflow.
+void Graph::PinEntry::demote_if_small(Pid self_id, OverflowPool& pool) {
+  const uint32_t idx = sedges_.overflow_idx;
+  if (pool.store.size_of(idx) > kDemoteMax) {
     return;
   }
-  // Inline: decode the 4 packed sedge slots + ledge0/ledge1 directly into inline_buf_.
-  constexpr uint64_t SLOT_MASK  = (1ULL << 16) - 1;  // grab 16 bits
-  constexpr uint64_t SIGN_BIT   = 1ULL << 15;
-  constexpr uint64_t DRIVER_BIT = 1ULL << 1;
-  constexpr uint64_t PIN_BIT    = 1ULL << 0;
-  constexpr uint64_t MAG_MASK   = (1ULL << 13) - 1;  // bits 14–2
+  std::array<Vid, kDemoteMax> keep{};
+  size_t                      n = 0;
+  pool.store.for_each(idx, [&](Vid v) { keep[n++] = v; });
 
-  const uint64_t self_num = static_cast<uint64_t>(pid) >> 2;
-  const uint64_t packed   = pin->sedges_.sedges;
-  for (int slot = 0; slot < 4; ++slot) {
-    const uint64_t raw = (packed >> (slot * 16)) & SLOT_MASK;
-    if (raw == 0) {
-      continue;
+  const PinEntry saved = *this;
+  use_overflow         = 0;
+  sedges_.sedges       = 0;
+  ledge0 = ledge1 = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (!insert_inline(self_id, keep[i])) {
+      *this = saved;
+      return;
+    }
+  }
+  pool.free(idx);
+}
+
+Graph::PinEntry::EdgeRange::EdgeRange(const Graph::PinEntry* pin, Pid pid, const Overflow_store& overflow) noexcept {
+  if (pin->use_overflow) {
+    const uint32_t idx = pin->sedges_.overflow_idx;
+    if (Overflow_store::is_slab(idx)) {
+      slab_       = overflow.slab.data(Overflow_store::slab_off(idx));
+      slab_count_ = overflow.slab.size(Overflow_store::slab_off(idx));
+    } else {
+      overflow_set_ = &overflow.sets[idx];
     }
-    const bool     neg           = (raw & SIGN_BIT) != 0;
-    const bool     driver        = (raw & DRIVER_BIT) != 0;
-    const bool     pin_bit       = (raw & PIN_BIT) != 0;
-    const uint64_t mag           = (raw >> 2) & MAG_MASK;
-    const int64_t  delta         = neg ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
-    const uint64_t target_num    = self_num - delta;
-    inline_buf_[inline_count_++] = static_cast<Vid>((target_num << 2) | (driver ? DRIVER_BIT : 0) | (pin_bit ? PIN_BIT : 0));
+    return;
   }
+  // Inline: decode the 4 packed sedge slots (one vector op, see sedge_decode.hpp)
+  // + ledge0/ledge1 directly into inline_buf_.
+  inline_count_ = static_cast<uint8_t>(
+      detail::decode_sedges4_compact(static_cast<uint64_t>(pin->sedges_.sedges), static_cast<uint64_t>(pid) >> 2, inline_buf_.data()));
   if (pin->ledge0) {
     inline_buf_[inline_count_++] = pin->ledge0;
   }
@@ -1521,7 +1793,7 @@ Graph::PinEntry::EdgeRange::EdgeRange(const Graph::PinEntry* pin, Pid pid, const
   }
 }
 
-auto Graph::PinEntry::get_edges(Pid pid, const OverflowVec& overflow) const noexcept -> EdgeRange {
+auto Graph::PinEntry::get_edges(Pid pid, const Overflow_store& overflow) const noexcept -> EdgeRange {
   return EdgeRange(this, pid, overflow);
 }
 
@@ -1541,6 +1813,22 @@ bool Graph::PinEntry::has_edges() const {
   return false;
 }
 
+bool Graph::PinEntry::has_dir_edges(Pid self_id, bool back, const Overflow_store& overflow) const noexcept {
+  if (use_overflow) {
+    for (const Vid vid : get_edges(self_id, overflow)) {
+      if (((vid & static_cast<Vid>(2)) != 0) == back) {
+        return true;
+      }
+    }
+    return false;
+  }
+  const auto masks = detail::sedge_masks(static_cast<uint64_t>(sedges_.sedges), 0);
+  if ((back ? masks.back : (masks.live & ~masks.back)) != 0) {
+    return true;
+  }
+  return (ledge0 != 0 && ((ledge0 & 2) != 0) == back) || (ledge1 != 0 && ((ledge1 & 2) != 0) == back);
+}
+
 Graph::NodeEntry::NodeEntry() { clear_node(); }
 Graph::NodeEntry::NodeEntry(bool alive_val) {
   clear_node();
@@ -1552,70 +1840,81 @@ void Graph::NodeEntry::clear_node() { bzero(this, sizeof(NodeEntry)); }
 auto Graph::NodeEntry::overflow_handling(Nid self_id, Vid other_id, OverflowPool& pool) -> bool {
   if (use_overflow) {
     if (other_id) {
-      pool.sets[sedges_.overflow_idx].insert(other_id);
+      sedges_.overflow_idx = pool.insert(sedges_.overflow_idx, other_id);
     }
     return true;
   }
 
-  uint32_t           idx       = pool.alloc();
-  auto&              hs        = pool.sets[idx];
-  constexpr int      SHIFT     = 16;
-  constexpr uint64_t SLOT_MASK = (1ULL << SHIFT) - 1;
-
-  auto flush_slot = [&](uint64_t raw) {
-    if (!raw) {
-      return;
-    }
-    bool     is_driver = raw & 2;
-    bool     is_pin    = raw & 1;
-    bool     neg       = raw & (1ULL << 15);
-    uint64_t mag       = (raw >> 2) & ((1ULL << 13) - 1);
-    int64_t  diff      = neg ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
-
-    Nid actual_self = static_cast<Nid>(self_id >> 2);
-    Vid target      = static_cast<Vid>(actual_self - diff);
-    target          = (target << 2);
-    if (is_driver) {
-      target |= 2;
-    }
-    if (is_pin) {
-      target |= 1;
-    }
-    hs.insert(target);
-  };
-
-  for (int i = 0; i < 4; ++i) {
-    flush_slot((sedges_.sedges >> (i * SHIFT)) & SLOT_MASK);
+  // Spill: decode the inline edges (4 sedges + 3 sedges_extra + 2 ledges) and
+  // move them, plus other_id, into an overflow tier sized for them.
+  std::array<Vid, EdgeRange::kInlineMax + 1> spill{};
+  size_t                                     n = 0;
+  for (const Vid v : EdgeRange(this, self_id, pool.store)) {
+    spill[n++] = v;
   }
-  const uint64_t extra = sedges_extra;
-  for (int i = 0; i < 3; ++i) {
-    flush_slot((extra >> (i * SHIFT)) & SLOT_MASK);
+  if (other_id) {
+    spill[n++] = other_id;
   }
 
-  if (ledge0) {
-    hs.insert(static_cast<Vid>(ledge0));
+  uint32_t idx = pool.alloc_for(n);
+  for (size_t i = 0; i < n; ++i) {
+    idx = pool.insert(idx, spill[i]);
   }
-  if (ledge1) {
-    hs.insert(static_cast<Vid>(ledge1));
-  }
-
   use_overflow         = 1;
   sedges_.sedges       = 0;
   sedges_.overflow_idx = idx;
   sedges_extra         = 0;
   ledge0 = ledge1 = 0;
-
-  if (other_id) {
-    hs.insert(other_id);
-  }
   return true;
 }
 
 auto Graph::NodeEntry::add_edge(Nid self_id, Vid other_id, OverflowPool& pool) -> bool {
-  if (use_overflow) {
-    return overflow_handling(self_id, other_id, pool);
+  if (!use_overflow && insert_inline(self_id, other_id)) {
+    return true;
+  }
+  return overflow_handling(self_id, other_id, pool);
+}
+
+void Graph::NodeEntry::add_edges(Nid self_id, std::span<const Vid> others, OverflowPool& pool) {
+  if (!use_overflow) {
+    size_t n = 0;
+    for ([[maybe_unused]] const Vid v : EdgeRange(this, self_id, pool.store)) {
+      ++n;
+    }
+    if (n + others.size() <= EdgeRange::kInlineMax) {
+      for (const Vid v : others) {
+        (void)add_edge(self_id, v, pool);
+      }
+      return;
+    }
+    std::vector<Vid> spill;
+    spill.reserve(n + others.size());
+    for (const Vid v : EdgeRange(this, self_id, pool.store)) {
+      spill.push_back(v);
+    }
+    spill.insert(spill.end(), others.begin(), others.end());
+    uint32_t idx = pool.alloc_for(spill.size());
+    if (!Overflow_store::is_slab(idx)) {
+      pool.store.sets[idx].reserve(spill.size());
+    }
+    for (const Vid v : spill) {
+      idx = pool.insert(idx, v);
+    }
+    use_overflow         = 1;
+    sedges_.sedges       = 0;
+    sedges_.overflow_idx = idx;
+    sedges_extra         = 0;
+    ledge0 = ledge1 = 0;
+    return;
   }
+  for (const Vid v : others) {
+    sedges_.overflow_idx = pool.insert(sedges_.overflow_idx, v);
+  }
+}
 
+// Places other_id in a free sedge/ledge slot; false when the inline slots
+// cannot hold it (the caller spills).
+auto Graph::NodeEntry::insert_inline(Nid self_id, Vid other_id) -> bool {
   Nid     actual_self  = self_id >> 2;
   Vid     actual_other = other_id >> 2;
   int64_t diff         = static_cast<int64_t>(actual_self) - static_cast<int64_t>(actual_other);
@@ -1633,7 +1932,7 @@ auto Graph::NodeEntry::add_edge(Nid self_id, Vid other_id, OverflowPool& pool) -
       ledge1 = other_id;
       return true;
     }
-    return overflow_handling(self_id, other_id, pool);
+    return false;
   }
 
   uint64_t e = 0;
@@ -1670,7 +1969,7 @@ auto Graph::NodeEntry::add_edge(Nid self_id, Vid other_id, OverflowPool& pool) -
       }
     }
   }
-  // if we reach here, insert into ledge0 or ledge1, or overflow
+  // if we reach here, insert into ledge0 or ledge1, or report full
   if (ledge0 == 0) {
     ledge0 = other_id;
     return true;
@@ -1679,12 +1978,17 @@ auto Graph::NodeEntry::add_edge(Nid self_id, Vid other_id, OverflowPool& pool) -
     ledge1 = other_id;
     return true;
   }
-  return overflow_handling(self_id, other_id, pool);
+  return false;
 }
 
 auto Graph::NodeEntry::delete_edge(Nid self_id, Vid other_id, OverflowPool& pool) -> bool {
   if (use_overflow) {
-    return pool.sets[sedges_.overflow_idx].erase(other_id) != 0;
+    if (!pool.erase(sedges_.overflow_idx, other_id)) {
+      return false;
+    }
+    sedges_.overflow_idx = pool.shrink(sedges_.overflow_idx);
+    demote_if_small(self_id, pool);
+    return true;
   }
 
   // Fast in-place delete for inline edges (4 sedges + 3 sedges_extra + 2 ledges).
@@ -1736,9 +2040,9 @@ auto Graph::NodeEntry::delete_edge(Nid self_id, Vid other_id, OverflowPool& pool
   return false;
 }
 
-bool Graph::NodeEntry::has_edges(const OverflowVec& overflow) const {
+bool Graph::NodeEntry::has_edges(const Overflow_store& overflow) const {
   if (use_overflow) {
-    return !overflow[sedges_.overflow_idx].empty();
+    return overflow.size_of(sedges_.overflow_idx) != 0;
   }
   if (sedges_.sedges != 0) {
     return true;
@@ -1755,67 +2059,61 @@ bool Graph::NodeEntry::has_edges(const OverflowVec& overflow) const {
   return false;
 }
 
-void Graph::NodeEntry::set_subnode(Nid self_nid, Gid gid, OverflowPool& pool) {
-  // Existence inside GraphLibrary must be checked by the caller (NodeEntry has no library pointer).
-  if (gid == Gid_invalid) {
-    return;
-  }
-  // Ensure overflow mode so ledge0 is no longer used as an edge spill slot.
-  if (!use_overflow) {
-    const Vid self_vid = static_cast<Vid>(self_nid & ~static_cast<Nid>(3));
-    (void)overflow_handling(self_vid, 0, pool);  // 0 => promote only, no edge insert
+bool Graph::NodeEntry::has_dir_edges(Nid self_id, bool back, const Overflow_store& overflow) const noexcept {
+  if (use_overflow) {
+    for (const Vid vid : get_edges(self_id, overflow)) {
+      if (((vid & static_cast<Vid>(2)) != 0) == back) {
+        return true;
+      }
+    }
+    return false;
   }
-
-  // Store gid in ledge0 as (gid + 1) so ledge0==0 means "no subnode".
-  const uint64_t g = static_cast<uint64_t>(gid);
-  assert(g < (1ULL << Nid_bits));  // since ledge0 is Nid_bits wide
-  ledge0 = static_cast<Nid>(g);
-}
-
-Gid Graph::NodeEntry::get_subnode() const noexcept {
-  if (!use_overflow || ledge0 == 0) {
-    return Gid_invalid;
+  const auto masks = detail::sedge_masks(static_cast<uint64_t>(sedges_.sedges), sedges_extra);
+  if ((back ? masks.back : (masks.live & ~masks.back)) != 0) {
+    return true;
   }
-  return static_cast<Gid>(static_cast<uint64_t>(ledge0));
+  return (ledge0 != 0 && ((ledge0 & 2) != 0) == back) || (ledge1 != 0 && ((ledge1 & 2) != 0) == back);
 }
 
-bool Graph::NodeEntry::has_subnode() const noexcept { return use_overflow && ledge0 != 0; }
-
-Graph::NodeEntry::EdgeRange::EdgeRange(const Graph::NodeEntry* node, Nid nid, const OverflowVec& overflow) noexcept {
-  if (node->use_overflow) {
-    overflow_set_ = &overflow[node->sedges_.overflow_idx];
+// See PinEntry::demote_if_small.
+void Graph::NodeEntry::demote_if_small(Nid self_id, OverflowPool& pool) {
+  const uint32_t idx = sedges_.overflow_idx;
+  if (pool.store.size_of(idx) > kDemoteMax) {
     return;
   }
-  // Inline: decode 4 packed sedge slots + 3 extra slots + ledge0/ledge1 into inline_buf_.
-  constexpr uint64_t SLOT_MASK  = (1ULL << 16) - 1;  // grab 16 bits
-  constexpr uint64_t SIGN_BIT   = 1ULL << 15;
-  constexpr uint64_t DRIVER_BIT = 1ULL << 1;
-  constexpr uint64_t PIN_BIT    = 1ULL << 0;
-  constexpr uint64_t MAG_MASK   = (1ULL << 13) - 1;  // bits 14–2
-
-  const uint64_t self_num = static_cast<uint64_t>(nid) >> 2;
+  std::array<Vid, kDemoteMax> keep{};
+  size_t                      n = 0;
+  pool.store.for_each(idx, [&](Vid v) { keep[n++] = v; });
 
-  auto decode_slot = [&](uint64_t raw) {
-    if (raw == 0) {
+  const NodeEntry saved = *this;
+  use_overflow          = 0;
+  sedges_.sedges        = 0;
+  sedges_extra          = 0;
+  ledge0 = ledge1 = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (!insert_inline(self_id, keep[i])) {
+      *this = saved;
       return;
     }
-    const bool     neg           = (raw & SIGN_BIT) != 0;
-    const bool     driver        = (raw & DRIVER_BIT) != 0;
-    const bool     pin_bit       = (raw & PIN_BIT) != 0;
-    const uint64_t mag           = (raw >> 2) & MAG_MASK;
-    const int64_t  delta         = neg ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
-    const uint64_t target_num    = self_num - delta;
-    inline_buf_[inline_count_++] = static_cast<Vid>((target_num << 2) | (driver ? DRIVER_BIT : 0) | (pin_bit ? PIN_BIT : 0));
-  };
-
-  const uint64_t packed = node->sedges_.sedges;
-  for (int slot = 0; slot < 4; ++slot) {
-    decode_slot((packed >> (slot * 16)) & SLOT_MASK);
   }
-  const uint64_t extra = node->sedges_extra;
-  for (int slot = 0; slot < 3; ++slot) {
-    decode_slot((extra >> (slot * 16)) & SLOT_MASK);
+  pool.free(idx);
+}
+
+Graph::NodeEntry::EdgeRange::EdgeRange(const Graph::NodeEntry* node, Nid nid, const Overflow_store& overflow) noexcept {
+  if (node->use_overflow) {
+    const uint32_t idx = node->sedges_.overflow_idx;
+    if (Overflow_store::is_slab(idx)) {
+      slab_       = overflow.slab.data(Overflow_store::slab_off(idx));
+      slab_count_ = overflow.slab.size(Overflow_store::slab_off(idx));
+    } else {
+      overflow_set_ = &overflow.sets[idx];
+    }
+    return;
   }
+  // Inline: decode 4 packed sedge slots + 3 extra slots in one go (see
+  // sedge_decode.hpp), then ledge0/ledge1, into inline_buf_.
+  inline_count_ = static_cast<uint8_t>(detail::decode_sedges_compact(static_cast<uint64_t>(node->sedges_.sedges), node->sedges_extra,
+                                                                     static_cast<uint64_t>(nid) >> 2, inline_buf_.data()));
   if (node->ledge0) {
     inline_buf_[inline_count_++] = node->ledge0;
   }
@@ -1824,7 +2122,7 @@ Graph::NodeEntry::EdgeRange::EdgeRange(const Graph::NodeEntry* node, Nid nid, co
   }
 }
 
-auto Graph::NodeEntry::get_edges(Nid nid, const OverflowVec& overflow) const noexcept -> EdgeRange {
+auto Graph::NodeEntry::get_edges(Nid nid, const Overflow_store& overflow) const noexcept -> EdgeRange {
   return EdgeRange(this, nid, overflow);
 }
 
@@ -1893,6 +2191,8 @@ void Graph::release_storage() noexcept {
   validated_loop_carries_.clear();
 #endif
   constant_pin_index_.clear();
+  port_index_.clear();
+  csr_cache_.reset();
   sync_loop_presence();
 }
 
@@ -1973,13 +2273,25 @@ void Graph::invalidate_from_library() noexcept {
   forward_pass2_cache_.clear();
   forward_remaining_in_cache_.clear();
   forward_caches_valid_ = false;
+  forward_order_cache_.clear();
+  forward_rank_cache_.clear();
+  forward_order_valid_ = false;
   backward_pass2_cache_.clear();
   backward_remaining_out_cache_.clear();
   backward_caches_valid_ = false;
+  backward_order_cache_.clear();
+  backward_rank_cache_.clear();
+  backward_order_valid_ = false;
+  node_counts_valid_    = false;
+  level_of_cache_.clear();
+  level_nodes_cache_.clear();
+  level_off_cache_.clear();
+  levels_valid_ = false;
   if (tree_) {
     tree_->clear();
   }
   subnode_tree_pos_.clear();
+  subnode_gid_.clear();
   subnode_loops_.clear();
   input_pins_.clear();
   output_pins_.clear();
@@ -2006,6 +2318,7 @@ void Graph::clear_graph() {
   }
   (void)tree_->add_root();
   subnode_tree_pos_.clear();
+  subnode_gid_.clear();
   subnode_loops_.clear();
 #ifndef NDEBUG
   validated_loop_carries_.clear();
@@ -2023,6 +2336,7 @@ void Graph::clear() {
   discard_attr_stores();
   srcloc_.clear();  // provenance is body content: dropped with the attrs (base kept)
   constant_pin_index_.clear();
+  port_index_.clear();
 
   for (auto& pin : pin_table) {
     pin = PinEntry();
@@ -2061,6 +2375,7 @@ void Graph::clear() {
   }
   (void)tree_->add_root();
   subnode_tree_pos_.clear();
+  subnode_gid_.clear();
   subnode_loops_.clear();
 #ifndef NDEBUG
   validated_loop_carries_.clear();
@@ -2087,11 +2402,9 @@ void Graph::bind_library(const GraphLibrary* owner, Gid self_gid) noexcept {
   srcloc_.set_base(owner != nullptr ? owner->srcmap_sp_.get() : nullptr);
 }
 
-// Shared traversal constant: where iteration over user nodes begins in
-// node_table. 0:invalid, 1:INPUT, 2:OUTPUT, 3:CONST are built-in singletons
-// reached via Graph::get_input_node/get_output_node/get_constant_node — never
-// emitted by class/flat/hier traversals. User nodes start at idx 4.
-static constexpr size_t kFirstUserNodeIdx = 4;
+// forward_rank_cache_ / backward_rank_cache_ value for a slot that is not in
+// the maintained order (built-ins, dead nodes).
+static constexpr uint32_t kNoRank = ~uint32_t{0};
 
 // Source classification used by both the cache builder and the streaming
 // iterator. INPUT (idx=1) and CONST (idx=3) are implicit sources; any live
@@ -2110,22 +2423,73 @@ bool Graph::forward_is_source(size_t idx) const noexcept {
   return node_table[idx].is_loop_break();
 }
 
-void Graph::ensure_forward_caches() const {
-  if (forward_caches_valid_) {
-    return;
+// Edge Vids of node idx (node-as-pin first, then its pins) in one direction.
+// Inline slots are decoded a whole entry at a time, only the lanes of that
+// direction, and overflow sets are read in place: no EdgeRange is built.
+template <typename Visit>
+bool Graph::for_each_dir_edge(size_t idx, bool back, Visit&& visit) const {
+  const auto&        overflow = overflow_sets();
+  std::array<Vid, 8> lanes;
+  const auto         in_dir         = [back](Vid vid) { return ((vid & static_cast<Vid>(2)) != 0) == back; };
+  const auto         visit_overflow = [&](uint32_t set) {
+    return overflow.for_each(set, [&](Vid vid) { return in_dir(vid) && visit(vid); });
+  };
+  const auto visit_inline = [&](unsigned n, Vid ledge0, Vid ledge1) {
+    for (unsigned i = 0; i < n; ++i) {
+      if (visit(lanes[i])) {
+        return true;
+      }
+    }
+    return (ledge0 != 0 && in_dir(ledge0) && visit(ledge0)) || (ledge1 != 0 && in_dir(ledge1) && visit(ledge1));
+  };
+
+  const auto& node = node_table[idx];
+  if (node.use_overflow ? visit_overflow(node.sedges_.overflow_idx)
+                        : visit_inline(detail::decode_sedges_dir(static_cast<uint64_t>(node.sedges_.sedges), node.sedges_extra,
+                                                                 static_cast<uint64_t>(idx), back, lanes.data()),
+                                       node.ledge0, node.ledge1)) {
+    return true;
   }
-  const size_t node_count = node_table.size();
+  for (Pid pin_vid = node.get_next_pin_id(); pin_vid != 0;) {
+    const Pid   canonical_pin = (pin_vid & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+    const auto* pin           = ref_pin(canonical_pin);
+    if (pin->use_overflow ? visit_overflow(pin->sedges_.overflow_idx)
+                          : visit_inline(detail::decode_sedges4_dir(static_cast<uint64_t>(pin->sedges_.sedges),
+                                                                    static_cast<uint64_t>(canonical_pin) >> 2, back, lanes.data()),
+                                         pin->ledge0, pin->ledge1)) {
+      return true;
+    }
+    pin_vid = pin->get_next_pin_id();
+  }
+  return false;
+}
 
-  forward_pass2_cache_.clear();
-  forward_remaining_in_cache_.assign(node_count, 0);
+namespace {
 
-  if (node_count <= kFirstUserNodeIdx) {
-    forward_caches_valid_ = true;
-    return;
+// fn(idx) for the for_each_forward_* visitors: true stops the walk; a void
+// visitor never stops.
+template <typename Fn>
+[[nodiscard]] bool visit_stops(Fn& fn, size_t idx) {
+  if constexpr (std::is_same_v<std::invoke_result_t<Fn&, size_t>, bool>) {
+    return fn(idx);
+  } else {
+    fn(idx);
+    return false;
   }
+}
 
-  // Resolve a sink Vid back to its owning node index.
-  auto sink_idx_of = [&](Vid vid) -> size_t {
+}  // namespace
+
+// Visits the node index of every forward sink of driver_idx (node-as-pin and
+// pin edges; in-edges skipped), restricted to user nodes and excluding a
+// compact loop carry's self edge -- the dependency set ensure_forward_caches
+// counts.
+template <typename Fn>
+void Graph::for_each_forward_sink(size_t driver_idx, Fn&& fn) const {
+  const Nid  driver_nid = static_cast<Nid>(driver_idx) << 2;
+  const auto node_count = node_table.size();
+
+  (void)for_each_dir_edge(driver_idx, false, [&](Vid vid) {
     Nid sink_nid;
     if (vid & static_cast<Vid>(1)) {
       const Pid sink_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
@@ -2133,7 +2497,184 @@ void Graph::ensure_forward_caches() const {
     } else {
       sink_nid = static_cast<Nid>(vid);
     }
-    sink_nid = sink_nid & ~static_cast<Nid>(3);
+    const size_t sink_idx = static_cast<size_t>((sink_nid & ~static_cast<Nid>(3)) >> 2);
+    if (sink_idx < kFirstUserNodeIdx || sink_idx >= node_count) {
+      return false;
+    }
+    if (sink_idx == driver_idx && subnode_loops_.contains(driver_nid)) {
+      return false;
+    }
+    return visit_stops(fn, sink_idx);
+  });
+}
+
+// Visits the node index of every driver counted against sink_idx: the reverse
+// of for_each_forward_sink, over the same decoded slots. Order repairs and
+// the bottom-up cone probes walk it.
+template <typename Fn>
+void Graph::for_each_forward_driver(size_t sink_idx, Fn&& fn) const {
+  const Nid  sink_nid   = static_cast<Nid>(sink_idx) << 2;
+  const auto node_count = node_table.size();
+
+  (void)for_each_dir_edge(sink_idx, true, [&](Vid vid) {
+    Nid driver_nid;
+    if (vid & static_cast<Vid>(1)) {
+      const Pid driver_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+      driver_nid           = ref_pin(driver_pid)->get_master_nid();
+    } else {
+      driver_nid = static_cast<Nid>(vid);
+    }
+    const size_t driver_idx = static_cast<size_t>((driver_nid & ~static_cast<Nid>(3)) >> 2);
+    if (driver_idx < kFirstUserNodeIdx || driver_idx >= node_count) {
+      return false;
+    }
+    if (driver_idx == sink_idx && subnode_loops_.contains(sink_nid)) {
+      return false;
+    }
+    return visit_stops(fn, driver_idx);
+  });
+}
+
+// Pearce–Kelly: with rank[to] < rank[from], collect the nodes `to` reaches
+// below rank[from] (ahead) and the nodes reaching `from` above rank[to]
+// (behind), then hand their pooled ranks out behind-first, each group keeping
+// its relative order. Nothing outside that window moves.
+bool Graph::reorder_for_edge(std::vector<uint32_t>& order, std::vector<uint32_t>& rank, size_t from, size_t to,
+                             bool forward) const {
+  if (from >= rank.size() || to >= rank.size() || rank[from] == kNoRank || rank[to] == kNoRank) {
+    return false;
+  }
+  const uint32_t lb = rank[to];
+  const uint32_t ub = rank[from];
+  if (lb > ub) {
+    return true;
+  }
+  if (lb == ub) {
+    return false;  // self dependency
+  }
+
+  // Successors along this order's direction, and the reverse.
+  auto next = [&](size_t idx, auto& fn) {
+    if (forward) {
+      for_each_forward_sink(idx, fn);
+    } else {
+      for_each_forward_driver(idx, fn);
+    }
+  };
+  auto prev = [&](size_t idx, auto& fn) {
+    if (forward) {
+      for_each_forward_driver(idx, fn);
+    } else {
+      for_each_forward_sink(idx, fn);
+    }
+  };
+
+  ankerl::unordered_dense::set<uint32_t> seen;
+  std::vector<uint32_t>                  ahead;
+  std::vector<uint32_t>                  behind;
+  std::vector<uint32_t>                  stack;
+  bool                                   failed = false;
+
+  auto ahead_step = [&](size_t idx) {
+    if (forward_is_source(idx)) {
+      return;
+    }
+    const uint32_t r = rank[idx];
+    if (r == ub || r == kNoRank) {
+      failed = true;  // reached `from`: the edge closes a cycle
+    } else if (r < ub && seen.insert(static_cast<uint32_t>(idx)).second) {
+      stack.push_back(static_cast<uint32_t>(idx));
+    }
+  };
+  seen.insert(static_cast<uint32_t>(to));
+  stack.push_back(static_cast<uint32_t>(to));
+  while (!stack.empty() && !failed) {
+    const uint32_t idx = stack.back();
+    stack.pop_back();
+    ahead.push_back(idx);
+    next(idx, ahead_step);
+  }
+  if (failed) {
+    return false;
+  }
+
+  auto behind_step = [&](size_t idx) {
+    if (forward_is_source(idx)) {
+      return;
+    }
+    const uint32_t r = rank[idx];
+    if (r == kNoRank) {
+      failed = true;
+    } else if (r > lb && seen.insert(static_cast<uint32_t>(idx)).second) {
+      stack.push_back(static_cast<uint32_t>(idx));
+    }
+  };
+  seen.insert(static_cast<uint32_t>(from));
+  stack.push_back(static_cast<uint32_t>(from));
+  while (!stack.empty() && !failed) {
+    const uint32_t idx = stack.back();
+    stack.pop_back();
+    behind.push_back(idx);
+    prev(idx, behind_step);
+  }
+  if (failed) {
+    return false;
+  }
+
+  const auto by_rank = [&](uint32_t a, uint32_t b) { return rank[a] < rank[b]; };
+  std::sort(ahead.begin(), ahead.end(), by_rank);
+  std::sort(behind.begin(), behind.end(), by_rank);
+  std::vector<uint32_t> slots;
+  slots.reserve(ahead.size() + behind.size());
+  for (const uint32_t idx : behind) {
+    slots.push_back(rank[idx]);
+  }
+  for (const uint32_t idx : ahead) {
+    slots.push_back(rank[idx]);
+  }
+  std::inplace_merge(slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(behind.size()), slots.end());
+  size_t k = 0;
+  for (const auto* group : {&behind, &ahead}) {
+    for (const uint32_t idx : *group) {
+      rank[idx]       = slots[k];
+      order[slots[k]] = idx;
+      ++k;
+    }
+  }
+  return true;
+}
+
+void Graph::ensure_forward_caches() const {
+  if (forward_caches_valid_) {
+    return;
+  }
+  std::lock_guard lock(cache_mu_);
+  if (forward_caches_valid_) {  // built by a concurrent reader while we waited
+    return;
+  }
+  const size_t node_count = node_table.size();
+
+  forward_pass2_cache_.clear();
+  forward_remaining_in_cache_.assign(node_count, 0);
+  forward_order_cache_.clear();
+  forward_rank_cache_.assign(node_count, kNoRank);
+
+  if (node_count <= kFirstUserNodeIdx) {
+    forward_order_valid_  = true;
+    forward_caches_valid_ = true;
+    return;
+  }
+
+  // Resolve a sink Vid back to its owning node index.
+  auto sink_idx_of = [&](Vid vid) -> size_t {
+    Nid sink_nid;
+    if (vid & static_cast<Vid>(1)) {
+      const Pid sink_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+      sink_nid           = ref_pin(sink_pid)->get_master_nid();
+    } else {
+      sink_nid = static_cast<Nid>(vid);
+    }
+    sink_nid = sink_nid & ~static_cast<Nid>(3);
     return static_cast<size_t>(sink_nid >> 2);
   };
 
@@ -2211,12 +2752,18 @@ void Graph::ensure_forward_caches() const {
     });
   };
 
+  size_t alive = 0;
   for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
-    if (!node_table[idx].is_alive() || is_emit(idx)) {
+    if (!node_table[idx].is_alive()) {
+      continue;
+    }
+    ++alive;
+    if (is_emit(idx)) {
       continue;
     }
     if (forward_is_source(idx) || working[idx] == 0) {
       mark_emit(idx);
+      forward_order_cache_.push_back(static_cast<uint32_t>(idx));
       propagate(idx, idx);
     }
   }
@@ -2227,14 +2774,165 @@ void Graph::ensure_forward_caches() const {
       continue;
     }
     mark_emit(idx);
+    forward_order_cache_.push_back(static_cast<uint32_t>(idx));
     propagate(idx, node_count);
   }
 
   // Tail (cycle survivors) is not cached — the streaming iterator re-derives
   // it by scanning for alive-but-unemitted entries after Pass 2 completes.
+  // Without survivors the emission order is a topological order: keep it.
+  forward_order_valid_ = forward_order_cache_.size() == alive;
+  if (forward_order_valid_) {
+    for (size_t pos = 0; pos < forward_order_cache_.size(); ++pos) {
+      forward_rank_cache_[forward_order_cache_[pos]] = static_cast<uint32_t>(pos);
+    }
+  } else {
+    forward_order_cache_.clear();
+  }
   forward_caches_valid_ = true;
 }
 
+void Graph::ensure_node_counts() const {
+  if (node_counts_valid_) {
+    return;
+  }
+  std::lock_guard lock(cache_mu_);
+  if (node_counts_valid_) {  // built by a concurrent reader while we waited
+    return;
+  }
+  live_node_count_  = 0;
+  loop_break_count_ = 0;
+  for (size_t idx = kFirstUserNodeIdx; idx < node_table.size(); ++idx) {
+    if (node_table[idx].is_alive()) {
+      ++live_node_count_;
+      loop_break_count_ += node_table[idx].is_loop_break() ? 1 : 0;
+    }
+  }
+  node_counts_valid_ = true;
+}
+
+// Every live node is yielded once (Pass 1/2, Tail or Order); loop_breaks are
+// yielded once per cut side they are placed on.
+size_t Graph::ordered_node_count(bool loop_break_first, bool loop_break_last) const {
+  ensure_node_counts();
+  const size_t cuts = static_cast<size_t>(loop_break_first) + static_cast<size_t>(loop_break_last);
+  return live_node_count_ - loop_break_count_ + loop_break_count_ * cuts;
+}
+
+// Kahn over the forward dependency counts: a node's level is fixed when its
+// last counted driver is processed, one past the deepest of them. Sources
+// (and loop_breaks) have no counted fan-in and sit at 0; nodes whose count
+// never drains are behind a cycle and stay kNoLevel.
+void Graph::ensure_level_caches() const {
+  if (levels_valid_ && !level_buckets_stale_) {
+    return;
+  }
+  std::lock_guard lock(cache_mu_);
+  if (levels_valid_ && !level_buckets_stale_) {
+    return;
+  }
+  const size_t node_count = node_table.size();
+  if (!levels_valid_) {
+    level_buckets_stale_ = true;  // keep lock-free readers off the buckets until re-bucketed
+    ensure_forward_caches();
+    std::vector<uint32_t> remaining = forward_remaining_in_cache_;
+    std::vector<uint32_t> ready;
+    level_of_cache_.assign(node_count, Level_view::kNoLevel);
+    for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+      if (!node_table[idx].is_alive()) {
+        continue;
+      }
+      level_of_cache_[idx] = 0;
+      if (forward_is_source(idx) || remaining[idx] == 0) {
+        ready.push_back(static_cast<uint32_t>(idx));
+      }
+    }
+    for (size_t head = 0; head < ready.size(); ++head) {
+      const size_t idx = ready[head];
+      if (forward_is_source(idx)) {
+        continue;
+      }
+      const uint32_t next = level_of_cache_[idx] + 1;
+      for_each_forward_sink(idx, [&](size_t sink_idx) {
+        if (forward_is_source(sink_idx) || remaining[sink_idx] == 0) {
+          return;
+        }
+        level_of_cache_[sink_idx] = std::max(level_of_cache_[sink_idx], next);
+        if (--remaining[sink_idx] == 0) {
+          ready.push_back(static_cast<uint32_t>(sink_idx));
+        }
+      });
+    }
+    for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+      if (remaining[idx] != 0 && !forward_is_source(idx)) {
+        level_of_cache_[idx] = Level_view::kNoLevel;
+      }
+    }
+    levels_valid_ = true;
+  }
+
+  // Counting sort by level, storage order within a level.
+  uint32_t depth = 0;
+  for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+    if (level_of_cache_[idx] != Level_view::kNoLevel) {
+      depth = std::max(depth, level_of_cache_[idx] + 1);
+    }
+  }
+  level_off_cache_.assign(static_cast<size_t>(depth) + 1, 0);
+  size_t unleveled = 0;
+  for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+    if (!node_table[idx].is_alive()) {
+      continue;
+    }
+    if (const uint32_t level = level_of_cache_[idx]; level != Level_view::kNoLevel) {
+      ++level_off_cache_[level + 1];
+    } else {
+      ++unleveled;
+    }
+  }
+  for (size_t level = 1; level <= depth; ++level) {
+    level_off_cache_[level] += level_off_cache_[level - 1];
+  }
+  level_nodes_cache_.assign(level_off_cache_.back() + unleveled, 0);
+  std::vector<uint32_t> fill(level_off_cache_.begin(), level_off_cache_.end());
+  for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+    if (!node_table[idx].is_alive()) {
+      continue;
+    }
+    const uint32_t level = level_of_cache_[idx];
+    const size_t   slot  = level != Level_view::kNoLevel ? fill[level]++ : fill[depth]++;
+    level_nodes_cache_[slot] = static_cast<Nid>(idx) << 2;
+  }
+  level_buckets_stale_ = false;
+}
+
+bool Graph::raise_levels_from(size_t driver_idx, size_t sink_idx) const {
+  if (level_of_cache_[sink_idx] > level_of_cache_[driver_idx]) {
+    return true;
+  }
+  level_of_cache_[sink_idx] = level_of_cache_[driver_idx] + 1;
+  std::vector<uint32_t> work{static_cast<uint32_t>(sink_idx)};
+  while (!work.empty()) {
+    const size_t idx = work.back();
+    work.pop_back();
+    if (idx == driver_idx) {
+      return false;  // the new edge closed a cycle
+    }
+    const uint32_t next = level_of_cache_[idx] + 1;
+    for_each_forward_sink(idx, [&](size_t s) {
+      if (forward_is_source(s) || level_of_cache_[s] == Level_view::kNoLevel) {
+        return;
+      }
+      if (level_of_cache_[s] < next) {
+        level_of_cache_[s] = next;
+        work.push_back(static_cast<uint32_t>(s));
+      }
+    });
+  }
+  level_buckets_stale_ = true;
+  return true;
+}
+
 bool Graph::backward_is_sink(size_t idx) const noexcept {
   if (idx == 2) {
     return true;
@@ -2252,12 +2950,19 @@ void Graph::ensure_backward_caches() const {
   if (backward_caches_valid_) {
     return;
   }
+  std::lock_guard lock(cache_mu_);
+  if (backward_caches_valid_) {  // built by a concurrent reader while we waited
+    return;
+  }
   const size_t node_count = node_table.size();
 
   backward_pass2_cache_.clear();
   backward_remaining_out_cache_.assign(node_count, 0);
+  backward_order_cache_.clear();
+  backward_rank_cache_.assign(node_count, kNoRank);
 
   if (node_count <= kFirstUserNodeIdx) {
+    backward_order_valid_  = true;
     backward_caches_valid_ = true;
     return;
   }
@@ -2348,13 +3053,19 @@ void Graph::ensure_backward_caches() const {
     });
   };
 
+  size_t alive = 0;
   for (size_t idx = node_count; idx > kFirstUserNodeIdx;) {
     --idx;
-    if (!node_table[idx].is_alive() || is_emit(idx)) {
+    if (!node_table[idx].is_alive()) {
+      continue;
+    }
+    ++alive;
+    if (is_emit(idx)) {
       continue;
     }
     if (backward_is_sink(idx) || working[idx] == 0) {
       mark_emit(idx);
+      backward_order_cache_.push_back(static_cast<uint32_t>(idx));
       propagate(idx, idx);
     }
   }
@@ -2365,14 +3076,26 @@ void Graph::ensure_backward_caches() const {
       continue;
     }
     mark_emit(idx);
+    backward_order_cache_.push_back(static_cast<uint32_t>(idx));
     propagate(idx, 0);  // Propagate backwards with cursor=0 so all deferrals are added
   }
 
+  backward_order_valid_ = backward_order_cache_.size() == alive;
+  if (backward_order_valid_) {
+    for (size_t pos = 0; pos < backward_order_cache_.size(); ++pos) {
+      backward_rank_cache_[backward_order_cache_[pos]] = static_cast<uint32_t>(pos);
+    }
+  } else {
+    backward_order_cache_.clear();
+  }
   backward_caches_valid_ = true;
 }
 
 void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t delta) noexcept {
-  if (!forward_caches_valid_ && !backward_caches_valid_) {
+  // Every edge edit moves the epoch, even with no cache to patch: snapshots
+  // (freeze_csr) and hierarchy iterators key their staleness check off it.
+  note_body_edit();
+  if (!forward_caches_valid_ && !backward_caches_valid_ && !levels_valid_) {
     return;
   }
 
@@ -2391,6 +3114,17 @@ void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t
   const size_t driver_idx = master_idx_of(driver_id);
   const size_t sink_idx   = master_idx_of(sink_id);
 
+  // A delete never breaks a topological order; an add that does is repaired
+  // in place, or, when it closes a cycle, drops the caches so the rebuild
+  // derives the Tail.
+  auto repair = [this](std::vector<uint32_t>& order, std::vector<uint32_t>& rank, size_t from, size_t to, bool forward) {
+    try {
+      return reorder_for_edge(order, rank, from, to, forward);
+    } catch (...) {
+      return false;
+    }
+  };
+
   if (forward_caches_valid_) {
     const size_t n = forward_remaining_in_cache_.size();
     if (driver_idx >= kFirstUserNodeIdx && driver_idx < n && sink_idx >= kFirstUserNodeIdx && sink_idx < n
@@ -2398,6 +3132,9 @@ void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t
       auto& slot = forward_remaining_in_cache_[sink_idx];
       if (delta > 0) {
         slot += static_cast<uint32_t>(delta);
+        if (forward_order_valid_ && !repair(forward_order_cache_, forward_rank_cache_, driver_idx, sink_idx, true)) {
+          forward_caches_valid_ = false;
+        }
       } else {
         const auto dec = 0u - static_cast<uint32_t>(delta);  // magnitude in unsigned space: avoids UB at INT32_MIN
         if (slot >= dec) {
@@ -2407,6 +3144,33 @@ void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t
         }
       }
     }
+    forward_order_valid_ = forward_order_valid_ && forward_caches_valid_;
+  }
+
+  // Levels only ever need a walk when an added edge deepens its sink; a
+  // delete that may lower the sink, or any edge touching a cycle, rebuilds.
+  if (levels_valid_) {
+    const size_t n = level_of_cache_.size();
+    if (driver_idx >= kFirstUserNodeIdx && driver_idx < n && sink_idx >= kFirstUserNodeIdx && sink_idx < n
+        && !forward_is_source(driver_idx) && !forward_is_source(sink_idx)) {
+      const uint32_t driver_level = level_of_cache_[driver_idx];
+      const uint32_t sink_level   = level_of_cache_[sink_idx];
+      if (delta > 0) {
+        if (sink_level == Level_view::kNoLevel) {
+          // Already behind a cycle; it stays there.
+        } else if (driver_level == Level_view::kNoLevel) {
+          levels_valid_ = false;
+        } else {
+          try {
+            levels_valid_ = raise_levels_from(driver_idx, sink_idx);
+          } catch (...) {
+            levels_valid_ = false;
+          }
+        }
+      } else if (driver_level == Level_view::kNoLevel || sink_level == driver_level + 1) {
+        levels_valid_ = false;
+      }
+    }
   }
 
   if (backward_caches_valid_) {
@@ -2416,6 +3180,9 @@ void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t
       auto& slot = backward_remaining_out_cache_[driver_idx];
       if (delta > 0) {
         slot += static_cast<uint32_t>(delta);
+        if (backward_order_valid_ && !repair(backward_order_cache_, backward_rank_cache_, sink_idx, driver_idx, false)) {
+          backward_caches_valid_ = false;
+        }
       } else {
         const auto dec = 0u - static_cast<uint32_t>(delta);  // magnitude in unsigned space: avoids UB at INT32_MIN
         if (slot >= dec) {
@@ -2425,11 +3192,51 @@ void Graph::patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id, int32_t
         }
       }
     }
+    backward_order_valid_ = backward_order_valid_ && backward_caches_valid_;
   }
+}
 
-  dirty_ = true;
-  if (owner_lib_ != nullptr) {
-    owner_lib_->note_graph_mutation();
+void Graph::patch_traversal_caches_for_new_node() noexcept {
+  note_body_edit();
+  const size_t idx = node_table.size() - 1;
+  if (node_counts_valid_) {
+    ++live_node_count_;
+  }
+  try {
+    if (forward_caches_valid_) {
+      if (forward_remaining_in_cache_.size() != idx) {
+        forward_caches_valid_ = false;
+      } else {
+        forward_remaining_in_cache_.push_back(0);
+        if (forward_order_valid_) {
+          forward_rank_cache_.push_back(static_cast<uint32_t>(forward_order_cache_.size()));
+          forward_order_cache_.push_back(static_cast<uint32_t>(idx));
+        }
+      }
+      forward_order_valid_ = forward_order_valid_ && forward_caches_valid_;
+    }
+    if (backward_caches_valid_) {
+      if (backward_remaining_out_cache_.size() != idx) {
+        backward_caches_valid_ = false;
+      } else {
+        backward_remaining_out_cache_.push_back(0);
+        if (backward_order_valid_) {
+          backward_rank_cache_.push_back(static_cast<uint32_t>(backward_order_cache_.size()));
+          backward_order_cache_.push_back(static_cast<uint32_t>(idx));
+        }
+      }
+      backward_order_valid_ = backward_order_valid_ && backward_caches_valid_;
+    }
+    if (levels_valid_) {
+      if (level_of_cache_.size() != idx) {
+        levels_valid_ = false;
+      } else {
+        level_of_cache_.push_back(0);
+        level_buckets_stale_ = true;
+      }
+    }
+  } catch (...) {
+    invalidate_traversal_caches();
   }
 }
 
@@ -2438,7 +3245,7 @@ auto Graph::create_node() -> Node {
   Nid id = node_table.size();
   assert(id);
   node_table.emplace_back(true);
-  invalidate_traversal_caches();
+  patch_traversal_caches_for_new_node();
   Nid raw_nid = id << 2 | 0;
   return Node_class(this, raw_nid);
 }
@@ -2458,7 +3265,7 @@ auto Graph::create_pin(Nid nid, Port_id pid) -> Pid {
   assert(id);
   pin_table.emplace_back(nid, pid);
   set_next_pin(nid, id);
-  invalidate_traversal_caches();
+  note_body_edit();  // an edge-less pin changes no traversal order
   return id << 2 | 1;
 }
 
@@ -2483,7 +3290,15 @@ auto Graph::find_pin(Node_class node, Port_id port_id, bool driver) const -> Pin
     return Pin_class(const_cast<Graph*>(this), pid);
   }
   const Nid self_nid = node.get_debug_nid() & ~static_cast<Nid>(2);
-  auto*     self     = ref_node(self_nid);
+  if (port_list(self_nid) != nullptr) {
+    const Pid canonical_pin = port_index_find(self_nid, port_id);
+    if (canonical_pin == 0) {
+      assert(false && "get_pin: requested pin was not created");
+      return {};
+    }
+    return make_pin_class(canonical_pin);
+  }
+  auto* self = ref_node(self_nid);
   for (Pid cur_pin = self->get_next_pin_id(); cur_pin != 0;) {
     const Pid  canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
     auto*      pin           = ref_pin(canonical_pin);
@@ -2509,18 +3324,30 @@ auto Graph::find_or_create_pin(Node_class node, Port_id port_id) -> Pin_class {
   // port_id is just below `port_id`, and stop early if a greater-or-equal port_id is found.
   Pid       prev_pin_id = 0;  // canonical Pid of predecessor (0 = insert at head)
   Pid       cur_pin     = self->get_next_pin_id();
-  while (cur_pin != 0) {
-    const Pid  canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-    auto*      pin           = ref_pin(canonical_pin);
-    const auto cur_port      = pin->get_port_id();
-    if (cur_port == port_id) {
-      return make_pin_class(canonical_pin);
-    }
-    if (cur_port > port_id) {
-      break;  // insertion point: new pin goes before cur_pin
+  size_t    walked      = 0;
+  if (const auto* ports = port_list(self_nid)) {
+    // Indexed node: binary search gives the same (prev, cur) pair the walk would.
+    const auto it = std::lower_bound(ports->begin(), ports->end(), port_id, [](const auto& e, Port_id p) { return e.first < p; });
+    if (it != ports->end() && it->first == port_id) {
+      return make_pin_class(it->second);
+    }
+    prev_pin_id = it == ports->begin() ? 0 : std::prev(it)->second;
+    cur_pin     = it == ports->end() ? 0 : it->second;
+  } else {
+    while (cur_pin != 0) {
+      const Pid  canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+      auto*      pin           = ref_pin(canonical_pin);
+      const auto cur_port      = pin->get_port_id();
+      if (cur_port == port_id) {
+        return make_pin_class(canonical_pin);
+      }
+      if (cur_port > port_id) {
+        break;  // insertion point: new pin goes before cur_pin
+      }
+      prev_pin_id = canonical_pin;
+      cur_pin     = pin->get_next_pin_id();
+      ++walked;
     }
-    prev_pin_id = canonical_pin;
-    cur_pin     = pin->get_next_pin_id();
   }
   // Pin not found: insert before cur_pin (which is 0 when appending at the tail).
   assert_accessible();
@@ -2536,12 +3363,13 @@ auto Graph::find_or_create_pin(Node_class node, Port_id port_id) -> Pin_class {
   } else {
     pin_table[prev_pin_id >> 2].set_next_pin_id(new_pid_canonical);
   }
+  index_new_pin(self_nid, port_id, new_pid_canonical, walked);
   if (self_nid == CONST_NODE) {
     // A caller bypassed intern_constant(). Rebuild lazily so a later intern
     // sees this pin and the true list tail.
     constant_pin_index_.clear();
   }
-  invalidate_traversal_caches();
+  note_body_edit();
   return Pin_class(this, new_pid_canonical);
 }
 
@@ -2571,10 +3399,93 @@ auto Graph::append_driver_pin(Node_class node, Port_id port_id, Pid tail_pin) ->
   } else {
     pin_table[tail_pin >> 2].set_next_pin_id(canonical);
   }
-  invalidate_traversal_caches();
+  if (auto it = port_index_.find(self_nid); it != port_index_.end()) {
+    it->second.emplace_back(port_id, canonical);  // tail append keeps the index sorted
+  }
+  note_body_edit();
   return Pin_class(this, canonical | static_cast<Pid>(2));
 }
 
+auto Graph::port_list(Nid self_nid) const -> const std::vector<std::pair<Port_id, Pid>>* {
+  if (port_index_.empty()) {
+    return nullptr;
+  }
+  const auto it = port_index_.find(self_nid & ~static_cast<Nid>(3));
+  return it == port_index_.end() ? nullptr : &it->second;
+}
+
+Pid Graph::port_index_find(Nid self_nid, Port_id port_id) const {
+  const auto* ports = port_list(self_nid);
+  assert(ports != nullptr);
+  const auto it = std::lower_bound(ports->begin(), ports->end(), port_id, [](const auto& e, Port_id p) { return e.first < p; });
+  return (it != ports->end() && it->first == port_id) ? it->second : 0;
+}
+
+void Graph::index_new_pin(Nid self_nid, Port_id port_id, Pid canonical, size_t walked) {
+  self_nid &= ~static_cast<Nid>(3);
+  if (auto it = port_index_.find(self_nid); it != port_index_.end()) {
+    auto&      ports = it->second;
+    const auto pos   = std::upper_bound(ports.begin(), ports.end(), port_id, [](Port_id p, const auto& e) { return p < e.first; });
+    ports.emplace(pos, port_id, canonical);
+    return;
+  }
+  // `walked` counts the pins before the insertion point. Ascending-port
+  // construction walks the whole list, so that is already the pin count;
+  // head or middle inserts (descending ports) finish the count from the new
+  // pin on. Either way at most kPortIndexThreshold entries are visited.
+  size_t count = walked + 1;
+  for (Pid cur = ref_pin(canonical)->get_next_pin_id(); cur != 0 && count < kPortIndexThreshold; ++count) {
+    cur = ref_pin((cur & ~static_cast<Pid>(2)) | static_cast<Pid>(1))->get_next_pin_id();
+  }
+  if (count >= kPortIndexThreshold) {
+    build_port_index(self_nid);
+  }
+}
+
+void Graph::unindex_pin(Nid self_nid, Port_id port_id, Pid canonical) {
+  auto it = port_index_.find(self_nid & ~static_cast<Nid>(3));
+  if (it == port_index_.end()) {
+    return;
+  }
+  auto& ports = it->second;
+  auto  pos   = std::lower_bound(ports.begin(), ports.end(), port_id, [](const auto& e, Port_id p) { return e.first < p; });
+  while (pos != ports.end() && pos->first == port_id && pos->second != canonical) {
+    ++pos;  // create_pin(Nid, Port_id) does not dedup, so match the exact pin
+  }
+  if (pos != ports.end() && pos->second == canonical) {
+    ports.erase(pos);
+  }
+  if (ports.size() < kPortIndexThreshold / 2) {
+    port_index_.erase(it);  // hysteresis: do not rebuild/drop on every add/del pair
+  }
+}
+
+void Graph::build_port_index(Nid self_nid) {
+  self_nid    &= ~static_cast<Nid>(3);
+  auto& ports  = port_index_[self_nid];
+  ports.clear();
+  for (Pid cur = ref_node(self_nid)->get_next_pin_id(); cur != 0;) {
+    const Pid canonical = (cur & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+    auto*     entry     = ref_pin(canonical);
+    ports.emplace_back(entry->get_port_id(), canonical);
+    cur = entry->get_next_pin_id();
+  }
+}
+
+void Graph::rebuild_port_index() {
+  port_index_.clear();
+  ankerl::unordered_dense::map<Nid, uint32_t> pins_per_node;
+  for (size_t i = 1; i < pin_table.size(); ++i) {
+    const Nid owner = pin_table[i].get_master_nid() & ~static_cast<Nid>(3);
+    if (owner == 0) {
+      continue;  // dead slot
+    }
+    if (++pins_per_node[owner] == kPortIndexThreshold) {
+      build_port_index(owner);
+    }
+  }
+}
+
 void Graph::rebuild_constant_pin_index(Port_id first_payload_port) {
   auto& index = constant_pin_index_;
   index.by_hash.clear();
@@ -2631,7 +3542,7 @@ auto Graph::resolve_driver_port(Node_class node, std::string_view name) const ->
   const auto* entry = ref_node(node.get_debug_nid());
   assert(entry->has_subnode() && "create_driver_pin: string form requires a subnode GraphIO");
   assert(owner_lib_ != nullptr && "create_driver_pin: graph has no GraphLibrary");
-  auto gio = owner_lib_->io_at_unlocked(entry->get_subnode());
+  auto gio = owner_lib_->io_at_unlocked(subnode_gid(node.get_debug_nid()));
   assert(gio != nullptr && gio->has_output(name) && "create_driver_pin: output name not found in subnode GraphIO");
   return gio->get_output_port_id(name);
 }
@@ -2641,7 +3552,7 @@ auto Graph::resolve_sink_port(Node_class node, std::string_view name) const -> P
   const auto* entry = ref_node(node.get_debug_nid());
   assert(entry->has_subnode() && "create_sink_pin: string form requires a subnode GraphIO");
   assert(owner_lib_ != nullptr && "create_sink_pin: graph has no GraphLibrary");
-  auto gio = owner_lib_->io_at_unlocked(entry->get_subnode());
+  auto gio = owner_lib_->io_at_unlocked(subnode_gid(node.get_debug_nid()));
   assert(gio != nullptr && gio->has_input(name) && "create_sink_pin: input name not found in subnode GraphIO");
   return gio->get_input_port_id(name);
 }
@@ -2682,7 +3593,7 @@ auto Graph::pin_name(Pin_class pin) const -> std::string_view {
 
   const auto* owner = ref_node(owner_nid);
   if (owner->has_subnode() && owner_lib_ != nullptr) {
-    auto gio = owner_lib_->io_at_unlocked(owner->get_subnode());
+    auto gio = owner_lib_->io_at_unlocked(subnode_gid(owner_nid));
     if (gio) {
       if (raw_pid & static_cast<Pid>(2)) {
         for (const auto& decl : gio->output_pin_decls_) {
@@ -2792,6 +3703,7 @@ void Graph::delete_pin(Pid pin_pid) {
 
   const Nid owner_nid = pin->get_master_nid() & ~static_cast<Nid>(2);
   auto*     owner     = ref_node(owner_nid);
+  unindex_pin(owner_nid, pin->get_port_id(), pin_lookup);
   if (owner->get_next_pin_id() == pin_lookup) {
     owner->set_next_pin_id(pin->get_next_pin_id());
   } else {
@@ -2807,8 +3719,7 @@ void Graph::delete_pin(Pid pin_pid) {
   }
 
   if (pin->check_overflow()) {
-    overflow_free_.push_back(pin->get_overflow_idx());
-    overflow_sets()[pin->get_overflow_idx()].clear();
+    pool.free(pin->get_overflow_idx());
   }
   erase_attr_object(make_pin_attr_key(static_cast<uint64_t>(pin_lookup)));
 
@@ -2865,8 +3776,10 @@ void Pin_class::del_sink(Pin_class driver_pin) const {
 
 void Pin_class::del_sink() const {
   assert(graph_ != nullptr && "del_sink: pin is not attached to a graph");
-  auto edges = graph_->inp_edges(*this);
-  for (const auto& edge : edges) {
+  // inp_edges() is a lazy view; snapshot before deleting (see del_driver).
+  auto                               r = graph_->inp_edges(*this);
+  absl::InlinedVector<Edge_class, 4> snap(r.begin(), r.end());
+  for (const auto& edge : snap) {
     edge.del_edge();
   }
 }
@@ -2893,7 +3806,7 @@ auto Pin_class::out_edges() const -> OutEdgeRange {
   return graph_->out_edges(*this);
 }
 
-auto Pin_class::inp_edges() const -> absl::InlinedVector<Edge_class, 4> {
+auto Pin_class::inp_edges() const -> InpEdgeRange {
   assert(graph_ != nullptr && "inp_edges: pin is not attached to a graph");
   return graph_->inp_edges(*this);
 }
@@ -2975,7 +3888,7 @@ Gid Node_class::get_subnode_gid() const {
   if (entry == nullptr || !entry->has_subnode()) {
     return Gid_invalid;
   }
-  return entry->get_subnode();
+  return graph_->subnode_gid(raw_nid);
 }
 
 std::shared_ptr<GraphIO> Node_class::get_subnode_io() const {
@@ -3259,8 +4172,15 @@ void Subnode_group::validate() const {
 
 void Node_class::set_type(Type type) const {
   assert(graph_ != nullptr && "set_type: node is not attached to a graph");
-  graph_->ref_node(raw_nid)->set_type(type);
-  graph_->invalidate_traversal_caches();
+  auto*      entry          = graph_->ref_node(raw_nid);
+  const bool was_loop_break = entry->is_loop_break();
+  entry->set_type(type);
+  // Only the loop_break bit feeds the traversal caches (it makes a source).
+  if (entry->is_loop_break() != was_loop_break) {
+    graph_->invalidate_traversal_caches();
+  } else {
+    graph_->note_body_edit();
+  }
 }
 
 Type Node_class::get_type() const {
@@ -3344,7 +4264,7 @@ auto Node_class::out_edges() const -> OutEdgeRange {
   return graph_->out_edges(*this);
 }
 
-auto Node_class::inp_edges() const -> absl::InlinedVector<Edge_class, 4> {
+auto Node_class::inp_edges() const -> InpEdgeRange {
   assert(graph_ != nullptr && "inp_edges: node is not attached to a graph");
   return graph_->inp_edges(*this);
 }
@@ -3361,22 +4281,19 @@ auto Node_class::inp_pins() const -> absl::InlinedVector<Pin_class, 4> {
 
 bool Node_class::has_out_edges() const {
   assert(graph_ != nullptr && "has_out_edges: node is not attached to a graph");
-  const Nid self_nid = raw_nid & ~static_cast<Nid>(2);
-  auto*     self     = graph_->ref_node(self_nid);
-  // Node-as-pin (port 0): scan node-entry edges, skip back-edges (bit 1 = sink).
-  for (auto vid : self->get_edges(self_nid, graph_->overflow_sets())) {
-    if (!(vid & static_cast<Vid>(2))) {
-      return true;
-    }
+  const Nid   self_nid = raw_nid & ~static_cast<Nid>(2);
+  auto*       self     = graph_->ref_node(self_nid);
+  const auto& overflow = graph_->overflow_sets();
+  // Node-as-pin (port 0) first, then the pin linked list; inline entries are
+  // answered from the slot masks alone (see sedge_decode.hpp).
+  if (self->has_dir_edges(self_nid, false, overflow)) {
+    return true;
   }
-  // Other pins: walk the pin linked list.
   for (Pid cur_pin = self->get_next_pin_id(); cur_pin != 0;) {
     const Pid canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
     auto*     pin_entry     = graph_->ref_pin(canonical_pin);
-    for (auto vid : pin_entry->get_edges(canonical_pin, graph_->overflow_sets())) {
-      if (!(vid & static_cast<Vid>(2))) {
-        return true;
-      }
+    if (pin_entry->has_dir_edges(canonical_pin, false, overflow)) {
+      return true;
     }
     cur_pin = pin_entry->get_next_pin_id();
   }
@@ -3385,22 +4302,19 @@ bool Node_class::has_out_edges() const {
 
 bool Node_class::has_inp_edges() const {
   assert(graph_ != nullptr && "has_inp_edges: node is not attached to a graph");
-  const Nid self_nid = raw_nid & ~static_cast<Nid>(2);
-  auto*     self     = graph_->ref_node(self_nid);
-  // Node-as-pin (port 0): scan node-entry edges, keep back-edges (bit 1 = sink).
-  for (auto vid : self->get_edges(self_nid, graph_->overflow_sets())) {
-    if (vid & static_cast<Vid>(2)) {
-      return true;
-    }
+  const Nid   self_nid = raw_nid & ~static_cast<Nid>(2);
+  auto*       self     = graph_->ref_node(self_nid);
+  const auto& overflow = graph_->overflow_sets();
+  // Node-as-pin (port 0) first, then the pin linked list; inline entries are
+  // answered from the slot masks alone (see sedge_decode.hpp).
+  if (self->has_dir_edges(self_nid, true, overflow)) {
+    return true;
   }
-  // Other pins.
   for (Pid cur_pin = self->get_next_pin_id(); cur_pin != 0;) {
     const Pid canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
     auto*     pin_entry     = graph_->ref_pin(canonical_pin);
-    for (auto vid : pin_entry->get_edges(canonical_pin, graph_->overflow_sets())) {
-      if (vid & static_cast<Vid>(2)) {
-        return true;
-      }
+    if (pin_entry->has_dir_edges(canonical_pin, true, overflow)) {
+      return true;
     }
     cur_pin = pin_entry->get_next_pin_id();
   }
@@ -3441,8 +4355,8 @@ void Graph::set_subnode(Nid nid, Gid gid) {
   validated_loop_carries_.erase(nid);
 #endif
   sync_loop_presence();
-  auto pool = get_overflow_pool();
-  ref_node(nid)->set_subnode(nid, gid, pool);
+  ref_node(nid)->set_subnode_flag();
+  subnode_gid_.insert_or_assign(nid, gid);
 
   // Persistent hierarchy: add a child to this graph's tree representing
   // this subnode instance. Only add if not already tracked (re-calling
@@ -3542,7 +4456,7 @@ bool Graph::would_create_cycle(Gid target_gid) const noexcept {
       if (!entry->is_alive() || !entry->has_subnode()) {
         continue;
       }
-      stack.push_back(entry->get_subnode());
+      stack.push_back(graph->subnode_gid(nid));
     }
   }
   return false;
@@ -3560,6 +4474,55 @@ void Graph::add_edge(Vid driver_id, Vid sink_id) {
 #endif
 }
 
+void Graph::add_edges(std::span<const std::pair<Pin_class, Pin_class>> edges) {
+  assert_accessible();
+  if (edges.empty()) {
+    return;
+  }
+  // Both half-edges of every connection, keyed by the entry that stores them
+  // (role bit 1 cleared so a pin's driver and sink halves share one group).
+  std::vector<std::pair<Vid, Vid>> halves;
+  halves.reserve(edges.size() * 2);
+  for (const auto& [driver_pin, sink_pin] : edges) {
+    assert_pin_exists(driver_pin);
+    assert_pin_exists(sink_pin);
+    const Vid driver_id = static_cast<Vid>(driver_pin.get_debug_pid()) | static_cast<Vid>(2);
+    const Vid sink_id   = static_cast<Vid>(sink_pin.get_debug_pid()) & ~static_cast<Vid>(2);
+    halves.emplace_back(driver_id & ~static_cast<Vid>(2), sink_id);
+    halves.emplace_back(sink_id, driver_id);
+  }
+  std::stable_sort(halves.begin(), halves.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  auto             pool = get_overflow_pool();
+  std::vector<Vid> others;
+  for (size_t i = 0; i < halves.size();) {
+    const Vid self = halves[i].first;
+    others.clear();
+    for (; i < halves.size() && halves[i].first == self; ++i) {
+      others.push_back(halves[i].second);
+    }
+    if (self & static_cast<Vid>(1)) {
+      ref_pin(self)->add_edges(self, others, pool);
+    } else {
+      ref_node(self)->add_edges(self, others, pool);
+    }
+  }
+
+  invalidate_traversal_caches();
+#ifndef NDEBUG
+  for (const auto& [driver_pin, sink_pin] : edges) {
+    debug_revalidate_loop_edge_mutation(static_cast<Vid>(driver_pin.get_debug_pid()) | static_cast<Vid>(2),
+                                        static_cast<Vid>(sink_pin.get_debug_pid()) & ~static_cast<Vid>(2));
+  }
+#endif
+}
+
+void Graph::reserve(size_t node_count, size_t pin_count) {
+  assert_accessible();
+  node_table.reserve(node_count);
+  pin_table.reserve(pin_count);
+}
+
 void Edge_class::del_edge() const {
   auto* graph = driver.get_graph();
   assert(graph != nullptr && "del_edge: edge driver is not attached to a graph");
@@ -3649,12 +4612,21 @@ OccurrenceNodeRange::const_iterator::const_iterator(std::shared_ptr<detail::Occu
 auto OccurrenceNodeRange::const_iterator::operator*() const -> reference {
   if (cursor_) {
     cursor_->state->assert_unmutated();
-    return cursor_->current;
+    return cursor_->node();
   }
   detail::assert_hierarchy_view_unmutated(state_);
   return (*entities_)[index_];
 }
 
+Occurrence_ref OccurrenceNodeRange::const_iterator::ref() const {
+  if (cursor_) {
+    cursor_->state->assert_unmutated();
+    return cursor_->current;
+  }
+  detail::assert_hierarchy_view_unmutated(state_);
+  return (*entities_)[index_].ref();
+}
+
 auto OccurrenceNodeRange::const_iterator::operator->() const -> pointer { return std::addressof(operator*()); }
 
 auto OccurrenceNodeRange::const_iterator::operator++() -> const_iterator& {
@@ -3695,18 +4667,25 @@ OccurrenceNodeRange::OccurrenceNodeRange() : entities_(std::make_shared<const st
 OccurrenceNodeRange::OccurrenceNodeRange(std::vector<Occurrence_node> entities, std::shared_ptr<detail::Hierarchy_view_state> state)
     : entities_(std::make_shared<const std::vector<Occurrence_node>>(std::move(entities))), state_(std::move(state)) {}
 
-OccurrenceNodeRange::OccurrenceNodeRange(std::shared_ptr<detail::Hierarchy_view_state> state)
-    : state_(std::move(state)), streaming_(true) {}
+OccurrenceNodeRange::OccurrenceNodeRange(std::shared_ptr<detail::Hierarchy_view_state> state, Stream stream, Cut_placement cuts)
+    : state_(std::move(state)), streaming_(true), stream_(stream), cuts_(cuts) {}
 
 OccurrenceNodeRange OccurrenceNodeRange::streaming(std::shared_ptr<detail::Hierarchy_view_state> state) {
-  return OccurrenceNodeRange(std::move(state));
+  return OccurrenceNodeRange(std::move(state), Stream::storage, Cut_placement::first);
+}
+
+OccurrenceNodeRange OccurrenceNodeRange::streaming(std::shared_ptr<detail::Hierarchy_view_state> state, bool forward,
+                                                   Cut_placement cuts) {
+  return OccurrenceNodeRange(std::move(state), forward ? Stream::forward : Stream::reverse, cuts);
 }
 
 auto OccurrenceNodeRange::begin() const -> const_iterator {
   if (!streaming_) {
     return const_iterator(entities_, 0, state_);
   }
-  auto cursor = std::make_shared<detail::Occurrence_node_cursor>(state_);
+  using Walk        = detail::Occurrence_node_cursor::Walk;
+  const auto walk   = stream_ == Stream::storage ? Walk::storage : stream_ == Stream::forward ? Walk::forward : Walk::reverse;
+  auto       cursor = std::make_shared<detail::Occurrence_node_cursor>(state_, walk, cuts_);
   if (cursor->done) {
     return {};
   }
@@ -3726,7 +4705,18 @@ std::optional<uint64_t> OccurrenceNodeRange::size_exact() const {
   if (!streaming_) {
     return static_cast<uint64_t>(entities_->size());
   }
-  return state_ ? state_->count_nodes(state_->expand_loops) : std::optional<uint64_t>(0);
+  if (!state_) {
+    return uint64_t{0};
+  }
+  if (stream_ == Stream::storage || cuts_ == Cut_placement::first || cuts_ == Cut_placement::last) {
+    return state_->count_nodes(state_->expand_loops);  // every occurrence exactly once
+  }
+  // omit / both drop or repeat the loop_breaks: count the walk itself.
+  uint64_t count = 0;
+  for (auto it = begin(), last = end(); it != last; ++it) {
+    ++count;
+  }
+  return count;
 }
 
 uint64_t OccurrenceNodeRange::size_hint() const { return size_exact().value_or(std::numeric_limits<uint64_t>::max()); }
@@ -3758,6 +4748,30 @@ BackwardClassRange Body_view::nodes(Node_order::reverse_t, Cut_placement cuts) c
   const auto [first, last] = cut_flags(cuts);
   return BackwardClassRange(graph_, first, last);
 }
+ForwardClassRange Body_view::nodes(Node_order::forward_t, Traversal_scratch& scratch, Cut_placement cuts) const noexcept {
+  assert_graph_alive();
+  const auto [first, last] = cut_flags(cuts);
+  return ForwardClassRange(graph_, first, last, &scratch);
+}
+BackwardClassRange Body_view::nodes(Node_order::reverse_t, Traversal_scratch& scratch, Cut_placement cuts) const noexcept {
+  assert_graph_alive();
+  const auto [first, last] = cut_flags(cuts);
+  return BackwardClassRange(graph_, first, last, &scratch);
+}
+
+Level_view Body_view::levels() const {
+  assert_graph_alive();
+  if (graph_ == nullptr) {
+    return Level_view({}, {}, {});
+  }
+  graph_->ensure_level_caches();
+  return Level_view(graph_->level_nodes_cache_, graph_->level_off_cache_, graph_->level_of_cache_);
+}
+
+uint32_t Level_view::level_of(const Node_class& node) const noexcept {
+  const auto idx = static_cast<size_t>(node.get_debug_nid() >> 2);
+  return idx < level_of_.size() ? level_of_[idx] : kNoLevel;
+}
 
 namespace {
 
@@ -4010,6 +5024,14 @@ OccurrenceNodeRange Grouped_hierarchy_view::nodes(Node_order::reverse_t, Cut_pla
   return OccurrenceNodeRange(order_occurrence_nodes(hierarchy->storage_nodes(), false, cuts), hierarchy);
 }
 
+OccurrenceNodeRange Grouped_hierarchy_view::spliced_nodes(Node_order::forward_t, Cut_placement cuts) const {
+  return OccurrenceNodeRange::streaming(state(), true, cuts);
+}
+
+OccurrenceNodeRange Grouped_hierarchy_view::spliced_nodes(Node_order::reverse_t, Cut_placement cuts) const {
+  return OccurrenceNodeRange::streaming(state(), false, cuts);
+}
+
 InstanceGroupRange Grouped_hierarchy_view::instances() const {
   auto hierarchy = state();
   return InstanceGroupRange(hierarchy->instance_groups(), hierarchy);
@@ -4025,10 +5047,22 @@ Occurrence_node Grouped_hierarchy_view::lift(Node_class root_node) const {
   return state()->make_node(root_node, 0, 0);
 }
 
+Occurrence_node Grouped_hierarchy_view::resolve(const Occurrence_ref& ref) const {
+  const auto hierarchy = state();
+  if (!ref.is_valid() || ref.path >= hierarchy->paths->entries.size() || ref.container >= hierarchy->paths->entries.size()) {
+    throw std::out_of_range("Grouped_hierarchy_view::resolve: ref was not produced by this view");
+  }
+  return hierarchy->make_node(Node_class(ref.graph, ref.nid), ref.path, ref.container);
+}
+
 ReachablePinRange Grouped_hierarchy_view::reachable_pins(std::vector<Occurrence_pin> seeds, Reach_options options) const {
   return ReachablePinRange(std::move(seeds), options);
 }
 
+Occurrence_cone Grouped_hierarchy_view::cone(std::span<const Occurrence_node> seeds, const Cone_options& opts) const {
+  return state()->cone(seeds, opts);
+}
+
 std::optional<uint64_t> Grouped_hierarchy_view::size_exact() const { return state()->count_nodes(false); }
 
 uint64_t Grouped_hierarchy_view::size_hint() const { return size_exact().value_or(std::numeric_limits<uint64_t>::max()); }
@@ -4059,6 +5093,14 @@ OccurrenceNodeRange Occurrences_view::nodes(Node_order::reverse_t, Cut_placement
   return OccurrenceNodeRange(order_occurrence_nodes(hierarchy->storage_nodes(), false, cuts), hierarchy);
 }
 
+OccurrenceNodeRange Occurrences_view::spliced_nodes(Node_order::forward_t, Cut_placement cuts) const {
+  return OccurrenceNodeRange::streaming(state(), true, cuts);
+}
+
+OccurrenceNodeRange Occurrences_view::spliced_nodes(Node_order::reverse_t, Cut_placement cuts) const {
+  return OccurrenceNodeRange::streaming(state(), false, cuts);
+}
+
 Occurrence_pin Occurrences_view::lift(Pin_class root_pin) const {
   assert(root_pin.get_graph() == graph_ && "Occurrences_view::lift requires a pin in the root body");
   return state()->make_pin(root_pin, 0, 0);
@@ -4069,10 +5111,22 @@ Occurrence_node Occurrences_view::lift(Node_class root_node) const {
   return state()->make_node(root_node, 0, 0);
 }
 
+Occurrence_node Occurrences_view::resolve(const Occurrence_ref& ref) const {
+  const auto hierarchy = state();
+  if (!ref.is_valid() || ref.path >= hierarchy->paths->entries.size() || ref.container >= hierarchy->paths->entries.size()) {
+    throw std::out_of_range("Occurrences_view::resolve: ref was not produced by this view");
+  }
+  return hierarchy->make_node(Node_class(ref.graph, ref.nid), ref.path, ref.container);
+}
+
 ReachablePinRange Occurrences_view::reachable_pins(std::vector<Occurrence_pin> seeds, Reach_options options) const {
   return ReachablePinRange(std::move(seeds), options);
 }
 
+Occurrence_cone Occurrences_view::cone(std::span<const Occurrence_node> seeds, const Cone_options& opts) const {
+  return state()->cone(seeds, opts);
+}
+
 std::optional<uint64_t> Occurrences_view::size_exact() const { return state()->count_nodes(true); }
 
 uint64_t Occurrences_view::size_hint() const { return size_exact().value_or(std::numeric_limits<uint64_t>::max()); }
@@ -4127,7 +5181,7 @@ const ankerl::unordered_dense::set<Gid>*& hier_opaque_ref() noexcept {
 // clobbering the cache). Pass 2 reads the cache directly. Tail re-scans
 // storage order for cycle survivors.
 
-ForwardClassIterator::ForwardClassIterator(Graph* graph, bool loop_break_first, bool loop_break_last)
+ForwardClassIterator::ForwardClassIterator(Graph* graph, bool loop_break_first, bool loop_break_last, Traversal_scratch* scratch)
     : graph_(graph), loop_break_first_(loop_break_first), loop_break_last_(loop_break_last) {
   if (graph_ == nullptr) {
     phase_ = Phase::End;
@@ -4140,8 +5194,16 @@ ForwardClassIterator::ForwardClassIterator(Graph* graph, bool loop_break_first,
     phase_ = Phase::End;
     return;
   }
-  working_remaining_in_ = graph_->forward_remaining_in_cache_;
-  emitted_bits_.assign((node_count_ + 63) / 64, 0);
+  if (graph_->forward_order_valid_) {
+    phase_ = Phase::Order;
+    idx_   = 0;
+    advance();
+    return;
+  }
+  // assign() into a borrowed buffer reuses its capacity.
+  scratch_ = Scratch_lease(scratch);
+  scratch_.counts.assign(graph_->forward_remaining_in_cache_.begin(), graph_->forward_remaining_in_cache_.end());
+  scratch_.emitted.assign((node_count_ + 63) / 64, 0);
   phase_ = Phase::Pass1;
   idx_   = kFirstUserNodeIdx;
   advance();
@@ -4152,9 +5214,9 @@ ForwardClassIterator& ForwardClassIterator::operator=(ForwardClassIterator&& o)
 
 bool ForwardClassIterator::is_source(size_t idx) const noexcept { return graph_->forward_is_source(idx); }
 
-bool ForwardClassIterator::is_emitted(size_t idx) const noexcept { return (emitted_bits_[idx >> 6] >> (idx & 63)) & 1ULL; }
+bool ForwardClassIterator::is_emitted(size_t idx) const noexcept { return (scratch_.emitted[idx >> 6] >> (idx & 63)) & 1ULL; }
 
-void ForwardClassIterator::mark_emitted(size_t idx) noexcept { emitted_bits_[idx >> 6] |= (1ULL << (idx & 63)); }
+void ForwardClassIterator::mark_emitted(size_t idx) noexcept { scratch_.emitted[idx >> 6] |= (1ULL << (idx & 63)); }
 
 // Decrement downstream sinks for a Pass-1 emission (cached Pass-2 replay does
 // not decrement — the cache already captures the full pending sequence).
@@ -4162,128 +5224,40 @@ void ForwardClassIterator::propagate(size_t driver_idx, size_t /*cursor*/) {
   if (is_source(driver_idx)) {
     return;
   }
-  const Nid driver_nid = static_cast<Nid>(driver_idx) << 2;
-  auto&     node_table = graph_->node_table;
-  auto&     overflow   = graph_->overflow_sets();
-
-  auto sink_idx_of = [&](Vid vid) -> size_t {
-    Nid sink_nid;
-    if (vid & static_cast<Vid>(1)) {
-      const Pid sink_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-      sink_nid           = graph_->ref_pin(sink_pid)->get_master_nid();
-    } else {
-      sink_nid = static_cast<Nid>(vid);
-    }
-    sink_nid = sink_nid & ~static_cast<Nid>(3);
-    return static_cast<size_t>(sink_nid >> 2);
-  };
-
-  auto try_dec = [&](size_t sink_idx) {
-    if (sink_idx < kFirstUserNodeIdx || sink_idx >= node_count_) {
-      return;
-    }
-    if (sink_idx == driver_idx && graph_->subnode_loops_.contains(driver_nid)) {
-      return;
-    }
+  graph_->for_each_forward_sink(driver_idx, [this](size_t sink_idx) {
     if (is_emitted(sink_idx) || is_source(sink_idx)) {
       return;
     }
-    if (working_remaining_in_[sink_idx] == 0) {
+    if (scratch_.counts[sink_idx] == 0) {
       return;
     }
-    --working_remaining_in_[sink_idx];
-  };
-
-  // Inline edge iteration: avoid building an EdgeRange (which allocates a
-  // scratch vector) for every node/pin we walk. For forward propagation we
-  // only care about outgoing edges (bit 2 == 0), so we can decode slots
-  // directly and skip incoming edges without ever materializing them.
-  constexpr uint64_t SLOT_MASK  = (1ULL << 16) - 1;
-  constexpr uint64_t SIGN_BIT   = 1ULL << 15;
-  constexpr uint64_t DRIVER_BIT = 1ULL << 1;
-  constexpr uint64_t PIN_BIT    = 1ULL << 0;
-  constexpr uint64_t MAG_MASK   = (1ULL << 13) - 1;
-
-  auto decode_inline_slot = [&](uint64_t raw, uint64_t self_num) -> Vid {
-    const bool     neg        = (raw & SIGN_BIT) != 0;
-    const bool     driver     = (raw & DRIVER_BIT) != 0;
-    const bool     pin        = (raw & PIN_BIT) != 0;
-    const uint64_t mag        = (raw >> 2) & MAG_MASK;
-    const int64_t  delta      = neg ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
-    const uint64_t target_num = self_num - delta;
-    return static_cast<Vid>((target_num << 2) | (driver ? DRIVER_BIT : 0) | (pin ? PIN_BIT : 0));
-  };
-
-  {
-    const auto&    node     = node_table[driver_idx];
-    const uint64_t self_num = static_cast<uint64_t>(driver_nid) >> 2;
-    if (node.use_overflow) {
-      for (auto vid : overflow[node.sedges_.overflow_idx]) {
-        if (vid & static_cast<Vid>(2)) {
-          continue;
-        }
-        try_dec(sink_idx_of(vid));
-      }
-    } else {
-      const uint64_t packed = node.sedges_.sedges;
-      for (int slot = 0; slot < 4; ++slot) {
-        const uint64_t raw = (packed >> (slot * 16)) & SLOT_MASK;
-        if (raw == 0 || (raw & DRIVER_BIT) != 0) {
-          continue;
-        }
-        try_dec(sink_idx_of(decode_inline_slot(raw, self_num)));
-      }
-      const uint64_t extra = node.sedges_extra;
-      for (int slot = 0; slot < 3; ++slot) {
-        const uint64_t raw = (extra >> (slot * 16)) & SLOT_MASK;
-        if (raw == 0 || (raw & DRIVER_BIT) != 0) {
-          continue;
-        }
-        try_dec(sink_idx_of(decode_inline_slot(raw, self_num)));
-      }
-      if (node.ledge0 && !(node.ledge0 & 2)) {
-        try_dec(sink_idx_of(node.ledge0));
-      }
-      if (node.ledge1 && !(node.ledge1 & 2)) {
-        try_dec(sink_idx_of(node.ledge1));
-      }
-    }
-  }
-  for (Pid pin_vid = node_table[driver_idx].get_next_pin_id(); pin_vid != 0;) {
-    const Pid   canonical_pin = (pin_vid & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-    const auto* pin           = graph_->ref_pin(canonical_pin);
-    if (pin->use_overflow) {
-      for (auto edge_vid : overflow[pin->sedges_.overflow_idx]) {
-        if (edge_vid & static_cast<Vid>(2)) {
-          continue;
-        }
-        try_dec(sink_idx_of(edge_vid));
-      }
-    } else {
-      const uint64_t self_num = static_cast<uint64_t>(canonical_pin) >> 2;
-      const uint64_t packed   = pin->sedges_.sedges;
-      for (int slot = 0; slot < 4; ++slot) {
-        const uint64_t raw = (packed >> (slot * 16)) & SLOT_MASK;
-        if (raw == 0 || (raw & DRIVER_BIT) != 0) {
-          continue;
-        }
-        try_dec(sink_idx_of(decode_inline_slot(raw, self_num)));
-      }
-      if (pin->ledge0 && !(pin->ledge0 & 2)) {
-        try_dec(sink_idx_of(pin->ledge0));
-      }
-      if (pin->ledge1 && !(pin->ledge1 & 2)) {
-        try_dec(sink_idx_of(pin->ledge1));
-      }
-    }
-    pin_vid = pin->get_next_pin_id();
-  }
+    --scratch_.counts[sink_idx];
+  });
 }
 
 void ForwardClassIterator::advance() {
   // Position at the next emittable node; emit it (mark + propagate if Pass1);
   // leaves current_idx_ set and phase_ == End when exhausted.
   while (true) {
+    if (phase_ == Phase::Order) {
+      // Maintained topological order: sources sit where Pass 1 met them.
+      const auto& order = graph_->forward_order_cache_;
+      while (idx_ < order.size()) {
+        const size_t i = order[idx_++];
+        if (i >= node_count_ || !graph_->node_table[i].is_alive() || (!loop_break_first_ && is_source(i))) {
+          continue;
+        }
+        current_idx_ = i;
+        return;
+      }
+      phase_ = loop_break_last_ ? Phase::LoopLast : Phase::End;
+      idx_   = kFirstUserNodeIdx;
+      if (phase_ == Phase::End) {
+        current_idx_ = 0;
+        return;
+      }
+      continue;
+    }
     if (phase_ == Phase::Pass1) {
       while (idx_ < node_count_) {
         const size_t i = idx_++;
@@ -4291,7 +5265,7 @@ void ForwardClassIterator::advance() {
           continue;
         }
         const bool src = is_source(i);
-        if (src || working_remaining_in_[i] == 0) {
+        if (src || scratch_.counts[i] == 0) {
           mark_emitted(i);
           propagate(i, i);
           // loop_break nodes are the only user-range sources. They are always
@@ -4369,14 +5343,16 @@ ForwardClassIterator& ForwardClassIterator::operator++() {
   return *this;
 }
 
-ForwardClassIterator ForwardClassRange::begin() const { return ForwardClassIterator(graph_, loop_break_first_, loop_break_last_); }
+ForwardClassIterator ForwardClassRange::begin() const {
+  return ForwardClassIterator(graph_, loop_break_first_, loop_break_last_, scratch_);
+}
 
 size_t ForwardClassRange::size() const {
-  size_t n = 0;
-  for (auto it = begin(); it != end(); ++it) {
-    ++n;
+  if (graph_ == nullptr) {
+    return 0;
   }
-  return n;
+  graph_->assert_accessible();
+  return graph_->ordered_node_count(loop_break_first_, loop_break_last_);
 }
 
 Node_class ForwardClassRange::front() const {
@@ -4385,106 +5361,811 @@ Node_class ForwardClassRange::front() const {
   return *it;
 }
 
-bool ForwardClassRange::empty() const { return begin() == end(); }
+bool ForwardClassRange::empty() const { return size() == 0; }
 
-// --- BackwardClassIterator ---
+// --- Body_view::parallel_for_each ---
 //
-// Replays the reverse topological emission order using backward_pass2_cache_ and
-// initial out-edge counts.
+// Level-synchronous in spirit, but without level barriers: each node carries
+// an atomic copy of its forward_remaining_in_cache_ count, and the worker
+// whose decrement reaches zero queues the sink on its own deque (LIFO for
+// locality). Idle workers steal the oldest entry of another deque.
+// `outstanding` counts queued plus running nodes; a child is counted before
+// its parent finishes, so it only reaches zero once the wave is done.
 
-BackwardClassIterator::BackwardClassIterator(Graph* graph, bool loop_break_first, bool loop_break_last)
-    : graph_(graph), loop_break_first_(loop_break_first), loop_break_last_(loop_break_last) {
-  if (graph_ == nullptr) {
-    phase_ = Phase::End;
-    return;
-  }
-  graph_->assert_accessible();
-  graph_->ensure_backward_caches();
-  node_count_ = graph_->node_table.size();
-  if (node_count_ <= kFirstUserNodeIdx) {
-    phase_ = Phase::End;
-    return;
-  }
-  working_remaining_out_ = graph_->backward_remaining_out_cache_;
-  emitted_bits_.assign((node_count_ + 63) / 64, 0);
-  phase_ = Phase::Pass1;
-  idx_   = node_count_;
-  advance();
-}
+namespace {
 
-BackwardClassIterator::BackwardClassIterator(BackwardClassIterator&& o) noexcept            = default;
-BackwardClassIterator& BackwardClassIterator::operator=(BackwardClassIterator&& o) noexcept = default;
+struct alignas(64) Ready_deque {
+  std::mutex           mu;
+  std::deque<uint32_t> q;
 
-bool BackwardClassIterator::is_sink(size_t idx) const noexcept { return graph_->backward_is_sink(idx); }
+  void push(uint32_t idx) {
+    std::lock_guard lock(mu);
+    q.push_back(idx);
+  }
+  bool pop_back(uint32_t& idx) {
+    std::lock_guard lock(mu);
+    if (q.empty()) {
+      return false;
+    }
+    idx = q.back();
+    q.pop_back();
+    return true;
+  }
+  bool steal(uint32_t& idx) {
+    std::lock_guard lock(mu);
+    if (q.empty()) {
+      return false;
+    }
+    idx = q.front();
+    q.pop_front();
+    return true;
+  }
+};
 
-bool BackwardClassIterator::is_emitted(size_t idx) const noexcept { return (emitted_bits_[idx >> 6] >> (idx & 63)) & 1ULL; }
+void run_on_threads(unsigned workers, function_ref<void(unsigned)> body) {
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (unsigned w = 1; w < workers; ++w) {
+    threads.emplace_back([body, w] { body(w); });
+  }
+  body(0);
+  for (auto& t : threads) {
+    t.join();
+  }
+}
 
-void BackwardClassIterator::mark_emitted(size_t idx) noexcept { emitted_bits_[idx >> 6] |= (1ULL << (idx & 63)); }
+}  // namespace
 
-void BackwardClassIterator::propagate(size_t sink_idx, size_t /*cursor*/) {
-  if (is_sink(sink_idx)) {
+void Body_view::parallel_for_each(Node_order::forward_t, function_ref<void(Node_class)> fn, const Parallel_options& opts) const {
+  assert_graph_alive();
+  if (graph_ == nullptr) {
+    return;
+  }
+  Graph* const g = graph_;
+  g->ensure_forward_caches();
+  (void)g->overflow_sets();  // settle a deferred overflow load before fanning out
+  const size_t node_count = g->node_table.size();
+  if (node_count <= kFirstUserNodeIdx) {
     return;
   }
+  const auto [loop_first, loop_last] = cut_flags(opts.cuts);
+  const unsigned workers = std::max(1U, opts.threads != 0 ? opts.threads : std::thread::hardware_concurrency());
 
-  auto driver_idx_of = [&](Vid vid) -> size_t {
-    Nid driver_nid;
-    if (vid & static_cast<Vid>(1)) {
-      const Pid driver_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-      driver_nid           = graph_->ref_pin(driver_pid)->get_master_nid();
-    } else {
-      driver_nid = static_cast<Nid>(vid);
-    }
-    driver_nid = driver_nid & ~static_cast<Nid>(3);
-    return static_cast<size_t>(driver_nid >> 2);
-  };
+  std::vector<uint32_t> remaining = g->forward_remaining_in_cache_;
+  std::unique_ptr<Ready_deque[]> queues(new Ready_deque[workers]);
+  std::atomic<size_t>            outstanding{0};
+  std::atomic<bool>              failed{false};
+  std::exception_ptr             error;
+  std::mutex                     error_mu;
 
-  auto try_dec = [&](size_t driver_idx) {
-    if (driver_idx < kFirstUserNodeIdx || driver_idx >= node_count_) {
-      return;
-    }
-    if (driver_idx == sink_idx && graph_->subnode_loops_.contains(static_cast<Nid>(sink_idx) << 2)) {
-      return;
-    }
-    if (is_emitted(driver_idx) || is_sink(driver_idx)) {
+  // Runs one wave: seeds are spread round-robin, then workers drain and steal.
+  const auto run_wave = [&](bool propagate) {
+    if (outstanding.load(std::memory_order_relaxed) == 0) {
       return;
     }
-    if (working_remaining_out_[driver_idx] == 0) {
-      return;
+    auto body = [&](unsigned w) {
+      Ready_deque& own = queues[w];
+      while (outstanding.load(std::memory_order_acquire) != 0 && !failed.load(std::memory_order_relaxed)) {
+        uint32_t idx = 0;
+        bool     got = own.pop_back(idx);
+        for (unsigned k = 1; !got && k < workers; ++k) {
+          got = queues[(w + k) % workers].steal(idx);
+        }
+        if (!got) {
+          std::this_thread::yield();
+          continue;
+        }
+        try {
+          fn(Node_class(g, static_cast<Nid>(idx) << 2));
+        } catch (...) {
+          std::lock_guard lock(error_mu);
+          if (!error) {
+            error = std::current_exception();
+          }
+          failed.store(true, std::memory_order_relaxed);
+        }
+        if (propagate && !g->forward_is_source(idx)) {
+          g->for_each_forward_sink(idx, [&](size_t sink_idx) {
+            if (g->forward_is_source(sink_idx)) {
+              return;
+            }
+            if (std::atomic_ref<uint32_t>(remaining[sink_idx]).fetch_sub(1, std::memory_order_acq_rel) == 1) {
+              outstanding.fetch_add(1, std::memory_order_relaxed);
+              own.push(static_cast<uint32_t>(sink_idx));
+            }
+          });
+        }
+        outstanding.fetch_sub(1, std::memory_order_acq_rel);
+      }
+    };
+    if (workers == 1) {
+      body(0);
+    } else if (opts.executor) {
+      opts.executor(workers, body);
+    } else {
+      run_on_threads(workers, body);
     }
-    --working_remaining_out_[driver_idx];
+  };
+  const auto seed = [&](size_t idx, unsigned& next) {
+    queues[next].q.push_back(static_cast<uint32_t>(idx));
+    next = next + 1 == workers ? 0 : next + 1;
+    outstanding.fetch_add(1, std::memory_order_relaxed);
   };
 
-  const Nid sink_nid   = static_cast<Nid>(sink_idx) << 2;
-  auto      node_edges = graph_->node_table[sink_idx].get_edges(sink_nid, graph_->overflow_sets());
-  for (auto vid : node_edges) {
-    if (!(vid & static_cast<Vid>(2))) {
+  // Pass 1 sources: count-zero combinational nodes, plus loop_breaks when
+  // they go first (they have no counted edges either way).
+  unsigned next = 0;
+  for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+    if (!g->node_table[idx].is_alive()) {
       continue;
     }
-    try_dec(driver_idx_of(vid));
+    if (g->forward_is_source(idx) ? loop_first : remaining[idx] == 0) {
+      seed(idx, next);
+    }
   }
-  for (Pid pin_vid = graph_->node_table[sink_idx].get_next_pin_id(); pin_vid != 0;) {
-    const Pid   canonical_pin = (pin_vid & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-    const auto* pin           = graph_->ref_pin(canonical_pin);  // hoist: one lookup per list step (was two)
-    for (auto edge_vid : pin->get_edges(canonical_pin, graph_->overflow_sets())) {
-      if (!(edge_vid & static_cast<Vid>(2))) {
-        continue;
+  run_wave(true);
+
+  // Cycle survivors: never reached zero. Same treatment as the iterator's Tail.
+  if (!failed.load(std::memory_order_relaxed)) {
+    for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+      if (g->node_table[idx].is_alive() && !g->forward_is_source(idx) && remaining[idx] != 0) {
+        fn(Node_class(g, static_cast<Nid>(idx) << 2));
       }
-      try_dec(driver_idx_of(edge_vid));
     }
-    pin_vid = pin->get_next_pin_id();
+  }
+
+  if (loop_last && !failed.load(std::memory_order_relaxed)) {
+    for (size_t idx = kFirstUserNodeIdx; idx < node_count; ++idx) {
+      if (g->node_table[idx].is_alive() && g->forward_is_source(idx)) {
+        seed(idx, next);
+      }
+    }
+    run_wave(false);
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
   }
 }
 
-void BackwardClassIterator::advance() {
-  while (true) {
-    if (phase_ == Phase::Pass1) {
-      while (idx_ > kFirstUserNodeIdx) {
-        const size_t i = --idx_;
+// --- Body_view::cone ---
+//
+// Level-synchronous BFS over node_table slots; `visited` is the cone so far.
+// A level is a list of slots (top-down: each claims its unvisited
+// neighbours) or, once it is a large share of the unvisited nodes, a bitmap
+// (bottom-up: each unvisited node looks for a neighbour in it and stops at
+// the first). Only expandable slots enter a level. A parallel top-down level
+// splits the list and claims bits with fetch_or; a parallel bottom-up level
+// splits the words, and each worker writes only its own.
+
+namespace {
+
+constexpr size_t kConeBottomUpAlpha   = 14;    // top-down -> bottom-up when frontier * alpha > unvisited
+constexpr size_t kConeTopDownBeta     = 24;    // bottom-up -> top-down when frontier * beta < live
+constexpr size_t kConeParallelMinSize = 4096;  // smaller levels stay on the calling thread
+
+[[nodiscard]] bool cone_test(const std::vector<uint64_t>& bits, size_t idx) noexcept {
+  return (bits[idx / 64] >> (idx % 64)) & 1U;
+}
+
+}  // namespace
+
+std::vector<Occurrence_ref> Occurrence_cone::refs() const {
+  std::vector<Occurrence_ref> result;
+  result.reserve(count_);
+  for (size_t key = 0; key < slots_.size(); ++key) {
+    const auto& slot = slots_[key];
+    for (size_t w = 0; w < slot.bits.size(); ++w) {
+      for (uint64_t word = slot.bits[w]; word != 0; word &= word - 1) {
+        const auto nid = static_cast<Nid>(w * 64 + static_cast<size_t>(std::countr_zero(word))) << 2;
+        result.push_back(Occurrence_ref{slot.graph, nid, static_cast<uint32_t>(key / 2), slot.container});
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<Nid> Node_cone::nids() const {
+  std::vector<Nid> result;
+  result.reserve(count_);
+  for (size_t w = 0; w < bits_.size(); ++w) {
+    for (uint64_t word = bits_[w]; word != 0; word &= word - 1) {
+      result.push_back(static_cast<Nid>(w * 64 + static_cast<size_t>(std::countr_zero(word))) << 2);
+    }
+  }
+  return result;
+}
+
+Node_cone Body_view::cone(std::span<const Node_class> seeds, const Cone_options& opts) const {
+  std::vector<uint32_t> frontier;
+  frontier.reserve(seeds.size());
+  for (const auto& node : seeds) {
+    assert((node.get_graph() == graph_ || node.is_invalid()) && "Body_view::cone: seed from another body");
+    if (!node.is_invalid()) {
+      frontier.push_back(static_cast<uint32_t>(node.get_debug_nid() >> 2));
+    }
+  }
+  return cone_from({}, std::move(frontier), opts);
+}
+
+Node_cone Body_view::cone(std::span<const Pin_class> seeds, const Cone_options& opts) const {
+  const bool            forward = opts.direction == Direction::forward;
+  std::vector<uint32_t> marks;
+  std::vector<uint32_t> frontier;
+  const auto            hit = [&](Node_class node) {
+    const auto idx = static_cast<uint32_t>(node.get_debug_nid() >> 2);
+    if (idx < kFirstUserNodeIdx) {
+      return;
+    }
+    if (opts.through_loop_breaks || !node.is_loop_break()) {
+      frontier.push_back(idx);
+    } else {
+      marks.push_back(idx);
+    }
+  };
+  for (const auto& pin : seeds) {
+    assert((pin.get_graph() == graph_ || pin.is_invalid()) && "Body_view::cone: seed from another body");
+    if (pin.is_invalid()) {
+      continue;
+    }
+    const auto master = static_cast<uint32_t>(pin.get_debug_nid() >> 2);
+    if (forward && pin.is_driver()) {
+      marks.push_back(master);
+      for (const auto& edge : pin.out_edges()) {
+        hit(edge.sink.get_master_node());
+      }
+    } else if (!forward && pin.is_sink()) {
+      marks.push_back(master);
+      for (const auto& edge : pin.inp_edges()) {
+        hit(edge.driver.get_master_node());
+      }
+    } else {
+      frontier.push_back(master);
+    }
+  }
+  return cone_from(std::move(marks), std::move(frontier), opts);
+}
+
+Node_cone Body_view::cone_from(std::vector<uint32_t> marks, std::vector<uint32_t> frontier, const Cone_options& opts) const {
+  assert_graph_alive();
+  if (graph_ == nullptr) {
+    return {};
+  }
+  Graph* const g = graph_;
+  g->ensure_node_counts();
+  (void)g->overflow_sets();  // settle a deferred overflow load before fanning out
+  const size_t   node_count = g->node_table.size();
+  const size_t   words      = (node_count + 63) / 64;
+  const size_t   live       = g->live_node_count_;
+  const bool     forward    = opts.direction == Direction::forward;
+  const unsigned workers    = std::max(1U, opts.threads != 0 ? opts.threads : std::thread::hardware_concurrency());
+
+  std::vector<uint64_t> visited(words, 0);
+  size_t                count = 0;
+  const auto            claim = [&](size_t idx) {
+    uint64_t& word = visited[idx / 64];
+    const auto bit = uint64_t{1} << (idx % 64);
+    if (word & bit) {
+      return false;
+    }
+    word |= bit;
+    ++count;
+    return true;
+  };
+  const auto member = [&](size_t idx) { return idx >= kFirstUserNodeIdx && idx < node_count && g->node_table[idx].is_alive(); };
+  const auto expands
+      = [&](size_t idx) { return opts.through_loop_breaks || !g->node_table[idx].is_loop_break(); };
+  // Neighbours along the cone's direction, and against it (bottom-up probes).
+  const auto next = [&](size_t idx, auto&& fn) {
+    if (forward) {
+      g->for_each_forward_sink(idx, fn);
+    } else {
+      g->for_each_forward_driver(idx, fn);
+    }
+  };
+  const auto prev = [&](size_t idx, auto&& fn) {
+    if (forward) {
+      g->for_each_forward_driver(idx, fn);
+    } else {
+      g->for_each_forward_sink(idx, fn);
+    }
+  };
+  const auto run_level = [&](unsigned level_workers, function_ref<void(unsigned)> body) {
+    if (level_workers == 1) {
+      body(0);
+    } else if (opts.executor) {
+      opts.executor(level_workers, body);
+    } else {
+      run_on_threads(level_workers, body);
+    }
+  };
+
+  for (const uint32_t idx : marks) {
+    if (member(idx)) {
+      claim(idx);
+    }
+  }
+  std::vector<uint32_t> level;
+  for (const uint32_t idx : frontier) {
+    if (!member(idx)) {
+      continue;
+    }
+    claim(idx);  // a seed expands even when a pin edge already marked it
+    level.push_back(idx);
+  }
+  std::ranges::sort(level);
+  level.erase(std::unique(level.begin(), level.end()), level.end());
+
+  std::vector<uint64_t>              level_bits;
+  std::vector<uint64_t>              next_bits;
+  std::vector<std::vector<uint32_t>> local(workers);
+  std::vector<size_t>                local_count(workers, 0);
+  bool                               bottom_up  = false;
+  size_t                             level_size = level.size();
+  while (level_size != 0) {
+    const size_t unvisited = live > count ? live - count : 0;
+    const bool   want_bu   = bottom_up ? level_size * kConeTopDownBeta >= live : level_size * kConeBottomUpAlpha > unvisited;
+    if (want_bu != bottom_up) {
+      // Convert the level between its two representations.
+      if (want_bu) {
+        level_bits.assign(words, 0);
+        for (const uint32_t idx : level) {
+          level_bits[idx / 64] |= uint64_t{1} << (idx % 64);
+        }
+      } else {
+        level.clear();
+        for (size_t w = 0; w < words; ++w) {
+          for (uint64_t word = level_bits[w]; word != 0; word &= word - 1) {
+            level.push_back(static_cast<uint32_t>(w * 64 + static_cast<size_t>(std::countr_zero(word))));
+          }
+        }
+      }
+      bottom_up = want_bu;
+    }
+    const unsigned level_workers = level_size >= kConeParallelMinSize ? workers : 1U;
+
+    if (!bottom_up) {
+      // Top-down: the level's slots push their unvisited neighbours.
+      for (auto& out : local) {
+        out.clear();
+      }
+      std::fill(local_count.begin(), local_count.end(), 0);
+      auto body = [&](unsigned w) {
+        auto&        out   = local[w];
+        const size_t first = level.size() * w / level_workers;
+        const size_t last  = level.size() * (w + 1) / level_workers;
+        for (size_t i = first; i < last; ++i) {
+          next(level[i], [&](size_t to) {
+            const auto bit = uint64_t{1} << (to % 64);
+            if (level_workers == 1) {
+              if (!claim(to)) {
+                return;
+              }
+            } else {
+              if (std::atomic_ref<uint64_t>(visited[to / 64]).fetch_or(bit, std::memory_order_relaxed) & bit) {
+                return;
+              }
+              ++local_count[w];
+            }
+            if (expands(to)) {
+              out.push_back(static_cast<uint32_t>(to));
+            }
+          });
+        }
+      };
+      run_level(level_workers, body);
+      level.clear();
+      for (unsigned w = 0; w < level_workers; ++w) {
+        count += local_count[w];
+        level.insert(level.end(), local[w].begin(), local[w].end());
+      }
+      level_size = level.size();
+      continue;
+    }
+
+    // Bottom-up: every unvisited node probes its neighbours for one in the level.
+    next_bits.assign(words, 0);
+    std::fill(local_count.begin(), local_count.end(), 0);
+    auto body = [&](unsigned w) {
+      const size_t first = words * w / level_workers;
+      const size_t last  = words * (w + 1) / level_workers;
+      for (size_t word = first; word < last; ++word) {
+        for (uint64_t open = ~visited[word]; open != 0; open &= open - 1) {
+          const size_t idx = word * 64 + static_cast<size_t>(std::countr_zero(open));
+          if (idx >= node_count) {
+            break;
+          }
+          if (!member(idx)) {
+            continue;
+          }
+          bool found = false;
+          prev(idx, [&](size_t from) { return found = cone_test(level_bits, from); });
+          if (!found) {
+            continue;
+          }
+          visited[word] |= uint64_t{1} << (idx % 64);
+          ++local_count[w];
+          if (expands(idx)) {
+            next_bits[word] |= uint64_t{1} << (idx % 64);
+          }
+        }
+      }
+    };
+    run_level(level_workers, body);
+    level_bits.swap(next_bits);
+    level_size = 0;
+    for (unsigned w = 0; w < level_workers; ++w) {
+      count += local_count[w];
+    }
+    for (const uint64_t word : level_bits) {
+      level_size += static_cast<size_t>(std::popcount(word));
+    }
+  }
+  return Node_cone(g, std::move(visited), count);
+}
+
+// --- Occurrences_view / Grouped_hierarchy_view::parallel_for_each ---
+//
+// The calling thread plans. A policy-blind occurrence estimate per callee body
+// (memoized by Gid) fixes a grain, and each body is cut into slices of storage
+// slots worth about one grain. A call site worth more than a grain becomes its
+// own tasks: chunks of ordinals when one call is small, otherwise one task per
+// ordinal followed by the tasks of its callee body. Tasks are emitted in
+// nodes() order. Workers pull them in that order, each with its own
+// Hierarchy_view_state rebuilt from the task's call chain.
+
+namespace {
+
+[[nodiscard]] uint64_t saturating_add(uint64_t a, uint64_t b) noexcept {
+  return a > std::numeric_limits<uint64_t>::max() - b ? std::numeric_limits<uint64_t>::max() : a + b;
+}
+
+[[nodiscard]] uint64_t saturating_mul(uint64_t a, uint64_t b) noexcept {
+  return b != 0 && a > std::numeric_limits<uint64_t>::max() / b ? std::numeric_limits<uint64_t>::max() : a * b;
+}
+
+using Occurrence_chain = std::vector<std::pair<Node_class, std::optional<uint64_t>>>;
+
+// A slice task yields storage slots [lo, hi) of `graph`'s body. A call task
+// yields ordinals [lo, hi) of `site` in that body, each followed by its callee
+// body unless the planner split the callee into tasks of its own.
+struct Occurrence_task {
+  Occurrence_chain chain;   // call path from the root down to `graph`'s body
+  std::vector<Gid> active;  // bodies on that path (the recursion guard)
+  Graph*           graph = nullptr;
+  bool             call  = false;
+  Node_class       site;
+  uint64_t         lo      = 0;
+  uint64_t         hi      = 0;
+  bool             descend = true;
+};
+
+struct Occurrence_planner {
+  explicit Occurrence_planner(detail::Hierarchy_view_state& state_value) : state(state_value) {}
+
+  detail::Hierarchy_view_state&               state;
+  uint64_t                                    grain = 1;
+  ankerl::unordered_dense::map<Gid, uint64_t> weights;
+  ankerl::unordered_dense::set<Gid>           weighing;
+  Occurrence_chain                            chain;
+  std::vector<Gid>                            active;
+  std::vector<Occurrence_task>                tasks;
+
+  [[nodiscard]] uint64_t calls(const Node_class& site) const {
+    const auto group = site.subnode_group();
+    return state.expand_loops && group.is_loop() ? group.size() : 1;
+  }
+
+  // Occurrences one call of `graph` yields when every site descends.
+  [[nodiscard]] uint64_t weight(Graph* graph) {
+    if (graph == nullptr) {
+      return 0;
+    }
+    const Gid gid = graph->get_gid();
+    if (const auto it = weights.find(gid); it != weights.end()) {
+      return it->second;
+    }
+    if (!weighing.insert(gid).second) {
+      return 0;  // recursive definition: the walk cuts it here too
+    }
+    uint64_t total = 0;
+    for (const auto node : graph->body().nodes()) {
+      total = saturating_add(total, node.get_subnode_io() ? site_weight(node) : 1);
+    }
+    weighing.erase(gid);
+    weights.emplace(gid, total);
+    return total;
+  }
+
+  [[nodiscard]] uint64_t site_weight(const Node_class& site) {
+    const auto child = state.subgraph(site);
+    return saturating_mul(calls(site), saturating_add(1, weight(child.get())));
+  }
+
+  void slice(Graph* graph, size_t lo, size_t hi) {
+    if (lo < hi) {
+      tasks.push_back(Occurrence_task{chain, active, graph, false, Node_class(), lo, hi, true});
+    }
+  }
+
+  // Cuts the body of `graph`, reached at `handle` and already on `active`.
+  void plan(Graph* graph, uint32_t handle) {
+    size_t   lo   = kFirstUserNodeIdx;
+    size_t   tail = lo;
+    uint64_t run  = 0;
+    for (const auto node : graph->body().nodes()) {
+      const size_t idx    = static_cast<size_t>(node.get_debug_nid() >> 2);
+      uint64_t     weight = 1;
+      tail                = idx + 1;
+      if (node.get_subnode_io()) {
+        weight = site_weight(node);
+        if (weight >= grain) {
+          const auto child = state.subgraph(node);
+          if (child && std::find(active.begin(), active.end(), child->get_gid()) == active.end()
+              && state.action(handle, node) == Instance_action::descend) {
+            slice(graph, lo, idx);
+            split(graph, handle, node, child.get());
+            lo  = idx + 1;
+            run = 0;
+            continue;
+          }
+        }
+      }
+      run = saturating_add(run, weight);
+      if (run >= grain) {
+        slice(graph, lo, idx + 1);
+        lo  = idx + 1;
+        run = 0;
+      }
+    }
+    slice(graph, lo, tail);
+  }
+
+  void split(Graph* graph, uint32_t handle, const Node_class& site, Graph* child) {
+    const auto group = site.subnode_group();
+    if (group.is_loop()) {
+      group.validate();
+    }
+    const uint64_t count    = calls(site);
+    const uint64_t per_call = saturating_add(1, weight(child));
+    if (per_call < grain) {
+      const uint64_t chunk = grain / per_call;
+      for (uint64_t first = 0; first < count; first += std::min(chunk, count - first)) {
+        tasks.push_back(Occurrence_task{chain, active, graph, true, site, first, first + std::min(chunk, count - first), true});
+      }
+      return;
+    }
+    const bool loop_expanded = state.expand_loops && group.is_loop();
+    for (uint64_t ordinal = 0; ordinal < count; ++ordinal) {
+      tasks.push_back(Occurrence_task{chain, active, graph, true, site, ordinal, ordinal + 1, false});
+      const auto path_ordinal = loop_expanded ? std::optional<uint64_t>(ordinal) : std::nullopt;
+      chain.emplace_back(site, path_ordinal);
+      active.push_back(child->get_gid());
+      plan(child, state.append_path(handle, site, path_ordinal));
+      active.pop_back();
+      chain.pop_back();
+    }
+  }
+};
+
+void run_occurrence_task(detail::Hierarchy_view_state& state, const Occurrence_task& task,
+                         function_ref<void(const Occurrence_node&)> emit) {
+  uint32_t handle = 0;
+  for (const auto& [site, ordinal] : task.chain) {
+    handle = state.append_path(handle, site, ordinal);
+  }
+  ankerl::unordered_dense::set<Gid> active(task.active.begin(), task.active.end());
+  if (!task.call) {
+    state.visit_slice(task.graph, handle, task.lo, task.hi, active, emit);
+    return;
+  }
+  const auto verdict = task.descend ? state.action(handle, task.site) : Instance_action::opaque;
+  state.visit_calls(task.site, verdict, handle, task.lo, task.hi, active, emit);
+}
+
+void parallel_occurrence_walk(detail::Hierarchy_view_state& state, function_ref<void(size_t)> on_tasks,
+                              function_ref<void(size_t, const Occurrence_node&)> fn, const Parallel_options& opts) {
+  state.assert_unmutated();
+  if (state.root == nullptr) {
+    on_tasks(0);
+    return;
+  }
+  const unsigned workers = std::max(1U, opts.threads != 0 ? opts.threads : std::thread::hardware_concurrency());
+
+  // Eight tasks per worker leaves room to balance uneven subtrees.
+  Occurrence_planner planner(state);
+  planner.grain = std::max<uint64_t>(1, planner.weight(state.root) / (uint64_t{workers} * 8));
+  planner.active.push_back(state.root->get_gid());
+  planner.plan(state.root, 0);
+  state.refresh_epoch();
+  const auto& tasks = planner.tasks;
+  on_tasks(tasks.size());
+
+  const auto*         ambient = hier_opaque_ref();  // thread_local: hand it to the workers
+  const auto          shared_mu = std::make_shared<std::mutex>();
+  std::atomic<size_t> next{0};
+  std::atomic<bool>   failed{false};
+  std::exception_ptr  error;
+  std::mutex          error_mu;
+  auto                body = [&](unsigned) {
+    const Hier_opaque_scope scope(ambient);
+    auto worker       = std::make_shared<detail::Hierarchy_view_state>(state.root, state.expand_loops, state.policy, state.opaque);
+    worker->shared_mu = shared_mu;
+    for (size_t t = next.fetch_add(1, std::memory_order_relaxed); t < tasks.size() && !failed.load(std::memory_order_relaxed);
+         t        = next.fetch_add(1, std::memory_order_relaxed)) {
+      auto emit = [&fn, t](const Occurrence_node& node) { fn(t, node); };
+      try {
+        run_occurrence_task(*worker, tasks[t], emit);
+      } catch (...) {
+        std::lock_guard lock(error_mu);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed.store(true, std::memory_order_relaxed);
+      }
+    }
+  };
+  if (workers == 1 || tasks.size() <= 1) {
+    body(0);
+  } else if (opts.executor) {
+    opts.executor(workers, body);
+  } else {
+    run_on_threads(workers, body);
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace
+
+void Occurrences_view::parallel_for_each_task(function_ref<void(size_t)> tasks,
+                                              function_ref<void(size_t, const Occurrence_node&)> fn,
+                                              const Parallel_options& opts) const {
+  parallel_occurrence_walk(*state(), tasks, fn, opts);
+}
+
+void Occurrences_view::parallel_for_each(function_ref<void(const Occurrence_node&)> fn, const Parallel_options& opts) const {
+  auto ignore = [](size_t) {};
+  auto visit  = [&fn](size_t, const Occurrence_node& node) { fn(node); };
+  parallel_occurrence_walk(*state(), ignore, visit, opts);
+}
+
+void Grouped_hierarchy_view::parallel_for_each_task(function_ref<void(size_t)> tasks,
+                                                    function_ref<void(size_t, const Occurrence_node&)> fn,
+                                                    const Parallel_options& opts) const {
+  parallel_occurrence_walk(*state(), tasks, fn, opts);
+}
+
+void Grouped_hierarchy_view::parallel_for_each(function_ref<void(const Occurrence_node&)> fn, const Parallel_options& opts) const {
+  auto ignore = [](size_t) {};
+  auto visit  = [&fn](size_t, const Occurrence_node& node) { fn(node); };
+  parallel_occurrence_walk(*state(), ignore, visit, opts);
+}
+
+// --- BackwardClassIterator ---
+//
+// Replays the reverse topological emission order using backward_pass2_cache_ and
+// initial out-edge counts.
+
+BackwardClassIterator::BackwardClassIterator(Graph* graph, bool loop_break_first, bool loop_break_last, Traversal_scratch* scratch)
+    : graph_(graph), loop_break_first_(loop_break_first), loop_break_last_(loop_break_last) {
+  if (graph_ == nullptr) {
+    phase_ = Phase::End;
+    return;
+  }
+  graph_->assert_accessible();
+  graph_->ensure_backward_caches();
+  node_count_ = graph_->node_table.size();
+  if (node_count_ <= kFirstUserNodeIdx) {
+    phase_ = Phase::End;
+    return;
+  }
+  if (graph_->backward_order_valid_) {
+    phase_ = Phase::Order;
+    idx_   = 0;
+    advance();
+    return;
+  }
+  scratch_ = Scratch_lease(scratch);
+  scratch_.counts.assign(graph_->backward_remaining_out_cache_.begin(), graph_->backward_remaining_out_cache_.end());
+  scratch_.emitted.assign((node_count_ + 63) / 64, 0);
+  phase_ = Phase::Pass1;
+  idx_   = node_count_;
+  advance();
+}
+
+BackwardClassIterator::BackwardClassIterator(BackwardClassIterator&& o) noexcept            = default;
+BackwardClassIterator& BackwardClassIterator::operator=(BackwardClassIterator&& o) noexcept = default;
+
+bool BackwardClassIterator::is_sink(size_t idx) const noexcept { return graph_->backward_is_sink(idx); }
+
+bool BackwardClassIterator::is_emitted(size_t idx) const noexcept { return (scratch_.emitted[idx >> 6] >> (idx & 63)) & 1ULL; }
+
+void BackwardClassIterator::mark_emitted(size_t idx) noexcept { scratch_.emitted[idx >> 6] |= (1ULL << (idx & 63)); }
+
+void BackwardClassIterator::propagate(size_t sink_idx, size_t /*cursor*/) {
+  if (is_sink(sink_idx)) {
+    return;
+  }
+
+  auto driver_idx_of = [&](Vid vid) -> size_t {
+    Nid driver_nid;
+    if (vid & static_cast<Vid>(1)) {
+      const Pid driver_pid = (static_cast<Pid>(vid) & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+      driver_nid           = graph_->ref_pin(driver_pid)->get_master_nid();
+    } else {
+      driver_nid = static_cast<Nid>(vid);
+    }
+    driver_nid = driver_nid & ~static_cast<Nid>(3);
+    return static_cast<size_t>(driver_nid >> 2);
+  };
+
+  auto try_dec = [&](size_t driver_idx) {
+    if (driver_idx < kFirstUserNodeIdx || driver_idx >= node_count_) {
+      return;
+    }
+    if (driver_idx == sink_idx && graph_->subnode_loops_.contains(static_cast<Nid>(sink_idx) << 2)) {
+      return;
+    }
+    if (is_emitted(driver_idx) || is_sink(driver_idx)) {
+      return;
+    }
+    if (scratch_.counts[driver_idx] == 0) {
+      return;
+    }
+    --scratch_.counts[driver_idx];
+  };
+
+  const Nid sink_nid   = static_cast<Nid>(sink_idx) << 2;
+  auto      node_edges = graph_->node_table[sink_idx].get_edges(sink_nid, graph_->overflow_sets());
+  for (auto vid : node_edges) {
+    if (!(vid & static_cast<Vid>(2))) {
+      continue;
+    }
+    try_dec(driver_idx_of(vid));
+  }
+  for (Pid pin_vid = graph_->node_table[sink_idx].get_next_pin_id(); pin_vid != 0;) {
+    const Pid   canonical_pin = (pin_vid & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+    const auto* pin           = graph_->ref_pin(canonical_pin);  // hoist: one lookup per list step (was two)
+    for (auto edge_vid : pin->get_edges(canonical_pin, graph_->overflow_sets())) {
+      if (!(edge_vid & static_cast<Vid>(2))) {
+        continue;
+      }
+      try_dec(driver_idx_of(edge_vid));
+    }
+    pin_vid = pin->get_next_pin_id();
+  }
+}
+
+void BackwardClassIterator::advance() {
+  while (true) {
+    if (phase_ == Phase::Order) {
+      const auto& order = graph_->backward_order_cache_;
+      while (idx_ < order.size()) {
+        const size_t i = order[idx_++];
+        if (i >= node_count_ || !graph_->node_table[i].is_alive() || (!loop_break_first_ && is_sink(i))) {
+          continue;
+        }
+        current_idx_ = i;
+        return;
+      }
+      phase_ = loop_break_last_ ? Phase::LoopLast : Phase::End;
+      idx_   = node_count_;
+      if (phase_ == Phase::End) {
+        current_idx_ = 0;
+        return;
+      }
+      continue;
+    }
+    if (phase_ == Phase::Pass1) {
+      while (idx_ > kFirstUserNodeIdx) {
+        const size_t i = --idx_;
         if (!graph_->node_table[i].is_alive() || is_emitted(i)) {
           continue;
         }
         const bool snk = is_sink(i);
-        if (snk || working_remaining_out_[i] == 0) {
+        if (snk || scratch_.counts[i] == 0) {
           mark_emitted(i);
           propagate(i, i);
           // loop_break nodes are the only user-range sinks. Mirror the forward
@@ -4561,15 +6242,15 @@ BackwardClassIterator& BackwardClassIterator::operator++() {
 }
 
 BackwardClassIterator BackwardClassRange::begin() const {
-  return BackwardClassIterator(graph_, loop_break_first_, loop_break_last_);
+  return BackwardClassIterator(graph_, loop_break_first_, loop_break_last_, scratch_);
 }
 
 size_t BackwardClassRange::size() const {
-  size_t n = 0;
-  for (auto it = begin(); it != end(); ++it) {
-    ++n;
+  if (graph_ == nullptr) {
+    return 0;
   }
-  return n;
+  graph_->assert_accessible();
+  return graph_->ordered_node_count(loop_break_first_, loop_break_last_);
 }
 
 Node_class BackwardClassRange::front() const {
@@ -4578,7 +6259,7 @@ Node_class BackwardClassRange::front() const {
   return *it;
 }
 
-bool BackwardClassRange::empty() const { return begin() == end(); }
+bool BackwardClassRange::empty() const { return size() == 0; }
 
 // --- Hier_instance members ---
 
@@ -4590,7 +6271,7 @@ Gid Hier_instance::get_target_gid() const {
   if (!entry->has_subnode()) {
     return Gid_invalid;
   }
-  return entry->get_subnode();
+  return parent_graph_->subnode_gid(parent_nid_);
 }
 
 std::shared_ptr<Graph> Hier_instance::get_target_graph() const {
@@ -4748,74 +6429,32 @@ auto Graph::out_edges_local(Node_class node) -> absl::InlinedVector<Edge_class,
   return out;
 }
 
-auto Graph::inp_edges(Node_class node) -> absl::InlinedVector<Edge_class, 4> {
+auto Graph::inp_edges(Node_class node) -> InpEdgeRange {
   assert_accessible();
   assert_node_exists(node);
+  // Same split as out_edges(Node_class): a HIER node materializes the
+  // cross-boundary-resolved drivers, everything else walks storage lazily.
   if (node.is_hier() && owner_lib_ != nullptr) {
-    return inp_edges_hier(node);
+    InpEdgeRange r;
+    r.graph_ = this;
+    r.mat_   = std::make_shared<absl::InlinedVector<Edge_class, 4>>(inp_edges_hier(node));
+    return r;
   }
   return inp_edges_local(node);
 }
 
-auto Graph::inp_edges_local(Node_class node) -> absl::InlinedVector<Edge_class, 4> {
-  absl::InlinedVector<Edge_class, 4> out;
-  const Nid                          self_nid = node.get_debug_nid() & ~static_cast<Nid>(2);
-  auto*                              self     = ref_node(self_nid);
-
-  Pin_class self_sink(this, self_nid & ~static_cast<Pid>(2));
-  self_sink.context_  = node.context_;
-  self_sink.root_gid_ = node.root_gid_;
-  self_sink.hier_pos_ = node.hier_pos_;
-
-  // 1) NodeEntry-level inp edges (sink pin == node-as-pin(0))
-  for (auto vid : self->get_edges(self_nid, overflow_sets())) {
-    if (!(vid & static_cast<Vid>(2))) {
-      continue;
-    }
-    Edge_class e{};
-    e.sink = self_sink;
-    if (vid & static_cast<Vid>(1)) {
-      e.driver           = Pin_class(this, static_cast<Pid>(vid));
-      e.driver.context_  = node.context_;
-      e.driver.root_gid_ = node.root_gid_;
-      e.driver.hier_pos_ = node.hier_pos_;
-    } else {
-      // node-as-pin driver: original code did not inherit context here
-      e.driver = Pin_class(this, static_cast<Nid>(vid) | static_cast<Nid>(2));
-    }
-    out.push_back(std::move(e));
-  }
-
-  // 2) Walk pin linked list inline.
-  for (Pid cur_pin = self->get_next_pin_id(); cur_pin != 0;) {
-    const Pid canonical_pin = (cur_pin & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-    auto*     pin_entry     = ref_pin(canonical_pin);
-
-    Pin_class pin_sink(this, canonical_pin);
-    pin_sink.context_  = node.context_;
-    pin_sink.root_gid_ = node.root_gid_;
-    pin_sink.hier_pos_ = node.hier_pos_;
-
-    for (auto vid : pin_entry->get_edges(canonical_pin, overflow_sets())) {
-      if (!(vid & static_cast<Vid>(2))) {
-        continue;  // forward edge (out_edge)
-      }
-      Edge_class e{};
-      e.sink = pin_sink;
-      if (vid & static_cast<Vid>(1)) {
-        e.driver           = Pin_class(this, static_cast<Pid>(vid));
-        e.driver.context_  = node.context_;
-        e.driver.root_gid_ = node.root_gid_;
-        e.driver.hier_pos_ = node.hier_pos_;
-      } else {
-        e.driver = Pin_class(this, static_cast<Nid>(vid) | static_cast<Nid>(2));
-      }
-      out.push_back(std::move(e));
-    }
-
-    cur_pin = pin_entry->get_next_pin_id();
-  }
-  return out;
+auto Graph::inp_edges_local(Node_class node) -> InpEdgeRange {
+  InpEdgeRange r;
+  r.graph_        = this;
+  r.context_      = node.context_;
+  r.root_gid_     = node.root_gid_;
+  r.hier_pos_     = node.hier_pos_;
+  r.hier_path_    = node.hier_path_;
+  r.is_node_src_  = true;
+  r.src_is_port0_ = false;
+  r.self_nid_     = node.get_debug_nid() & ~static_cast<Nid>(2);
+  r.src_pid_      = 0;
+  return r;
 }
 
 // --- Cross-boundary (hierarchical) edge resolution -------------------------
@@ -4825,6 +6464,10 @@ Pid Graph::find_pin_or_zero(Nid nid, Port_id port_id, bool driver) const {
   if (port_id == 0) {
     return driver ? (base | static_cast<Pid>(2)) : base;  // node-as-pin
   }
+  if (port_list(base) != nullptr) {
+    const Pid canonical = port_index_find(base, port_id);
+    return (canonical != 0 && driver) ? (canonical | static_cast<Pid>(2)) : canonical;
+  }
   const auto* self = ref_node(base);
   for (Pid cur = self->get_next_pin_id(); cur != 0;) {
     const Pid   canonical = (cur & ~static_cast<Pid>(2)) | static_cast<Pid>(1);  // real-pin sink form
@@ -4873,7 +6516,7 @@ Graph* Graph::hier_path_to_insts(Graph* root, const std::vector<Nid>& chain, std
     if (!entry->has_subnode()) {
       return nullptr;
     }
-    const Gid child_gid = entry->get_subnode();
+    const Gid child_gid = g->subnode_gid(base);
     if (!g->owner_lib_->has_graph(child_gid)) {
       return nullptr;
     }
@@ -4899,7 +6542,7 @@ bool Graph::reconstruct_hier_path(Graph* root, Gid body_gid, Tree_pos body_hier_
     if (!entry->is_alive() || !entry->has_subnode()) {
       continue;
     }
-    const Gid child_gid = entry->get_subnode();
+    const Gid child_gid = root->subnode_gid(nid);
     path.push_back(HierInst{root, nid, tree_pos});
     if (child_gid == body_gid && tree_pos == body_hier_pos) {
       return true;  // path ends at the instance wrapping the target body
@@ -4957,7 +6600,7 @@ void Graph::resolve_hier_driver(Graph* g, std::vector<HierInst> path, Pid driver
       // hierarchically opaque (pass/lec --collapse), in which case the read stops
       // here at the instance boundary (the box's output IS the leaf driver), so it
       // agrees with an opaque hierarchy view leaving the body undescended.
-      const Gid   child_gid = entry->get_subnode();
+      const Gid   child_gid = g->subnode_gid(master);
       const auto* lib       = g->owner_lib_;
       if (lib->has_graph(child_gid) && !hier_is_opaque(child_gid)) {
         Graph*         child          = const_cast<Graph*>(lib->get_graph(child_gid).get());
@@ -5018,7 +6661,7 @@ void Graph::resolve_hier_sink(Graph* g, std::vector<HierInst> path, Pid sink_pid
     if (entry->has_subnode() && g->owner_lib_ != nullptr) {
       // Sink pin on a sub-instance == the instance's input port. Cross down
       // into the body's INPUT_NODE driver for the same port.
-      const Gid   child_gid = entry->get_subnode();
+      const Gid   child_gid = g->subnode_gid(master);
       const auto* lib       = g->owner_lib_;
       if (lib->has_graph(child_gid)) {
         Graph*         child           = const_cast<Graph*>(lib->get_graph(child_gid).get());
@@ -5063,7 +6706,8 @@ bool Graph::hier_base_path(Node_class node, std::vector<HierInst>& base_path) {
 auto Graph::inp_edges_hier(Node_class node) -> absl::InlinedVector<Edge_class, 4> {
   std::vector<HierInst> base_path;
   if (!hier_base_path(node, base_path)) {
-    return inp_edges_local(node);  // not locatable in the hierarchy: degrade to local
+    const auto local = inp_edges_local(node);  // not locatable in the hierarchy: degrade to local
+    return {local.begin(), local.end()};
   }
 
   absl::InlinedVector<Edge_class, 4> result;
@@ -5336,12 +6980,10 @@ void OutEdgeIterator::bind_node_as_pin() {
   static_assert(Graph::NodeEntry::EdgeRange::kInlineMax <= kBufCap, "buf_ too small for NodeEntry inline edges");
   set_driver(self_nid_ | static_cast<Pid>(2));
   if (node_entry_->check_overflow()) {
-    ovf_         = &graph_->overflow_sets()[node_entry_->get_overflow_idx()];
-    ovf_it_      = ovf_->begin();
-    ovf_end_     = ovf_->end();
-    is_overflow_ = true;
+    bind_overflow(node_entry_->get_overflow_idx());
   } else {
-    n_ = 0;
+    slab_ = nullptr;
+    n_    = 0;
     for (const Vid v : node_entry_->get_edges(self_nid_, graph_->overflow_sets())) {
       buf_[n_++] = v;
     }
@@ -5354,12 +6996,10 @@ void OutEdgeIterator::bind_pin() {
   static_assert(Graph::PinEntry::EdgeRange::kInlineMax <= kBufCap, "buf_ too small for PinEntry inline edges");
   set_driver(cur_pin_lookup_ | static_cast<Pid>(2));
   if (pin_entry_->check_overflow()) {
-    ovf_         = &graph_->overflow_sets()[pin_entry_->get_overflow_idx()];
-    ovf_it_      = ovf_->begin();
-    ovf_end_     = ovf_->end();
-    is_overflow_ = true;
+    bind_overflow(pin_entry_->get_overflow_idx());
   } else {
-    n_ = 0;
+    slab_ = nullptr;
+    n_    = 0;
     for (const Vid v : pin_entry_->get_edges(cur_pin_lookup_, graph_->overflow_sets())) {
       buf_[n_++] = v;
     }
@@ -5368,6 +7008,23 @@ void OutEdgeIterator::bind_pin() {
   }
 }
 
+void OutEdgeIterator::bind_overflow(uint32_t overflow_idx) {
+  const auto& store = graph_->overflow_sets();
+  if (Overflow_store::is_slab(overflow_idx)) {
+    const uint32_t off = Overflow_store::slab_off(overflow_idx);
+    slab_              = store.slab.data(off);
+    slab_it_           = slab_;
+    slab_end_          = slab_ + store.slab.size(off);
+    is_overflow_       = false;
+    return;
+  }
+  ovf_         = &store.sets[overflow_idx];
+  ovf_it_      = ovf_->begin();
+  ovf_end_     = ovf_->end();
+  slab_        = nullptr;
+  is_overflow_ = true;
+}
+
 void OutEdgeIterator::set_driver(Pid driver_pid) {
   cur_driver_           = Pin_class(graph_, driver_pid);
   cur_driver_.context_  = context_;
@@ -5405,14 +7062,253 @@ Edge_class OutEdgeIterator::build_edge(Vid vid) const {
   return e;
 }
 
-Edge_class OutEdgeIterator::operator*() const {
+Edge_class OutEdgeIterator::operator*() const {
+  if (phase_ == Phase::Materialized) {
+    return (*mat_)[mat_idx_];
+  }
+  return build_edge(entry_cur_vid());
+}
+
+OutEdgeIterator& OutEdgeIterator::operator++() {
+  if (phase_ == Phase::Materialized) {
+    ++mat_idx_;
+    if (mat_idx_ >= mat_->size()) {
+      phase_ = Phase::End;
+    }
+    return *this;
+  }
+  entry_step();
+  skip_and_position();
+  return *this;
+}
+
+auto Graph::inp_edges(Pin_class pin) -> InpEdgeRange {
+  assert_accessible();
+  assert_pin_exists(pin);
+  // Like out_edges(Pin_class), a pin's inp edges never cross a boundary, so the
+  // range is always lazy; the port0 / non-port0 stamping differences live in
+  // InpEdgeIterator::set_sink / build_edge.
+  InpEdgeRange r;
+  r.graph_       = this;
+  r.context_     = pin.context_;
+  r.root_gid_    = pin.root_gid_;
+  r.hier_pos_    = pin.hier_pos_;
+  r.hier_path_   = pin.hier_path_;
+  r.is_node_src_ = false;
+  if (!(pin.get_debug_pid() & static_cast<Pid>(1))) {
+    r.src_is_port0_ = true;
+    r.self_nid_     = pin.get_debug_pid() & ~static_cast<Nid>(2);
+    r.src_pid_      = 0;
+  } else {
+    r.src_is_port0_ = false;
+    r.src_pid_      = (pin.get_debug_pid() & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+    r.self_nid_     = 0;
+  }
+  return r;
+}
+
+// ---- InpEdgeRange / InpEdgeIterator (lazy inp-edge view) ----------------
+
+InpEdgeIterator InpEdgeRange::begin() const {
+  InpEdgeIterator it;
+  it.graph_          = graph_;
+  it.is_node_src_    = is_node_src_;
+  it.src_is_port0_   = src_is_port0_;
+  it.self_nid_       = self_nid_;
+  it.cur_pin_lookup_ = src_pid_;  // used only for a non-port0 pin source
+  it.context_        = context_;
+  it.root_gid_       = root_gid_;
+  it.hier_pos_       = hier_pos_;
+  it.hier_path_      = hier_path_;
+  it.mat_            = mat_;
+  it.start();
+  return it;
+}
+
+size_t InpEdgeRange::size() const {
+  size_t n = 0;
+  for (auto it = begin(), e = end(); it != e; ++it) {
+    ++n;
+  }
+  return n;
+}
+
+Edge_class InpEdgeRange::front() const {
+  assert(!empty() && "InpEdgeRange::front called on an empty range");
+  return *begin();
+}
+
+Edge_class InpEdgeRange::operator[](size_t i) const {
+  auto it = begin();
+  for (; i != 0 && it != end(); --i) {
+    ++it;
+  }
+  assert(it != end() && "InpEdgeRange::operator[] index out of range");
+  return *it;
+}
+
+Edge_class InpEdgeRange::at(size_t i) const {
+  auto it = begin();
+  for (; i != 0 && it != end(); --i) {
+    ++it;
+  }
+  if (it == end()) {
+    throw std::out_of_range("InpEdgeRange::at: index out of range");
+  }
+  return *it;
+}
+
+void InpEdgeIterator::start() {
+  if (mat_) {
+    mat_idx_ = 0;
+    phase_   = mat_->empty() ? Phase::End : Phase::Materialized;
+    return;
+  }
+  if (is_node_src_) {
+    phase_       = Phase::NodeAsPin;
+    node_entry_  = graph_->ref_node(self_nid_);
+    next_pin_id_ = node_entry_->get_next_pin_id();
+    bind_node_as_pin();
+  } else if (src_is_port0_) {
+    phase_       = Phase::NodeAsPin;
+    node_entry_  = graph_->ref_node(self_nid_);
+    next_pin_id_ = 0;
+    bind_node_as_pin();
+  } else {
+    phase_       = Phase::PinList;
+    pin_entry_   = graph_->ref_pin(cur_pin_lookup_);
+    next_pin_id_ = 0;
+    bind_pin();
+  }
+  skip_and_position();
+}
+
+void InpEdgeIterator::skip_and_position() {
+  while (true) {
+    while (!entry_at_end()) {
+      if (entry_cur_vid() & static_cast<Vid>(2)) {
+        return;  // positioned on an incoming edge
+      }
+      entry_step();  // skip an outgoing edge
+    }
+    if (!open_next_entry()) {
+      phase_ = Phase::End;
+      return;
+    }
+  }
+}
+
+bool InpEdgeIterator::open_next_entry() {
+  if (!is_node_src_) {
+    return false;  // pin source: a single entry
+  }
+  phase_ = Phase::PinList;
+  return load_next_pin();
+}
+
+bool InpEdgeIterator::load_next_pin() {
+  if (next_pin_id_ == 0) {
+    return false;
+  }
+  cur_pin_lookup_ = (next_pin_id_ & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+  pin_entry_      = graph_->ref_pin(cur_pin_lookup_);
+  next_pin_id_    = pin_entry_->get_next_pin_id();
+  bind_pin();
+  return true;
+}
+
+void InpEdgeIterator::bind_node_as_pin() {
+  static_assert(Graph::NodeEntry::EdgeRange::kInlineMax <= kBufCap, "buf_ too small for NodeEntry inline edges");
+  set_sink(self_nid_);
+  if (node_entry_->check_overflow()) {
+    bind_overflow(node_entry_->get_overflow_idx());
+  } else {
+    slab_ = nullptr;
+    n_    = 0;
+    for (const Vid v : node_entry_->get_edges(self_nid_, graph_->overflow_sets())) {
+      buf_[n_++] = v;
+    }
+    idx_         = 0;
+    is_overflow_ = false;
+  }
+}
+
+void InpEdgeIterator::bind_pin() {
+  static_assert(Graph::PinEntry::EdgeRange::kInlineMax <= kBufCap, "buf_ too small for PinEntry inline edges");
+  set_sink(cur_pin_lookup_);
+  if (pin_entry_->check_overflow()) {
+    bind_overflow(pin_entry_->get_overflow_idx());
+  } else {
+    slab_ = nullptr;
+    n_    = 0;
+    for (const Vid v : pin_entry_->get_edges(cur_pin_lookup_, graph_->overflow_sets())) {
+      buf_[n_++] = v;
+    }
+    idx_         = 0;
+    is_overflow_ = false;
+  }
+}
+
+void InpEdgeIterator::bind_overflow(uint32_t overflow_idx) {
+  const auto& store = graph_->overflow_sets();
+  if (Overflow_store::is_slab(overflow_idx)) {
+    const uint32_t off = Overflow_store::slab_off(overflow_idx);
+    slab_              = store.slab.data(off);
+    slab_it_           = slab_;
+    slab_end_          = slab_ + store.slab.size(off);
+    is_overflow_       = false;
+    return;
+  }
+  ovf_         = &store.sets[overflow_idx];
+  ovf_it_      = ovf_->begin();
+  ovf_end_     = ovf_->end();
+  slab_        = nullptr;
+  is_overflow_ = true;
+}
+
+void InpEdgeIterator::set_sink(Pid sink_pid) {
+  cur_sink_           = Pin_class(graph_, sink_pid);
+  cur_sink_.context_  = context_;
+  cur_sink_.root_gid_ = root_gid_;
+  cur_sink_.hier_pos_ = hier_pos_;
+  // Only a port0 pin source stamped the sink's hier_path_ in the old builder.
+  if (!is_node_src_ && src_is_port0_) {
+    cur_sink_.hier_path_ = hier_path_;
+  }
+}
+
+Edge_class InpEdgeIterator::build_edge(Vid vid) const {
+  Edge_class e{};
+  e.sink = cur_sink_;
+  if (vid & static_cast<Vid>(1)) {  // real-pin driver
+    e.driver           = Pin_class(graph_, static_cast<Pid>(vid));
+    e.driver.context_  = context_;
+    e.driver.root_gid_ = root_gid_;
+    e.driver.hier_pos_ = hier_pos_;
+    if (!is_node_src_) {
+      e.driver.hier_path_ = hier_path_;
+    }
+  } else {  // node-as-pin driver
+    e.driver = Pin_class(graph_, static_cast<Nid>(vid) | static_cast<Nid>(2));
+    // Only a port0 pin source stamped context onto a node-as-pin driver.
+    if (!is_node_src_ && src_is_port0_) {
+      e.driver.context_   = context_;
+      e.driver.root_gid_  = root_gid_;
+      e.driver.hier_pos_  = hier_pos_;
+      e.driver.hier_path_ = hier_path_;
+    }
+  }
+  return e;
+}
+
+Edge_class InpEdgeIterator::operator*() const {
   if (phase_ == Phase::Materialized) {
     return (*mat_)[mat_idx_];
   }
   return build_edge(entry_cur_vid());
 }
 
-OutEdgeIterator& OutEdgeIterator::operator++() {
+InpEdgeIterator& InpEdgeIterator::operator++() {
   if (phase_ == Phase::Materialized) {
     ++mat_idx_;
     if (mat_idx_ >= mat_->size()) {
@@ -5425,90 +7321,6 @@ OutEdgeIterator& OutEdgeIterator::operator++() {
   return *this;
 }
 
-auto Graph::inp_edges(Pin_class pin) -> absl::InlinedVector<Edge_class, 4> {
-  assert_accessible();
-  assert_pin_exists(pin);
-
-  // port_id == 0: read edges from NodeEntry, build pin-aware results
-  if (!(pin.get_debug_pid() & static_cast<Pid>(1))) {
-    const Nid self_nid = pin.get_debug_pid() & ~static_cast<Nid>(2);
-    auto*     self     = ref_node(self_nid);
-    auto      edges    = self->get_edges(self_nid, overflow_sets());
-    Pin_class self_sink_pin(this, self_nid);
-    self_sink_pin.context_   = pin.context_;
-    self_sink_pin.root_gid_  = pin.root_gid_;
-    self_sink_pin.hier_pos_  = pin.hier_pos_;
-    self_sink_pin.hier_path_ = pin.hier_path_;
-
-    absl::InlinedVector<Edge_class, 4> out;
-    for (auto vid : edges) {
-      if (!(vid & 2)) {
-        continue;  // skip local/forward edges
-      }
-      if (vid & 1) {
-        Edge_class e{};
-        e.driver            = make_pin_class(static_cast<Pid>(vid));
-        e.driver.context_   = pin.context_;
-        e.driver.root_gid_  = pin.root_gid_;
-        e.driver.hier_pos_  = pin.hier_pos_;
-        e.driver.hier_path_ = pin.hier_path_;
-        e.sink              = self_sink_pin;
-        out.push_back(std::move(e));
-      } else {
-        const Nid  driver_nid = static_cast<Nid>(vid);
-        Edge_class e{};
-        e.driver            = Pin_class(this, driver_nid | static_cast<Nid>(2));
-        e.driver.context_   = pin.context_;
-        e.driver.root_gid_  = pin.root_gid_;
-        e.driver.hier_pos_  = pin.hier_pos_;
-        e.driver.hier_path_ = pin.hier_path_;
-        e.sink              = self_sink_pin;
-        out.push_back(std::move(e));
-      }
-    }
-    return out;
-  }
-
-  absl::InlinedVector<Edge_class, 4> out;
-  const Pid                          self_pid         = pin.get_debug_pid();
-  const Pid                          self_pid_sink    = (self_pid & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
-  auto*                              self             = ref_pin(self_pid_sink);
-  auto                               edges            = self->get_edges(self_pid_sink, overflow_sets());
-  const Pin_class                    self_sink_pin    = make_pin_class(self_pid_sink);
-  Pin_class                          context_sink_pin = self_sink_pin;
-  context_sink_pin.context_                           = pin.context_;
-  context_sink_pin.root_gid_                          = pin.root_gid_;
-  context_sink_pin.hier_pos_                          = pin.hier_pos_;
-
-  for (auto vid : edges) {
-    if (!(vid & 2)) {
-      continue;
-    }
-    if (vid & 1) {
-      const Pid driver_pid = static_cast<Pid>(vid);
-
-      Edge_class e{};
-      e.driver            = make_pin_class(driver_pid);
-      e.driver.context_   = pin.context_;
-      e.driver.root_gid_  = pin.root_gid_;
-      e.driver.hier_pos_  = pin.hier_pos_;
-      e.driver.hier_path_ = pin.hier_path_;
-      e.sink              = context_sink_pin;
-      out.push_back(std::move(e));
-      continue;
-    }
-
-    const Nid driver_nid = static_cast<Nid>(vid);
-
-    Edge_class e{};
-    e.driver = Pin_class(this, driver_nid | static_cast<Nid>(2));
-    e.sink   = context_sink_pin;
-    out.push_back(std::move(e));
-  }
-
-  return out;
-}
-
 auto Graph::get_pins(Node_class node) -> absl::InlinedVector<Pin_class, 4> {
   assert_accessible();
   assert_node_exists(node);
@@ -5574,6 +7386,10 @@ void Graph::delete_node(Nid nid) {
   assert(actual_id < node_table.size() && node_table[actual_id].is_alive() && "delete_node: node handle is invalid");
 
   auto* node = ref_node(nid);
+  if (node_counts_valid_) {
+    --live_node_count_;
+    loop_break_count_ -= node->is_loop_break() ? 1 : 0;
+  }
 
   std::vector<Pid> pins_to_delete;
   for (Pid cur_pin = node->get_next_pin_id(); cur_pin != 0;) {
@@ -5602,32 +7418,43 @@ void Graph::delete_node(Nid nid) {
 
   for (const auto& [driver, sink] : edges_to_remove) {
     del_edge_int(driver, sink);
+    patch_traversal_caches_for_edge(driver, sink, -1);
   }
 
   erase_attr_object(make_node_attr_key(static_cast<uint64_t>(nid)));
   erase_attr_object(make_pin_attr_key(static_cast<uint64_t>(nid)));
+  auto pool = get_overflow_pool();
   for (auto pin_pid : pins_to_delete) {
     const Pid actual_pin_id = pin_pid >> 2;
     auto*     pin           = &pin_table[actual_pin_id];
     if (pin->use_overflow) {
-      overflow_free_.push_back(pin->get_overflow_idx());
-      overflow_sets()[pin->get_overflow_idx()].clear();
+      pool.free(pin->get_overflow_idx());
     }
     erase_attr_object(make_pin_attr_key(static_cast<uint64_t>(pin_pid)));
     pin_table[actual_pin_id] = PinEntry();
   }
 
   if (node->use_overflow) {
-    overflow_free_.push_back(node->get_overflow_idx());
-    overflow_sets()[node->get_overflow_idx()].clear();
+    pool.free(node->get_overflow_idx());
   }
   node_table[actual_id] = NodeEntry();
+  port_index_.erase(nid);
+  subnode_gid_.erase(nid);
   subnode_loops_.erase(nid);
 #ifndef NDEBUG
   validated_loop_carries_.erase(nid);
 #endif
   sync_loop_presence();
-  invalidate_traversal_caches();
+  // The edges were patched out one by one and the dead slot is skipped by
+  // every replay. A cyclic body (no maintained order) rebuilds instead: the
+  // deletion may have broken its cycle, and Pass 2 is not patched.
+  forward_caches_valid_  = forward_caches_valid_ && forward_order_valid_;
+  backward_caches_valid_ = backward_caches_valid_ && backward_order_valid_;
+  if (levels_valid_) {
+    level_of_cache_[actual_id] = Level_view::kNoLevel;
+    level_buckets_stale_       = true;
+  }
+  note_body_edit();
 }
 
 void Graph::add_edge_int(Vid self_id, Vid other_id) {
@@ -5665,17 +7492,31 @@ void Graph::set_next_pin(Nid nid, Pid next_pin) {
   if (head == 0 || pin_table[head >> 2].get_port_id() > new_port) {
     pin_table[next_pin].set_next_pin_id(head);
     node->set_next_pin_id(new_pid_canonical);
+    index_new_pin(nid, new_port, new_pid_canonical, 0);
     return;
   }
-  Pid cur = head >> 2;
+  if (const auto* ports = port_list(nid)) {
+    // Indexed node: the predecessor is the last indexed pin with port <= new_port
+    // (equal ports keep insertion order, matching the walk below).
+    const auto it  = std::upper_bound(ports->begin(), ports->end(), new_port, [](Port_id p, const auto& e) { return p < e.first; });
+    const Pid  cur = std::prev(it)->second >> 2;  // head port <= new_port, so it != begin
+    pin_table[next_pin].set_next_pin_id(pin_table[cur].get_next_pin_id());
+    pin_table[cur].set_next_pin_id(new_pid_canonical);
+    index_new_pin(nid, new_port, new_pid_canonical, 0);
+    return;
+  }
+  Pid    cur    = head >> 2;
+  size_t walked = 1;
   while (true) {
     Pid nxt = pin_table[cur].get_next_pin_id();
     if (nxt == 0 || pin_table[nxt >> 2].get_port_id() > new_port) {
       pin_table[next_pin].set_next_pin_id(nxt);
       pin_table[cur].set_next_pin_id(new_pid_canonical);
+      index_new_pin(nid, new_port, new_pid_canonical, walked);
       return;
     }
     cur = nxt >> 2;
+    ++walked;
   }
 }
 
@@ -5727,7 +7568,7 @@ void Graph::print(std::ostream& os) const {
 
     const auto* entry = ref_node(raw_nid);
     if (entry->has_subnode() && owner_lib_ != nullptr) {
-      const auto gio = owner_lib_->io_at_unlocked(entry->get_subnode());
+      const auto gio = owner_lib_->io_at_unlocked(subnode_gid(raw_nid));
       if (gio != nullptr) {
         os << " : " << gio->get_name();
       }
@@ -5759,7 +7600,7 @@ std::string Graph::print() const {
 // --------------------------------------------------------------------------
 
 static constexpr uint32_t GRAPH_BODY_MAGIC     = 0x48484742;  // "HHGB"
-static constexpr uint32_t GRAPH_BODY_VERSION   = 5;
+static constexpr uint32_t GRAPH_BODY_VERSION   = 7;
 static constexpr uint32_t SUBNODE_LOOP_VERSION = 1;
 static constexpr uint32_t ENDIAN_CHECK         = 0x01020304;
 
@@ -5801,7 +7642,8 @@ void Graph::save_body(const std::string& dir_path) const {
 
     const uint64_t node_count     = node_table.size();
     const uint64_t pin_count      = pin_table.size();
-    const uint64_t overflow_count = overflow_sets().size();
+    const uint64_t overflow_count = overflow_sets().sets.size();
+    const uint64_t slab_words     = overflow_sets().slab.words().size();
 
     ofs.write(reinterpret_cast<const char*>(&GRAPH_BODY_MAGIC), sizeof(GRAPH_BODY_MAGIC));
     ofs.write(reinterpret_cast<const char*>(&GRAPH_BODY_VERSION), sizeof(GRAPH_BODY_VERSION));
@@ -5809,11 +7651,23 @@ void Graph::save_body(const std::string& dir_path) const {
     ofs.write(reinterpret_cast<const char*>(&node_count), sizeof(node_count));
     ofs.write(reinterpret_cast<const char*>(&pin_count), sizeof(pin_count));
     ofs.write(reinterpret_cast<const char*>(&overflow_count), sizeof(overflow_count));
+    ofs.write(reinterpret_cast<const char*>(&slab_words), sizeof(slab_words));
 
     // Bulk write node_table and pin_table — pointer-free POD arrays.
     ofs.write(reinterpret_cast<const char*>(node_table.data()), static_cast<std::streamsize>(node_count * sizeof(NodeEntry)));
     ofs.write(reinterpret_cast<const char*>(pin_table.data()), static_cast<std::streamsize>(pin_count * sizeof(PinEntry)));
 
+    // Subnode targets (the entries only carry the has_subnode flag), in nid
+    // order for the same determinism reason as the loop descriptors below.
+    std::vector<std::pair<Nid, Gid>> subnodes(subnode_gid_.begin(), subnode_gid_.end());
+    std::ranges::sort(subnodes);
+    const uint64_t subnode_count = subnodes.size();
+    ofs.write(reinterpret_cast<const char*>(&subnode_count), sizeof(subnode_count));
+    for (const auto& [nid, gid] : subnodes) {
+      ofs.write(reinterpret_cast<const char*>(&nid), sizeof(nid));
+      ofs.write(reinterpret_cast<const char*>(&gid), sizeof(gid));
+    }
+
     // Native compact-loop descriptors. Write in nid order so persistence is a
     // pure function of stored structure, independent of hash-map iteration.
     std::vector<Nid> loop_nids;
@@ -5856,20 +7710,27 @@ void Graph::save_body(const std::string& dir_path) const {
   // Consolidating into a single overflow.bin cuts the file count (and open()s) by
   // ~700x. Each set is [u64 count][count x Vid], concatenated in overflow_idx
   // order; the number of sets is overflow_count (already in body.bin), so no index
-  // is needed. An empty-overflow graph writes no overflow.bin at all.
+  // is needed. The small-vector slab arena follows as one raw block of
+  // slab_words Vids (chunk headers included), so slab offsets stored in the
+  // entries stay valid. An empty-overflow graph writes no overflow.bin at all.
   if (!overflow_sets().empty()) {
     const auto    path = fs::path(dir_path) / "overflow.bin";
     std::ofstream ofs(path, std::ios::binary);
     assert(ofs.good() && "save_body: cannot open overflow.bin for writing");
-    for (uint32_t i = 0; i < overflow_sets().size(); ++i) {
+    const auto& sets = overflow_sets().sets;
+    for (uint32_t i = 0; i < sets.size(); ++i) {
       // Use the values() API — contiguous Vid vector, no bucket data needed.
-      const auto&    vals  = overflow_sets()[i].values();
+      const auto&    vals  = sets[i].values();
       const uint64_t count = vals.size();
       ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
       if (count > 0) {
         ofs.write(reinterpret_cast<const char*>(vals.data()), static_cast<std::streamsize>(count * sizeof(Vid)));
       }
     }
+    const auto& words = overflow_sets().slab.words();
+    if (!words.empty()) {
+      ofs.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(Vid)));
+    }
   }
 
   dirty_ = false;
@@ -5882,11 +7743,15 @@ void Graph::ensure_overflow_loaded() const {
   if (!overflow_deferred_) {
     return;
   }
-  namespace fs             = std::filesystem;
-  auto* self               = const_cast<Graph*>(this);
-  // Clear the flag FIRST so overflow_storage_ accesses below (and any re-entry
-  // through overflow_sets()) do not recurse back into this read.
-  self->overflow_deferred_ = false;
+  std::lock_guard lock(cache_mu_);
+  if (!overflow_deferred_) {  // loaded by a concurrent reader while we waited
+    return;
+  }
+  namespace fs = std::filesystem;
+  auto* self   = const_cast<Graph*>(this);
+  // The flag is cleared only after the read below, so a concurrent reader
+  // never sees half-loaded sets. Everything here touches overflow_storage_
+  // directly; nothing re-enters overflow_sets().
 
   auto read_set = [self](std::istream& ifs, uint32_t i) {
     uint64_t count = 0;
@@ -5894,7 +7759,7 @@ void Graph::ensure_overflow_loaded() const {
     if (count > 0) {
       std::vector<Vid> vals(count);
       ifs.read(reinterpret_cast<char*>(vals.data()), static_cast<std::streamsize>(count * sizeof(Vid)));
-      self->overflow_storage_[i].replace(std::move(vals));
+      self->overflow_storage_.sets[i].replace(std::move(vals));
     }
   };
   // Current format: one overflow.bin holding every set back to back (see
@@ -5904,17 +7769,22 @@ void Graph::ensure_overflow_loaded() const {
   if (!overflow_storage_.empty() && fs::exists(consolidated)) {
     std::ifstream ifs(consolidated, std::ios::binary);
     assert(ifs.good() && "ensure_overflow_loaded: cannot open overflow.bin for reading");
-    for (uint32_t i = 0; i < overflow_storage_.size(); ++i) {
+    for (uint32_t i = 0; i < overflow_storage_.sets.size(); ++i) {
       read_set(ifs, i);
     }
+    auto& words = self->overflow_storage_.slab.raw_words();  // sized by load_body
+    if (!words.empty()) {
+      ifs.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(Vid)));
+    }
   } else {
-    for (uint32_t i = 0; i < overflow_storage_.size(); ++i) {  // legacy per-file fallback
+    for (uint32_t i = 0; i < overflow_storage_.sets.size(); ++i) {  // legacy per-file fallback
       const auto    path = fs::path(overflow_src_dir_) / ("overflow_" + std::to_string(i) + ".bin");
       std::ifstream ifs(path, std::ios::binary);
       assert(ifs.good() && "ensure_overflow_loaded: cannot open overflow file for reading");
       read_set(ifs, i);
     }
   }
+  overflow_deferred_ = false;  // publish
 }
 
 void Graph::load_body(const std::string& dir_path) {
@@ -5942,10 +7812,13 @@ void Graph::load_body(const std::string& dir_path) {
       throw std::runtime_error("load_body: endian mismatch — file from different platform");
     }
 
-    uint64_t node_count = 0, pin_count = 0, overflow_count = 0;
+    uint64_t node_count = 0, pin_count = 0, overflow_count = 0, slab_words = 0;
     ifs.read(reinterpret_cast<char*>(&node_count), sizeof(node_count));
     ifs.read(reinterpret_cast<char*>(&pin_count), sizeof(pin_count));
     ifs.read(reinterpret_cast<char*>(&overflow_count), sizeof(overflow_count));
+    if (version >= 6) {
+      ifs.read(reinterpret_cast<char*>(&slab_words), sizeof(slab_words));
+    }
 
     // Bulk read node_table and pin_table.
     node_table.resize(node_count);
@@ -5954,9 +7827,41 @@ void Graph::load_body(const std::string& dir_path) {
     pin_table.resize(pin_count);
     ifs.read(reinterpret_cast<char*>(pin_table.data()), static_cast<std::streamsize>(pin_count * sizeof(PinEntry)));
 
+    subnode_gid_.clear();
+    if (version >= 7) {
+      uint64_t subnode_count = 0;
+      ifs.read(reinterpret_cast<char*>(&subnode_count), sizeof(subnode_count));
+      for (uint64_t i = 0; i < subnode_count; ++i) {
+        Nid nid = 0;
+        Gid gid = Gid_invalid;
+        ifs.read(reinterpret_cast<char*>(&nid), sizeof(nid));
+        ifs.read(reinterpret_cast<char*>(&gid), sizeof(gid));
+        const size_t idx = static_cast<size_t>(nid >> 2);
+        if (!ifs || (nid & static_cast<Nid>(3)) != 0 || idx >= node_table.size() || !node_table[idx].has_subnode()) {
+          throw std::runtime_error("load_body: subnode target belongs to a non-Sub node");
+        }
+        subnode_gid_.emplace(nid, gid);
+      }
+    } else {
+      // Pre-7 bodies kept the target Gid in ledge0 of a forced-overflow entry
+      // (overflow_handling zeroes both ledges, so a non-zero ledge0 there can
+      // only be a Gid). Move it to the side table.
+      for (size_t i = 1; i < node_table.size(); ++i) {
+        auto& entry = node_table[i];
+        if (!entry.is_alive() || !entry.use_overflow || entry.ledge0 == 0) {
+          continue;
+        }
+        subnode_gid_.emplace(static_cast<Nid>(i) << 2, static_cast<Gid>(entry.ledge0));
+        entry.ledge0 = 0;
+        entry.set_subnode_flag();
+      }
+    }
+
     // Size the overflow vector (holes included) but DEFER reading the set
     // contents — see below.
-    overflow_storage_.resize(overflow_count);
+    overflow_storage_.clear();
+    overflow_storage_.sets.resize(overflow_count);
+    overflow_storage_.slab.raw_words().resize(slab_words);
     overflow_free_.clear();
 
     subnode_loops_.clear();
@@ -6030,7 +7935,7 @@ void Graph::load_body(const std::string& dir_path) {
   // On a legacy library that alone is the difference between ~1.2M file opens and
   // none. overflow_count==0 => nothing to defer.
   overflow_src_dir_  = dir_path;
-  overflow_deferred_ = (overflow_storage_.size() > 0);
+  overflow_deferred_ = !overflow_storage_.empty();
 
   rebuild_derived_after_body();
   // Descriptor-local load validation. Edge-shape validation remains deferred
@@ -6060,8 +7965,9 @@ void Graph::load_body(const std::string& dir_path) {
 
 void Graph::rebuild_derived_after_body() {
   constant_pin_index_.clear();
-  // Rebuild structure tree: save/load only persists node_table (which holds
-  // each subnode's target Gid in ledge0). Walk the live entries and
+  rebuild_port_index();
+  // Rebuild structure tree: save/load only persists node_table (which flags
+  // each subnode) and the subnode_gid_ targets. Walk the live entries and
   // reconstruct tree_ + subnode_tree_pos_ so hier traversal works.
   if (!tree_) {
     tree_ = Tree::create();
@@ -6135,6 +8041,7 @@ void Graph::copy_body_from(const Graph& src) {
   overflow_free_     = src.overflow_free_;
   overflow_deferred_ = false;
   overflow_src_dir_.clear();
+  subnode_gid_   = src.subnode_gid_;
   subnode_loops_ = src.subnode_loops_;
 #ifndef NDEBUG
   validated_loop_carries_.clear();
@@ -6145,10 +8052,598 @@ void Graph::copy_body_from(const Graph& src) {
   dirty_ = true;
 }
 
+bool Graph_remap::is_identity() const noexcept {
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i] != i) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < pins.size(); ++i) {
+    if (pins[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Graph::compact() -> Graph_remap {
+  assert_accessible();
+
+  Graph_remap remap;
+  remap.nodes.assign(node_table.size(), 0);
+  remap.pins.assign(pin_table.size(), 0);
+  Nid next_node = 1;
+  for (size_t i = 1; i < node_table.size(); ++i) {
+    if (i <= (CONST_NODE >> 2) || node_table[i].is_alive()) {
+      remap.nodes[i] = next_node++;
+    }
+  }
+  Pid next_pin = 1;
+  for (size_t i = 1; i < pin_table.size(); ++i) {
+    const Nid owner = pin_table[i].get_master_nid() & ~static_cast<Nid>(3);
+    if (owner != 0 && remap.nodes[owner >> 2] != 0) {
+      remap.pins[i] = next_pin++;
+    }
+  }
+  if (next_node == node_table.size() && next_pin == pin_table.size()) {
+    return remap;  // no tombstones: ids are already dense
+  }
+
+  apply_renumbering(remap);
+  return remap;
+}
+
+void Graph::apply_renumbering(const Graph_remap& remap) {
+  const auto& overflow = overflow_sets();  // deferred sets must be in memory before re-encoding
+  // Inverse maps: new index -> old index, so the fresh tables are filled in
+  // their new order.
+  const auto live_count = [](const std::vector<uint64_t>& ids) {
+    return 1 + static_cast<size_t>(std::count_if(ids.begin(), ids.end(), [](uint64_t id) { return id != 0; }));
+  };
+  std::vector<Nid> old_node(live_count(remap.nodes), 0);
+  std::vector<Pid> old_pin(live_count(remap.pins), 0);
+  for (size_t i = 1; i < remap.nodes.size(); ++i) {
+    if (remap.nodes[i] != 0) {
+      assert(remap.nodes[i] < old_node.size() && "apply_renumbering: node ids must be dense");
+      old_node[remap.nodes[i]] = i;
+    }
+  }
+  for (size_t i = 1; i < remap.pins.size(); ++i) {
+    if (remap.pins[i] != 0) {
+      assert(remap.pins[i] < old_pin.size() && "apply_renumbering: pin ids must be dense");
+      old_pin[remap.pins[i]] = i;
+    }
+  }
+
+  // Each edge is stored on both endpoints; collect it once from the driver
+  // side (an entry whose stored neighbour has the driver bit clear drives it).
+  std::vector<std::pair<Vid, Vid>> edges;
+  for (size_t i = 1; i < node_table.size(); ++i) {
+    if (remap.nodes[i] == 0) {
+      continue;
+    }
+    const Nid self = static_cast<Nid>(i) << 2;
+    for (const Vid other : node_table[i].get_edges(self, overflow)) {
+      if (!(other & static_cast<Vid>(2))) {
+        edges.emplace_back(remap.remap(self | static_cast<Vid>(2)), remap.remap(other));
+      }
+    }
+  }
+  for (size_t i = 1; i < pin_table.size(); ++i) {
+    if (remap.pins[i] == 0) {
+      continue;
+    }
+    const Pid self = (static_cast<Pid>(i) << 2) | static_cast<Pid>(1);
+    for (const Vid other : pin_table[i].get_edges(self, overflow)) {
+      if (!(other & static_cast<Vid>(2))) {
+        edges.emplace_back(remap.remap(self | static_cast<Vid>(2)), remap.remap(other));
+      }
+    }
+  }
+
+  // Fresh tables: type + subnode flag per node, (owner, port) per pin, and the
+  // pin lists relinked in their old (port-sorted) order.
+  std::vector<NodeEntry> new_nodes;
+  std::vector<PinEntry>  new_pins;
+  new_nodes.reserve(old_node.size());
+  new_pins.reserve(old_pin.size());
+  new_nodes.emplace_back(false);
+  new_pins.emplace_back(0, 0);
+  for (size_t n = 1; n < old_node.size(); ++n) {
+    assert(old_node[n] != 0 && "apply_renumbering: node ids must be dense");
+    const auto& old = node_table[old_node[n]];
+    auto&       dst = new_nodes.emplace_back(true);
+    dst.set_type(old.get_type());
+    if (old.has_subnode()) {
+      dst.set_subnode_flag();
+    }
+  }
+  for (size_t n = 1; n < old_pin.size(); ++n) {
+    assert(old_pin[n] != 0 && "apply_renumbering: pin ids must be dense");
+    const auto& old = pin_table[old_pin[n]];
+    new_pins.emplace_back(remap.remap(old.get_master_nid() & ~static_cast<Nid>(3)), old.get_port_id());
+  }
+  for (size_t i = 1; i < node_table.size(); ++i) {
+    if (remap.nodes[i] == 0) {
+      continue;
+    }
+    Pid tail = 0;
+    for (Pid cur = node_table[i].get_next_pin_id(); cur != 0; cur = pin_table[cur >> 2].get_next_pin_id()) {
+      const Pid moved = remap.remap((cur & ~static_cast<Pid>(2)) | static_cast<Pid>(1));
+      if (tail == 0) {
+        new_nodes[remap.nodes[i]].set_next_pin_id(moved);
+      } else {
+        new_pins[tail >> 2].set_next_pin_id(moved);
+      }
+      tail = moved;
+    }
+  }
+
+  node_table = std::move(new_nodes);
+  pin_table  = std::move(new_pins);
+  overflow_storage_.clear();
+  overflow_free_.clear();
+  overflow_deferred_ = false;
+  overflow_src_dir_.clear();
+  for (const auto& [driver, sink] : edges) {
+    assert(driver != 0 && sink != 0 && "apply_renumbering: live entity holds an edge to a tombstone");
+    add_edge_int(driver, sink);
+    add_edge_int(sink, driver);
+  }
+
+  // Side tables keyed by Nid / holding Pids.
+  const auto remap_keys = [&remap](auto& map) {
+    std::remove_reference_t<decltype(map)> moved;
+    moved.reserve(map.size());
+    for (auto& [nid, value] : map) {
+      if (const Nid new_nid = remap.remap(nid); new_nid != 0) {
+        moved.emplace(new_nid, std::move(value));
+      }
+    }
+    map = std::move(moved);
+  };
+  remap_keys(subnode_gid_);
+  remap_keys(subnode_loops_);
+#ifndef NDEBUG
+  remap_keys(validated_loop_carries_);
+#endif
+  for (auto* pins : {&input_pins_, &output_pins_}) {
+    for (auto& [name, pid] : *pins) {
+      pid = remap.remap(pid);
+    }
+  }
+
+  // Attr keys are (raw id << 1) | is_pin_key; the raw id is a Nid or a Pid.
+  auto attr_key_map = [&remap](Attr_key key) -> Attr_key {
+    const Vid moved = remap.remap(static_cast<Vid>(key >> 1U));
+    return moved == 0 ? 0 : ((static_cast<Attr_key>(moved) << 1U) | (key & 1U));
+  };
+  remap_attr_objects(attr_key_map);
+  auto site_map = [&remap](Nid site) -> Nid { return remap.remap(site); };
+  if (owner_lib_ != nullptr) {
+    for (const auto& [gid, g] : owner_lib_->graphs_) {
+      if (g && !g->deleted_ && g->remap_attr_sites(self_gid_, site_map)) {
+        g->dirty_ = true;
+      }
+    }
+  } else {
+    (void)remap_attr_sites(self_gid_, site_map);
+  }
+
+  rebuild_derived_after_body();  // tree_, subnode_tree_pos_, port and constant indexes
+  dirty_ = true;
+  if (owner_lib_ != nullptr) {
+    owner_lib_->note_graph_mutation();
+  }
+}
+
+auto Graph::edge_tier_stats() const -> Edge_tier_stats {
+  assert_accessible();
+  const auto&     overflow = overflow_sets();
+  Edge_tier_stats stats;
+  const auto      account  = [&stats, &overflow](const auto& entry, uint64_t self) {
+    if (entry.use_overflow) {
+      const uint32_t idx = entry.sedges_.overflow_idx;
+      const auto     n   = static_cast<uint64_t>(overflow.size_of(idx));
+      if (Overflow_store::is_slab(idx)) {
+        ++stats.slab_sets;
+        stats.slab_edges += n;
+      } else {
+        ++stats.hash_sets;
+        stats.hash_edges += n;
+      }
+      return;
+    }
+    uint64_t n = 0;
+    for ([[maybe_unused]] const Vid v : entry.get_edges(self, overflow)) {
+      ++n;
+    }
+    const uint64_t longs  = static_cast<uint64_t>(entry.ledge0 != 0) + static_cast<uint64_t>(entry.ledge1 != 0);
+    stats.long_edges     += longs;
+    stats.short_edges    += n - longs;
+  };
+  for (size_t i = 1; i < node_table.size(); ++i) {
+    if (node_table[i].is_alive()) {
+      account(node_table[i], static_cast<uint64_t>(i) << 2);
+    }
+  }
+  for (size_t i = 1; i < pin_table.size(); ++i) {
+    if (pin_table[i].get_master_nid() != 0) {
+      account(pin_table[i], (static_cast<uint64_t>(i) << 2) | 1U);
+    }
+  }
+  return stats;
+}
+
+namespace {
+
+// Value vector plus bucket array of an ankerl::unordered_dense map / set.
+template <typename M>
+uint64_t dense_table_bytes(const M& m) noexcept {
+  return static_cast<uint64_t>(m.values().capacity()) * sizeof(typename M::value_type)
+         + static_cast<uint64_t>(m.bucket_count()) * sizeof(typename M::bucket_type);
+}
+
+template <typename T>
+uint64_t vector_bytes(const std::vector<T>& v) noexcept {
+  return static_cast<uint64_t>(v.capacity()) * sizeof(T);
+}
+
+}  // namespace
+
+auto Graph::memory_stats() const -> Graph_memory_stats {
+  assert_accessible();
+  Graph_memory_stats stats;
+  stats.node_table  = static_cast<uint64_t>(node_table.size()) * sizeof(NodeEntry);
+  stats.pin_table   = static_cast<uint64_t>(pin_table.size()) * sizeof(PinEntry);
+  stats.table_slack = static_cast<uint64_t>(node_table.capacity() - node_table.size()) * sizeof(NodeEntry)
+                      + static_cast<uint64_t>(pin_table.capacity() - pin_table.size()) * sizeof(PinEntry);
+
+  // Raw member on purpose: reading it must not trigger the deferred load.
+  const auto& slab    = overflow_storage_.slab;
+  stats.overflow_slab = vector_bytes(slab.words());
+  stats.overflow_sets = vector_bytes(overflow_storage_.sets) + vector_bytes(overflow_free_);
+  for (const auto& set : overflow_storage_.sets) {
+    stats.overflow_sets += dense_table_bytes(set);
+  }
+  stats.overflow_deferred = overflow_deferred_;
+
+  stats.traversal_caches = vector_bytes(forward_pass2_cache_) + vector_bytes(forward_remaining_in_cache_)
+                           + vector_bytes(forward_order_cache_) + vector_bytes(forward_rank_cache_)
+                           + vector_bytes(backward_pass2_cache_) + vector_bytes(backward_remaining_out_cache_)
+                           + vector_bytes(backward_order_cache_) + vector_bytes(backward_rank_cache_)
+                           + vector_bytes(level_of_cache_) + vector_bytes(level_nodes_cache_) + vector_bytes(level_off_cache_);
+  {
+    std::lock_guard lock(csr_mu_);
+    if (csr_cache_) {
+      stats.traversal_caches += csr_cache_->memory_bytes();
+    }
+  }
+
+  stats.side_tables = dense_table_bytes(constant_pin_index_.by_hash) + dense_table_bytes(port_index_)
+                      + dense_table_bytes(subnode_tree_pos_) + dense_table_bytes(subnode_gid_)
+                      + dense_table_bytes(subnode_loops_) + dense_table_bytes(input_pins_) + dense_table_bytes(output_pins_);
+  for (const auto& [nid, ports] : port_index_.values()) {
+    stats.side_tables += vector_bytes(ports);
+  }
+
+  stats.attrs = attr_store_stats();
+  for (const auto& a : stats.attrs) {
+    stats.attr_stores += a.bytes;
+  }
+  stats.source_locator = srcloc_.memory_bytes();
+  stats.hierarchy_tree = tree_ ? tree_->memory_bytes() : 0;
+  if (!overflow_deferred_) {
+    stats.edges = edge_tier_stats();
+  }
+  return stats;
+}
+
+Graph_memory_stats& Graph_memory_stats::operator+=(const Graph_memory_stats& o) {
+  node_table       += o.node_table;
+  pin_table        += o.pin_table;
+  table_slack      += o.table_slack;
+  overflow_slab    += o.overflow_slab;
+  overflow_sets    += o.overflow_sets;
+  traversal_caches += o.traversal_caches;
+  side_tables      += o.side_tables;
+  attr_stores      += o.attr_stores;
+  source_locator   += o.source_locator;
+  hierarchy_tree   += o.hierarchy_tree;
+  for (const auto& a : o.attrs) {
+    const auto it = std::find_if(attrs.begin(), attrs.end(), [&a](const Attr_store_stats& x) {
+      return x.persistent_id == a.persistent_id;
+    });
+    if (it == attrs.end()) {
+      attrs.push_back(a);
+    } else {
+      it->entries += a.entries;
+      it->bytes   += a.bytes;
+    }
+  }
+  edges.short_edges += o.edges.short_edges;
+  edges.long_edges  += o.edges.long_edges;
+  edges.slab_sets   += o.edges.slab_sets;
+  edges.slab_edges  += o.edges.slab_edges;
+  edges.hash_sets   += o.edges.hash_sets;
+  edges.hash_edges  += o.edges.hash_edges;
+  overflow_deferred  = overflow_deferred || o.overflow_deferred;
+  return *this;
+}
+
+void Graph_memory_stats::print(std::ostream& os) const {
+  os << "total=" << total_bytes() << " node_table=" << node_table << " pin_table=" << pin_table
+     << " table_slack=" << table_slack << " overflow_slab=" << overflow_slab << " overflow_sets=" << overflow_sets
+     << " traversal_caches=" << traversal_caches << " side_tables=" << side_tables << " attr_stores=" << attr_stores
+     << " source_locator=" << source_locator << " hierarchy_tree=" << hierarchy_tree
+     << " short_edges=" << edges.short_edges << " long_edges=" << edges.long_edges << " slab_sets=" << edges.slab_sets
+     << " slab_edges=" << edges.slab_edges << " hash_sets=" << edges.hash_sets << " hash_edges=" << edges.hash_edges;
+  if (overflow_deferred) {
+    os << " overflow_deferred=1";
+  }
+  for (const auto& a : attrs) {
+    os << " attr[" << a.persistent_id << "]=" << a.bytes;
+  }
+}
+
+void Library_memory_stats::print(std::ostream& os) const {
+  os << "graphs=" << graphs << " pending_graphs=" << pending_graphs << " source_map=" << source_map << ' ';
+  bodies.print(os);
+}
+
+auto Graph::relayout(Relayout_order order) -> Relayout_result {
+  assert_accessible();
+  Relayout_result result;
+  result.before = edge_tier_stats();
+
+  const auto&  overflow   = overflow_sets();
+  const size_t n          = node_table.size();
+  const size_t first_user = (CONST_NODE >> 2) + 1;
+  const auto   owner_of   = [this](Vid v) -> size_t {
+    return (v & static_cast<Vid>(1)) ? (pin_table[v >> 2].get_master_nid() >> 2) : (v >> 2);
+  };
+
+  // Node-level adjacency (an edge between two pins links their owners) in CSR
+  // form. IO/CONST nodes stay pinned to slots 1-3 and are not traversed, or
+  // every module-level net would collapse into one BFS wave.
+  std::vector<std::pair<uint64_t, uint64_t>> links;
+  const auto collect = [&](const auto& entry, uint64_t self) {
+    const size_t u = owner_of(self);
+    for (const Vid other : entry.get_edges(self, overflow)) {
+      const size_t v = owner_of(other);
+      if (!(other & static_cast<Vid>(2)) && u >= first_user && v >= first_user && u != v) {
+        links.emplace_back(u, v);
+      }
+    }
+  };
+  for (size_t i = first_user; i < n; ++i) {
+    if (node_table[i].is_alive()) {
+      collect(node_table[i], static_cast<uint64_t>(i) << 2);
+    }
+  }
+  for (size_t i = 1; i < pin_table.size(); ++i) {
+    if (pin_table[i].get_master_nid() != 0) {
+      collect(pin_table[i], (static_cast<uint64_t>(i) << 2) | 1U);
+    }
+  }
+  std::vector<uint64_t> offset(n + 1, 0);
+  for (const auto& [u, v] : links) {
+    ++offset[u + 1];
+    ++offset[v + 1];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    offset[i + 1] += offset[i];
+  }
+  std::vector<uint64_t> adj(offset[n]);
+  {
+    std::vector<uint64_t> fill(offset.begin(), offset.end() - 1);
+    for (const auto& [u, v] : links) {
+      adj[fill[u]++] = v;
+      adj[fill[v]++] = u;
+    }
+  }
+  links.clear();
+  links.shrink_to_fit();
+  const auto degree = [&offset](uint64_t u) { return offset[u + 1] - offset[u]; };
+
+  std::vector<uint64_t> seeds;
+  for (size_t i = first_user; i < n; ++i) {
+    if (node_table[i].is_alive()) {
+      seeds.push_back(i);
+    }
+  }
+  if (order == Relayout_order::rcm) {
+    std::stable_sort(seeds.begin(), seeds.end(), [&degree](uint64_t a, uint64_t b) { return degree(a) < degree(b); });
+    for (size_t u = first_user; u < n; ++u) {
+      std::sort(adj.begin() + static_cast<std::ptrdiff_t>(offset[u]),
+                adj.begin() + static_cast<std::ptrdiff_t>(offset[u + 1]),
+                [&degree](uint64_t a, uint64_t b) { return degree(a) < degree(b) || (degree(a) == degree(b) && a < b); });
+    }
+  }
+
+  std::vector<uint64_t> visit;  // old node indices in BFS order
+  visit.reserve(seeds.size());
+  std::vector<uint8_t> seen(n, 0);
+  for (const uint64_t seed : seeds) {
+    if (seen[seed]) {
+      continue;
+    }
+    seen[seed] = 1;
+    visit.push_back(seed);
+    for (size_t head = visit.size() - 1; head < visit.size(); ++head) {
+      const uint64_t u = visit[head];
+      for (uint64_t e = offset[u]; e < offset[u + 1]; ++e) {
+        if (!seen[adj[e]]) {
+          seen[adj[e]] = 1;
+          visit.push_back(adj[e]);
+        }
+      }
+    }
+  }
+  if (order == Relayout_order::rcm) {
+    std::reverse(visit.begin(), visit.end());
+  }
+
+  // New ids: built-ins first, then the visit order; each node's pins follow in
+  // port order so pin<->pin edges of neighbouring nodes stay close too.
+  Graph_remap& remap = result.remap;
+  remap.nodes.assign(n, 0);
+  remap.pins.assign(pin_table.size(), 0);
+  Nid next_node = 1;
+  Pid next_pin  = 1;
+  const auto place = [&](uint64_t i) {
+    remap.nodes[i] = next_node++;
+    for (Pid cur = node_table[i].get_next_pin_id(); cur != 0; cur = pin_table[cur >> 2].get_next_pin_id()) {
+      remap.pins[cur >> 2] = next_pin++;
+    }
+  };
+  for (size_t i = 1; i < first_user && i < n; ++i) {
+    place(i);
+  }
+  for (const uint64_t i : visit) {
+    place(i);
+  }
+
+  apply_renumbering(remap);
+  result.after = edge_tier_stats();
+  return result;
+}
+
+// --- Csr_view -------------------------------------------------------------
+
+Edge_class Csr_view::Edge_range::iterator::operator*() const {
+  Edge_class e{};
+  e.driver = Pin_class(graph_, cur_->driver);
+  e.sink   = Pin_class(graph_, cur_->sink);
+  return e;
+}
+
+std::span<const Csr_edge> Csr_view::Dir::node(Nid nid) const noexcept {
+  const size_t idx = static_cast<size_t>(nid >> 2);
+  if (idx >= pin0_end.size()) {
+    return {};
+  }
+  return std::span<const Csr_edge>(edges).subspan(node_off[idx], node_off[idx + 1] - node_off[idx]);
+}
+
+std::span<const Csr_edge> Csr_view::Dir::pin(Pid pid) const noexcept {
+  if (!(pid & static_cast<Pid>(1))) {  // node-as-pin(0)
+    const size_t idx = static_cast<size_t>(pid >> 2);
+    if (idx >= pin0_end.size()) {
+      return {};
+    }
+    return std::span<const Csr_edge>(edges).subspan(node_off[idx], pin0_end[idx] - node_off[idx]);
+  }
+  const size_t idx = static_cast<size_t>(pid >> 2);
+  if (idx >= pin_rng.size()) {
+    return {};
+  }
+  const auto [b, e] = pin_rng[idx];
+  return std::span<const Csr_edge>(edges).subspan(b, e - b);
+}
+
+auto Csr_view::out_edges(const Node_class& node) const -> Edge_range { return {graph_, out_.node(node.get_debug_nid())}; }
+auto Csr_view::inp_edges(const Node_class& node) const -> Edge_range { return {graph_, inp_.node(node.get_debug_nid())}; }
+auto Csr_view::out_edges(const Pin_class& pin) const -> Edge_range { return {graph_, out_.pin(pin.get_debug_pid())}; }
+auto Csr_view::inp_edges(const Pin_class& pin) const -> Edge_range { return {graph_, inp_.pin(pin.get_debug_pid())}; }
+
+bool Csr_view::is_current() const noexcept {
+  return graph_ != nullptr && graph_->owner_lib_ != nullptr && graph_->owner_lib_->mutation_epoch() == epoch_;
+}
+
+uint64_t Csr_view::memory_bytes() const noexcept {
+  uint64_t bytes = 0;
+  for (const Dir* d : {&out_, &inp_}) {
+    bytes += vector_bytes(d->edges) + vector_bytes(d->node_off) + vector_bytes(d->pin0_end) + vector_bytes(d->pin_rng);
+  }
+  return bytes;
+}
+
+auto Graph::freeze_csr() const -> std::shared_ptr<const Csr_view> {
+  assert_accessible();
+  const uint64_t  epoch = owner_lib_ != nullptr ? owner_lib_->mutation_epoch() : 0;
+  std::lock_guard lock(csr_mu_);
+  if (csr_cache_ && epoch != 0 && csr_cache_->epoch_ == epoch) {
+    return csr_cache_;
+  }
+
+  auto csr     = std::make_shared<Csr_view>();
+  csr->graph_  = const_cast<Graph*>(this);
+  csr->epoch_  = epoch;
+  const auto&  overflow = overflow_sets();
+  const size_t n        = node_table.size();
+  for (Csr_view::Dir* dir : {&csr->out_, &csr->inp_}) {
+    dir->node_off.assign(n + 1, 0);
+    dir->pin0_end.assign(n, 0);
+    dir->pin_rng.assign(pin_table.size(), {0, 0});
+  }
+
+  // Decode one entry once, splitting its stored ids by direction. A stored id
+  // with bit 1 clear is a sink of `self` (self drives); set, it is a driver.
+  const auto decode = [&](const auto& entry, Pid self_sink) {
+    const Pid self_driver = self_sink | static_cast<Pid>(2);
+    for (const Vid vid : entry.get_edges(self_sink, overflow)) {
+      if (vid & static_cast<Vid>(2)) {
+        const Pid driver = (vid & static_cast<Vid>(1)) ? static_cast<Pid>(vid) : (static_cast<Pid>(vid) | static_cast<Pid>(2));
+        csr->inp_.edges.push_back({driver, self_sink});
+      } else {
+        const Pid sink = (vid & static_cast<Vid>(1)) ? static_cast<Pid>(vid) : (static_cast<Pid>(vid) & ~static_cast<Pid>(2));
+        csr->out_.edges.push_back({self_driver, sink});
+      }
+    }
+  };
+  const auto mark = [&](auto&& fn) {
+    fn(csr->out_);
+    fn(csr->inp_);
+  };
+
+  for (size_t i = 0; i < n; ++i) {
+    mark([i](Csr_view::Dir& d) { d.node_off[i] = static_cast<uint32_t>(d.edges.size()); });
+    if (i != 0 && node_table[i].is_alive()) {
+      const Nid self = static_cast<Nid>(i) << 2;
+      decode(node_table[i], self);
+      mark([i](Csr_view::Dir& d) { d.pin0_end[i] = static_cast<uint32_t>(d.edges.size()); });
+      for (Pid cur = node_table[i].get_next_pin_id(); cur != 0;) {
+        const Pid    canonical = (cur & ~static_cast<Pid>(2)) | static_cast<Pid>(1);
+        const size_t pin_idx   = static_cast<size_t>(canonical >> 2);
+        mark([pin_idx](Csr_view::Dir& d) { d.pin_rng[pin_idx].first = static_cast<uint32_t>(d.edges.size()); });
+        decode(pin_table[pin_idx], canonical);
+        mark([pin_idx](Csr_view::Dir& d) { d.pin_rng[pin_idx].second = static_cast<uint32_t>(d.edges.size()); });
+        cur = pin_table[pin_idx].get_next_pin_id();
+      }
+    } else {
+      mark([i](Csr_view::Dir& d) { d.pin0_end[i] = static_cast<uint32_t>(d.edges.size()); });
+    }
+  }
+  mark([n](Csr_view::Dir& d) {
+    d.node_off[n] = static_cast<uint32_t>(d.edges.size());
+    assert(d.edges.size() <= UINT32_MAX && "freeze_csr: edge count exceeds 32-bit offsets");
+  });
+
+  if (epoch != 0) {
+    csr_cache_ = csr;
+  }
+  return csr;
+}
+
 // --------------------------------------------------------------------------
 // GraphLibrary persistence
 // --------------------------------------------------------------------------
 
+auto GraphLibrary::memory_stats() const -> Library_memory_stats {
+  std::shared_lock     lock(registry_mu_);
+  Library_memory_stats stats;
+  for (const auto& [gid, g] : graphs_) {
+    if (g && !g->deleted_) {
+      ++stats.graphs;
+      stats.bodies += g->memory_stats();
+    }
+  }
+  stats.pending_graphs = pending_body_dir_.size();
+  stats.source_map     = srcmap_sp_->memory_bytes();
+  return stats;
+}
+
 void GraphLibrary::save(const std::string& db_path) const {
   namespace fs = std::filesystem;
   fs::create_directories(db_path);
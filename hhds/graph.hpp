@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
 #include <condition_variable>
 #include <cstddef>
@@ -11,6 +12,7 @@
 #include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
@@ -20,6 +22,7 @@
 #include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -45,6 +48,154 @@ namespace hhds {
 using OverflowVec = std::vector<ankerl::unordered_dense::set<Vid>>;
 using OverflowSet = ankerl::unordered_dense::set<Vid>;
 
+// overflow_idx tag: set => the index is a word offset into the Overflow_slab
+// arena (small-vector tier); clear => an index into the hash-set vector.
+inline constexpr uint32_t kOverflowSlabBit = 1U << 31;
+// Default number of edges a small-vector chunk may hold before the set is
+// promoted to a hash set (tests/small_set_bench.cpp: a linear scan beats the
+// hash lookup below ~32 entries).
+inline constexpr uint32_t kDefaultOverflowPromoteThreshold = 32;
+
+// Small-vector overflow tier: one contiguous Vid arena per Graph, carved into
+// power-of-two chunks. A chunk is [header][cap x Vid] with
+// header = (cap << 32) | count, so an entry only keeps the chunk offset in its
+// 32-bit overflow_idx. Freed chunks are recycled by capacity class.
+class Overflow_slab {
+public:
+  static constexpr uint32_t kMinChunk = 16;
+
+  [[nodiscard]] const Vid *data(uint32_t off) const noexcept {
+    return words_.data() + off + 1;
+  }
+  [[nodiscard]] Vid *data(uint32_t off) noexcept {
+    return words_.data() + off + 1;
+  }
+  [[nodiscard]] uint32_t size(uint32_t off) const noexcept {
+    return static_cast<uint32_t>(words_[off]);
+  }
+  [[nodiscard]] uint32_t capacity(uint32_t off) const noexcept {
+    return static_cast<uint32_t>(words_[off] >> 32);
+  }
+  [[nodiscard]] bool contains(uint32_t off, Vid v) const noexcept {
+    const Vid *p = data(off);
+    return std::find(p, p + size(off), v) != p + size(off);
+  }
+
+  uint32_t alloc(uint32_t cap) {
+    const auto cls = static_cast<size_t>(std::bit_width(cap - 1));
+    cap = 1U << cls;
+    uint32_t off = 0;
+    if (cls < free_.size() && !free_[cls].empty()) {
+      off = free_[cls].back();
+      free_[cls].pop_back();
+    } else {
+      off = static_cast<uint32_t>(words_.size());
+      assert(off + cap + 1 < kOverflowSlabBit && "Overflow_slab: arena full");
+      words_.resize(words_.size() + cap + 1, 0);
+    }
+    words_[off] = static_cast<Vid>(cap) << 32;
+    return off;
+  }
+  void free(uint32_t off) {
+    const auto cls = static_cast<size_t>(std::bit_width(capacity(off) - 1));
+    if (cls >= free_.size()) {
+      free_.resize(cls + 1);
+    }
+    words_[off] = static_cast<Vid>(capacity(off)) << 32;
+    free_[cls].push_back(off);
+  }
+  void set_size(uint32_t off, uint32_t n) noexcept {
+    words_[off] = (static_cast<Vid>(capacity(off)) << 32) | n;
+  }
+  // Appends v; the caller guarantees !contains(off, v) && size < capacity.
+  void push(uint32_t off, Vid v) noexcept {
+    data(off)[size(off)] = v;
+    ++words_[off];
+  }
+  bool erase(uint32_t off, Vid v) noexcept {
+    Vid *p = data(off);
+    const uint32_t n = size(off);
+    for (uint32_t i = 0; i < n; ++i) {
+      if (p[i] == v) {
+        p[i] = p[n - 1]; // order is not significant, swap-remove
+        --words_[off];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return words_.empty(); }
+  [[nodiscard]] const std::vector<Vid> &words() const noexcept {
+    return words_;
+  }
+  // Raw arena access for load/save. Free lists are not persisted: a reloaded
+  // arena keeps its holes until it is rebuilt.
+  [[nodiscard]] std::vector<Vid> &raw_words() noexcept { return words_; }
+  void clear() noexcept {
+    words_.clear();
+    free_.clear();
+  }
+
+private:
+  std::vector<Vid> words_;
+  std::vector<std::vector<uint32_t>> free_; // by log2(capacity)
+};
+
+// Both overflow tiers of a Graph. An entry with use_overflow set resolves its
+// overflow_idx here: kOverflowSlabBit selects the slab chunk, otherwise it
+// indexes the hash-set vector.
+struct Overflow_store {
+  OverflowVec sets;
+  Overflow_slab slab;
+
+  [[nodiscard]] static bool is_slab(uint32_t idx) noexcept {
+    return (idx & kOverflowSlabBit) != 0;
+  }
+  [[nodiscard]] static uint32_t slab_off(uint32_t idx) noexcept {
+    return idx & ~kOverflowSlabBit;
+  }
+  [[nodiscard]] size_t size_of(uint32_t idx) const noexcept {
+    return is_slab(idx) ? slab.size(slab_off(idx)) : sets[idx].size();
+  }
+  [[nodiscard]] bool empty() const noexcept {
+    return sets.empty() && slab.empty();
+  }
+  // Visits every Vid of the overflow set `idx` regardless of tier. An fn
+  // returning bool stops the walk by returning true; for_each then returns
+  // true as well.
+  template <typename Fn> bool for_each(uint32_t idx, Fn &&fn) const {
+    const auto step = [&fn](Vid v) {
+      if constexpr (std::is_same_v<std::invoke_result_t<Fn &, Vid>, bool>) {
+        return fn(v);
+      } else {
+        fn(v);
+        return false;
+      }
+    };
+    if (is_slab(idx)) {
+      const Vid *p = slab.data(slab_off(idx));
+      const Vid *e = p + slab.size(slab_off(idx));
+      for (; p != e; ++p) {
+        if (step(*p)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    for (const Vid v : sets[idx]) {
+      if (step(v)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  void clear() noexcept {
+    sets.clear();
+    slab.clear();
+  }
+};
+
 // Writer-preferring shared mutex.
 //
 // libstdc++'s std::shared_mutex wraps a glibc pthread_rwlock with the default
@@ -109,8 +260,8 @@ private:
 };
 
 // Forward iterator over the edges of a node or pin. Two modes:
-//   - Inline: walks a contiguous buffer owned by the EdgeRange (decoded sedges
-//   + ledges).
+//   - Contiguous: walks a Vid array -- the buffer owned by the EdgeRange
+//   (decoded sedges + ledges) or a small-vector chunk of the Overflow_slab.
 //   - Overflow: walks the OverflowSet (unordered_dense::set<Vid>) in-place, no
 //   copy.
 class EdgeIterator {
@@ -160,22 +311,104 @@ private:
 };
 
 struct OverflowPool {
-  OverflowVec &sets;
+  Overflow_store &store;
   std::vector<uint32_t> &free_list;
+  uint32_t promote_threshold = kDefaultOverflowPromoteThreshold;
 
+  // Hash-set tier slot.
   uint32_t alloc() {
     if (!free_list.empty()) {
       uint32_t idx = free_list.back();
       free_list.pop_back();
-      sets[idx].clear();
+      store.sets[idx].clear();
+      return idx;
+    }
+    store.sets.emplace_back();
+    return static_cast<uint32_t>(store.sets.size() - 1);
+  }
+
+  // First spill out of the inline slots: a slab chunk when `n` edges fit under
+  // the promotion threshold, a hash set otherwise.
+  uint32_t alloc_for(size_t n) {
+    if (promote_threshold != 0 && n <= promote_threshold) {
+      const auto cap = std::max<uint32_t>(Overflow_slab::kMinChunk,
+                                          static_cast<uint32_t>(n));
+      return store.slab.alloc(std::min(cap, std::bit_ceil(promote_threshold))) |
+             kOverflowSlabBit;
+    }
+    return alloc();
+  }
+
+  // Inserts v into set `idx` (set semantics). Returns the possibly relocated
+  // index: a full chunk grows to the next capacity class, or is promoted to a
+  // hash set once it would exceed promote_threshold.
+  uint32_t insert(uint32_t idx, Vid v) {
+    if (!Overflow_store::is_slab(idx)) {
+      store.sets[idx].insert(v);
+      return idx;
+    }
+    auto &slab = store.slab;
+    const uint32_t off = Overflow_store::slab_off(idx);
+    if (slab.contains(off, v)) {
+      return idx;
+    }
+    const uint32_t n = slab.size(off);
+    if (n < slab.capacity(off) && n < promote_threshold) {
+      slab.push(off, v);
+      return idx;
+    }
+    uint32_t next = 0;
+    if (n + 1 > promote_threshold) {
+      next = alloc();
+      auto &hs = store.sets[next];
+      hs.reserve(n + 1);
+      hs.insert(slab.data(off), slab.data(off) + n);
+      hs.insert(v);
+    } else {
+      const uint32_t grown = slab.alloc(slab.capacity(off) * 2);
+      // Re-read data(off) after alloc: growing the arena may reallocate it.
+      std::copy_n(slab.data(off), n, slab.data(grown));
+      slab.set_size(grown, n);
+      slab.push(grown, v);
+      next = grown | kOverflowSlabBit;
+    }
+    slab.free(off);
+    return next;
+  }
+
+  // Hash sets that shrank to half the promotion threshold move back to a slab
+  // chunk (hysteresis against churn at the threshold). Returns the new index.
+  uint32_t shrink(uint32_t idx) {
+    if (Overflow_store::is_slab(idx) || promote_threshold == 0) {
+      return idx;
+    }
+    const auto &hs = store.sets[idx];
+    if (hs.size() > promote_threshold / 2) {
       return idx;
     }
-    sets.emplace_back();
-    return static_cast<uint32_t>(sets.size() - 1);
+    const uint32_t off = store.slab.alloc(
+        std::max<uint32_t>(Overflow_slab::kMinChunk,
+                           static_cast<uint32_t>(hs.size())));
+    for (const Vid v : store.sets[idx]) {
+      store.slab.push(off, v);
+    }
+    free(idx);
+    return off | kOverflowSlabBit;
+  }
+
+  bool erase(uint32_t idx, Vid v) {
+    if (Overflow_store::is_slab(idx)) {
+      return store.slab.erase(Overflow_store::slab_off(idx), v);
+    }
+    return store.sets[idx].erase(v) != 0;
   }
 
   void free(uint32_t idx) {
-    sets[idx].clear();
+    if (Overflow_store::is_slab(idx)) {
+      store.slab.free(Overflow_store::slab_off(idx));
+      return;
+    }
+    store.sets[idx].clear();
     free_list.push_back(idx);
   }
 };
@@ -198,10 +431,13 @@ class BackwardClassRange;
 class Hier_instance;
 class OutEdgeIterator;
 class OutEdgeRange;
+class InpEdgeIterator;
+class InpEdgeRange;
 class Subnode_group;
 class Subnode_occurrence;
 class SubnodeOccurrenceRange;
 class Body_view;
+class Csr_view;
 class Definitions_view;
 class Grouped_hierarchy_view;
 class Occurrences_view;
@@ -210,6 +446,7 @@ class Occurrence_node;
 class Occurrence_pin;
 class Occurrence_edge;
 class OccurrenceNodeRange;
+class OccurrenceRefRange;
 class ReachablePinRange;
 
 // Compact subnode-loop domain. Carries deliberately do not live here: they
@@ -346,10 +583,10 @@ public:
   // It is a view over live storage: snapshot before mutating during iteration
   // (see OutEdgeRange docs).
   [[nodiscard]] OutEdgeRange out_edges() const;
-  // inp_edges() stays eager: a sink's fan-in is small (usually a single
-  // driver), so the heap-free InlinedVector is the right shape; [4] inline
-  // covers it.
-  [[nodiscard]] absl::InlinedVector<Edge_class, 4> inp_edges() const;
+  // inp_edges() is the lazy mirror of out_edges() (see InpEdgeRange): most
+  // sinks have a single driver, but wide reductions, muxes and output ports
+  // can have hundreds, and backward passes ask every sink.
+  [[nodiscard]] InpEdgeRange inp_edges() const;
   // Drivers feeding this sink pin (the far end of each inp edge). A sink's
   // fan-in is small — usually a single driver in a well-formed net — so this
   // materializes into the same heap-free InlinedVector the other pin/node
@@ -357,10 +594,24 @@ public:
   // huge, so there is no eager get_sink_pins() companion here.
   [[nodiscard]] absl::InlinedVector<Pin_class, 4> get_driver_pins() const;
 
+  // Key for the keyed bulk attribute helpers (Attr_host::attr_fill, ...).
+  [[nodiscard]] constexpr Attr_key get_attr_key() const noexcept {
+    return make_pin_attr_key(
+        static_cast<uint64_t>(pin_pid & ~static_cast<Pid>(2)));
+  }
+  // Position in Attr_host::attr_span(tag, get_attr_column()): the pin table
+  // index, or the node's for a port-0 (node-as-pin) handle.
+  [[nodiscard]] constexpr Attr_column get_attr_column() const noexcept {
+    return (pin_pid & static_cast<Pid>(1)) != 0 ? Attr_column::Pin
+                                                : Attr_column::Node_pin;
+  }
+  [[nodiscard]] constexpr size_t get_attr_slot() const noexcept {
+    return static_cast<size_t>(pin_pid >> 2);
+  }
+
   template <Attribute Tag> [[nodiscard]] AttrRef<Tag> attr(Tag = {}) const {
     assert(graph_ != nullptr && "attr: pin is not attached to a graph");
-    const auto flat_key = make_pin_attr_key(
-        static_cast<uint64_t>(pin_pid & ~static_cast<Pid>(2)));
+    const auto flat_key = get_attr_key();
     if (context_ == Handle_context::Hier) {
       return AttrRef<Tag>(graph_, flat_key, hier_pos_);
     }
@@ -393,6 +644,7 @@ private:
   friend class Node_class;
   friend class OutEdgeIterator; // builds/stamps driver+sink pins while walking
                                 // out edges
+  friend class InpEdgeIterator; // same, for inp edges
   friend void inherit_pin_context(Pin_class &pin, const Node_class &node);
 };
 
@@ -502,7 +754,8 @@ public:
   // In Class/Flat context this walks live storage on demand; in Hier context it
   // resolves cross-boundary edges (materialized) behind the same range type.
   [[nodiscard]] OutEdgeRange out_edges() const;
-  [[nodiscard]] absl::InlinedVector<Edge_class, 4> inp_edges() const;
+  // Lazy in-edge view (see InpEdgeRange); same Hier-context rule as above.
+  [[nodiscard]] InpEdgeRange inp_edges() const;
   [[nodiscard]] absl::InlinedVector<Pin_class, 4> out_pins() const;
   [[nodiscard]] absl::InlinedVector<Pin_class, 4> inp_pins() const;
   // Fast boolean predicates — avoid materializing the full edge vector when
@@ -511,10 +764,19 @@ public:
   [[nodiscard]] bool has_out_edges() const;
   [[nodiscard]] bool has_inp_edges() const;
 
+  // Key for the keyed bulk attribute helpers (Attr_host::attr_fill, ...).
+  [[nodiscard]] constexpr Attr_key get_attr_key() const noexcept {
+    return make_node_attr_key(
+        static_cast<uint64_t>(raw_nid & ~static_cast<Nid>(3)));
+  }
+  // Position in Attr_host::attr_span(tag): the node table index.
+  [[nodiscard]] constexpr size_t get_attr_slot() const noexcept {
+    return static_cast<size_t>(raw_nid >> 2);
+  }
+
   template <Attribute Tag> [[nodiscard]] AttrRef<Tag> attr(Tag = {}) const {
     assert(graph_ != nullptr && "attr: node is not attached to a graph");
-    const auto flat_key = make_node_attr_key(
-        static_cast<uint64_t>(raw_nid & ~static_cast<Nid>(3)));
+    const auto flat_key = get_attr_key();
     if (context_ == Context::Hier) {
       return AttrRef<Tag>(graph_, flat_key, hier_pos_);
     }
@@ -897,6 +1159,58 @@ using InstanceGroupRange = Hierarchy_entity_range<Hier_instance>;
 using Definition_node = Node_class;
 using DefinitionNodeRange = Entity_range<Definition_node>;
 
+// Compact, trivially copyable occurrence handle: the node's body and slot
+// plus the view's interned path ids (Occurrence_path::interned_handle). It
+// holds no references, so storing or copying it costs no refcount traffic.
+// Ids are interned per view: compare refs and resolve() them only with the
+// view that produced them; use get_occurrence_index() for keys that outlive
+// it. resolve() throws std::out_of_range for an invalid ref or one whose ids
+// the view never interned; a foreign ref whose ids happen to be in range is
+// not detected and resolves to an unrelated occurrence.
+struct Occurrence_ref {
+  Graph *graph = nullptr;
+  Nid nid = 0;
+  uint32_t path = 0;      // identity path (the call path for a call site)
+  uint32_t container = 0; // path of the body the node sits in
+
+  [[nodiscard]] bool is_valid() const noexcept { return graph != nullptr; }
+  [[nodiscard]] bool operator==(const Occurrence_ref &) const noexcept =
+      default;
+
+  template <typename H> friend H AbslHashValue(H h, const Occurrence_ref &x) {
+    return H::combine(std::move(h), x.graph, x.nid, x.path);
+  }
+};
+static_assert(std::is_trivially_copyable_v<Occurrence_ref>);
+
+// hier_storage ref for an object at `path`. When the host already interned
+// the path (it holds some hier attribute there) the ref is just the 16-byte
+// key, found with one probe per step and no allocation; otherwise the steps
+// are kept so that a set() can intern them.
+template <Attribute Tag>
+[[nodiscard]] AttrRef<Tag> occurrence_attr_ref(Attr_host *host,
+                                               Attr_key flat_key,
+                                               const Occurrence_path &path) {
+  const auto steps = path.steps();
+  if (const auto *paths = host->hier_paths(); paths != nullptr) {
+    uint32_t id = paths->find_root(path.root_gid());
+    for (const auto &step : steps) {
+      id = paths->find_child(
+          id, Hier_attr_step{step.subnode.gid, step.subnode.value, step.ordinal});
+    }
+    if (id != 0) {
+      return AttrRef<Tag>(host, Hier_attr_key{id, flat_key});
+    }
+  }
+  std::vector<Hier_attr_step> owned;
+  owned.reserve(steps.size());
+  for (const auto &step : steps) {
+    owned.push_back(
+        Hier_attr_step{step.subnode.gid, step.subnode.value, step.ordinal});
+  }
+  return AttrRef<Tag>(host, flat_key, path.root_gid(), std::move(owned));
+}
+
 // Read-only physical/grouped node handle. Structural rewrites are available
 // only after the caller explicitly asks for base_node().
 class Occurrence_node {
@@ -905,6 +1219,11 @@ public:
 
   [[nodiscard]] Node_class base_node() const { return node_; }
   [[nodiscard]] const Occurrence_path &path() const noexcept { return path_; }
+  [[nodiscard]] Occurrence_ref ref() const noexcept {
+    return Occurrence_ref{node_.get_graph(), node_.get_debug_nid(),
+                          path_.interned_handle(),
+                          container_path_.interned_handle()};
+  }
   [[nodiscard]] Occurrence_index get_occurrence_index() const noexcept {
     return Occurrence_index{path_, node_.get_definition_index()};
   }
@@ -964,16 +1283,11 @@ public:
     static_assert(std::is_same_v<typename Tag::storage, hier_storage>,
                   "Occurrence_node::attr requires a hier_storage attribute "
                   "tag; use base_node().attr() for class storage");
-    std::vector<Hier_attr_step> steps;
-    steps.reserve(path_.steps().size());
-    for (const auto &step : path_.steps()) {
-      steps.push_back(
-          Hier_attr_step{step.subnode.gid, step.subnode.value, step.ordinal});
-    }
-    return AttrRef<Tag>(node_.get_graph(),
-                        make_node_attr_key(static_cast<uint64_t>(
-                            node_.get_debug_nid() & ~static_cast<Nid>(3))),
-                        path_.root_gid(), std::move(steps));
+    return occurrence_attr_ref<Tag>(
+        node_.get_graph(),
+        make_node_attr_key(
+            static_cast<uint64_t>(node_.get_debug_nid() & ~static_cast<Nid>(3))),
+        path_);
   }
 
   [[nodiscard]] bool operator==(const Occurrence_node &other) const noexcept {
@@ -1050,16 +1364,11 @@ public:
     static_assert(std::is_same_v<typename Tag::storage, hier_storage>,
                   "Occurrence_pin::attr requires a hier_storage attribute tag; "
                   "use base_pin().attr() for class storage");
-    std::vector<Hier_attr_step> steps;
-    steps.reserve(path_.steps().size());
-    for (const auto &step : path_.steps()) {
-      steps.push_back(
-          Hier_attr_step{step.subnode.gid, step.subnode.value, step.ordinal});
-    }
-    return AttrRef<Tag>(pin_.get_graph(),
-                        make_pin_attr_key(static_cast<uint64_t>(
-                            pin_.get_debug_pid() & ~static_cast<Pid>(2))),
-                        path_.root_gid(), std::move(steps));
+    return occurrence_attr_ref<Tag>(
+        pin_.get_graph(),
+        make_pin_attr_key(
+            static_cast<uint64_t>(pin_.get_debug_pid() & ~static_cast<Pid>(2))),
+        path_);
   }
 
   [[nodiscard]] bool operator==(const Occurrence_pin &other) const noexcept {
@@ -1236,6 +1545,104 @@ using Instance_group = Hier_instance;
 using Node = Node_class;
 using Pin = Pin_class;
 
+// Old -> new id translation returned by Graph::compact(). Both tables are
+// indexed by the OLD table index (raw id >> 2) and hold the new index; 0 marks
+// a tombstoned entity that compaction dropped.
+struct Graph_remap {
+  std::vector<Nid> nodes;
+  std::vector<Pid> pins;
+
+  // Translate a raw Nid / Pid / Vid, keeping its role bits (bit 0 = pin,
+  // bit 1 = driver). Returns 0 for a dropped or out-of-range id.
+  [[nodiscard]] Vid remap(Vid old_id) const noexcept {
+    const auto &table = (old_id & static_cast<Vid>(1)) ? pins : nodes;
+    const uint64_t idx = old_id >> 2;
+    if (idx >= table.size() || table[idx] == 0) {
+      return 0;
+    }
+    return (table[idx] << 2) | (old_id & static_cast<Vid>(3));
+  }
+  [[nodiscard]] Class_index remap(Class_index old_idx) const noexcept {
+    return Class_index{remap(old_idx.value)};
+  }
+  // True when nothing moved (no tombstones were present).
+  [[nodiscard]] bool is_identity() const noexcept;
+};
+
+// Where a graph's stored edge endpoints live (each edge counts once per
+// endpoint). short_edges fit a 16-bit delta slot, long_edges spilled to
+// ledge0/ledge1; slab_* and hash_* are the overflow tiers.
+struct Edge_tier_stats {
+  uint64_t short_edges = 0;
+  uint64_t long_edges = 0;
+  uint64_t slab_sets = 0;
+  uint64_t slab_edges = 0;
+  uint64_t hash_sets = 0;
+  uint64_t hash_edges = 0;
+
+  [[nodiscard]] uint64_t total_edges() const noexcept {
+    return short_edges + long_edges + slab_edges + hash_edges;
+  }
+};
+
+// Approximate heap bytes held by one graph body (Graph::memory_stats).
+// Container figures are capacity based; node_table / pin_table count the used
+// entries and table_slack the reserved-but-unused tail of both.
+struct Graph_memory_stats {
+  uint64_t node_table = 0;
+  uint64_t pin_table = 0;
+  uint64_t table_slack = 0;
+  uint64_t overflow_slab = 0;    // arena words
+  uint64_t overflow_sets = 0;    // hash-set values + bucket arrays
+  uint64_t traversal_caches = 0; // forward/backward caches + CSR snapshot
+  uint64_t side_tables = 0;      // port/constant indexes, subnode and IO maps
+  uint64_t attr_stores = 0;      // sum over attrs
+  uint64_t source_locator = 0;   // per-graph delta only
+  uint64_t hierarchy_tree = 0;
+  std::vector<Attr_store_stats> attrs;
+  Edge_tier_stats edges;
+  // The overflow sets were still pending a lazy load: their bytes are the
+  // empty shells and edges leaves out the slab / hash tiers.
+  bool overflow_deferred = false;
+
+  [[nodiscard]] uint64_t total_bytes() const noexcept {
+    return node_table + pin_table + table_slack + overflow_slab +
+           overflow_sets + traversal_caches + side_tables + attr_stores +
+           source_locator + hierarchy_tree;
+  }
+  // Field-wise sum; attrs entries with the same persistent_id are merged.
+  Graph_memory_stats &operator+=(const Graph_memory_stats &o);
+  // One `key=value` line, suitable for logs.
+  void print(std::ostream &os) const;
+};
+
+// GraphLibrary::memory_stats: the sum over materialized bodies plus the
+// library source map. Bodies still pending a lazy load cost nothing yet and
+// are only counted.
+struct Library_memory_stats {
+  uint64_t graphs = 0;
+  uint64_t pending_graphs = 0;
+  uint64_t source_map = 0;
+  Graph_memory_stats bodies;
+
+  [[nodiscard]] uint64_t total_bytes() const noexcept {
+    return bodies.total_bytes() + source_map;
+  }
+  void print(std::ostream &os) const;
+};
+
+// Node order used by Graph::relayout. bfs: breadth-first from each component
+// in storage order. rcm: reverse Cuthill-McKee (min-degree seeds, neighbours
+// by ascending degree, order reversed), which keeps the bandwidth -- and so
+// the edge deltas -- smallest.
+enum class Relayout_order : uint8_t { bfs, rcm };
+
+struct Relayout_result {
+  Graph_remap remap;
+  Edge_tier_stats before;
+  Edge_tier_stats after;
+};
+
 class GraphLibrary;
 
 class Graph : public Attr_host {
@@ -1250,8 +1657,16 @@ class Graph : public Attr_host {
     [[nodiscard]] Nid get_master_nid() const { return master_nid; }
     [[nodiscard]] Port_id get_port_id() const { return port_id; }
     auto add_edge(Pid self_id, Pid other_id, OverflowPool &pool) -> bool;
+    // Batch of edges for this endpoint: spills once, straight into the tier
+    // sized for the final count, when the batch cannot stay inline.
+    void add_edges(Pid self_id, std::span<const Vid> others,
+                   OverflowPool &pool);
     auto delete_edge(Pid self_id, Pid other_id, OverflowPool &pool) -> bool;
     [[nodiscard]] bool has_edges() const;
+    // Any edge in one direction (`back`: self is the sink). Inline entries
+    // answer from the slot masks without decoding a delta.
+    [[nodiscard]] bool has_dir_edges(Pid self_id, bool back,
+                                     const Overflow_store &overflow) const noexcept;
     [[nodiscard]] Pid get_next_pin_id() const { return next_pin_id; }
     void set_next_pin_id(Pid id) { next_pin_id = id; }
     [[nodiscard]] bool check_overflow() const { return use_overflow; }
@@ -1268,7 +1683,7 @@ class Graph : public Attr_host {
       using iterator = EdgeIterator;
 
       EdgeRange(const PinEntry *pin, Pid pid,
-                const OverflowVec &overflow) noexcept;
+                const Overflow_store &overflow) noexcept;
       // begin()/end() hand out iterators into inline_buf_, which lives inside
       // this object. Copying/moving an EdgeRange would dangle those iterators,
       // so forbid it — range-for and `auto r = get_edges(...)` still compile
@@ -1279,26 +1694,38 @@ class Graph : public Attr_host {
       EdgeRange &operator=(EdgeRange &&) = delete;
 
       iterator begin() const noexcept {
-        return overflow_set_ ? iterator(overflow_set_->begin())
-                             : iterator(inline_buf_.data());
+        if (overflow_set_) {
+          return iterator(overflow_set_->begin());
+        }
+        return iterator(slab_ ? slab_ : inline_buf_.data());
       }
       iterator end() const noexcept {
-        return overflow_set_ ? iterator(overflow_set_->end())
-                             : iterator(inline_buf_.data() + inline_count_);
+        if (overflow_set_) {
+          return iterator(overflow_set_->end());
+        }
+        return slab_ ? iterator(slab_ + slab_count_)
+                     : iterator(inline_buf_.data() + inline_count_);
       }
 
     private:
       std::array<Vid, kInlineMax> inline_buf_{};
       const OverflowSet *overflow_set_ = nullptr;
+      const Vid *slab_ = nullptr; // small-vector tier chunk, walked in place
+      uint32_t slab_count_ = 0;
       uint8_t inline_count_ = 0;
     };
     [[nodiscard]] auto get_edges(Pid pid,
-                                 const OverflowVec &overflow) const noexcept
+                                 const Overflow_store &overflow) const noexcept
         -> EdgeRange;
 
   private:
     auto overflow_handling(Pid self_id, Vid other_id, OverflowPool &pool)
         -> bool;
+    auto insert_inline(Pid self_id, Vid other_id) -> bool;
+    void demote_if_small(Pid self_id, OverflowPool &pool);
+    // Overflow sets at or below this size move back inline (hysteresis: half
+    // the inline capacity).
+    static constexpr size_t kDemoteMax = EdgeRange::kInlineMax / 2;
 
     Nid master_nid : Nid_bits;   // 42 bits
     Port_id port_id : Port_bits; // 22 bits    => 64 bits (8 bytes)
@@ -1311,8 +1738,8 @@ class Graph : public Attr_host {
 
     union {
       int64_t sedges; // 4 × 16-bit packed slots (when use_overflow == 0)
-      uint32_t overflow_idx; // index into Graph::overflow_sets_ (when
-                             // use_overflow == 1)
+      uint32_t overflow_idx; // Overflow_store index (when use_overflow == 1),
+                             // kOverflowSlabBit selects the slab tier
     } sedges_;               // Total: 8 bytes
   };
 
@@ -1332,19 +1759,32 @@ class Graph : public Attr_host {
     [[nodiscard]] bool is_loop_break() const noexcept {
       return (type & 1u) != 0u;
     }
-    [[nodiscard]] Pid get_next_pin_id() const { return next_pin_id; }
-    void set_next_pin_id(Pid id) { next_pin_id = id; }
-    [[nodiscard]] bool has_edges(const OverflowVec &overflow) const;
+    [[nodiscard]] Pid get_next_pin_id() const {
+      return next_pin_id & ~kSubnodeFlag;
+    }
+    void set_next_pin_id(Pid id) {
+      next_pin_id = (id & ~kSubnodeFlag) | (next_pin_id & kSubnodeFlag);
+    }
+    [[nodiscard]] bool has_edges(const Overflow_store &overflow) const;
+    [[nodiscard]] bool has_dir_edges(Nid self_id, bool back,
+                                     const Overflow_store &overflow)
+        const noexcept; // see PinEntry::has_dir_edges
     auto add_edge(Pid self_id, Pid other_id, OverflowPool &pool) -> bool;
+    void add_edges(Nid self_id, std::span<const Vid> others,
+                   OverflowPool &pool); // see PinEntry::add_edges
     auto delete_edge(Pid self_id, Pid other_id, OverflowPool &pool) -> bool;
     [[nodiscard]] bool check_overflow() const { return use_overflow; }
     [[nodiscard]] uint32_t get_overflow_idx() const {
       return sedges_.overflow_idx;
     }
 
-    void set_subnode(Nid self_nid, Gid gid, OverflowPool &pool);
-    [[nodiscard]] Gid get_subnode() const noexcept;
-    [[nodiscard]] bool has_subnode() const noexcept;
+    // Subnode instances are flagged in bit 1 of next_pin_id, which is always
+    // 0 in the canonical Pid stored there. The target Gid lives in
+    // Graph::subnode_gid_, so instance nodes keep the inline edge slots.
+    void set_subnode_flag() noexcept { next_pin_id |= kSubnodeFlag; }
+    [[nodiscard]] bool has_subnode() const noexcept {
+      return (next_pin_id & kSubnodeFlag) != 0;
+    }
 
     static constexpr size_t MAX_EDGES = 8;
 
@@ -1356,7 +1796,7 @@ class Graph : public Attr_host {
       using iterator = EdgeIterator;
 
       EdgeRange(const NodeEntry *node, Nid nid,
-                const OverflowVec &overflow) noexcept;
+                const Overflow_store &overflow) noexcept;
       // See PinEntry::EdgeRange: iterators point into inline_buf_, so copy/move
       // would dangle. Prvalue return + copy elision keep all callers valid.
       EdgeRange(const EdgeRange &) = delete;
@@ -1365,32 +1805,44 @@ class Graph : public Attr_host {
       EdgeRange &operator=(EdgeRange &&) = delete;
 
       iterator begin() const noexcept {
-        return overflow_set_ ? iterator(overflow_set_->begin())
-                             : iterator(inline_buf_.data());
+        if (overflow_set_) {
+          return iterator(overflow_set_->begin());
+        }
+        return iterator(slab_ ? slab_ : inline_buf_.data());
       }
       iterator end() const noexcept {
-        return overflow_set_ ? iterator(overflow_set_->end())
-                             : iterator(inline_buf_.data() + inline_count_);
+        if (overflow_set_) {
+          return iterator(overflow_set_->end());
+        }
+        return slab_ ? iterator(slab_ + slab_count_)
+                     : iterator(inline_buf_.data() + inline_count_);
       }
 
     private:
       std::array<Vid, kInlineMax> inline_buf_{};
       const OverflowSet *overflow_set_ = nullptr;
+      const Vid *slab_ = nullptr; // small-vector tier chunk, walked in place
+      uint32_t slab_count_ = 0;
       uint8_t inline_count_ = 0;
     };
 
     [[nodiscard]] auto get_edges(Nid nid,
-                                 const OverflowVec &overflow) const noexcept
+                                 const Overflow_store &overflow) const noexcept
         -> EdgeRange;
 
   private:
+    static constexpr Pid kSubnodeFlag = 2;
+
     void clear_node();
     auto overflow_handling(Nid self_id, Vid other_id, OverflowPool &pool)
         -> bool;
+    auto insert_inline(Nid self_id, Vid other_id) -> bool;
+    void demote_if_small(Nid self_id, OverflowPool &pool);
+    static constexpr size_t kDemoteMax = EdgeRange::kInlineMax / 2;
 
     // Layout (packed, 32 bytes):
     //   type            : 16 bits
-    //   next_pin_id     : 42 bits
+    //   next_pin_id     : 42 bits  (bit 1 = has_subnode flag)
     //   ledge0          : 42 bits
     //   ledge1          : 42 bits
     //   use_overflow    :  1 bit
@@ -1406,8 +1858,8 @@ class Graph : public Attr_host {
     uint64_t sedges_extra : 48;
     union {
       int64_t sedges;        // low-4 slots of 16 bits (fills 64 bits exactly)
-      uint32_t overflow_idx; // index into Graph::overflow_sets_ (when
-                             // use_overflow == 1)
+      uint32_t overflow_idx; // Overflow_store index (when use_overflow == 1),
+                             // kOverflowSlabBit selects the slab tier
     } sedges_;               // 8 bytes
   };
 
@@ -1457,6 +1909,51 @@ public:
   void abort();
 
   [[nodiscard]] bool is_frozen() const noexcept { return frozen_; }
+
+  // Edge sets that outgrow the inline slots spill first into the small-vector
+  // slab tier and are promoted to a hash set once they hold more than this
+  // many edges. 0 disables the slab tier. Only affects later transitions;
+  // sets already in a tier stay there.
+  void set_overflow_promote_threshold(uint32_t n) noexcept {
+    overflow_promote_threshold_ = n;
+  }
+  [[nodiscard]] uint32_t overflow_promote_threshold() const noexcept {
+    return overflow_promote_threshold_;
+  }
+
+  // Bulk edge construction. Connects every (driver, sink) pair like
+  // driver.connect_sink(sink), but groups the half-edges by endpoint so each
+  // entry settles its storage tier once (no inline fill followed by a spill
+  // and per-edge slab growth), and invalidates the traversal caches once at
+  // the end instead of patching them per edge.
+  void add_edges(std::span<const std::pair<Pin_class, Pin_class>> edges);
+  // Pre-size the node / pin tables (totals, built-ins included) ahead of a
+  // bulk import, so create_node / create_*_pin do not reallocate mid-build.
+  void reserve(size_t node_count, size_t pin_count = 0);
+
+  // Tombstone garbage collection. Renumbers the live nodes and pins densely
+  // (relative order and the built-in INPUT/OUTPUT/CONST nodes are kept),
+  // rebuilds edge storage, and rekeys the attr stores, subnode side tables
+  // and IO pin maps. Hier attrs recorded through this graph's instances are
+  // rekeyed in every materialized graph of the library; bodies still pending
+  // a lazy load are not touched, so materialize them first. Opt-in: every
+  // held Node/Pin handle and Class_index is stale afterwards -- translate
+  // them through the returned map.
+  Graph_remap compact();
+  // Locality renumbering: compact() plus a node order that places connected
+  // nodes next to each other (pins follow their owner), so more edges fit the
+  // 16-bit delta slots instead of ledges / overflow sets. Same handle and
+  // Class_index caveats as compact(); reports tier stats before and after.
+  Relayout_result relayout(Relayout_order order = Relayout_order::rcm);
+  [[nodiscard]] Edge_tier_stats edge_tier_stats() const;
+  // Bytes held by this body, by component, plus the edge tier counts. Does
+  // not trigger a deferred overflow load (see overflow_deferred).
+  [[nodiscard]] Graph_memory_stats memory_stats() const;
+  // Immutable CSR snapshot of this body (see Csr_view). Cached and shared
+  // until the library mutation epoch moves; concurrent readers share one
+  // build. Do not call while another thread mutates the graph.
+  [[nodiscard]] std::shared_ptr<const Csr_view> freeze_csr() const;
+
   [[nodiscard]] Pin_class get_input_pin(std::string_view name) const;
   [[nodiscard]] Pin_class get_output_pin(std::string_view name) const;
 
@@ -1552,19 +2049,28 @@ public:
 
 private:
   void attr_note_modified() noexcept override { dirty_ = true; }
+  // make_node_attr_key / make_pin_attr_key shift a raw id whose table index
+  // sits in bits 2+: key bits 0-2 are (pin key, raw pin bit, 0), so nodes,
+  // node-as-pin (port 0) and table pins land in columns 0, 1 and 3.
+  [[nodiscard]] Attr_key_space attr_key_space() const noexcept override {
+    return Attr_key_space{.column_bits = 3,
+                          .pin_column = 3,
+                          .node_slots = node_table.size(),
+                          .pin_slots = pin_table.size()};
+  }
   [[nodiscard]] OverflowPool get_overflow_pool() {
-    return {overflow_sets(), overflow_free_};
+    return {overflow_sets(), overflow_free_, overflow_promote_threshold_};
   }
   // Overflow-set CONTENTS accessor: materializes the deferred overflow read on
   // first use, so every edge path (get_edges / EdgeRange / has_edges) sees full
   // adjacency. The raw member is overflow_storage_ (load/save/clear only).
-  [[nodiscard]] OverflowVec &overflow_sets() {
+  [[nodiscard]] Overflow_store &overflow_sets() {
     if (overflow_deferred_) {
       ensure_overflow_loaded();
     }
     return overflow_storage_;
   }
-  [[nodiscard]] const OverflowVec &overflow_sets() const {
+  [[nodiscard]] const Overflow_store &overflow_sets() const {
     if (overflow_deferred_) {
       ensure_overflow_loaded();
     }
@@ -1578,6 +2084,11 @@ private:
   void assert_node_exists(const Node_class &node) const noexcept;
   void assert_pin_exists(const Pin_class &pin) const noexcept;
   [[nodiscard]] bool is_node_valid(Nid nid) const noexcept;
+  // Target Gid of subnode instance `nid`, Gid_invalid for any other node.
+  [[nodiscard]] Gid subnode_gid(Nid nid) const noexcept {
+    const auto it = subnode_gid_.find(nid & ~static_cast<Nid>(3));
+    return it != subnode_gid_.end() ? it->second : Gid_invalid;
+  }
   [[nodiscard]] bool is_pin_valid(Pid pid) const noexcept;
   [[nodiscard]] NodeEntry *ref_node(Nid id) const {
     assert_accessible();
@@ -1631,6 +2142,18 @@ private:
   [[nodiscard]] Pin_class append_driver_pin(Node_class node, Port_id port_id,
                                             Pid tail_pin);
   void rebuild_constant_pin_index(Port_id first_payload_port);
+  // Port index helpers (see port_index_). port_list returns nullptr for a
+  // node below the threshold; callers then walk the next_pin_id list.
+  [[nodiscard]] const std::vector<std::pair<Port_id, Pid>> *
+  port_list(Nid self_nid) const;
+  [[nodiscard]] Pid port_index_find(Nid self_nid, Port_id port_id) const;
+  void index_new_pin(Nid self_nid, Port_id port_id, Pid canonical,
+                     size_t walked);
+  void unindex_pin(Nid self_nid, Port_id port_id, Pid canonical);
+  void build_port_index(Nid self_nid);
+  void rebuild_port_index();
+  // Shared tail of compact()/relayout(): rebuild storage under a dense remap.
+  void apply_renumbering(const Graph_remap &remap);
   [[nodiscard]] Port_id resolve_driver_port(Node_class node,
                                             std::string_view name) const;
   [[nodiscard]] Port_id resolve_sink_port(Node_class node,
@@ -1650,9 +2173,9 @@ private:
   }
   void del_edge(Pin_class driver_pin, Pin_class sink_pin);
   [[nodiscard]] OutEdgeRange out_edges(Node_class node);
-  [[nodiscard]] absl::InlinedVector<Edge_class, 4> inp_edges(Node_class node);
+  [[nodiscard]] InpEdgeRange inp_edges(Node_class node);
   [[nodiscard]] OutEdgeRange out_edges(Pin_class pin);
-  [[nodiscard]] absl::InlinedVector<Edge_class, 4> inp_edges(Pin_class pin);
+  [[nodiscard]] InpEdgeRange inp_edges(Pin_class pin);
   [[nodiscard]] absl::InlinedVector<Pin_class, 4> get_pins(Node_class node);
   [[nodiscard]] absl::InlinedVector<Pin_class, 4>
   get_driver_pins(Node_class node);
@@ -1666,20 +2189,63 @@ private:
   void set_name(std::string_view name) { name_ = name; }
   void
   invalidate_traversal_caches() noexcept; // defined inline at end of header
+  // A body edit no traversal cache depends on (a new pin, a type change that
+  // keeps the loop_break bit): moves the epoch, keeps the caches. Inline at
+  // end of header.
+  void note_body_edit() noexcept;
+  // Extends the caches with the slot create_node() just appended: no edges,
+  // not a loop_break, so it is ready at once in either direction.
+  void patch_traversal_caches_for_new_node() noexcept;
   // Incremental patch for a single edge add/delete. delta = +1 for add, -1 for
   // delete. Bumps forward_remaining_in_cache_[sink_idx] and
   // backward_remaining_out_cache_[driver_idx] using the same filters the cache
   // builder applies. Pass-2 caches are left intact — stale entries are already
-  // filtered by is_emitted() during replay. Falls back to full invalidation on
-  // unexpected underflow.
+  // filtered by is_emitted() during replay. A maintained emission order is
+  // repaired with reorder_for_edge(). Falls back to full invalidation on
+  // unexpected underflow or a new cycle.
   void patch_traversal_caches_for_edge(Vid driver_id, Vid sink_id,
                                        int32_t delta) noexcept;
   // Build (or refresh) the Pass-2 deferred list and the initial in-edge counts
-  // used by ordered body traversal. The full emission ordering
-  // is never materialized — only these two small caches persist.
+  // used by ordered body traversal. On an acyclic body the dry run's emission
+  // order is kept too (forward_order_cache_), and edge edits keep it valid.
   void ensure_forward_caches() const;
   // Exposed to the Forward iterator classes (which are friends).
   [[nodiscard]] bool forward_is_source(size_t idx) const noexcept;
+  // Visits the node index of each forward sink of driver_idx: the
+  // dependency edges ensure_forward_caches counts. Defined in graph.cpp. An
+  // fn returning bool stops the walk by returning true.
+  template <typename Fn>
+  void for_each_forward_sink(size_t driver_idx, Fn &&fn) const;
+  // The reverse walk: node index of each driver counted against sink_idx.
+  template <typename Fn>
+  void for_each_forward_driver(size_t sink_idx, Fn &&fn) const;
+  // Shared by both: the edge Vids of node idx and its pins in one direction
+  // (`back`: the entry is the sink), decoded straight from the slots and
+  // overflow sets. visit(Vid) returns true to stop; so does the walk.
+  template <typename Visit>
+  bool for_each_dir_edge(size_t idx, bool back, Visit &&visit) const;
+  // Pearce–Kelly repair of a maintained emission order for a new from -> to
+  // dependency (forward: driver -> sink; backward: sink -> driver). Only the
+  // nodes ranked between the two endpoints are visited and re-ranked; false
+  // when the edge closes a cycle.
+  [[nodiscard]] bool reorder_for_edge(std::vector<uint32_t> &order,
+                                      std::vector<uint32_t> &rank, size_t from,
+                                      size_t to, bool forward) const;
+
+  // Live user nodes and live loop_breaks among them, for the O(1) ordered
+  // range size(). Counted on first use, then patched by create_node() and
+  // delete_node(); invalidate_traversal_caches() drops them.
+  void ensure_node_counts() const;
+  [[nodiscard]] size_t ordered_node_count(bool loop_break_first,
+                                          bool loop_break_last) const;
+
+  // levels() cache: refreshes level_of_cache_ in full when !levels_valid_,
+  // then re-buckets it when level_buckets_stale_.
+  void ensure_level_caches() const;
+  // Raises levels downstream of a new driver -> sink edge; false when the
+  // edge closes a cycle (the caller then drops the level cache).
+  [[nodiscard]] bool raise_levels_from(size_t driver_idx,
+                                       size_t sink_idx) const;
 
   void ensure_backward_caches() const;
   // Exposed to the Backward iterator classes (which are friends).
@@ -1737,8 +2303,7 @@ private:
 
   // Local (single-graph) edge readers — the historical behavior, used directly
   // for Class/Flat handles and as the per-graph primitive by the hier readers.
-  [[nodiscard]] absl::InlinedVector<Edge_class, 4>
-  inp_edges_local(Node_class node);
+  [[nodiscard]] InpEdgeRange inp_edges_local(Node_class node);
   [[nodiscard]] absl::InlinedVector<Edge_class, 4>
   out_edges_local(Node_class node);
   // Hier readers: resolve each far endpoint across module boundaries.
@@ -1777,6 +2342,17 @@ private:
       by_hash.clear();
     }
   } constant_pin_index_;
+  // Per-node sorted (port_id, canonical Pid) mirror of the next_pin_id list,
+  // kept only for nodes with at least kPortIndexThreshold pins (memory macros,
+  // wide buses, blackbox IPs) so find_pin / find_or_create_pin /
+  // find_pin_or_zero binary-search instead of walking. The linked list stays
+  // authoritative: the index is built when an insertion walk reaches the
+  // threshold, patched on pin create/delete, and rebuilt from the pin table in
+  // rebuild_derived_after_body (it is not persisted). Readers never build it,
+  // so const lookups stay safe to share across threads.
+  static constexpr size_t kPortIndexThreshold = 32;
+  ankerl::unordered_dense::map<Nid, std::vector<std::pair<Port_id, Pid>>>
+      port_index_;
   // Edge-adjacency overflow sets. LAZY: load_body sizes this vector but defers
   // reading the set CONTENTS (the overflow.bin / overflow_<i>.bin files) until
   // an edge is actually traversed — a pure structure walk (body nodes + subnode
@@ -1784,9 +2360,28 @@ private:
   // to read them. Access the CONTENTS only via overflow_sets() (which ensures
   // the deferred read has happened); overflow_storage_ is the raw backing store
   // used by load/save/clear, which must NOT trigger a re-read.
-  OverflowVec overflow_storage_;
-  std::vector<uint32_t> overflow_free_;
-  mutable bool overflow_deferred_ = false;
+  Overflow_store overflow_storage_;
+  std::vector<uint32_t> overflow_free_; // free hash-set slots (slab keeps its own)
+  uint32_t overflow_promote_threshold_ = kDefaultOverflowPromoteThreshold;
+  // Validity bit of a lazily built read cache. Const readers test it without
+  // a lock (acquire load); the builder publishes it with a release store once
+  // the cache is complete. Mutators are single-threaded and use it like bool.
+  class Cache_flag {
+  public:
+    Cache_flag() noexcept = default;
+    Cache_flag(bool v) noexcept : v_(v) {}
+    operator bool() const noexcept {
+      return v_.load(std::memory_order_acquire);
+    }
+    Cache_flag &operator=(bool v) noexcept {
+      v_.store(v, std::memory_order_release);
+      return *this;
+    }
+
+  private:
+    std::atomic<bool> v_{false};
+  };
+  mutable Cache_flag overflow_deferred_;
   std::string overflow_src_dir_;
   // Persistent hierarchy: one Tree per Graph, populated by set_subnode and
   // torn down in clear()/load_body rebuild. The tree's children correspond
@@ -1794,6 +2389,8 @@ private:
   // Nid back to its Tree_pos so del_node / debug cycle checks can find it.
   std::shared_ptr<Tree> tree_;
   ankerl::unordered_dense::map<Nid, Tree_pos> subnode_tree_pos_;
+  // Target Gid of every subnode instance (NodeEntry::has_subnode flags them).
+  ankerl::unordered_dense::map<Nid, Gid> subnode_gid_;
   // Sparse native storage: ordinary nodes pay no per-node descriptor cost.
   ankerl::unordered_dense::map<Nid, Subnode_loop> subnode_loops_;
 #ifndef NDEBUG
@@ -1809,17 +2406,43 @@ private:
   // transfer the persisted per-graph presence bit without double-counting.
   bool loop_presence_counted_ = false;
   // Forward-traversal caches, shared by ordered body, definition, and hierarchy
-  // views for this graph body. Only the Pass-2 deferral list and the
-  // initial in-edge counts are kept — the Pass-1 emission order is replayed
-  // from storage order and the Tail from alive-but-unemitted survivors. No
-  // Node_class objects are cached, so memory is O(Pass2) + O(N × 4 bytes)
-  // rather than O(N × sizeof(Node_class)).
+  // views for this graph body. The Pass-2 deferral list and the initial
+  // in-edge counts drive the Pass-1/Pass-2/Tail replay. When the body is
+  // acyclic the emission order itself is kept as node indices (order + rank,
+  // O(N × 8 bytes)) and repaired per edge add, so an edit never forces the
+  // O(V+E) dry run again. No Node_class objects are cached.
   mutable std::vector<Nid> forward_pass2_cache_;
   mutable std::vector<uint32_t> forward_remaining_in_cache_;
-  mutable bool forward_caches_valid_ = false;
+  mutable Cache_flag forward_caches_valid_;
+  mutable std::vector<uint32_t> forward_order_cache_;
+  mutable std::vector<uint32_t> forward_rank_cache_;
+  mutable Cache_flag forward_order_valid_;
   mutable std::vector<Nid> backward_pass2_cache_;
   mutable std::vector<uint32_t> backward_remaining_out_cache_;
-  mutable bool backward_caches_valid_ = false;
+  mutable Cache_flag backward_caches_valid_;
+  mutable std::vector<uint32_t> backward_order_cache_;
+  mutable std::vector<uint32_t> backward_rank_cache_;
+  mutable Cache_flag backward_order_valid_;
+  mutable size_t live_node_count_ = 0;
+  mutable size_t loop_break_count_ = 0;
+  mutable Cache_flag node_counts_valid_;
+  // Body_view::levels() cache. level_of_cache_ (per node slot, kNoLevel when
+  // dead or behind a cycle) is authoritative and patched per edge add;
+  // level_nodes_cache_ / level_off_cache_ are its level-major buckets
+  // (unleveled nodes last), rebuilt from it when level_buckets_stale_.
+  mutable std::vector<uint32_t> level_of_cache_;
+  mutable std::vector<Nid> level_nodes_cache_;
+  mutable std::vector<uint32_t> level_off_cache_;
+  mutable Cache_flag levels_valid_;
+  mutable Cache_flag level_buckets_stale_;
+  // Serializes the slow path of the lazy builds above (ensure_*_caches,
+  // ensure_node_counts, ensure_overflow_loaded): concurrent readers that miss
+  // re-check under it, so each cache is built once. Recursive because the
+  // level build nests the forward build, which nests the overflow load.
+  mutable std::recursive_mutex cache_mu_;
+  // freeze_csr() cache; csr_mu_ serializes concurrent rebuilds.
+  mutable std::mutex csr_mu_;
+  mutable std::shared_ptr<const Csr_view> csr_cache_;
   ankerl::unordered_dense::map<std::string, Pid, Name_hash, Name_eq>
       input_pins_;
   ankerl::unordered_dense::map<std::string, Pid, Name_hash, Name_eq>
@@ -1854,8 +2477,11 @@ private:
   friend class Hier_instance;
   friend class OutEdgeIterator;
   friend class OutEdgeRange;
+  friend class InpEdgeIterator;
+  friend class InpEdgeRange;
   friend class Subnode_group;
   friend class Body_view;
+  friend class Csr_view;
   friend class Definitions_view;
   friend class Grouped_hierarchy_view;
   friend class Occurrences_view;
@@ -1916,18 +2542,27 @@ private:
   [[nodiscard]] Edge_class build_edge(Vid vid) const;
 
   [[nodiscard]] bool entry_at_end() const noexcept {
-    return is_overflow_ ? (ovf_it_ == ovf_end_) : (idx_ >= n_);
+    if (is_overflow_) {
+      return ovf_it_ == ovf_end_;
+    }
+    return slab_ ? (slab_it_ == slab_end_) : (idx_ >= n_);
   }
   [[nodiscard]] Vid entry_cur_vid() const noexcept {
-    return is_overflow_ ? *ovf_it_ : buf_[idx_];
+    if (is_overflow_) {
+      return *ovf_it_;
+    }
+    return slab_ ? *slab_it_ : buf_[idx_];
   }
   void entry_step() noexcept {
     if (is_overflow_) {
       ++ovf_it_;
+    } else if (slab_) {
+      ++slab_it_;
     } else {
       ++idx_;
     }
   }
+  void bind_overflow(uint32_t overflow_idx);
 
   Graph *graph_ = nullptr;
   Phase phase_ = Phase::End;
@@ -1965,6 +2600,10 @@ private:
   const OverflowSet *ovf_ = nullptr;
   OverflowSet::const_iterator ovf_it_{};
   OverflowSet::const_iterator ovf_end_{};
+  // Slab cursor: borrowed small-vector chunk (non-null => slab tier).
+  const Vid *slab_ = nullptr;
+  const Vid *slab_it_ = nullptr;
+  const Vid *slab_end_ = nullptr;
 
   // Hier-materialized backing (node in Hier context).
   std::shared_ptr<absl::InlinedVector<Edge_class, 4>> mat_;
@@ -2007,6 +2646,145 @@ private:
   friend class OutEdgeIterator;
 };
 
+// Lazy view over the INP edges of a pin or node; the mirror of OutEdgeRange
+// (same phase machine: node-as-pin entry, pin list, overflow walked in place).
+// Yields only back edges (vid bit 2 set) with the far end as the driver, and
+// stamps context exactly as the eager builder did. A node in Hier context is
+// backed by the cross-boundary-resolved snapshot. Same lifetime rules as
+// OutEdgeRange: snapshot before deleting edges while iterating.
+class InpEdgeIterator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = Edge_class;
+  using reference = Edge_class;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+
+  InpEdgeIterator() = default; // End sentinel (phase_ == End)
+
+  [[nodiscard]] Edge_class operator*() const;
+  InpEdgeIterator &operator++();
+  InpEdgeIterator operator++(int) {
+    InpEdgeIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  [[nodiscard]] bool operator==(const InpEdgeIterator &o) const noexcept {
+    return phase_ == Phase::End && o.phase_ == Phase::End;
+  }
+  [[nodiscard]] bool operator!=(const InpEdgeIterator &o) const noexcept {
+    return !(*this == o);
+  }
+
+private:
+  enum class Phase : uint8_t { NodeAsPin, PinList, Materialized, End };
+
+  void start();             // seed -> first incoming edge (or End)
+  void skip_and_position(); // advance to next incoming edge across entries
+  bool open_next_entry();   // node-as-pin -> pin list; false when done
+  bool load_next_pin();
+  void bind_node_as_pin();
+  void bind_pin();
+  void set_sink(Pid sink_pid);
+  [[nodiscard]] Edge_class build_edge(Vid vid) const;
+
+  [[nodiscard]] bool entry_at_end() const noexcept {
+    if (is_overflow_) {
+      return ovf_it_ == ovf_end_;
+    }
+    return slab_ ? (slab_it_ == slab_end_) : (idx_ >= n_);
+  }
+  [[nodiscard]] Vid entry_cur_vid() const noexcept {
+    if (is_overflow_) {
+      return *ovf_it_;
+    }
+    return slab_ ? *slab_it_ : buf_[idx_];
+  }
+  void entry_step() noexcept {
+    if (is_overflow_) {
+      ++ovf_it_;
+    } else if (slab_) {
+      ++slab_it_;
+    } else {
+      ++idx_;
+    }
+  }
+  void bind_overflow(uint32_t overflow_idx);
+
+  Graph *graph_ = nullptr;
+  Phase phase_ = Phase::End;
+  bool is_node_src_ = false;  // node source (node-as-pin then pin list)
+  bool src_is_port0_ = false; // pin source that is the node-as-pin(0)
+  bool is_overflow_ = false;  // current entry uses the overflow set
+
+  // Source identity + context template (see OutEdgeIterator).
+  Nid self_nid_ = 0; // node base (& ~2)
+  Handle_context context_ = Handle_context::Class;
+  Gid root_gid_ = Gid_invalid;
+  Tree_pos hier_pos_ = INVALID;
+  std::shared_ptr<const std::vector<Nid>> hier_path_;
+
+  const Graph::NodeEntry *node_entry_ = nullptr;
+  const Graph::PinEntry *pin_entry_ = nullptr;
+  Pid cur_pin_lookup_ = 0; // canonical ((pid&~2)|1) of pin_entry_
+  Pid next_pin_id_ = 0;    // next pin in the node's linked list
+
+  static constexpr size_t kBufCap = 9;
+  std::array<Vid, kBufCap> buf_{};
+  uint8_t n_ = 0;
+  uint8_t idx_ = 0;
+
+  const OverflowSet *ovf_ = nullptr;
+  OverflowSet::const_iterator ovf_it_{};
+  OverflowSet::const_iterator ovf_end_{};
+  const Vid *slab_ = nullptr;
+  const Vid *slab_it_ = nullptr;
+  const Vid *slab_end_ = nullptr;
+
+  std::shared_ptr<absl::InlinedVector<Edge_class, 4>> mat_;
+  size_t mat_idx_ = 0;
+
+  // Sink pin for the active entry (built once per entry, already stamped).
+  Pin_class cur_sink_{};
+
+  friend class InpEdgeRange;
+  friend class Graph;
+};
+
+// Movable handle returned by inp_edges(); begin() seeds a fresh iterator.
+class InpEdgeRange {
+public:
+  using iterator = InpEdgeIterator;
+
+  [[nodiscard]] InpEdgeIterator begin() const;
+  [[nodiscard]] InpEdgeIterator end() const noexcept {
+    return InpEdgeIterator{};
+  }
+  [[nodiscard]] bool empty() const { return begin() == end(); }
+  [[nodiscard]] size_t size() const;      // O(n): walks the range
+  [[nodiscard]] Edge_class front() const; // precondition: !empty()
+  // Indexing kept from the eager vector inp_edges() used to return; each call
+  // walks i edges from begin(). at() throws std::out_of_range past the end.
+  [[nodiscard]] Edge_class operator[](size_t i) const; // precondition: i < size()
+  [[nodiscard]] Edge_class at(size_t i) const;
+
+private:
+  Graph *graph_ = nullptr;
+  bool is_node_src_ = false;
+  bool src_is_port0_ = false;
+  Nid self_nid_ = 0; // node base, or pin-port0 node base
+  Pid src_pid_ = 0;  // non-port0 pin source canonical pid (else 0)
+  Handle_context context_ = Handle_context::Class;
+  Gid root_gid_ = Gid_invalid;
+  Tree_pos hier_pos_ = INVALID;
+  std::shared_ptr<const std::vector<Nid>> hier_path_;
+  std::shared_ptr<absl::InlinedVector<Edge_class, 4>>
+      mat_; // non-null => hier-materialized
+
+  friend class Graph;
+  friend class InpEdgeIterator;
+};
+
 // Lazy, single-pass iterator over a graph's live nodes (node_table scan,
 // tombstones skipped). No materialization; no per-node shared_ptr overhead.
 class FastClassIterator {
@@ -2036,6 +2814,7 @@ public:
 private:
   FastClassIterator(Graph *graph, size_t idx, size_t end) noexcept;
   void skip_tombstones() noexcept;
+  friend struct detail::Hierarchy_view_state;
 
   Graph *graph_ = nullptr;
   size_t idx_ = 0;
@@ -2054,12 +2833,83 @@ private:
   Graph *graph_;
 };
 
+// Reusable buffers for ordered body walks on a cyclic body (an acyclic body
+// replays its maintained order and needs none). Pass one to
+// Body_view::nodes(order, scratch, cuts) and every walk borrows its buffers
+// instead of allocating O(N) fresh ones; they grow to the largest body seen
+// and are handed back when the iterator is destroyed. Works across graphs.
+// Not thread-safe: one scratch per thread. Two live walks on one scratch are
+// still correct; the second just allocates.
+class Traversal_scratch {
+public:
+  Traversal_scratch() = default;
+  Traversal_scratch(const Traversal_scratch &) = delete;
+  Traversal_scratch &operator=(const Traversal_scratch &) = delete;
+  Traversal_scratch(Traversal_scratch &&) noexcept = default;
+  Traversal_scratch &operator=(Traversal_scratch &&) noexcept = default;
+
+  // Bytes held for reuse (zero while a walk has them borrowed).
+  [[nodiscard]] size_t capacity_bytes() const noexcept {
+    return counts_.capacity() * sizeof(uint32_t) +
+           emitted_.capacity() * sizeof(uint64_t);
+  }
+
+private:
+  std::vector<uint32_t> counts_;
+  std::vector<uint64_t> emitted_;
+
+  friend class Scratch_lease;
+};
+
+// An ordered iterator's per-walk buffers: borrowed from a Traversal_scratch
+// for the iterator's lifetime, or owned outright when there is none.
+class Scratch_lease {
+public:
+  Scratch_lease() noexcept = default;
+  explicit Scratch_lease(Traversal_scratch *home) noexcept : home_(home) {
+    if (home_ != nullptr) {
+      counts.swap(home_->counts_);
+      emitted.swap(home_->emitted_);
+    }
+  }
+  Scratch_lease(const Scratch_lease &) = delete;
+  Scratch_lease &operator=(const Scratch_lease &) = delete;
+  Scratch_lease(Scratch_lease &&o) noexcept
+      : counts(std::move(o.counts)), emitted(std::move(o.emitted)),
+        home_(std::exchange(o.home_, nullptr)) {}
+  Scratch_lease &operator=(Scratch_lease &&o) noexcept {
+    if (this != &o) {
+      give_back();
+      counts = std::move(o.counts);
+      emitted = std::move(o.emitted);
+      home_ = std::exchange(o.home_, nullptr);
+    }
+    return *this;
+  }
+  ~Scratch_lease() { give_back(); }
+
+  std::vector<uint32_t> counts;
+  std::vector<uint64_t> emitted;
+
+private:
+  void give_back() noexcept {
+    if (home_ != nullptr) {
+      home_->counts_.swap(counts);
+      home_->emitted_.swap(emitted);
+      home_ = nullptr;
+    }
+  }
+  Traversal_scratch *home_ = nullptr;
+};
+
 // Forward topological iterator for a single graph body. Emits sources first,
 // then storage-order combinational nodes (Pass 1), then deferred back-edge
 // targets (Pass 2 replayed from Graph::forward_pass2_cache_), then any cycle
-// survivors (Tail). No Node_class objects are cached — per-iteration scratch
-// (a working copy of in-edge counts and an emitted bitset) is the only
-// per-walk allocation. Move-only to keep that scratch unique.
+// survivors (Tail). When the graph keeps a maintained emission order
+// (acyclic body) it is replayed directly instead (Order), with no scratch.
+// No Node_class objects are cached — per-iteration scratch (a working copy of
+// in-edge counts and an emitted bitset) is the only per-walk allocation, and
+// a Traversal_scratch removes even that. Move-only to keep that scratch unique.
 class ForwardClassIterator {
 public:
   using iterator_category = std::input_iterator_tag;
@@ -2093,11 +2943,13 @@ public:
 private:
   // Phase order: Pass1 (sources + storage-order combinational), Pass2 (cached
   // back-edge replay), Tail (cycle survivors), LoopLast (loop_break replay,
-  // only entered when loop_break_last_), End.
-  enum class Phase : uint8_t { Pass1, Pass2, Tail, LoopLast, End };
+  // only entered when loop_break_last_), End. Order replaces Pass1..Tail when
+  // Graph::forward_order_valid_.
+  enum class Phase : uint8_t { Order, Pass1, Pass2, Tail, LoopLast, End };
 
   explicit ForwardClassIterator(Graph *graph, bool loop_break_first = true,
-                                bool loop_break_last = false);
+                                bool loop_break_last = false,
+                                Traversal_scratch *scratch = nullptr);
   void advance();
   void propagate(size_t driver_idx, size_t cursor);
   [[nodiscard]] bool is_source(size_t idx) const noexcept;
@@ -2112,8 +2964,8 @@ private:
   bool loop_break_first_ = true;
   bool loop_break_last_ = false;
 
-  std::vector<uint32_t> working_remaining_in_;
-  std::vector<uint64_t> emitted_bits_;
+  // counts: working copy of the in-edge counts; emitted: bitset.
+  Scratch_lease scratch_;
 
   friend class ForwardClassRange;
 };
@@ -2121,8 +2973,9 @@ private:
 class ForwardClassRange {
 public:
   explicit ForwardClassRange(Graph *graph, bool loop_break_first = true,
-                             bool loop_break_last = false) noexcept
-      : graph_(graph), loop_break_first_(loop_break_first),
+                             bool loop_break_last = false,
+                             Traversal_scratch *scratch = nullptr) noexcept
+      : graph_(graph), scratch_(scratch), loop_break_first_(loop_break_first),
         loop_break_last_(loop_break_last) {}
   [[nodiscard]] ForwardClassIterator begin() const;
   [[nodiscard]] ForwardClassIterator end() const noexcept {
@@ -2130,13 +2983,16 @@ public:
   }
 
   // Backward-compat helpers for callers that previously used std::span.
-  // size()/front() each walk the iteration once (O(N)) — avoid in hot paths.
+  // size()/empty() are O(1) from the graph's cached live/loop_break counts
+  // (every live node is yielded once, loop_breaks once per cut side);
+  // front() starts one walk.
   [[nodiscard]] size_t size() const;
   [[nodiscard]] Node_class front() const;
   [[nodiscard]] bool empty() const;
 
 private:
   Graph *graph_;
+  Traversal_scratch *scratch_ = nullptr;
   bool loop_break_first_ = true;
   bool loop_break_last_ = false;
 };
@@ -2175,7 +3031,7 @@ private:
 // Backward topological iterator for a single graph body. Emits sinks first,
 // then reverse storage-order combinational nodes (Pass 1), then deferred
 // back-edge sources (Pass 2 replayed from Graph::backward_pass2_cache_), then
-// any cycle survivors (Tail).
+// any cycle survivors (Tail), or the maintained order on an acyclic body.
 class BackwardClassIterator {
 public:
   using iterator_category = std::input_iterator_tag;
@@ -2208,10 +3064,12 @@ private:
   // Phase order mirrors ForwardClassIterator: Pass1 (sinks + reverse
   // storage-order combinational), Pass2 (cached replay), Tail (cycle
   // survivors), LoopLast (loop_break replay, only when loop_break_last_), End.
-  enum class Phase : uint8_t { Pass1, Pass2, Tail, LoopLast, End };
+  // Order replays Graph::backward_order_cache_ instead of Pass1..Tail.
+  enum class Phase : uint8_t { Order, Pass1, Pass2, Tail, LoopLast, End };
 
   explicit BackwardClassIterator(Graph *graph, bool loop_break_first = true,
-                                 bool loop_break_last = false);
+                                 bool loop_break_last = false,
+                                 Traversal_scratch *scratch = nullptr);
   void advance();
   void propagate(size_t sink_idx, size_t cursor);
   [[nodiscard]] bool is_sink(size_t idx) const noexcept;
@@ -2227,8 +3085,8 @@ private:
   bool loop_break_first_ = true;
   bool loop_break_last_ = false;
 
-  std::vector<uint32_t> working_remaining_out_;
-  std::vector<uint64_t> emitted_bits_;
+  // counts: working copy of the out-edge counts; emitted: bitset.
+  Scratch_lease scratch_;
 
   friend class BackwardClassRange;
 };
@@ -2236,20 +3094,23 @@ private:
 class BackwardClassRange {
 public:
   explicit BackwardClassRange(Graph *graph, bool loop_break_first = true,
-                              bool loop_break_last = false) noexcept
-      : graph_(graph), loop_break_first_(loop_break_first),
+                              bool loop_break_last = false,
+                              Traversal_scratch *scratch = nullptr) noexcept
+      : graph_(graph), scratch_(scratch), loop_break_first_(loop_break_first),
         loop_break_last_(loop_break_last) {}
   [[nodiscard]] BackwardClassIterator begin() const;
   [[nodiscard]] BackwardClassIterator end() const noexcept {
     return BackwardClassIterator{};
   }
 
+  // As ForwardClassRange: size()/empty() O(1), front() starts one walk.
   [[nodiscard]] size_t size() const;
   [[nodiscard]] Node_class front() const;
   [[nodiscard]] bool empty() const;
 
 private:
   Graph *graph_;
+  Traversal_scratch *scratch_ = nullptr;
   bool loop_break_first_ = true;
   bool loop_break_last_ = false;
 };
@@ -2285,12 +3146,16 @@ public:
     explicit const_iterator(
         std::shared_ptr<detail::Occurrence_node_cursor> cursor);
 
+    // The current position as a compact handle, without materializing it.
+    [[nodiscard]] Occurrence_ref ref() const;
+
     std::shared_ptr<const std::vector<Occurrence_node>> entities_;
     size_t index_ = 0;
     std::shared_ptr<detail::Hierarchy_view_state> state_;
     std::shared_ptr<detail::Occurrence_node_cursor> cursor_;
 
     friend class OccurrenceNodeRange;
+    friend class OccurrenceRefRange;
   };
 
   OccurrenceNodeRange();
@@ -2298,6 +3163,10 @@ public:
                       std::shared_ptr<detail::Hierarchy_view_state> state);
   [[nodiscard]] static OccurrenceNodeRange
   streaming(std::shared_ptr<detail::Hierarchy_view_state> state);
+  // Streaming dependency-order walk; see Occurrences_view::spliced_nodes.
+  [[nodiscard]] static OccurrenceNodeRange
+  streaming(std::shared_ptr<detail::Hierarchy_view_state> state, bool forward,
+            Cut_placement cuts);
 
   [[nodiscard]] const_iterator begin() const;
   [[nodiscard]] const_iterator end() const;
@@ -2306,17 +3175,215 @@ public:
   [[nodiscard]] uint64_t size_hint() const;
   [[nodiscard]] std::optional<uint64_t> size_exact() const;
   [[nodiscard]] const Occurrence_node &front() const;
+  // The same walk as compact handles; see Occurrence_ref.
+  [[nodiscard]] OccurrenceRefRange refs() const;
 
 private:
-  explicit OccurrenceNodeRange(
-      std::shared_ptr<detail::Hierarchy_view_state> state);
+  enum class Stream : uint8_t { storage, forward, reverse };
+
+  OccurrenceNodeRange(std::shared_ptr<detail::Hierarchy_view_state> state,
+                      Stream stream, Cut_placement cuts);
 
   std::shared_ptr<const std::vector<Occurrence_node>> entities_;
   std::shared_ptr<detail::Hierarchy_view_state> state_;
   bool streaming_ = false;
+  Stream stream_ = Stream::storage;
+  Cut_placement cuts_ = Cut_placement::first;
   mutable std::optional<Occurrence_node> front_cache_;
 };
 
+// OccurrenceNodeRange::refs(): yields Occurrence_ref by value. A streaming
+// walk never builds the full Occurrence_node, so collecting millions of
+// handles touches no shared state.
+class OccurrenceRefRange {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Occurrence_ref;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Occurrence_ref;
+
+    const_iterator() = default;
+
+    [[nodiscard]] reference operator*() const { return it_.ref(); }
+    const_iterator &operator++() {
+      ++it_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto old = *this;
+      old.it_ = it_++;
+      return old;
+    }
+    [[nodiscard]] bool operator==(const const_iterator &other) const noexcept {
+      return it_ == other.it_;
+    }
+    [[nodiscard]] bool operator!=(const const_iterator &other) const noexcept {
+      return !(*this == other);
+    }
+
+  private:
+    explicit const_iterator(OccurrenceNodeRange::const_iterator it)
+        : it_(std::move(it)) {}
+
+    OccurrenceNodeRange::const_iterator it_;
+
+    friend class OccurrenceRefRange;
+  };
+
+  explicit OccurrenceRefRange(OccurrenceNodeRange nodes)
+      : nodes_(std::move(nodes)) {}
+
+  [[nodiscard]] const_iterator begin() const {
+    return const_iterator(nodes_.begin());
+  }
+  [[nodiscard]] const_iterator end() const {
+    return const_iterator(nodes_.end());
+  }
+  [[nodiscard]] bool empty() const { return nodes_.empty(); }
+  [[nodiscard]] size_t size() const { return nodes_.size(); }
+
+private:
+  OccurrenceNodeRange nodes_;
+};
+
+inline OccurrenceRefRange OccurrenceNodeRange::refs() const {
+  return OccurrenceRefRange(*this);
+}
+
+// Longest-path levels of a graph body (Body_view::levels). Level 0 holds the
+// nodes with no combinational fan-in -- loop_breaks, and nodes fed only by
+// graph inputs, constants or loop_breaks; every other node sits one past its
+// deepest combinational driver, so size() is the critical path depth. Each
+// level is a contiguous span of raw Nids in storage order. Nodes on or behind
+// a combinational cycle have no level and are listed by unleveled(). The
+// view reads the graph's cache: any later mutation invalidates it.
+class Level_view {
+public:
+  static constexpr uint32_t kNoLevel = ~uint32_t{0};
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::span<const Nid>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::span<const Nid>;
+
+    iterator() noexcept = default;
+    [[nodiscard]] std::span<const Nid> operator*() const noexcept {
+      return (*view_)[level_];
+    }
+    iterator &operator++() noexcept {
+      ++level_;
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      auto tmp = *this;
+      ++level_;
+      return tmp;
+    }
+    [[nodiscard]] bool operator==(const iterator &o) const noexcept {
+      return level_ == o.level_;
+    }
+
+  private:
+    friend class Level_view;
+    iterator(const Level_view *view, size_t level) noexcept
+        : view_(view), level_(level) {}
+    const Level_view *view_ = nullptr;
+    size_t level_ = 0;
+  };
+
+  [[nodiscard]] size_t size() const noexcept {
+    return off_.empty() ? 0 : off_.size() - 1;
+  }
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+  [[nodiscard]] std::span<const Nid> operator[](size_t level) const noexcept {
+    return nodes_.subspan(off_[level], off_[level + 1] - off_[level]);
+  }
+  [[nodiscard]] iterator begin() const noexcept { return {this, 0}; }
+  [[nodiscard]] iterator end() const noexcept { return {this, size()}; }
+  [[nodiscard]] std::span<const Nid> unleveled() const noexcept {
+    return off_.empty() ? std::span<const Nid>{} : nodes_.subspan(off_.back());
+  }
+  // Level of a node of this body; kNoLevel for an unleveled or dead node.
+  [[nodiscard]] uint32_t level_of(const Node_class &node) const noexcept;
+
+private:
+  friend class Body_view;
+  Level_view(std::span<const Nid> nodes, std::span<const uint32_t> off,
+             std::span<const uint32_t> level_of) noexcept
+      : nodes_(nodes), off_(off), level_of_(level_of) {}
+
+  std::span<const Nid> nodes_;
+  std::span<const uint32_t> off_;
+  std::span<const uint32_t> level_of_;
+};
+
+// parallel_for_each knobs (Body_view and the hierarchical views).
+struct Parallel_options {
+  // Worker count; 0 picks std::thread::hardware_concurrency().
+  unsigned threads = 0;
+  // Body walks only; a hierarchical walk follows storage order.
+  Cut_placement cuts = Cut_placement::first;
+  // Runs body(w) for every w in [0, workers), concurrently where it can, and
+  // returns once every call has returned -- the hook for running the walk on
+  // the caller's own thread pool. Empty: worker 0 runs on the calling thread
+  // and each other worker gets a std::thread.
+  std::function<void(unsigned workers, function_ref<void(unsigned)> body)>
+      executor;
+};
+
+// Options for a batch cone query (Body_view::cone, Occurrences_view::cone).
+struct Cone_options {
+  // forward: fanout cone (sinks of the seeds); backward: fanin cone.
+  Direction direction = Direction::forward;
+  // A reached loop_break is part of the cone but is not expanded further,
+  // so the cone stops at state. Seeds are always expanded.
+  bool through_loop_breaks = false;
+  // Body cones only: workers sharing each BFS level; 0 picks
+  // std::thread::hardware_concurrency(). Small levels stay on the caller.
+  unsigned threads = 1;
+  // Runs a level's workers; see Parallel_options::executor.
+  std::function<void(unsigned workers, function_ref<void(unsigned)> body)>
+      executor;
+};
+
+// The nodes of one body reached by Body_view::cone, as a dense bitmap over
+// node_table slots (bit i is the node with raw nid i << 2).
+class Node_cone {
+public:
+  Node_cone() = default;
+
+  [[nodiscard]] Graph *get_graph() const noexcept { return graph_; }
+  [[nodiscard]] bool contains(size_t idx) const noexcept {
+    return idx / 64 < bits_.size() && ((bits_[idx / 64] >> (idx % 64)) & 1U);
+  }
+  [[nodiscard]] bool contains(const Node_class &node) const noexcept {
+    return contains(static_cast<size_t>(node.get_debug_nid() >> 2));
+  }
+  [[nodiscard]] size_t size() const noexcept { return count_; }
+  [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+  [[nodiscard]] std::span<const uint64_t> bitmap() const noexcept {
+    return bits_;
+  }
+  // The members as ascending raw nids.
+  [[nodiscard]] std::vector<Nid> nids() const;
+
+private:
+  Node_cone(Graph *graph, std::vector<uint64_t> bits, size_t count)
+      : graph_(graph), bits_(std::move(bits)), count_(count) {}
+
+  Graph *graph_ = nullptr;
+  std::vector<uint64_t> bits_;
+  size_t count_ = 0;
+
+  friend class Body_view;
+};
+
 class Body_view {
 public:
   explicit Body_view(Graph *graph) : graph_(graph) {}
@@ -2328,8 +3395,53 @@ public:
   [[nodiscard]] BackwardClassRange
   nodes(Node_order::reverse_t,
         Cut_placement cuts = Cut_placement::first) const noexcept;
+  // Same walks, borrowing their per-walk buffers from `scratch` (see
+  // Traversal_scratch). The scratch must outlive the iterators.
+  [[nodiscard]] ForwardClassRange
+  nodes(Node_order::forward_t, Traversal_scratch &scratch,
+        Cut_placement cuts = Cut_placement::first) const noexcept;
+  [[nodiscard]] BackwardClassRange
+  nodes(Node_order::reverse_t, Traversal_scratch &scratch,
+        Cut_placement cuts = Cut_placement::first) const noexcept;
+
+  // Longest-path level buckets (see Level_view). Computed once from the
+  // forward traversal cache and kept with it; an edge add that deepens a
+  // sink is patched in place, other edits rebuild on the next call.
+  [[nodiscard]] Level_view levels() const;
+
+  // Parallel nodes(Node_order::forward, opts.cuts): calls fn once for every
+  // node that range yields, from opts.threads workers. fn(driver) happens
+  // before fn(sink) for each edge the sequential order honours (driver not a
+  // loop_break). Dependency counters start from the forward cache; a node
+  // whose counter drops to zero is queued on the finishing worker's deque,
+  // and idle workers steal. Cycle survivors then run on the calling thread
+  // in storage order, and Cut_placement::last loop_breaks run after them.
+  // fn must tolerate concurrent calls and the body must not be mutated
+  // meanwhile. The first exception thrown by fn stops the walk and is
+  // rethrown here.
+  void parallel_for_each(Node_order::forward_t,
+                         function_ref<void(Node_class)> fn,
+                         const Parallel_options &opts = {}) const;
+
+  // Transitive fanout (or fanin) cone of many seeds at once, node-granular,
+  // seeds included. A driver pin seed of a forward cone (sink pin of a
+  // backward one) starts from that pin's own edges only; any other pin seed
+  // stands for its node. The BFS keeps its visited set and frontier as
+  // bitmaps over node_table and switches a level to bottom-up (unvisited
+  // nodes probe their neighbours) once the frontier is a large part of what
+  // is left. Graph IO and constants are never members. For many-seed,
+  // whole-cone queries; reachable_pins() streams and stops early instead.
+  [[nodiscard]] Node_cone cone(std::span<const Node_class> seeds,
+                               const Cone_options &opts = {}) const;
+  [[nodiscard]] Node_cone cone(std::span<const Pin_class> seeds,
+                               const Cone_options &opts = {}) const;
 
 private:
+  // marks join the cone as they are; frontier slots join it and expand.
+  [[nodiscard]] Node_cone cone_from(std::vector<uint32_t> marks,
+                                    std::vector<uint32_t> frontier,
+                                    const Cone_options &opts) const;
+
   // Debug-only staleness check. A view holds a raw Graph*, is publicly
   // constructible and freely copyable, so it can outlive the delete_graph()
   // that gutted its graph. Graph::body() asserts when the view is HANDED
@@ -2345,6 +3457,123 @@ private:
   Graph *graph_ = nullptr;
 };
 
+// One edge of a Csr_view: the raw driver / sink pin ids, i.e. exactly what
+// the Pin_class handles of the matching out_edges() / inp_edges() entry hold.
+struct Csr_edge {
+  Pid driver = 0;
+  Pid sink = 0;
+};
+
+// Immutable compressed-sparse-row snapshot of one graph body, built by
+// Graph::freeze_csr() for passes that only read the netlist. Out- and
+// in-edges each live in one contiguous array; every node owns one block
+// laid out as [node-as-pin(0) edges][edges of each pin, pin-list order], so
+// the node range and every pin range are plain slices of the same array and
+// a walk never decodes inline slots, chases next_pin_id or probes an
+// overflow set.
+//
+// The snapshot is never written after construction: one shared_ptr can be
+// handed to any number of reader threads. It does not follow later edits --
+// is_current() compares the library mutation epoch captured at build time,
+// and ids created after the build simply report no edges.
+class Csr_view {
+public:
+  // Mirrors OutEdgeRange / inp_edges(): yields Class-context Edge_class
+  // values built on the fly. raw() exposes the underlying slice.
+  class Edge_range {
+  public:
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Edge_class;
+      using reference = Edge_class;
+      using pointer = void;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+      iterator(Graph *graph, const Csr_edge *cur) : graph_(graph), cur_(cur) {}
+
+      [[nodiscard]] Edge_class operator*() const;
+      iterator &operator++() {
+        ++cur_;
+        return *this;
+      }
+      iterator operator++(int) {
+        iterator tmp = *this;
+        ++cur_;
+        return tmp;
+      }
+      [[nodiscard]] bool operator==(const iterator &o) const noexcept {
+        return cur_ == o.cur_;
+      }
+
+    private:
+      Graph *graph_ = nullptr;
+      const Csr_edge *cur_ = nullptr;
+    };
+
+    Edge_range() = default;
+    Edge_range(Graph *graph, std::span<const Csr_edge> edges)
+        : graph_(graph), edges_(edges) {}
+
+    [[nodiscard]] iterator begin() const {
+      return iterator(graph_, edges_.data());
+    }
+    [[nodiscard]] iterator end() const {
+      return iterator(graph_, edges_.data() + edges_.size());
+    }
+    [[nodiscard]] size_t size() const noexcept { return edges_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return edges_.empty(); }
+    [[nodiscard]] std::span<const Csr_edge> raw() const noexcept {
+      return edges_;
+    }
+
+  private:
+    Graph *graph_ = nullptr;
+    std::span<const Csr_edge> edges_;
+  };
+
+  // Node granularity: node-as-pin(0) plus every pin of the node, the same
+  // set Graph::out_edges(Node_class) / inp_edges(Node_class) report.
+  [[nodiscard]] Edge_range out_edges(const Node_class &node) const;
+  [[nodiscard]] Edge_range inp_edges(const Node_class &node) const;
+  // Pin granularity; a port-0 handle (node-as-pin) selects the node's own
+  // entry only.
+  [[nodiscard]] Edge_range out_edges(const Pin_class &pin) const;
+  [[nodiscard]] Edge_range inp_edges(const Pin_class &pin) const;
+
+  // Every edge once, grouped by driver node (node order, then pin order).
+  [[nodiscard]] std::span<const Csr_edge> all_edges() const noexcept {
+    return out_.edges;
+  }
+  [[nodiscard]] size_t num_edges() const noexcept { return out_.edges.size(); }
+  [[nodiscard]] Graph *get_graph() const noexcept { return graph_; }
+  // Library mutation epoch at build time (0 for a graph with no library).
+  [[nodiscard]] uint64_t epoch() const noexcept { return epoch_; }
+  [[nodiscard]] bool is_current() const noexcept;
+  [[nodiscard]] uint64_t memory_bytes() const noexcept;
+
+private:
+  friend class Graph;
+
+  // One direction. node_off has one extra trailing entry; pin0_end[i] ends
+  // node i's node-as-pin prefix; pin_rng is indexed by pin table slot.
+  struct Dir {
+    std::vector<Csr_edge> edges;
+    std::vector<uint32_t> node_off;
+    std::vector<uint32_t> pin0_end;
+    std::vector<std::pair<uint32_t, uint32_t>> pin_rng;
+
+    [[nodiscard]] std::span<const Csr_edge> node(Nid nid) const noexcept;
+    [[nodiscard]] std::span<const Csr_edge> pin(Pid pid) const noexcept;
+  };
+
+  Graph *graph_ = nullptr;
+  uint64_t epoch_ = 0;
+  Dir out_;
+  Dir inp_;
+};
+
 class Definitions_view {
 public:
   explicit Definitions_view(Graph *graph) : graph_(graph) {}
@@ -2380,6 +3609,49 @@ private:
   mutable std::shared_ptr<detail::Hierarchy_view_state> state_;
 };
 
+// The occurrences reached by a hierarchical cone() (Occurrences_view,
+// Grouped_hierarchy_view): one node_table bitmap per interned path of the
+// view that ran it, so membership is two indexings instead of a hash probe.
+// A call site yielded as a node of its own (an opaque instance) is kept in a
+// slot apart from its callee body's nodes.
+class Occurrence_cone {
+public:
+  Occurrence_cone() = default;
+
+  [[nodiscard]] bool contains(const Occurrence_ref &ref) const noexcept {
+    const size_t key = slot_of(ref);
+    if (key >= slots_.size() || slots_[key].graph != ref.graph) {
+      return false;
+    }
+    const auto idx = static_cast<size_t>(ref.nid >> 2);
+    const auto &bits = slots_[key].bits;
+    return idx / 64 < bits.size() && ((bits[idx / 64] >> (idx % 64)) & 1U);
+  }
+  [[nodiscard]] bool contains(const Occurrence_node &node) const noexcept {
+    return contains(node.ref());
+  }
+  [[nodiscard]] size_t size() const noexcept { return count_; }
+  [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+  // Members ordered by (path id, nid); resolve() them with the same view.
+  [[nodiscard]] std::vector<Occurrence_ref> refs() const;
+
+private:
+  struct Slot {
+    Graph *graph = nullptr;
+    uint32_t container = 0;
+    std::vector<uint64_t> bits;
+  };
+
+  [[nodiscard]] static size_t slot_of(const Occurrence_ref &ref) noexcept {
+    return size_t{ref.path} * 2 + (ref.path != ref.container ? 1 : 0);
+  }
+
+  std::vector<Slot> slots_;
+  size_t count_ = 0;
+
+  friend struct detail::Hierarchy_view_state;
+};
+
 class Grouped_hierarchy_view {
 public:
   explicit Grouped_hierarchy_view(
@@ -2393,9 +3665,17 @@ public:
   nodes(Node_order::forward_t, Cut_placement cuts = Cut_placement::first) const;
   [[nodiscard]] OccurrenceNodeRange
   nodes(Node_order::reverse_t, Cut_placement cuts = Cut_placement::first) const;
+  // Streaming dependency order; see Occurrences_view::spliced_nodes.
+  [[nodiscard]] OccurrenceNodeRange
+  spliced_nodes(Node_order::forward_t,
+                Cut_placement cuts = Cut_placement::first) const;
+  [[nodiscard]] OccurrenceNodeRange
+  spliced_nodes(Node_order::reverse_t,
+                Cut_placement cuts = Cut_placement::first) const;
   [[nodiscard]] InstanceGroupRange instances() const;
   [[nodiscard]] Occurrence_pin lift(Pin_class root_pin) const;
   [[nodiscard]] Occurrence_node lift(Node_class root_node) const;
+  [[nodiscard]] Occurrence_node resolve(const Occurrence_ref &ref) const;
   [[nodiscard]] ReachablePinRange
   reachable_pins(std::vector<Occurrence_pin> seeds,
                  Reach_options options = {}) const;
@@ -2404,10 +3684,20 @@ public:
                  Reach_options options = {}) const {
     return reachable_pins(std::vector<Occurrence_pin>(seeds), options);
   }
+  // See Occurrences_view::cone.
+  [[nodiscard]] Occurrence_cone cone(std::span<const Occurrence_node> seeds,
+                                     const Cone_options &opts = {}) const;
   [[nodiscard]] uint64_t size_hint() const;
   [[nodiscard]] std::optional<uint64_t> size_exact() const;
   [[nodiscard]] uint64_t physical_node_count_hint() const;
   [[nodiscard]] std::optional<uint64_t> physical_node_count_exact() const;
+  // Parallel nodes(); see Occurrences_view::parallel_for_each_task.
+  void parallel_for_each_task(
+      function_ref<void(size_t)> tasks,
+      function_ref<void(size_t, const Occurrence_node &)> fn,
+      const Parallel_options &opts = {}) const;
+  void parallel_for_each(function_ref<void(const Occurrence_node &)> fn,
+                         const Parallel_options &opts = {}) const;
 
 private:
   // Debug-only staleness check. A view holds a raw Graph*, is publicly
@@ -2444,8 +3734,26 @@ public:
   nodes(Node_order::forward_t, Cut_placement cuts = Cut_placement::first) const;
   [[nodiscard]] OccurrenceNodeRange
   nodes(Node_order::reverse_t, Cut_placement cuts = Cut_placement::first) const;
+  // Streaming dependency order without materializing the hierarchy. Each
+  // body is walked in its own cached order (as body().nodes(order)) and a
+  // callee body is spliced in whole at its call site: forward yields the
+  // call then its callee, reverse the callee then the call, loop ordinals
+  // last-first. State is O(depth), plus an O(body) copy for a cyclic body.
+  // Unlike nodes(order), a callee is never interleaved with its caller, so
+  // a dependency that re-enters the same call (a combinational path out of
+  // it and back in) is ordered like a cycle in the caller's body. Loop
+  // breaks stay in place for first; last / both replay them afterwards
+  // with a storage-order pass.
+  [[nodiscard]] OccurrenceNodeRange
+  spliced_nodes(Node_order::forward_t,
+                Cut_placement cuts = Cut_placement::first) const;
+  [[nodiscard]] OccurrenceNodeRange
+  spliced_nodes(Node_order::reverse_t,
+                Cut_placement cuts = Cut_placement::first) const;
   [[nodiscard]] Occurrence_pin lift(Pin_class root_pin) const;
   [[nodiscard]] Occurrence_node lift(Node_class root_node) const;
+  // Rebuild the full handle for a ref yielded by one of this view's ranges.
+  [[nodiscard]] Occurrence_node resolve(const Occurrence_ref &ref) const;
   [[nodiscard]] ReachablePinRange
   reachable_pins(std::vector<Occurrence_pin> seeds,
                  Reach_options options = {}) const;
@@ -2454,9 +3762,33 @@ public:
                  Reach_options options = {}) const {
     return reachable_pins(std::vector<Occurrence_pin>(seeds), options);
   }
+  // Whole transitive fanout / fanin cone of many seeds, across instance
+  // boundaries (edges resolve as in out_edges() / inp_edges()). Visited
+  // occurrences are kept as dense per-path bitmaps; opts.threads does not
+  // apply. See Body_view::cone for the single-body engine.
+  [[nodiscard]] Occurrence_cone cone(std::span<const Occurrence_node> seeds,
+                                     const Cone_options &opts = {}) const;
   [[nodiscard]] uint64_t size_hint() const;
   [[nodiscard]] std::optional<uint64_t> size_exact() const;
 
+  // Parallel nodes(): calls fn once for every occurrence nodes() yields, from
+  // opts.threads workers (opts.cuts does not apply). The calling thread cuts
+  // the instance tree at call sites into tasks, each a contiguous slice of
+  // the nodes() order, and tasks(n) runs once with their count before any fn
+  // call. Workers take tasks in order, each with its own path interning and
+  // verdict cache, and fn(t, node) names the task: per-task results joined in
+  // task order reproduce nodes(). The policy is called under a lock, so it
+  // need not be thread-safe; fn must be, and the library must not be mutated
+  // meanwhile. The first exception thrown by fn stops the walk and is
+  // rethrown here.
+  void parallel_for_each_task(
+      function_ref<void(size_t)> tasks,
+      function_ref<void(size_t, const Occurrence_node &)> fn,
+      const Parallel_options &opts = {}) const;
+  // Same walk when the visiting order does not matter.
+  void parallel_for_each(function_ref<void(const Occurrence_node &)> fn,
+                         const Parallel_options &opts = {}) const;
+
 private:
   // Debug-only staleness check. A view holds a raw Graph*, is publicly
   // constructible and freely copyable, so it can outlive the delete_graph()
@@ -2874,6 +4206,11 @@ public:
   // other threads hold graphs from this library.
   [[nodiscard]] Source_locator &source_map() noexcept { return *srcmap_sp_; }
 
+  // Memory accounting over the materialized bodies (Graph::memory_stats,
+  // summed) and the library source map. Takes the registry lock shared; do
+  // not call while another thread mutates one of the bodies.
+  [[nodiscard]] Library_memory_stats memory_stats() const;
+
   // Shared in-memory source map (hhds-srcloc). A Forest and a GraphLibrary that
   // persist into the SAME db directory must share ONE table (the tree-side and
   // graph-side IRs come from the same source, so their content-addressed ids
@@ -3747,13 +5084,33 @@ inline Port_id GraphIO::get_output_port_id(std::string_view name) const {
   return output_pin_decls_[it->second.index].port_id;
 }
 
-inline void Graph::invalidate_traversal_caches() noexcept {
+inline void Graph::note_body_edit() noexcept {
   dirty_ = true;
-  forward_caches_valid_ = false;
-  backward_caches_valid_ = false;
   if (owner_lib_ != nullptr) {
     owner_lib_->note_graph_mutation();
   }
 }
 
+inline void Graph::invalidate_traversal_caches() noexcept {
+  forward_caches_valid_ = false;
+  forward_order_valid_ = false;
+  backward_caches_valid_ = false;
+  backward_order_valid_ = false;
+  node_counts_valid_ = false;
+  levels_valid_ = false;
+  note_body_edit();
+}
+
 } // namespace hhds
+
+template <> struct std::hash<hhds::Occurrence_ref> {
+  [[nodiscard]] size_t operator()(const hhds::Occurrence_ref &x) const noexcept {
+    size_t h = std::hash<const void *>{}(x.graph);
+    const auto mix = [&h](size_t value) {
+      h ^= value + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);
+    };
+    mix(std::hash<hhds::Nid>{}(x.nid));
+    mix(std::hash<uint32_t>{}(x.path));
+    return h;
+  }
+};
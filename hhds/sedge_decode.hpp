@@ -0,0 +1,255 @@
+#pragma once
+// Decoder for the packed 16-bit short-edge slots of Graph::NodeEntry /
+// Graph::PinEntry (docs/storage_internals.md, Tier 1). A slot is
+//   [15] sign  [14:2] |delta|  [1] driver  [0] pin      (0 = empty slot)
+// and names the target (self_num - delta) << 2 | driver | pin. A NodeEntry
+// holds 8 slot lanes (4 in sedges + 3 in sedges_extra + 1 always empty), a
+// PinEntry 4, so one call decodes a whole entry.
+//
+// The vector path is built only when the compiler targets AVX2 (-mavx2 /
+// -march=...). Narrower x86-64 targets use the scalar loop: with only SSE2 /
+// SSE4.1 the 16 -> 64 bit widening costs more than it saves. Both paths
+// produce identical results; decode_sedges_scalar() stays callable so tests
+// can cross-check the vector path on any host.
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "graph_sizing.hpp"
+
+namespace hhds::detail {
+
+struct Sedge_masks {
+  uint8_t live = 0; // bit i: slot i holds an edge
+  uint8_t back = 0; // bit i: slot i stores a driver (self is the sink)
+};
+
+// Masks only (no delta arithmetic): enough for "any out/in edge?" checks.
+// SWAR over the two 64-bit halves; `extra` must keep its top 16 bits clear.
+[[nodiscard]] constexpr Sedge_masks sedge_masks(uint64_t packed,
+                                                uint64_t extra) noexcept {
+  constexpr uint64_t kLow15 = 0x7FFF7FFF7FFF7FFFULL;
+  constexpr uint64_t kLane0 = 0x0001000100010001ULL;
+  // Gathers bit 16*k into bit 48+k (no two partial products overlap).
+  constexpr uint64_t kGather = (1ULL << 48) | (1ULL << 33) | (1ULL << 18) | (1ULL << 3);
+  const auto nonzero = [](uint64_t x) {
+    return ((((x & kLow15) + kLow15) | x) >> 15) & kLane0;
+  };
+  const auto gather = [](uint64_t lanes) {
+    return static_cast<uint8_t>(((lanes * kGather) >> 48) & 0xF);
+  };
+  Sedge_masks m;
+  m.live = static_cast<uint8_t>(gather(nonzero(packed)) |
+                                (gather(nonzero(extra)) << 4));
+  m.back = static_cast<uint8_t>(gather((packed >> 1) & kLane0) |
+                                (gather((extra >> 1) & kLane0) << 4));
+  return m;
+}
+
+namespace sedge_scalar {
+// Decodes the live slots among the low `slots` lanes of `word` into
+// out[first + i], recording them in `m` (lane-indexed form).
+inline void lanes(uint64_t word, int slots, int first, uint64_t self_num,
+                  Vid *out, Sedge_masks &m) noexcept {
+  for (int i = 0; i < slots; ++i) {
+    const uint64_t raw = (word >> (i * 16)) & 0xFFFF;
+    if (raw == 0) {
+      continue;
+    }
+    const uint64_t mag = (raw >> 2) & 0x1FFF;
+    const int64_t delta =
+        (raw & 0x8000) ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
+    out[first + i] = static_cast<Vid>(((self_num - delta) << 2) | (raw & 3));
+    m.live = static_cast<uint8_t>(m.live | (1U << (first + i)));
+    m.back = static_cast<uint8_t>(m.back | (((raw >> 1) & 1U) << (first + i)));
+  }
+}
+
+// Appends the live slots among the low `slots` lanes of `word` to out[n...]
+// (compact form); returns the new count.
+inline unsigned append(uint64_t word, int slots, uint64_t self_num, Vid *out,
+                       unsigned n) noexcept {
+  for (int i = 0; i < slots; ++i) {
+    const uint64_t raw = (word >> (i * 16)) & 0xFFFF;
+    if (raw != 0) {
+      const uint64_t mag = (raw >> 2) & 0x1FFF;
+      const int64_t delta =
+          (raw & 0x8000) ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
+      out[n++] = static_cast<Vid>(((self_num - delta) << 2) | (raw & 3));
+    }
+  }
+  return n;
+}
+
+// append() restricted to one direction (`back`: the slot stores a driver);
+// the other direction's slots are skipped before any delta arithmetic.
+inline unsigned append_dir(uint64_t word, int slots, uint64_t self_num,
+                           bool back, Vid *out, unsigned n) noexcept {
+  for (int i = 0; i < slots; ++i) {
+    const uint64_t raw = (word >> (i * 16)) & 0xFFFF;
+    if (raw != 0 && ((raw >> 1) & 1U) == static_cast<uint64_t>(back)) {
+      const uint64_t mag = (raw >> 2) & 0x1FFF;
+      const int64_t delta =
+          (raw & 0x8000) ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag);
+      out[n++] = static_cast<Vid>(((self_num - delta) << 2) | (raw & 3));
+    }
+  }
+  return n;
+}
+} // namespace sedge_scalar
+
+// Reference decoder: the live lanes of (packed, extra) go to out[lane] (slot
+// order; other lanes are left untouched). out must hold 8 Vids; lane 7 (the
+// top 16 bits of `extra`) is always empty in a NodeEntry and is not read.
+inline Sedge_masks decode_sedges_scalar(uint64_t packed, uint64_t extra,
+                                        uint64_t self_num, Vid *out) noexcept {
+  Sedge_masks m;
+  sedge_scalar::lanes(packed, 4, 0, self_num, out, m);
+  sedge_scalar::lanes(extra, 3, 4, self_num, out, m);
+  return m;
+}
+
+#if defined(__AVX2__)
+namespace sedge_simd {
+// Per-lane signed delta and low (driver|pin) bits, 16-bit lanes.
+struct Lanes {
+  __m128i delta;
+  __m128i low;
+  Sedge_masks masks;
+};
+
+inline Lanes split(__m128i raw) noexcept {
+  const __m128i zero = _mm_setzero_si128();
+  // Conditional negate: neg is all-ones on sign lanes, (mag ^ neg) - neg.
+  const __m128i mag = _mm_and_si128(_mm_srli_epi16(raw, 2), _mm_set1_epi16(0x1FFF));
+  const __m128i neg = _mm_srai_epi16(raw, 15);
+  const __m128i empty = _mm_cmpeq_epi16(raw, zero);
+  const __m128i fwd = _mm_cmpeq_epi16(_mm_and_si128(raw, _mm_set1_epi16(2)), zero);
+  Lanes l;
+  l.delta = _mm_sub_epi16(_mm_xor_si128(mag, neg), neg);
+  l.low = _mm_and_si128(raw, _mm_set1_epi16(3));
+  l.masks.live = static_cast<uint8_t>(~_mm_movemask_epi8(_mm_packs_epi16(empty, zero)) & 0xFF);
+  l.masks.back = static_cast<uint8_t>(~_mm_movemask_epi8(_mm_packs_epi16(fwd, zero)) & 0xFF);
+  return l;
+}
+
+// Widens lanes [0, N) to 64-bit Vids: (self - delta) << 2 | low.
+template <int N>
+inline void widen(const Lanes &l, uint64_t self_num, Vid *out) noexcept {
+  const __m256i self = _mm256_set1_epi64x(static_cast<int64_t>(self_num));
+  for (int quad = 0; quad < N / 4; ++quad) {
+    const __m128i d16 = quad ? _mm_srli_si128(l.delta, 8) : l.delta;
+    const __m128i l16 = quad ? _mm_srli_si128(l.low, 8) : l.low;
+    const __m256i target = _mm256_sub_epi64(self, _mm256_cvtepi16_epi64(d16));
+    const __m256i vid = _mm256_or_si256(_mm256_slli_epi64(target, 2),
+                                        _mm256_cvtepu16_epi64(l16));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 4 * quad), vid);
+  }
+}
+} // namespace sedge_simd
+#endif
+
+// NodeEntry: decodes all 8 lanes into out[0..7] (slot order; lanes whose
+// `live` bit is clear hold garbage) and returns the masks.
+inline Sedge_masks decode_sedges(uint64_t packed, uint64_t extra,
+                                 uint64_t self_num, Vid *out) noexcept {
+#if defined(__AVX2__)
+  const auto l = sedge_simd::split(_mm_set_epi64x(static_cast<int64_t>(extra),
+                                                  static_cast<int64_t>(packed)));
+  sedge_simd::widen<8>(l, self_num, out);
+  return l.masks;
+#else
+  return decode_sedges_scalar(packed, extra, self_num, out);
+#endif
+}
+
+// PinEntry: 4 lanes, out[0..3].
+inline Sedge_masks decode_sedges4(uint64_t packed, uint64_t self_num,
+                                  Vid *out) noexcept {
+#if defined(__AVX2__)
+  const auto l = sedge_simd::split(_mm_cvtsi64_si128(static_cast<int64_t>(packed)));
+  sedge_simd::widen<4>(l, self_num, out);
+  return l.masks;
+#else
+  Sedge_masks m;
+  sedge_scalar::lanes(packed, 4, 0, self_num, out, m);
+  return m;
+#endif
+}
+
+// Moves the live lanes of out[] to the front, keeping slot order, and returns
+// how many there are. Free when they already form a prefix -- the common case,
+// since an insert takes the first empty slot.
+inline unsigned compact_live(Vid *out, unsigned live) noexcept {
+  if ((live & (live + 1)) == 0) {
+    return static_cast<unsigned>(std::countr_zero(live + 1));
+  }
+  unsigned n = 0;
+  for (; live != 0; live &= live - 1) {
+    out[n++] = out[std::countr_zero(live)];
+  }
+  return n;
+}
+
+
+// Live slots straight into out[0, n) in slot order; returns n. The
+// EdgeRange fill path: no masks needed, and the scalar build skips the
+// lane-indexed detour. NodeEntry form: `extra` is sedges_extra (3 slots).
+inline unsigned decode_sedges_compact(uint64_t packed, uint64_t extra,
+                                      uint64_t self_num, Vid *out) noexcept {
+#if defined(__AVX2__)
+  return compact_live(out, decode_sedges(packed, extra, self_num, out).live);
+#else
+  return sedge_scalar::append(extra, 3, self_num, out,
+                              sedge_scalar::append(packed, 4, self_num, out, 0));
+#endif
+}
+
+// PinEntry form of decode_sedges_compact (4 slots).
+inline unsigned decode_sedges4_compact(uint64_t packed, uint64_t self_num,
+                                       Vid *out) noexcept {
+#if defined(__AVX2__)
+  return compact_live(out, decode_sedges4(packed, self_num, out).live);
+#else
+  return sedge_scalar::append(packed, 4, self_num, out, 0);
+#endif
+}
+
+// The live slots of one direction (`back`: self is the sink) into out[0, n)
+// in slot order; returns n. Forward propagation only wants the outgoing ones.
+inline unsigned decode_sedges_dir(uint64_t packed, uint64_t extra,
+                                  uint64_t self_num, bool back,
+                                  Vid *out) noexcept {
+#if defined(__AVX2__)
+  const auto m = decode_sedges(packed, extra, self_num, out);
+  return compact_live(out, back ? m.back : (m.live & ~m.back & 0xFFU));
+#else
+  return sedge_scalar::append_dir(
+      extra, 3, self_num, back, out,
+      sedge_scalar::append_dir(packed, 4, self_num, back, out, 0));
+#endif
+}
+
+// PinEntry form of decode_sedges_dir (4 slots).
+inline unsigned decode_sedges4_dir(uint64_t packed, uint64_t self_num,
+                                   bool back, Vid *out) noexcept {
+#if defined(__AVX2__)
+  const auto m = decode_sedges4(packed, self_num, out);
+  return compact_live(out, back ? m.back : (m.live & ~m.back & 0xFU));
+#else
+  return sedge_scalar::append_dir(packed, 4, self_num, back, out, 0);
+#endif
+}
+
+[[nodiscard]] constexpr const char *sedge_decoder_isa() noexcept {
+#if defined(__AVX2__)
+  return "avx2";
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace hhds::detail
@@ -668,6 +668,30 @@ public:
     return entries_.size();
   }
 
+  // Approximate heap bytes of own data: entry table and id index, file
+  // records with their line tables and in-memory content (a content buffer
+  // shared with another locator is counted by both). A load_lazy table that
+  // has not been parsed yet counts as zero; this does not parse it.
+  [[nodiscard]] uint64_t memory_bytes() const {
+    constexpr uint64_t kNode = 2 * sizeof(void*);  // unordered_map node: next + cached hash
+    uint64_t           bytes = entries_.capacity() * sizeof(entries_[0]);
+    for (const auto& [id, e] : entries_) {
+      bytes += e.parents.capacity() * sizeof(SourceId);
+    }
+    bytes += index_.bucket_count() * sizeof(void*) + index_.size() * (sizeof(*index_.begin()) + kNode);
+    bytes += path_to_fid_.bucket_count() * sizeof(void*);
+    for (const auto& [path, fid] : path_to_fid_) {
+      bytes += sizeof(std::pair<const std::string, uint32_t>) + kNode + (path.capacity() > 15 ? path.capacity() + 1 : 0);
+    }
+    for (const auto& f : files_) {
+      bytes += sizeof(File) + (f.path.capacity() > 15 ? f.path.capacity() + 1 : 0) + f.line_offsets.capacity() * sizeof(uint64_t);
+      if (f.content) {
+        bytes += f.content->capacity();
+      }
+    }
+    return bytes;
+  }
+
   // Drops own entries and files (parsed or still load_lazy-deferred); keeps
   // the base pointer.
   void clear() noexcept {
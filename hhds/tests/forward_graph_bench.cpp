@@ -1,6 +1,8 @@
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
 #include <memory>
+#include <random>
 #include <utility>
 #include <vector>
 
@@ -78,6 +80,37 @@ std::shared_ptr<hhds::Graph> build_hier(hhds::GraphLibrary& lib, int k_outer, in
   return top;
 }
 
+// Layered DAG: `layers` rows of `width` nodes, each node fed by `fanin`
+// random nodes of the row above. Node storage order is shuffled so the
+// topological order is not just storage order.
+std::shared_ptr<hhds::Graph> build_layered(hhds::GraphLibrary& lib, int layers, int width, int fanin,
+                                           std::vector<std::vector<hhds::Node>>& rows) {
+  auto graph = lib.create_io("eco")->create_graph();
+  std::mt19937 rng(7);
+
+  std::vector<std::pair<int, int>> slots;
+  for (int l = 0; l < layers; ++l) {
+    for (int w = 0; w < width; ++w) {
+      slots.emplace_back(l, w);
+    }
+  }
+  std::shuffle(slots.begin(), slots.end(), rng);
+  rows.assign(static_cast<size_t>(layers), std::vector<hhds::Node>(static_cast<size_t>(width)));
+  for (auto [l, w] : slots) {
+    rows[l][w] = graph->create_node();
+  }
+  for (int l = 1; l < layers; ++l) {
+    for (int w = 0; w < width; ++w) {
+      auto sink = rows[l][w];
+      for (int k = 0; k < fanin; ++k) {
+        auto& driver = rows[l - 1][rng() % width];
+        driver.create_driver_pin(k + 1).connect_sink(sink.create_sink_pin(k + 1));
+      }
+    }
+  }
+  return graph;
+}
+
 template <typename Span>
 void drain(Span&& span) {
   int cnt = 0;
@@ -161,6 +194,41 @@ FWD_CHAIN_BENCH(chain_1k_loop, 1000, true)
 FWD_HIER_BENCH(hier_100x100_straight, 100, 100, false)
 FWD_HIER_BENCH(hier_100x100_loop, 100, 100, true)
 
+// ECO loop: one small edit (a new node spliced between two random layers,
+// then deleted again) followed by an ordered query, repeated on a warm graph.
+// The maintained order absorbs the edit; the _rebuild variant toggles a
+// node's loop_break bit each round, which drops the caches and pays the full
+// O(V+E) dry run again -- the cost every edit had before.
+void bench_eco_edit_query(benchmark::State& state, bool rebuild) {
+  hhds::GraphLibrary                   lib;
+  std::vector<std::vector<hhds::Node>> rows;
+  const int                            layers = static_cast<int>(state.range(0));
+  constexpr int                        kWidth = 100;
+  auto                                 g      = build_layered(lib, layers, kWidth, 2, rows);
+  drain(g->body().nodes(hhds::Node_order::forward));
+
+  std::mt19937 rng(11);
+  auto         probe = rows[0][0];
+  for (auto _ : state) {
+    const int lo = static_cast<int>(rng() % static_cast<unsigned>(layers - 1));
+    const int hi = lo + 1 + static_cast<int>(rng() % static_cast<unsigned>(layers - 1 - lo));
+    auto      m  = g->create_node();
+    rows[lo][rng() % kWidth].create_driver_pin(100).connect_sink(m.create_sink_pin(1));
+    m.create_driver_pin(1).connect_sink(rows[hi][rng() % kWidth].create_sink_pin(100));
+    if (rebuild) {
+      probe.set_type(1);
+      probe.set_type(0);
+    }
+    drain(g->body().nodes(hhds::Node_order::forward));
+    m.del_node();
+  }
+}
+
+void bench_eco_edit_query_maintained(benchmark::State& state) { bench_eco_edit_query(state, false); }
+void bench_eco_edit_query_rebuild(benchmark::State& state) { bench_eco_edit_query(state, true); }
+BENCHMARK(bench_eco_edit_query_maintained)->Arg(100)->Arg(1000);
+BENCHMARK(bench_eco_edit_query_rebuild)->Arg(100)->Arg(1000);
+
 }  // namespace
 
 BENCHMARK_MAIN();
@@ -3,12 +3,19 @@
 // Concurrent GraphLibrary registry stress test. Mirrors forest_concurrency.cpp:
 // only the registry is required to be thread-safe (create_io / find_io /
 // create_graph / delete on different IOs). Build with --config=tsan to catch
-// races; under a normal build it just exercises the lock paths.
+// races; under a normal build it just exercises the lock paths. The last
+// tests cover read-only walks: Body_view::parallel_for_each, many threads
+// racing to build one body's lazy traversal caches, the hierarchical
+// parallel_for_each of the occurrence views, and parallel cone levels.
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <atomic>
+#include <filesystem>
+#include <mutex>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -151,3 +158,428 @@ TEST(GraphConcurrency, ParallelCreateAndDeleteDistinctSlots) {
     th.join();
   }
 }
+
+// Body_view::parallel_for_each: every node of the sequential forward order is
+// visited exactly once, and each combinational driver finishes before its
+// combinational sinks start.
+TEST(GraphConcurrency, ParallelForwardWalkHonoursDependencies) {
+  hhds::GraphLibrary lib;
+  auto               g = lib.create_io("dag")->create_graph();
+
+  constexpr int           kNodes = 3000;
+  std::mt19937            rng(7);
+  std::vector<hhds::Node> n;
+  for (int i = 0; i < kNodes; ++i) {
+    n.push_back(g->create_node());
+    if (i % 97 == 5) {
+      n.back().set_type(3);  // loop_break
+    }
+  }
+  std::vector<std::pair<int, int>> dag_edges;
+  for (int i = 1; i < kNodes; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      // Mostly forward edges; loop_breaks also feed back to earlier nodes.
+      const int  d    = static_cast<int>(rng() % static_cast<unsigned>(i));
+      const bool back = n[i].is_loop_break() && k == 0;
+      const int  from = back ? i : d;
+      const int  to   = back ? d : i;
+      n[from].create_driver_pin(k).connect_sink(n[to].create_sink_pin(k + 1));
+      dag_edges.emplace_back(from, to);
+    }
+  }
+  // A combinational cycle and a node behind it: the Tail case.
+  auto c0 = g->create_node();
+  auto c1 = g->create_node();
+  auto c2 = g->create_node();
+  c0.create_driver_pin(0).connect_sink(c1.create_sink_pin(0));
+  c1.create_driver_pin(0).connect_sink(c0.create_sink_pin(0));
+  c1.create_driver_pin(1).connect_sink(c2.create_sink_pin(1));
+
+  std::vector<hhds::Nid> sequential;
+  for (auto node : g->body().nodes(hhds::Node_order::forward)) {
+    sequential.push_back(node.get_debug_nid());
+  }
+
+  std::vector<std::atomic<uint32_t>> finished(kNodes + 16);  // by node slot (nid >> 2)
+  std::atomic<uint32_t>              clock{0};
+  std::atomic<uint32_t>              executor_calls{0};
+  hhds::Parallel_options             opts;
+  opts.threads  = kThreads;
+  opts.executor = [&executor_calls](unsigned workers, hhds::function_ref<void(unsigned)> body) {
+    executor_calls.fetch_add(1);
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w) {
+      threads.emplace_back([body, w] { body(w); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  };
+  std::atomic<bool> ordered{true};
+  std::vector<std::vector<int>> drivers_of(kNodes);
+  for (const auto& [from, to] : dag_edges) {
+    drivers_of[to].push_back(from);
+  }
+  std::vector<int> index_of(finished.size(), -1);
+  for (int i = 0; i < kNodes; ++i) {
+    index_of[n[i].get_debug_nid() >> 2] = i;
+  }
+  auto check = [&](hhds::Node node) {
+    const auto slot = node.get_debug_nid() >> 2;
+    if (const int i = index_of[slot]; i >= 0 && !n[i].is_loop_break()) {  // a loop_break's inputs are cut
+      for (const int d : drivers_of[i]) {
+        if (!n[d].is_loop_break() && finished[n[d].get_debug_nid() >> 2].load() == 0) {
+          ordered.store(false);
+        }
+      }
+    }
+    EXPECT_EQ(finished[slot].exchange(clock.fetch_add(1) + 1), 0u) << "visited twice";
+  };
+  g->body().parallel_for_each(hhds::Node_order::forward, check, opts);
+  EXPECT_TRUE(ordered.load());
+  EXPECT_EQ(executor_calls.load(), 1u);
+  EXPECT_EQ(clock.load(), sequential.size());
+  for (const auto nid : sequential) {
+    EXPECT_NE(finished[nid >> 2].load(), 0u) << nid;
+  }
+
+  // Cut placement: last replays loop_breaks after everything else; omit
+  // drops them.
+  std::vector<hhds::Nid> last_order;
+  std::mutex             mu;
+  opts.cuts = hhds::Cut_placement::last;
+  opts.executor = nullptr;
+  auto record = [&](hhds::Node node) {
+    std::lock_guard lock(mu);
+    last_order.push_back(node.get_debug_nid());
+  };
+  g->body().parallel_for_each(hhds::Node_order::forward, record, opts);
+  ASSERT_EQ(last_order.size(), sequential.size());
+  const auto first_break = std::find_if(last_order.begin(), last_order.end(),
+                                        [&g](hhds::Nid nid) { return g->get_node(hhds::Class_index{nid}).is_loop_break(); });
+  EXPECT_TRUE(std::all_of(first_break, last_order.end(),
+                          [&g](hhds::Nid nid) { return g->get_node(hhds::Class_index{nid}).is_loop_break(); }));
+
+  std::atomic<size_t> omitted{0};
+  opts.cuts = hhds::Cut_placement::omit;
+  auto count = [&](hhds::Node node) {
+    EXPECT_FALSE(node.is_loop_break());
+    omitted.fetch_add(1);
+  };
+  g->body().parallel_for_each(hhds::Node_order::forward, count, opts);
+  EXPECT_EQ(omitted.load(), g->body().nodes(hhds::Node_order::forward, hhds::Cut_placement::omit).size());
+
+  // An exception from fn stops the walk and reaches the caller.
+  opts.cuts = hhds::Cut_placement::first;
+  auto stop = [](hhds::Node) { throw std::runtime_error("stop"); };
+  EXPECT_THROW(g->body().parallel_for_each(hhds::Node_order::forward, stop, opts), std::runtime_error);
+}
+
+// Readers share one freshly loaded body: the first ordered walks race to
+// materialize the deferred overflow sets and the forward / backward / level
+// caches. Every reader must see the same complete result as a walk made after
+// the race (TSAN flags any unsynchronized build).
+TEST(GraphConcurrency, ConcurrentOrderedTraversalsShareLazyCaches) {
+  const auto dir = std::filesystem::temp_directory_path() / "hhds_graph_concurrency_lazy";
+  std::filesystem::remove_all(dir);
+  {
+    hhds::GraphLibrary lib;
+    std::mt19937       rng(11);
+    for (const bool cyclic : {false, true}) {
+      auto                    g = lib.create_io(cyclic ? "cyc" : "dag")->create_graph();
+      std::vector<hhds::Node> n;
+      for (int i = 0; i < 2000; ++i) {
+        n.push_back(g->create_node());
+      }
+      for (int i = 1; i < 2000; ++i) {
+        for (int k = 0; k < 2; ++k) {
+          n[rng() % static_cast<unsigned>(i)].create_driver_pin(k).connect_sink(n[i].create_sink_pin(k));
+        }
+      }
+      auto hub = n[0].create_driver_pin(7);  // wide fan-out: lands in the overflow sets
+      for (int i = 1; i < 2000; i += 9) {
+        hub.connect_sink(n[i].create_sink_pin(9));
+      }
+      if (cyclic) {
+        n[1999].create_driver_pin(5).connect_sink(n[1000].create_sink_pin(5));
+      }
+    }
+    lib.save(dir.string());
+  }
+
+  hhds::GraphLibrary lib;
+  lib.load(dir.string());
+  for (const auto* name : {"dag", "cyc"}) {
+    auto g = lib.find_io(name)->get_graph();
+    ASSERT_NE(g, nullptr);
+    EXPECT_TRUE(g->memory_stats().overflow_deferred) << name;
+
+    struct Seen {
+      std::vector<hhds::Nid> forward, reverse, leveled;
+      size_t                 size = 0;
+    };
+    auto walk = [&g](Seen& s) {
+      hhds::Traversal_scratch scratch;
+      for (auto node : g->body().nodes(hhds::Node_order::forward, scratch)) {
+        s.forward.push_back(node.get_debug_nid());
+      }
+      for (auto node : g->body().nodes(hhds::Node_order::reverse)) {
+        s.reverse.push_back(node.get_debug_nid());
+      }
+      for (auto level : g->body().levels()) {
+        s.leveled.insert(s.leveled.end(), level.begin(), level.end());
+      }
+      s.size = g->body().nodes(hhds::Node_order::forward).size();
+    };
+
+    std::vector<Seen>        seen(kThreads);
+    std::atomic<int>         ready{0};
+    std::atomic<bool>        go{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        ready.fetch_add(1, std::memory_order_acq_rel);
+        while (!go.load(std::memory_order_acquire)) {
+        }
+        walk(seen[t]);
+      });
+    }
+    while (ready.load(std::memory_order_acquire) < kThreads) {
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) {
+      th.join();
+    }
+
+    EXPECT_FALSE(g->memory_stats().overflow_deferred) << name;
+    Seen expected;
+    walk(expected);
+    EXPECT_EQ(expected.forward.size(), 2000u) << name;
+    EXPECT_EQ(expected.size, 2000u) << name;
+    for (const auto& s : seen) {
+      EXPECT_EQ(s.forward, expected.forward) << name;
+      EXPECT_EQ(s.reverse, expected.reverse) << name;
+      EXPECT_EQ(s.leveled, expected.leveled) << name;
+      EXPECT_EQ(s.size, expected.size) << name;
+    }
+  }
+  std::filesystem::remove_all(dir);
+}
+
+// Hierarchical parallel walk: per-task results joined in task order must
+// reproduce the sequential nodes() of both hierarchical views, and the policy
+// (a plain counter here, no locking of its own) is consulted serially.
+TEST(GraphConcurrency, ParallelHierarchyWalkMatchesSequential) {
+  hhds::GraphLibrary lib;
+  auto               leaf_io = lib.create_io("leaf");
+  auto               mid_io  = lib.create_io("mid");
+  auto               top_io  = lib.create_io("top");
+  {
+    auto leaf = leaf_io->create_graph();
+    for (int i = 0; i < 40; ++i) {
+      (void)leaf->create_node();
+    }
+    auto mid = mid_io->create_graph();
+    for (int i = 0; i < 30; ++i) {
+      (void)mid->create_node();
+      if (i % 3 == 0) {
+        mid->create_node().set_subnode(leaf_io);
+      }
+    }
+    mid->create_node().set_subnode(leaf_io, hhds::Subnode_loop{.first = 0, .step = 1, .count = 6});
+    auto top = top_io->create_graph();
+    for (int i = 0; i < 50; ++i) {
+      (void)top->create_node();
+      if (i % 5 == 0) {
+        top->create_node().set_subnode(mid_io);
+      }
+    }
+  }
+  auto top = top_io->get_graph();
+
+  hhds::Parallel_options opts;
+  opts.threads = kThreads;
+  auto check   = [&opts](const auto& view) {
+    std::vector<hhds::Occurrence_node> sequential;
+    for (const auto& node : view.nodes()) {
+      sequential.push_back(node);
+    }
+    std::vector<std::vector<hhds::Occurrence_node>> per_task;
+    auto                                            tasks = [&per_task](size_t n) { per_task.resize(n); };
+    auto visit = [&per_task](size_t t, const hhds::Occurrence_node& node) { per_task[t].push_back(node); };
+    view.parallel_for_each_task(tasks, visit, opts);
+    EXPECT_GT(per_task.size(), 1u);
+    std::vector<hhds::Occurrence_node> joined;
+    for (const auto& part : per_task) {
+      joined.insert(joined.end(), part.begin(), part.end());
+    }
+    EXPECT_EQ(joined, sequential);
+
+    std::atomic<size_t> visited{0};
+    auto                count = [&visited](const hhds::Occurrence_node&) { visited.fetch_add(1); };
+    view.parallel_for_each(count, opts);
+    EXPECT_EQ(visited.load(), sequential.size());
+  };
+  check(top->occurrences());
+  check(top->grouped_hierarchy());
+
+  size_t policy_calls = 0;
+  auto   policy       = [&](const hhds::Instance_site& site) {
+    ++policy_calls;
+    if (site.is_loop()) {
+      return hhds::Instance_action::prune;
+    }
+    return site.parent_path().steps().size() == 1 && (site.definition_index().value >> 2) % 2 == 0 ? hhds::Instance_action::opaque
+                                                                                          : hhds::Instance_action::descend;
+  };
+  check(top->occurrences(policy));
+  EXPECT_GT(policy_calls, 0u);
+
+  // An exception from fn stops the walk and reaches the caller.
+  auto stop = [](const hhds::Occurrence_node&) { throw std::runtime_error("stop"); };
+  EXPECT_THROW(top->occurrences().parallel_for_each(stop, opts), std::runtime_error);
+}
+
+TEST(GraphConcurrency, ParallelWalkNodesResolveEdgesAfterTheWalk) {
+  // A chain of leaf instances: each leaf's input edge resolves through its
+  // call site to the previous instance, which another worker may have
+  // walked. Nodes kept from the parallel walk must still resolve (and reach
+  // the policy) once the walk and its workers are gone.
+  hhds::GraphLibrary lib;
+  auto               leaf_io = lib.create_io("leaf");
+  leaf_io->add_input("a", 1);
+  leaf_io->add_output("y", 2);
+  auto top_io = lib.create_io("top");
+  {
+    auto leaf = leaf_io->create_graph();
+    auto cell = leaf->create_node();
+    leaf->get_input_pin("a").connect_sink(cell.create_sink_pin(1));
+    cell.create_driver_pin(2).connect_sink(leaf->get_output_pin("y"));
+    for (int i = 0; i < 20; ++i) {
+      (void)leaf->create_node();
+    }
+
+    auto             top = top_io->create_graph();
+    hhds::Node_class prev;
+    for (int i = 0; i < 32; ++i) {
+      auto inst = top->create_node();
+      inst.set_subnode(leaf_io);
+      if (prev.is_valid()) {
+        prev.create_driver_pin("y").connect_sink(inst.create_sink_pin("a"));
+      }
+      prev = inst;
+      for (int j = 0; j < 10; ++j) {
+        (void)top->create_node();
+      }
+    }
+  }
+  auto top = top_io->get_graph();
+
+  std::atomic<size_t> policy_calls{0};
+  auto                policy = [&policy_calls](const hhds::Instance_site&) {
+    policy_calls.fetch_add(1);
+    return hhds::Instance_action::descend;
+  };
+  const auto view = top->occurrences(policy);
+
+  std::vector<hhds::Occurrence_node> sequential;
+  for (const auto& node : view.nodes()) {
+    sequential.push_back(node);
+  }
+
+  hhds::Parallel_options opts;
+  opts.threads = kThreads;
+  std::vector<std::vector<hhds::Occurrence_node>> per_task;
+  auto                                            tasks = [&per_task](size_t n) { per_task.resize(n); };
+  auto visit = [&per_task](size_t t, const hhds::Occurrence_node& node) { per_task[t].push_back(node); };
+  view.parallel_for_each_task(tasks, visit, opts);
+  ASSERT_GT(per_task.size(), 1u);
+
+  const size_t                       walk_policy_calls = policy_calls.load();
+  std::vector<hhds::Occurrence_node> kept;
+  for (const auto& part : per_task) {
+    kept.insert(kept.end(), part.begin(), part.end());
+  }
+  ASSERT_EQ(kept.size(), sequential.size());
+  size_t crossing = 0;
+  for (size_t i = 0; i < kept.size(); ++i) {
+    ASSERT_EQ(kept[i], sequential[i]);
+    const auto got_inp_range = kept[i].inp_edges();
+    const std::vector<hhds::Occurrence_edge> got_inp(got_inp_range.begin(), got_inp_range.end());
+    const auto ref_inp_range = sequential[i].inp_edges();
+    const std::vector<hhds::Occurrence_edge> ref_inp(ref_inp_range.begin(), ref_inp_range.end());
+    ASSERT_EQ(got_inp.size(), ref_inp.size());
+    for (size_t e = 0; e < got_inp.size(); ++e) {
+      EXPECT_EQ(got_inp[e].driver, ref_inp[e].driver);
+      crossing += got_inp[e].driver.path() != kept[i].path() ? 1 : 0;
+    }
+    const auto got_out_range = kept[i].out_edges();
+    const std::vector<hhds::Occurrence_edge> got_out(got_out_range.begin(), got_out_range.end());
+    const auto ref_out_range = sequential[i].out_edges();
+    const std::vector<hhds::Occurrence_edge> ref_out(ref_out_range.begin(), ref_out_range.end());
+    ASSERT_EQ(got_out.size(), ref_out.size());
+    for (size_t e = 0; e < got_out.size(); ++e) {
+      EXPECT_EQ(got_out[e].sink, ref_out[e].sink);
+    }
+  }
+  EXPECT_GT(crossing, 0u);
+  // Some call sites were only ever decided by another worker's state.
+  EXPECT_GT(policy_calls.load(), walk_policy_calls);
+}
+
+TEST(GraphConcurrency, ParallelConeMatchesSequential) {
+  // Wide enough that both the top-down and the bottom-up levels fan out to
+  // workers (levels of 4096+ slots).
+  hhds::GraphLibrary lib;
+  auto               g = lib.create_io("cone")->create_graph();
+
+  constexpr int           kNodes = 20000;
+  std::mt19937            rng(11);
+  std::vector<hhds::Node> n;
+  for (int i = 0; i < kNodes; ++i) {
+    n.push_back(g->create_node());
+    if (i % 131 == 7) {
+      n.back().set_type(3);  // loop_break
+    }
+  }
+  for (int i = 1; i < kNodes; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      const int from = static_cast<int>(rng() % static_cast<unsigned>(kNodes));
+      n[from].create_driver_pin(k).connect_sink(n[i].create_sink_pin(k + 1));
+    }
+  }
+
+  std::vector<hhds::Node> seeds;
+  for (int i = 0; i < 64; ++i) {
+    seeds.push_back(n[rng() % kNodes]);
+  }
+  for (const auto direction : {hhds::Direction::forward, hhds::Direction::backward}) {
+    for (const bool through : {false, true}) {
+      hhds::Cone_options opts;
+      opts.direction           = direction;
+      opts.through_loop_breaks = through;
+      const auto sequential    = g->body().cone(seeds, opts);
+      opts.threads             = kThreads;
+      const auto parallel      = g->body().cone(seeds, opts);
+      EXPECT_GT(sequential.size(), 4096U);
+      EXPECT_EQ(parallel.size(), sequential.size());
+      EXPECT_TRUE(std::ranges::equal(parallel.bitmap(), sequential.bitmap()));
+
+      // The wide levels go through the caller's executor, not raw threads.
+      std::atomic<uint32_t> executor_calls{0};
+      opts.executor = [&executor_calls](unsigned workers, hhds::function_ref<void(unsigned)> body) {
+        executor_calls.fetch_add(1);
+        std::vector<std::thread> threads;
+        for (unsigned w = 0; w < workers; ++w) {
+          threads.emplace_back([body, w] { body(w); });
+        }
+        for (auto& t : threads) {
+          t.join();
+        }
+      };
+      const auto pooled = g->body().cone(seeds, opts);
+      EXPECT_GT(executor_calls.load(), 0u);
+      EXPECT_TRUE(std::ranges::equal(pooled.bitmap(), sequential.bitmap()));
+    }
+  }
+}
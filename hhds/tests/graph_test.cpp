@@ -12,9 +12,15 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <random>
+#include <set>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -525,6 +531,63 @@ void test_occurrence_storage_walk_streams_large_loop() {
   assert(collect_nids(top->body().nodes()).size() == 1);
 }
 
+void test_occurrence_refs_round_trip_through_the_view() {
+  static_assert(std::is_trivially_copyable_v<hhds::Occurrence_ref>);
+
+  hhds::GraphLibrary lib;
+  auto               body_io = lib.create_io("ref_body");
+  auto               body    = body_io->create_graph();
+  auto               leaf    = body->create_node();
+  leaf.create_sink_pin(0).connect_driver(leaf.create_driver_pin(0));
+
+  auto top  = lib.create_io("ref_top")->create_graph();
+  auto loop = top->create_node();
+  loop.set_subnode(body_io, hhds::Subnode_loop{.first = 0, .step = 1, .count = 3});
+  auto once = top->create_node();
+  once.set_subnode(body_io);
+
+  // Streaming and materialized ranges yield the same refs as their nodes,
+  // and every ref resolves back to an equal occurrence.
+  const auto view = top->occurrences();
+  for (const auto& range : {view.nodes(), view.nodes(hhds::Node_order::forward)}) {
+    std::vector<hhds::Occurrence_ref> refs(range.refs().begin(), range.refs().end());
+    assert(refs.size() == 8 && range.refs().size() == 8);
+    size_t i = 0;
+    for (const auto& node : range) {
+      assert(refs[i] == node.ref());
+      const auto back = view.resolve(refs[i]);
+      assert(back == node && back.get_hier_name() == node.get_hier_name());
+      assert(back.inp_edges().size() == node.inp_edges().size());
+      ++i;
+    }
+    std::unordered_set<hhds::Occurrence_ref> distinct(refs.begin(), refs.end());
+    assert(distinct.size() == refs.size() && "one ref per occurrence");
+  }
+
+  // The call site and its callee body sit in different containers.
+  const auto site = view.resolve(*view.nodes().refs().begin());
+  assert(site.get_definition_index() == loop.get_definition_index());
+  assert(site.ref().path != site.ref().container);
+
+  // Ids the view never interned fail cleanly in every build.
+  auto stale = site.ref();
+  stale.path = std::numeric_limits<uint32_t>::max();
+  bool rejected_stale = false;
+  try {
+    (void)view.resolve(stale);
+  } catch (const std::out_of_range&) {
+    rejected_stale = true;
+  }
+  assert(rejected_stale);
+  bool rejected_empty = false;
+  try {
+    (void)top->grouped_hierarchy().resolve(hhds::Occurrence_ref{});
+  } catch (const std::out_of_range&) {
+    rejected_empty = true;
+  }
+  assert(rejected_empty);
+}
+
 void test_zero_count_loop_bypasses_carries() {
   hhds::GraphLibrary lib;
   auto               body_io = lib.create_io("zero_body");
@@ -890,6 +953,105 @@ void test_out_edges_lazy_range() {
   }
 }
 
+void test_inp_edges_lazy_range() {
+  hhds::GraphLibrary lib;
+  auto               gio = lib.create_io("top");
+  auto               g   = gio->create_graph();
+
+  const auto contains = [](const std::vector<hhds::Pid>& v, hhds::Pid p) { return std::find(v.begin(), v.end(), p) != v.end(); };
+
+  // --- small fan-in on a port-0 sink pin: real-pin and node-as-pin drivers ---
+  {
+    auto snk = g->create_node().create_sink_pin();
+    auto d0  = g->create_node().create_driver_pin();   // node-as-pin driver
+    auto d3  = g->create_node().create_driver_pin(3);  // real-pin driver
+    snk.connect_driver(d0);
+    snk.connect_driver(d3);
+    auto ins = snk.inp_edges();
+    assert(!ins.empty());
+    assert(ins.size() == 2);
+    assert(ins.front().sink == snk);
+    std::vector<hhds::Pid> seen;
+    for (const auto& e : ins) {
+      assert(e.sink == snk);
+      assert(e.driver.is_driver());
+      seen.push_back(e.driver.get_debug_pid());
+    }
+    assert(seen.size() == 2);
+    assert(contains(seen, d0.get_debug_pid()));
+    assert(contains(seen, d3.get_debug_pid()));
+  }
+
+  // --- node-composite ordering: node-as-pin (port 0) edges, then pin-list ---
+  {
+    auto n  = g->create_node();
+    auto s0 = n.create_sink_pin();   // port 0 -> stored on the NodeEntry
+    auto s2 = n.create_sink_pin(2);  // named pin -> stored on its PinEntry
+    s0.connect_driver(g->create_node().create_driver_pin());
+    s2.connect_driver(g->create_node().create_driver_pin(1));
+    std::vector<hhds::Pid> sinks;
+    for (const auto& e : n.inp_edges()) {
+      sinks.push_back(e.sink.get_debug_pid());
+    }
+    assert(sinks.size() == 2);
+    assert(sinks[0] == s0.get_debug_pid());  // node-as-pin first
+    assert(sinks[1] == s2.get_debug_pid());  // pin-list second
+    // Out edges on the same entries are skipped, not reported as inputs.
+    n.create_driver_pin(4).connect_sink(g->create_node().create_sink_pin());
+    assert(n.inp_edges().size() == 2);
+    assert(s2.inp_edges().size() == 1);
+  }
+
+  // --- wide fan-in (forces the overflow set): lazy walk, early break, del ---
+  {
+    auto      snk = g->create_node().create_sink_pin(1);
+    const int kN  = 1000;
+    for (int i = 0; i < kN; ++i) {
+      snk.connect_driver(g->create_node().create_driver_pin(i % 2));
+    }
+    assert(snk.inp_edges().size() == static_cast<size_t>(kN));
+    assert(snk.get_master_node().inp_edges().size() == static_cast<size_t>(kN));
+    assert(snk.get_driver_pins().size() == static_cast<size_t>(kN));
+
+    int count = 0;
+    for (const auto& e : snk.inp_edges()) {
+      assert(e.sink == snk);
+      assert(e.driver.is_driver());
+      ++count;
+    }
+    assert(count == kN);
+
+    int seen = 0;
+    for (const auto& e : snk.inp_edges()) {
+      (void)e;
+      if (++seen == 5) {
+        break;
+      }
+    }
+    assert(seen == 5);
+
+    // del_sink snapshots first, then deletes — safe on a high-degree pin.
+    snk.del_sink();
+    assert(snk.inp_edges().empty());
+    assert(snk.get_master_node().inp_edges().size() == 0);
+  }
+
+  // --- empty range on an unconnected sink pin and node ---
+  {
+    auto n = g->create_node();
+    assert(n.create_sink_pin(1).inp_edges().empty());
+    assert(n.inp_edges().empty());
+    assert(n.inp_edges().begin() == n.inp_edges().end());
+    bool rejected_at = false;
+    try {
+      (void)n.inp_edges().at(0);
+    } catch (const std::out_of_range&) {
+      rejected_at = true;
+    }
+    assert(rejected_at);
+  }
+}
+
 void test_body_forward_returns_wrappers() {
   hhds::GraphLibrary lib;
   auto               gio   = lib.create_io("top");
@@ -1315,7 +1477,10 @@ void test_backward_cache_invalidates_after_edge_mutation() {
 
   n3.create_driver_pin().connect_sink(n1.create_sink_pin());
 
-  const std::vector<hhds::Nid> after_edge{n2.get_debug_nid(), n1.get_debug_nid(), n3.get_debug_nid()};
+  // The maintained order is repaired in place rather than rebuilt: only n1
+  // and n3 (the ranks the new edge spans) swap; a stale cache would still
+  // emit n3 before its sink n1.
+  const std::vector<hhds::Nid> after_edge{n1.get_debug_nid(), n2.get_debug_nid(), n3.get_debug_nid()};
   assert(collect_nids(graph->body().nodes(hhds::Node_order::reverse)) == after_edge);
 }
 
@@ -1346,6 +1511,124 @@ void test_backward_diamond_fan_in() {
   assert(collect_nids(graph->body().nodes(hhds::Node_order::reverse)) == expected);
 }
 
+void test_body_cone_stops_at_loop_breaks_and_pin_seeds() {
+  //   a.1 -> b -> reg(loop_break) -> c      a.2 -> d      IN -> a
+  hhds::GraphLibrary lib;
+  auto               gio = lib.create_io("top");
+  gio->add_input("in", 1);
+  auto graph = gio->create_graph();
+  auto a     = graph->create_node();
+  auto b     = graph->create_node();
+  auto reg   = graph->create_node();
+  auto c     = graph->create_node();
+  auto d     = graph->create_node();
+  reg.set_type(1);
+  graph->get_input_pin("in").connect_sink(a.create_sink_pin(0));
+  a.create_driver_pin(1).connect_sink(b.create_sink_pin(0));
+  a.create_driver_pin(2).connect_sink(d.create_sink_pin(0));
+  b.create_driver_pin(0).connect_sink(reg.create_sink_pin(0));
+  reg.create_driver_pin(0).connect_sink(c.create_sink_pin(0));
+
+  const auto nids = [](std::initializer_list<hhds::Node_class> nodes) {
+    std::vector<hhds::Nid> out;
+    for (const auto& node : nodes) {
+      out.push_back(node.get_debug_nid());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+  const hhds::Node_class seed_a[] = {a};
+  auto                   fan_out  = graph->body().cone(seed_a);
+  assert(fan_out.nids() == nids({a, b, reg, d}) && "the register is reached but not crossed");
+  assert(fan_out.size() == 4 && fan_out.contains(reg) && !fan_out.contains(c));
+
+  hhds::Cone_options through;
+  through.through_loop_breaks = true;
+  assert(graph->body().cone(seed_a, through).nids() == nids({a, b, reg, c, d}));
+
+  // A driver pin seed fans out through that pin only.
+  const hhds::Pin_class seed_pin[] = {a.get_driver_pin(1)};
+  assert(graph->body().cone(seed_pin).nids() == nids({a, b, reg}));
+
+  // Fanin: the graph input is not a member, and the register stops the walk.
+  hhds::Cone_options fan_in;
+  fan_in.direction                = hhds::Direction::backward;
+  const hhds::Node_class seed_c[] = {c};
+  assert(graph->body().cone(seed_c, fan_in).nids() == nids({c, reg}));
+  const hhds::Node_class seed_b[] = {b};
+  assert(graph->body().cone(seed_b, fan_in).nids() == nids({a, b}));
+  // A seeded register is expanded.
+  const hhds::Node_class seed_reg[] = {reg};
+  assert(graph->body().cone(seed_reg, fan_in).nids() == nids({a, b, reg}));
+}
+
+void test_body_cone_matches_reference_bfs() {
+  // A hub fanning out to most of the body pushes the BFS into its bottom-up
+  // levels; the result must not depend on which representation ran.
+  std::mt19937       rng(7);
+  hhds::GraphLibrary lib;
+  auto               graph = lib.create_io("top")->create_graph();
+  std::vector<hhds::Node_class> nodes;
+  for (int i = 0; i < 600; ++i) {
+    nodes.push_back(graph->create_node());
+    if (rng() % 40 == 0) {
+      nodes.back().set_type(1);
+    }
+  }
+  hhds::Port_id port = 1;
+  for (int i = 1; i < 500; ++i) {
+    nodes[0].create_driver_pin(port).connect_sink(nodes[i].create_sink_pin(port));
+    ++port;
+  }
+  for (int e = 0; e < 1500; ++e) {
+    const auto from = rng() % nodes.size();
+    const auto to   = rng() % nodes.size();
+    nodes[from].create_driver_pin(port).connect_sink(nodes[to].create_sink_pin(port));
+    ++port;
+  }
+
+  for (const auto direction : {hhds::Direction::forward, hhds::Direction::backward}) {
+    for (int trial = 0; trial < 8; ++trial) {
+      std::vector<hhds::Node_class> seeds;
+      for (int k = 0; k < 1 + trial; ++k) {
+        seeds.push_back(nodes[rng() % nodes.size()]);
+      }
+      seeds.push_back(nodes[0]);
+
+      std::set<hhds::Nid>           expected;
+      std::vector<hhds::Node_class> work;
+      for (const auto& seed : seeds) {
+        expected.insert(seed.get_debug_nid());
+        work.push_back(seed);
+      }
+      while (!work.empty()) {
+        const auto node = work.back();
+        work.pop_back();
+        const auto visit = [&](hhds::Node_class far) {
+          if (expected.insert(far.get_debug_nid()).second && !far.is_loop_break()) {
+            work.push_back(far);
+          }
+        };
+        if (direction == hhds::Direction::forward) {
+          for (const auto& edge : node.out_edges()) {
+            visit(edge.sink.get_master_node());
+          }
+        } else {
+          for (const auto& edge : node.inp_edges()) {
+            visit(edge.driver.get_master_node());
+          }
+        }
+      }
+
+      hhds::Cone_options opts;
+      opts.direction = direction;
+      const auto cone = graph->body().cone(seeds, opts);
+      assert(cone.nids() == std::vector<hhds::Nid>(expected.begin(), expected.end()));
+      assert(cone.size() == expected.size());
+    }
+  }
+}
+
 void test_backward_named_pin_and_declared_io_edges() {
   hhds::GraphLibrary lib;
   auto               gio = lib.create_io("top");
@@ -1438,6 +1721,41 @@ void test_traversal_caches_after_edge_delete() {
   assert(pos(bwd, n3.get_debug_nid()) < pos(bwd, n2.get_debug_nid()));
 }
 
+// Maintained order: an ECO-style splice (new node, new pins, an edge that
+// runs against the current order) is repaired in place; a cycle-closing edge
+// falls back to a rebuild, and deleting the node restores an acyclic body.
+void test_traversal_order_repaired_after_splice() {
+  hhds::GraphLibrary lib;
+  auto               gio   = lib.create_io("top");
+  auto               graph = gio->create_graph();
+
+  auto n1 = graph->create_node();
+  auto n2 = graph->create_node();
+  auto n3 = graph->create_node();
+  n1.create_driver_pin().connect_sink(n2.create_sink_pin());
+  n2.create_driver_pin().connect_sink(n3.create_sink_pin());
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::forward)).size() == 3);
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::reverse)).size() == 3);
+
+  // m -> n1: the new node is appended last, so the chain moves behind it.
+  auto m = graph->create_node();
+  m.create_driver_pin().connect_sink(n1.create_sink_pin(2));
+
+  const std::vector<hhds::Nid> fwd{m.get_debug_nid(), n1.get_debug_nid(), n2.get_debug_nid(), n3.get_debug_nid()};
+  const std::vector<hhds::Nid> bwd{n3.get_debug_nid(), n2.get_debug_nid(), n1.get_debug_nid(), m.get_debug_nid()};
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::forward)) == fwd);
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::reverse)) == bwd);
+
+  // n3 -> m now closes a cycle: the caches rebuild and the cycle surfaces as
+  // the Tail, still emitting every node once.
+  n3.create_driver_pin(2).connect_sink(m.create_sink_pin());
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::forward)).size() == 4);
+
+  m.del_node();
+  const std::vector<hhds::Nid> fwd_after{n1.get_debug_nid(), n2.get_debug_nid(), n3.get_debug_nid()};
+  assert(collect_nids(graph->body().nodes(hhds::Node_order::forward)) == fwd_after);
+}
+
 // Incremental cache patching: deleting a pin must decrement counts for every
 // edge connected to that pin.
 void test_traversal_caches_after_pin_delete() {
@@ -2857,6 +3175,151 @@ void test_grouped_hierarchy_ordering_preserves_node_set() {
   }
 }
 
+
+void test_grouped_spliced_order_streams_callee_bodies() {
+  // spliced_nodes() reuses each body's cached order and enters a callee body
+  // right after its call site (forward) or right before it (reverse), so the
+  // walk only keeps one frame per hierarchy level.
+  //
+  //   top:  src -> inst(mid).a ; inst.y -> dst ; treg ; rinst(regm)
+  //   mid:  a -> m1 -> m2 -> y
+  //   regm: r (r -> r), which also makes rinst a loop_break
+  hhds::GraphLibrary lib;
+  auto               mid_io = lib.create_io("mid");
+  mid_io->add_input("a", 1);
+  mid_io->add_output("y", 2);
+  auto mid = mid_io->create_graph();
+  auto m2  = mid->create_node();  // created first: storage order != dependency order
+  auto m1  = mid->create_node();
+  mid->get_input_pin("a").connect_sink(m1.create_sink_pin(0));
+  m1.create_driver_pin(0).connect_sink(m2.create_sink_pin(0));
+  m2.create_driver_pin(0).connect_sink(mid->get_output_pin("y"));
+
+  auto regm_io = lib.create_io("regm");
+  auto regm    = regm_io->create_graph();
+  auto r       = regm->create_node();
+  r.set_type(1);
+  r.create_sink_pin(0).connect_driver(r.create_driver_pin(0));
+
+  auto top  = lib.create_io("top")->create_graph();
+  auto dst  = top->create_node();
+  auto inst = top->create_node();
+  inst.set_subnode(mid_io);
+  auto src  = top->create_node();
+  auto treg = top->create_node();
+  treg.set_type(1);
+  auto rinst = top->create_node();
+  rinst.set_subnode(regm_io);
+  src.create_driver_pin(0).connect_sink(inst.create_sink_pin("a"));
+  inst.create_driver_pin("y").connect_sink(dst.create_sink_pin(0));
+  assert(!inst.is_loop_break() && rinst.is_loop_break());
+
+  const auto top_gid = top->get_gid();
+  const auto mid_gid = mid->get_gid();
+  const auto is_cut  = [&](const std::pair<hhds::Gid, hhds::Nid>& s) {
+    const auto n = node_of(s.second);
+    return s.first == regm->get_gid()
+           || (s.first == top_gid && (n == node_of(treg.get_debug_nid()) || n == node_of(rinst.get_debug_nid())));
+  };
+  const auto sorted = [](std::vector<std::pair<hhds::Gid, hhds::Nid>> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+  };
+
+  const auto fwd = collect_gid_nids(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::forward));
+  assert(fwd.size() == 8);
+  assert(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::forward).size() == 8);
+  assert(sorted(fwd) == sorted(collect_gid_nids(top->grouped_hierarchy().nodes())) && "same node set as the storage walk");
+  const size_t f_src  = hier_pos_of(fwd, top_gid, src.get_debug_nid());
+  const size_t f_inst = hier_pos_of(fwd, top_gid, inst.get_debug_nid());
+  const size_t f_m1   = hier_pos_of(fwd, mid_gid, m1.get_debug_nid());
+  const size_t f_m2   = hier_pos_of(fwd, mid_gid, m2.get_debug_nid());
+  const size_t f_dst  = hier_pos_of(fwd, top_gid, dst.get_debug_nid());
+  assert(f_src < f_inst && f_inst < f_m1 && f_m1 < f_m2 && f_m2 < f_dst);
+
+  const auto   rev    = collect_gid_nids(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::reverse));
+  const size_t r_src  = hier_pos_of(rev, top_gid, src.get_debug_nid());
+  const size_t r_inst = hier_pos_of(rev, top_gid, inst.get_debug_nid());
+  const size_t r_m1   = hier_pos_of(rev, mid_gid, m1.get_debug_nid());
+  const size_t r_m2   = hier_pos_of(rev, mid_gid, m2.get_debug_nid());
+  const size_t r_dst  = hier_pos_of(rev, top_gid, dst.get_debug_nid());
+  assert(rev.size() == 8);
+  assert(r_dst < r_m2 && r_m2 < r_m1 && r_m1 < r_inst && r_inst < r_src);
+
+  // Cut placement: last moves the three cut nodes to the tail, omit drops them
+  // (the same set the materialized walk keeps), both replays them at the end.
+  const auto tail = collect_gid_nids(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::forward, hhds::Cut_placement::last));
+  assert(tail.size() == 8);
+  assert(std::all_of(tail.begin() + 5, tail.end(), is_cut));
+  const auto omit = collect_gid_nids(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::forward, hhds::Cut_placement::omit));
+  assert(omit.size() == 5 && std::none_of(omit.begin(), omit.end(), is_cut));
+  assert(sorted(omit) == sorted(collect_gid_nids(top->grouped_hierarchy().nodes(hhds::Node_order::forward, hhds::Cut_placement::omit))));
+  assert(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::forward, hhds::Cut_placement::omit).size() == 5);
+  const auto both = collect_gid_nids(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::reverse, hhds::Cut_placement::both));
+  assert(both.size() == 11 && std::all_of(both.begin() + 8, both.end(), is_cut));
+  assert(top->grouped_hierarchy().spliced_nodes(hhds::Node_order::reverse, hhds::Cut_placement::both).size() == 11);
+
+  // The occurrence view streams the same order.
+  assert(collect_gid_nids(top->occurrences().spliced_nodes(hhds::Node_order::forward)) == fwd);
+}
+
+void test_hier_cone_crosses_instance_boundaries() {
+  //   top:  src -> inst(mid).a ; inst.y -> dst ; other
+  //   mid:  a -> m1 -> m2 -> y
+  hhds::GraphLibrary lib;
+  auto               mid_io = lib.create_io("cone_mid");
+  mid_io->add_input("a", 1);
+  mid_io->add_output("y", 2);
+  auto mid = mid_io->create_graph();
+  auto m1  = mid->create_node();
+  auto m2  = mid->create_node();
+  mid->get_input_pin("a").connect_sink(m1.create_sink_pin(0));
+  m1.create_driver_pin(0).connect_sink(m2.create_sink_pin(0));
+  m2.create_driver_pin(0).connect_sink(mid->get_output_pin("y"));
+
+  auto top  = lib.create_io("cone_top")->create_graph();
+  auto src  = top->create_node();
+  auto inst = top->create_node();
+  inst.set_subnode(mid_io);
+  auto dst   = top->create_node();
+  auto other = top->create_node();
+  src.create_driver_pin(0).connect_sink(inst.create_sink_pin("a"));
+  inst.create_driver_pin("y").connect_sink(dst.create_sink_pin(0));
+
+  const auto view    = top->grouped_hierarchy();
+  const auto top_gid = top->get_gid();
+  const auto mid_gid = mid->get_gid();
+  const auto src_h   = view.lift(src);
+  const auto dst_h   = view.lift(dst);
+  const auto as_set  = [&](const hhds::Occurrence_cone& cone) {
+    std::vector<std::pair<hhds::Gid, hhds::Nid>> out;
+    for (const auto& ref : cone.refs()) {
+      const auto node = view.resolve(ref);
+      assert(cone.contains(node));
+      out.emplace_back(node.get_current_gid(), node_of(node.get_debug_nid()));
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+  };
+  std::vector<std::pair<hhds::Gid, hhds::Nid>> expected{
+      {top_gid, node_of(src.get_debug_nid())},
+      {top_gid, node_of(dst.get_debug_nid())},
+      {mid_gid, node_of(m1.get_debug_nid())},
+      {mid_gid, node_of(m2.get_debug_nid())},
+  };
+  std::sort(expected.begin(), expected.end());
+
+  const hhds::Occurrence_node fwd_seed[] = {src_h};
+  const auto                  fwd        = view.cone(fwd_seed);
+  assert(fwd.size() == 4 && as_set(fwd) == expected);
+  assert(!fwd.contains(view.lift(other)) && !fwd.contains(view.lift(inst)));
+
+  hhds::Cone_options fan_in;
+  fan_in.direction                       = hhds::Direction::backward;
+  const hhds::Occurrence_node bwd_seed[] = {dst_h};
+  assert(as_set(view.cone(bwd_seed, fan_in)) == expected);
+}
+
 }  // namespace
 
 int main() {
@@ -2867,12 +3330,14 @@ int main() {
   test_native_subnode_loop_persistence();
   test_native_subnode_loop_activation_bindings();
   test_occurrence_storage_walk_streams_large_loop();
+  test_occurrence_refs_round_trip_through_the_view();
   test_zero_count_loop_bypasses_carries();
   test_nested_loop_occurrence_identity_and_names();
   test_same_index_pin_to_node_port0_edge_survives();
   test_node_port0_self_loop_edge_survives();
   test_pin_get_driver_pins();
   test_out_edges_lazy_range();
+  test_inp_edges_lazy_range();
   test_body_forward_returns_wrappers();
   test_body_reverse_returns_wrappers();
   test_traversal_contexts_use_one_node_type();
@@ -2888,10 +3353,13 @@ int main() {
   test_backward_cache_invalidates_after_set_type();
   test_backward_cache_invalidates_after_edge_mutation();
   test_backward_diamond_fan_in();
+  test_body_cone_stops_at_loop_breaks_and_pin_seeds();
+  test_body_cone_matches_reference_bfs();
   test_backward_named_pin_and_declared_io_edges();
   test_backward_skips_tombstones_after_delete();
   test_backward_cycle_tail_without_loop_break();
   test_traversal_caches_after_edge_delete();
+  test_traversal_order_repaired_after_splice();
   test_traversal_caches_after_pin_delete();
   test_traversal_caches_after_back_edge_add();
   test_reverse_definitions_are_caller_first_and_deduplicated();
@@ -2940,6 +3408,8 @@ int main() {
   test_grouped_forward_comb_and_flop_outputs_of_stateful_sub();
   test_grouped_forward_stateful_sub_cut_placement();
   test_grouped_reverse_comb_and_flop_outputs_of_stateful_sub();
+  test_grouped_spliced_order_streams_callee_bodies();
+  test_hier_cone_crosses_instance_boundaries();
   std::cout << "graph_test passed\n";
   return 0;
 }
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <span>
 #include <vector>
 
 #include "hhds/graph.hpp"
@@ -98,6 +99,134 @@ TEST(GraphTraversalApi, BackwardClassUsesNodeWrappers) {
   EXPECT_EQ(order[2], n1.get_debug_nid());
 }
 
+TEST(GraphTraversalApi, LevelsBucketByLongestPath) {
+  hhds::GraphLibrary lib;
+  auto               graph = lib.create_io("top")->create_graph();
+
+  // a -> b -> d, a -> d, c -> d; f is a loop_break fed by d and driving e;
+  // x <-> y is a combinational cycle driving z.
+  auto a = graph->create_node();
+  auto b = graph->create_node();
+  auto c = graph->create_node();
+  auto d = graph->create_node();
+  auto e = graph->create_node();
+  auto f = graph->create_node();
+  auto x = graph->create_node();
+  auto y = graph->create_node();
+  auto z = graph->create_node();
+  f.set_type(3);
+  a.create_driver_pin(1).connect_sink(b.create_sink_pin(1));
+  b.create_driver_pin(1).connect_sink(d.create_sink_pin(1));
+  a.create_driver_pin(1).connect_sink(d.create_sink_pin(2));
+  c.create_driver_pin(1).connect_sink(d.create_sink_pin(3));
+  d.create_driver_pin(1).connect_sink(f.create_sink_pin(1));
+  f.create_driver_pin(1).connect_sink(e.create_sink_pin(1));
+  x.create_driver_pin(1).connect_sink(y.create_sink_pin(1));
+  y.create_driver_pin(1).connect_sink(x.create_sink_pin(1));
+  y.create_driver_pin(2).connect_sink(z.create_sink_pin(1));
+
+  auto nids = [](std::span<const hhds::Nid> s) { return std::vector<hhds::Nid>(s.begin(), s.end()); };
+  auto view = graph->body().levels();
+  ASSERT_EQ(view.size(), 3u);
+  EXPECT_EQ(nids(view[0]),
+            (std::vector<hhds::Nid>{a.get_debug_nid(), c.get_debug_nid(), e.get_debug_nid(), f.get_debug_nid()}));
+  EXPECT_EQ(nids(view[1]), (std::vector<hhds::Nid>{b.get_debug_nid()}));
+  EXPECT_EQ(nids(view[2]), (std::vector<hhds::Nid>{d.get_debug_nid()}));
+  EXPECT_EQ(nids(view.unleveled()), (std::vector<hhds::Nid>{x.get_debug_nid(), y.get_debug_nid(), z.get_debug_nid()}));
+  EXPECT_EQ(view.level_of(d), 2u);
+  EXPECT_EQ(view.level_of(z), hhds::Level_view::kNoLevel);
+
+  // Patched in place vs. a full rebuild (a loop_break toggle drops every cache).
+  auto snapshot = [&] {
+    std::vector<std::vector<hhds::Nid>> out;
+    for (auto level : graph->body().levels()) {
+      out.push_back(nids(level));
+    }
+    out.push_back(nids(graph->body().levels().unleveled()));
+    return out;
+  };
+  auto rebuilt = [&] {
+    const auto type = a.get_type();
+    a.set_type(static_cast<hhds::Type>(type ^ 1U));
+    a.set_type(type);
+    return snapshot();
+  };
+
+  d.create_driver_pin(2).connect_sink(e.create_sink_pin(2));  // deepens e to 3
+  EXPECT_EQ(graph->body().levels().level_of(e), 3u);
+  EXPECT_EQ(graph->body().levels().size(), 4u);
+  auto patched = snapshot();
+  EXPECT_EQ(patched, rebuilt());
+
+  c.create_driver_pin(2).connect_sink(b.create_sink_pin(2));  // no change
+  patched = snapshot();
+  EXPECT_EQ(patched, rebuilt());
+
+  b.get_driver_pin(1).out_edges().front().del_edge();  // d drops to 1, e to 2
+  patched = snapshot();
+  EXPECT_EQ(patched, rebuilt());
+  EXPECT_EQ(graph->body().levels().level_of(e), 2u);
+
+  e.create_driver_pin(3).connect_sink(a.create_sink_pin(3));  // closes a -> d -> e -> a
+  patched = snapshot();
+  EXPECT_EQ(patched, rebuilt());
+  EXPECT_EQ(graph->body().levels().level_of(a), hhds::Level_view::kNoLevel);
+}
+
+TEST(GraphTraversalApi, ScratchReuseAndConstantSize) {
+  hhds::GraphLibrary lib;
+  auto               graph = lib.create_io("top")->create_graph();
+
+  // a -> b <-> c (combinational cycle, so walks use the scratch), f is a
+  // loop_break fed by c.
+  auto a = graph->create_node();
+  auto b = graph->create_node();
+  auto c = graph->create_node();
+  auto f = graph->create_node();
+  f.set_type(3);
+  a.create_driver_pin(1).connect_sink(b.create_sink_pin(1));
+  b.create_driver_pin(1).connect_sink(c.create_sink_pin(1));
+  c.create_driver_pin(1).connect_sink(b.create_sink_pin(2));
+  c.create_driver_pin(2).connect_sink(f.create_sink_pin(1));
+
+  auto collect = [](auto&& range) {
+    std::vector<hhds::Nid> out;
+    for (auto node : range) {
+      out.push_back(node.get_debug_nid());
+    }
+    return out;
+  };
+
+  hhds::Traversal_scratch scratch;
+  EXPECT_EQ(scratch.capacity_bytes(), 0u);
+  for (auto cuts : {hhds::Cut_placement::first, hhds::Cut_placement::last, hhds::Cut_placement::both,
+                    hhds::Cut_placement::omit}) {
+    const auto fwd = collect(graph->body().nodes(hhds::Node_order::forward, cuts));
+    const auto bwd = collect(graph->body().nodes(hhds::Node_order::reverse, cuts));
+    EXPECT_EQ(collect(graph->body().nodes(hhds::Node_order::forward, scratch, cuts)), fwd);
+    EXPECT_EQ(collect(graph->body().nodes(hhds::Node_order::reverse, scratch, cuts)), bwd);
+    EXPECT_EQ(graph->body().nodes(hhds::Node_order::forward, cuts).size(), fwd.size());
+    EXPECT_EQ(graph->body().nodes(hhds::Node_order::reverse, cuts).size(), bwd.size());
+  }
+  // The buffers come back after each walk and are lent out during one.
+  const size_t held = scratch.capacity_bytes();
+  EXPECT_GT(held, 0u);
+  {
+    auto range = graph->body().nodes(hhds::Node_order::forward, scratch);
+    [[maybe_unused]] auto it = range.begin();
+    EXPECT_EQ(scratch.capacity_bytes(), 0u);
+  }
+  EXPECT_EQ(scratch.capacity_bytes(), held);
+
+  // size() follows creation and deletion without a walk.
+  auto d = graph->create_node();
+  EXPECT_EQ(graph->body().nodes(hhds::Node_order::forward).size(), 5u);
+  d.del_node();
+  f.del_node();
+  EXPECT_EQ(graph->body().nodes(hhds::Node_order::forward, hhds::Cut_placement::both).size(), 3u);
+  EXPECT_FALSE(graph->body().nodes(hhds::Node_order::reverse).empty());
+}
+
 TEST(TreeDeclarationApi, CreateFindAndNavigate) {
   auto forest = hhds::Forest::create();
   auto tio    = forest->create_io("tree");
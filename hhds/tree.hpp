@@ -668,6 +668,17 @@ public:
 
   [[nodiscard]] bool is_dirty() const noexcept { return dirty_; }
 
+  // Approximate heap bytes: node chunks, validity bitmap, subnode refs and
+  // attribute stores.
+  [[nodiscard]] uint64_t memory_bytes() const {
+    uint64_t bytes = pointers_stack.capacity() * sizeof(Tree_pointers) + validity_stack.capacity() * sizeof(std::bitset<64>)
+                     + subnode_refs.capacity() * sizeof(Tree_pos);
+    for (const auto& store : attr_store_stats()) {
+      bytes += store.bytes;
+    }
+    return bytes;
+  }
+
 private:
   // Raw-Tree_pos navigation / mutation primitives. These are the
   // implementation backbone; every public entry point converts between